@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+import shutil
+import tempfile
+import subprocess
+
+# loops that go out of bounds have to abort, and say which index was bad -- the first one the loop would have
+# used, even when the check was hoisted out in front of it. (the in-range loops are in tests/boundschecks.flx.)
+# run from the root of the repo, like speed-test.py.
+
+if os.name == "nt":
+	flaxc_path = "build/meson-rel/flaxc.exe"
+else:
+	flaxc_path = "build/sysroot/usr/local/bin/flaxc"
+
+# the error is printf-ed right before abort(), so it's lost if stdout isn't flushed.
+unbuffered = ([ "stdbuf", "-o0" ] if shutil.which("stdbuf") else [ ])
+
+helpers = """
+fn sumUp(xs: [int:], n: int) -> int
+{
+	var s = 0
+	for i in 0 ..< n { s += xs[i] }
+	return s
+}
+
+fn sumDown(xs: [int:], lo: int) -> int
+{
+	var s = 0
+	for i in 3 ... lo { s += xs[i] }
+	return s
+}
+
+fn sumWhile(xs: [int:], n: int) -> int
+{
+	var s = 0
+	var i = 0
+	while i < n
+	{
+		s += xs[i]
+		i += 1
+	}
+	return s
+}
+"""
+
+# (what it does, the body of main, the index that should be reported)
+cases = [
+	("range past a fixed array", "var a: [int: 5] = [ 1, 2, 3, 4, 5 ]\n\tvar s = 0\n\tfor i in 0 ..< 10 { s += a[i] }", 5),
+	("range past the end", "sumUp(xs, 9)", 6),
+	("range past the start", "sumDown(xs, -2)", -1),
+	("while past the end", "sumWhile(xs, 9)", 6),
+]
+
+failed = 0
+with tempfile.TemporaryDirectory() as tmp:
+	for (name, body, index) in cases:
+		path = os.path.join(tmp, "boundscheck.flx")
+		with open(path, "w") as f:
+			f.write("export boundscheck\nimport libc as _\n%s\n@entry fn main()\n{\n\tlet xs = [ 1, 2, 3, 4, 5, 6 ]\n\t%s\n\tprintf(\"no abort\\n\")\n}\n" % (helpers, body))
+
+		for opt in [ "-O0", "-O2" ]:
+			res = subprocess.run(unbuffered + [ flaxc_path, "-sysroot", "build/sysroot", opt, "--ffi-escape", "-backend", "interp", "-run", path ],
+				stdout = subprocess.PIPE, stderr = subprocess.STDOUT, text = True)
+
+			expected = "'%d'" % index
+			if res.returncode == 0 or "out of bounds" not in res.stdout or expected not in res.stdout:
+				print("FAIL: %s (%s): expected an abort at index %d, got exit code %d:\n%s" % (name, opt, index, res.returncode, res.stdout))
+				failed += 1
+			else:
+				print("ok: %s (%s)" % (name, opt))
+
+if failed > 0:
+	print("%d failed" % failed)
+	sys.exit(1)
@@ -67,10 +67,10 @@ def gen_test(reps):
 	{
 		struct Node
 		{
-			var data: T
+			data: T
 
-			var prev: &Node
-			var next: &Node
+			prev: &Node
+			next: &Node
 		}
 
 		var head: &Node
@@ -222,6 +222,71 @@ def gen_test(reps):
 
 
 
+# stresses type construction in the typechecker: every generic here gets instantiated
+# with deeply nested tuple/array/function types.
+def gen_generics(reps):
+	template = """
+	fn pair(?)<A, B>(a: A, b: B) -> (A, B) => (a, b)
+	fn apply(?)<T, U>(x: T, f: fn(T) -> U) -> U => f(x)
+	fn count(?)(x: [int]) -> int => x.length
+
+	fn nest(?)<T>(x: T) -> (((T, T), (T, T)), ((T, T), (T, T)))
+	{
+		let p = pair(?)(x, x)
+		let q = pair(?)(p, p)
+		return pair(?)(q, q)
+	}
+
+	fn collect(?)<T>(x: T, n: int) -> [T]
+	{
+		var ret: [T]
+
+		var i = 0
+		while i < n
+		{
+			ret.append(x)
+			i += 1
+		}
+
+		return ret
+	}
+
+	fn first(?)<T>(xs: [T:]) -> T => xs[0]
+
+	fn generics(?)()
+	{
+		let a = nest(?)(1)
+		let b = nest(?)(a)
+		let c = nest(?)((1.5, "x"))
+		let d = collect(?)(b, 3)
+		let e = pair(?)(d, collect(?)(c, 2))
+		let f = nest(?)(e)
+		let g = first(?)(f.0.0.0.0)
+		let h = nest(?)(b)
+		let k = apply(?)(collect(?)(1, 4), count(?))
+
+		printf("%d %d %d\\n", a.0.0.0 + h.0.0.0.0.0.0.0.0.0, d.length + e.1.length + k, g.0.0.0.0.0.0)
+	}
+	"""
+
+	outfile = open("build/massive_generics.flx", "wt")
+
+	outfile.write("export massive_generics\n")
+	outfile.write("import libc as _\n")
+
+	for i in range(reps):
+		outfile.write(template.replace("(?)", str(i)) + "\n")
+
+	outfile.write("@entry fn main() -> i32 {\n")
+	for i in range(reps):
+		outfile.write("\tgenerics(?)()\n".replace("(?)", str(i)))
+
+	outfile.write("\treturn 0\n}\n")
+
+	outfile.close()
+
+
+
 
 if __name__ == '__main__':
     globals()[sys.argv[1]](int(sys.argv[2]))
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+
+import re
+import os
+import sys
+import statistics
+import subprocess
+
+# instructions per second in the interpreter, on the loop-heavy tests (forloops.flx and fizzbuzz.flx, run a few
+# times over) and interpbench.flx; run from the root of the repo, like speed-test.py.
+# usage: build/interp-bench.py [repeats] [runs]
+
+repeats = int(sys.argv[1]) if len(sys.argv) > 1 else 50
+runs = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+
+if os.name == "nt":
+	flaxc_path = "build/meson-rel/flaxc.exe"
+else:
+	flaxc_path = "build/sysroot/usr/local/bin/flaxc"
+
+# the tests don't have an entry point, so wrap them in one.
+def make_driver(name, module, call):
+	path = "build/interp-%s.flx" % name
+	with open(path, "w") as f:
+		f.write("export interp_%s\n\nimport \"tests/%s.flx\"\n\n" % (name, name))
+		f.write("@entry fn main()\n{\n\tvar i = 0\n\twhile i < %d\n\t{\n\t\t%s::%s\n\t\ti += 1\n\t}\n}\n" % (repeats, module, call))
+
+	return path
+
+programs = [
+	("forloops", make_driver("forloops", "test_forloops", "doForLoopTest()")),
+	("fizzbuzz", make_driver("fizzbuzz", "test_fizz", "doFizzBuzz(100)")),
+	("interpbench", "build/interpbench.flx"),
+]
+
+rex = re.compile(r"interp executed (\d+) instructions \((\d+\.\d+) M/s\)")
+
+for (name, path) in programs:
+	rates = []
+	count = 0
+	for i in range(0, runs):
+		# the program's output and the profile both go to stdout.
+		output = subprocess.run([ flaxc_path, "-sysroot", "build/sysroot", "--ffi-escape", "-backend", "interp", "-run", "-profile", path ],
+			stdout = subprocess.PIPE, stderr = subprocess.STDOUT, text = True).stdout
+
+		m = rex.search(output)
+		if m is None:
+			print("could not find the instruction count for %s; is -profile working?" % name)
+			sys.exit(1)
+
+		count = int(m.group(1))
+		rates.append(float(m.group(2)))
+
+	print("%-12s %10d instructions, median %.1f M/s, best %.1f M/s" % (name, count, statistics.median(rates), max(rates)))
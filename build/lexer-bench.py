@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+
+import re
+import os
+import sys
+import statistics
+import subprocess
+import generate_test
+
+# lexer throughput on the generated stress test; run from the root of the repo, like speed-test.py.
+# usage: build/lexer-bench.py [reps] [runs]
+
+reps = int(sys.argv[1]) if len(sys.argv) > 1 else 512
+runs = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+
+generate_test.gen_test(reps)
+if os.name == "nt":
+	flaxc_path = "build/meson-rel/flaxc.exe"
+else:
+	flaxc_path = "build/sysroot/usr/local/bin/flaxc"
+
+rex = re.compile(r"lexer: (\d+\.\d+) MB in (\d+\.\d+) ms \((\d+\.\d+) MB/s\)")
+
+speeds = []
+for i in range(0, runs):
+	# the profile goes to stderr.
+	output = subprocess.run([ flaxc_path, "-sysroot", "build/sysroot", "-run", "-backend", "none", "-profile", "build/massive.flx" ],
+		stdout = subprocess.PIPE, stderr = subprocess.STDOUT, text = True).stdout
+
+	m = rex.search(output)
+	if m is None:
+		print("could not find the lexer stats in the output; is -profile working?")
+		sys.exit(1)
+
+	print("run %d: %s MB in %s ms (%s MB/s)" % (i + 1, m.group(1), m.group(2), m.group(3)))
+	speeds.append(float(m.group(3)))
+
+print("median: %.1f MB/s, best: %.1f MB/s" % (statistics.median(speeds), max(speeds)))
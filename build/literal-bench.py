@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+
+import re
+import os
+import sys
+import random
+import statistics
+import subprocess
+
+# typecheck time for code that is mostly number literals; run from the root of the repo, like speed-test.py.
+# usage: build/literal-bench.py [functions] [runs]
+
+funcs = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+runs = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+
+if os.name == "nt":
+	flaxc_path = "build/meson-rel/flaxc.exe"
+else:
+	flaxc_path = "build/sysroot/usr/local/bin/flaxc"
+
+# the same every time, so runs can be compared.
+random.seed(1)
+
+def int_lit():
+	return random.choice([ "%d" % random.randint(0, 1000), "%d" % random.randint(0, 1 << 20), "0x%X" % random.randint(0, 1 << 24) ])
+
+def float_lit():
+	return "%d.%d" % (random.randint(0, 1000), random.randint(0, 99999))
+
+with open("build/literals.flx", "w") as f:
+	f.write("export literals\n\n")
+	for i in range(0, funcs):
+		f.write("fn lits_%d() -> f64\n{\n" % i)
+		f.write("\tlet a = %s\n" % " + ".join([ int_lit() for _ in range(0, 16) ]))
+		f.write("\tlet b = %s\n" % " * ".join([ float_lit() for _ in range(0, 16) ]))
+		f.write("\tlet c = [ %s ]\n" % ", ".join([ int_lit() for _ in range(0, 16) ]))
+		f.write("\tlet d: i64 = %d\n" % random.randint(1 << 32, 1 << 62))
+		f.write("\treturn b + (a as f64) + (c[%d] as f64) + (d as f64)\n}\n\n" % random.randint(0, 15))
+
+	f.write("@entry fn main() { }\n")
+
+rex = re.compile(r"typechk: (\d+\.\d+)")
+
+times = []
+for i in range(0, runs):
+	# the profile goes to stderr.
+	output = subprocess.run([ flaxc_path, "-sysroot", "build/sysroot", "-backend", "none", "-profile", "build/literals.flx" ],
+		stdout = subprocess.PIPE, stderr = subprocess.STDOUT, text = True).stdout
+
+	m = rex.search(output)
+	if m is None:
+		print("could not find the typecheck time in the output; is -profile working?")
+		sys.exit(1)
+
+	print("run %d: typecheck %s ms" % (i + 1, m.group(1)))
+	times.append(float(m.group(1)))
+
+print("median: %.1f ms, best: %.1f ms" % (statistics.median(times), min(times)))
@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+
+import re
+import os
+import sys
+import subprocess
+
+# time per line over a long scripted repl session; run from the root of the repo, like speed-test.py. if the repl
+# is working properly, the last lines shouldn't take any longer than the first ones.
+# usage: build/repl-bench.py [lines]
+
+lines = int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+
+if os.name == "nt":
+	flaxc_path = "build/meson-rel/flaxc.exe"
+else:
+	flaxc_path = "build/sysroot/usr/local/bin/flaxc"
+
+# a bit of everything: globals, functions, types, and expressions that use what came before.
+def gen_line(i):
+	k = i // 5
+	return [
+		"let val_%d = %d" % (k, k),
+		"fn fn_%d(a: int) -> int { return a + val_%d }" % (k, k),
+		"struct Point_%d { x: int; y: int }" % k,
+		"let pt_%d = Point_%d(x: fn_%d(1), y: val_%d)" % (k, k, k, max(k - 1, 0)),
+		"pt_%d.x + pt_%d.y + fn_%d(val_%d)" % (k, k, k, k // 2),
+	][i % 5]
+
+with open("build/repl-session.flx", "w") as f:
+	for i in range(0, lines):
+		f.write(gen_line(i) + "\n")
+
+	f.write(":q\n")
+
+with open("build/repl-session.flx", "r") as f:
+	output = subprocess.run([ flaxc_path, "-sysroot", "build/sysroot", "-repl", "-profile" ], stdin = f,
+		stdout = subprocess.DEVNULL, stderr = subprocess.PIPE, text = True).stderr
+
+m = re.search(r"repl: .*", output)
+if m is None:
+	print("could not find the repl stats in the output; is -profile working?")
+	sys.exit(1)
+
+print(m.group(0))
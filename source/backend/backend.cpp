@@ -18,6 +18,9 @@ namespace backend
 			case BackendOption::Interpreter:
 				return new FIRInterpBackend(cd, in, out);
 
+			case BackendOption::Tiered:
+				return new FIRTieredBackend(cd, in, out);
+
 			case BackendOption::Assembly_x64:
 				return new x64Backend(cd, in, out);
 
@@ -51,6 +51,7 @@ namespace backend
 	void FIRInterpBackend::performCompilation()
 	{
 		this->is = new InterpState(this->compiledData.module);
+		this->is->stats.countInstructions = frontend::getPrintProfileStats();
 		this->is->initialise(/* runGlobalInit:*/ true);
 
 		// it suffices to compile just the entry function.
@@ -80,6 +81,16 @@ namespace backend
 			this->is->runFunction(f, args);
 
 			_printTiming(ts, "interp");
+
+			if(frontend::getPrintProfileStats())
+			{
+				auto dur = std::chrono::high_resolution_clock::now() - ts;
+				auto secs = static_cast<double>(dur.count()) / 1000000000.0;
+				auto count = this->is->stats.instructionsExecuted;
+
+				printf("interp executed %zu instructions (%.1f M/s)\n", count, secs > 0 ? (count / secs) / 1000000.0 : 0.0);
+				printf("interp peak heap usage: %.1f kb\n", this->is->stats.peakHeapUsage / 1024.0);
+			}
 		}
 		else
 		{
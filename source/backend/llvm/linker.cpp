@@ -64,7 +64,11 @@
 #include "ir/module.h"
 #include "ir/irbuilder.h"
 
+#include "ir/block.h"
+#include "ir/function.h"
+
 #include "frontend.h"
+#include "parallel.h"
 #include "backends/llvm.h"
 
 #include "tinyprocesslib/tinyprocess.h"
@@ -72,6 +76,12 @@
 
 static llvm::LLVMContext globalContext;
 
+// translation of the other codegen units happens in their own contexts.
+static llvm::LLVMContext* currentContext = &globalContext;
+
+// below this many instructions (per unit), it's not worth splitting up codegen.
+#define INSTRUCTIONS_PER_CODEGEN_UNIT   25000
+
 template <typename T>
 static void _printTiming(T ts, const std::string& thing)
 {
@@ -87,7 +97,84 @@ namespace backend
 {
 	llvm::LLVMContext& LLVMBackend::getLLVMContext()
 	{
-		return globalContext;
+		return *currentContext;
+	}
+
+	bool CodegenUnit::isReplicated(fir::Function* fn)
+	{
+		// these are small, and they need to be in the same module as their callers to get inlined.
+		return fn->isAlwaysInlined() && fn->linkageType == fir::LinkageType::Internal;
+	}
+
+	static size_t countInstructions(fir::Function* fn)
+	{
+		size_t ret = 0;
+		for(auto b : fn->getBlockList())
+			ret += b->getInstructions().size();
+
+		return ret;
+	}
+
+	static size_t getNumCodegenUnits(fir::Module* mod)
+	{
+		// everything except a linked program wants exactly one module (or object file) out of us.
+		if(frontend::getOutputMode() != ProgOutputMode::Program)
+			return 1;
+
+		if(auto n = frontend::getParameter("codegen-units"); !n.empty())
+			return std::stoul(n);
+
+		size_t count = 0;
+		for(auto f : mod->getAllFunctions())
+			count += countInstructions(f);
+
+		auto threads = static_cast<size_t>(std::max(std::thread::hardware_concurrency(), 1U));
+		return std::clamp(count / INSTRUCTIONS_PER_CODEGEN_UNIT, static_cast<size_t>(1), threads);
+	}
+
+	static std::vector<CodegenUnit> partitionModule(fir::Module* mod, size_t count)
+	{
+		std::vector<std::pair<fir::Function*, size_t>> fns;
+		std::vector<fir::Function*> replicated;
+
+		for(auto f : mod->getAllFunctions())
+		{
+			if(f->getBlockList().empty())
+				continue;
+
+			if(CodegenUnit::isReplicated(f))
+				replicated.push_back(f);
+
+			else
+				fns.push_back({ f, countInstructions(f) });
+		}
+
+		count = std::max(static_cast<size_t>(1), std::min(count, fns.size()));
+
+		std::vector<CodegenUnit> units(count);
+		std::vector<size_t> sizes(count);
+
+		for(size_t i = 0; i < count; i++)
+		{
+			units[i].index = i;
+			units[i].functions.insert(replicated.begin(), replicated.end());
+		}
+
+		// biggest first, each going to whichever unit has the least so far. sort by id after that, so we get the
+		// same split every time.
+		std::sort(fns.begin(), fns.end(), [](const auto& a, const auto& b) -> bool {
+			return a.second != b.second ? a.second > b.second : a.first->id < b.first->id;
+		});
+
+		for(const auto& [ fn, size ] : fns)
+		{
+			auto k = static_cast<size_t>(std::min_element(sizes.begin(), sizes.end()) - sizes.begin());
+
+			units[k].functions.insert(fn);
+			sizes[k] += size;
+		}
+
+		return units;
 	}
 
 	LLVMBackend::LLVMBackend(CompiledData& dat, const std::vector<std::string>& inputs, const std::string& output)
@@ -106,25 +193,52 @@ namespace backend
 
 		llvm::InitializeNativeTarget();
 
-		auto mainModule = this->translateFIRtoLLVM(this->compiledData.module);
+		auto units = partitionModule(this->compiledData.module, getNumCodegenUnits(this->compiledData.module));
+		auto mainModule = this->translateFIRtoLLVM(this->compiledData.module, units.size() > 1 ? &units[0] : 0);
 
 		if(this->compiledData.module->getEntryFunction())
 			this->entryFunction = mainModule->getFunction(this->compiledData.module->getEntryFunction()->getName().mangled());
 
 		this->linkedModule = std::unique_ptr<llvm::Module>(mainModule);
 
+		// fir makes types on the fly, so reading it from more than one thread isn't safe -- the translation itself
+		// stays here, but since every unit has its own context, everything after this can be done in parallel.
+		for(size_t i = 1; i < units.size(); i++)
+		{
+			this->unitContexts.push_back(std::make_unique<llvm::LLVMContext>());
+			currentContext = this->unitContexts.back().get();
+
+			this->unitModules.push_back(std::unique_ptr<llvm::Module>(this->translateFIRtoLLVM(this->compiledData.module, &units[i])));
+		}
+
+		currentContext = &globalContext;
+
 		// ok, move some shit into here because llvm is fucking retarded
-		this->setupTargetMachine();
+		this->targetMachine = this->createTargetMachine();
 		this->linkedModule->setDataLayout(this->targetMachine->createDataLayout());
 
-		_printTiming(ts, "llvm translation");
-	}
+		// target machines can't be shared between threads either.
+		for(auto& mod : this->unitModules)
+		{
+			this->unitTargetMachines.push_back(this->createTargetMachine());
+			mod->setDataLayout(this->unitTargetMachines.back()->createDataLayout());
+		}
 
+		_printTiming(ts, units.size() > 1 ? strprintf("llvm translation (%d units)", units.size()) : "llvm translation");
+	}
 
-	void LLVMBackend::optimiseProgram()
+	std::vector<llvm::Module*> LLVMBackend::getAllModules()
 	{
-		auto ts = std::chrono::high_resolution_clock::now();
+		std::vector<llvm::Module*> ret = { this->linkedModule.get() };
+		for(auto& mod : this->unitModules)
+			ret.push_back(mod.get());
+
+		return ret;
+	}
 
+
+	static void optimiseModule(llvm::Module* mod)
+	{
 		llvm::legacy::PassManager fpm = llvm::legacy::PassManager();
 
 		fpm.add(llvm::createDeadInstEliminationPass());
@@ -172,24 +286,62 @@ namespace backend
 			fpm.add(llvm::createLoopSimplifyPass());
 		}
 
-		fpm.run(*this->linkedModule);
+		fpm.run(*mod);
+	}
+
+	void LLVMBackend::optimiseProgram()
+	{
+		auto ts = std::chrono::high_resolution_clock::now();
+
+		auto mods = this->getAllModules();
+		util::parallelFor(mods.size(), [&mods](size_t i) {
+			optimiseModule(mods[i]);
+		});
 
 		_printTiming(ts, "llvm opt");
 
 		if(frontend::getPrintLLVMIR())
-			this->linkedModule->print(llvm::outs(), 0);
+		{
+			for(auto mod : mods)
+				mod->print(llvm::outs(), 0);
+		}
+	}
+
+	static llvm::SmallVector<char, 0> emitObject(llvm::TargetMachine* tm, llvm::Module* mod)
+	{
+		llvm::SmallVector<char, 0> buffer;
+		{
+			auto bufferStream = std::make_unique<llvm::raw_svector_ostream>(buffer);
+			llvm::raw_pwrite_stream* rawStream = bufferStream.get();
+
+			{
+				llvm::legacy::PassManager pm = llvm::legacy::PassManager();
+				tm->addPassesToEmitFile(pm, *rawStream, nullptr,
+					llvm::CodeGenFileType::CGFT_ObjectFile);
+
+				pm.run(*mod);
+			}
+
+			// flush and kill it.
+			rawStream->flush();
+		}
+
+		return buffer;
 	}
 
 	void LLVMBackend::writeOutput()
 	{
 		auto ts = std::chrono::high_resolution_clock::now();
 
-		if(llvm::verifyModule(*this->linkedModule, &llvm::errs()))
+		for(auto mod : this->getAllModules())
 		{
-			fprintf(stderr, "\n\n");
-			this->linkedModule->print(llvm::errs(), 0);
+			if(llvm::verifyModule(*mod, &llvm::errs()))
+			{
+				fprintf(stderr, "\n\n");
+				mod->print(llvm::errs(), 0);
 
-			BareError::make("llvm: module verification failed")->postAndQuit();
+				BareError::make("llvm: module verification failed")->postAndQuit();
+			}
 		}
 
 		std::string oname;
@@ -242,26 +394,11 @@ namespace backend
 				error("llvm: no entry function marked, a program cannot be compiled");
 			}
 
-			llvm::SmallVector<char, 0> buffer;
-			{
-				auto bufferStream = std::make_unique<llvm::raw_svector_ostream>(buffer);
-				llvm::raw_pwrite_stream* rawStream = bufferStream.get();
-
-				{
-					llvm::legacy::PassManager pm = llvm::legacy::PassManager();
-					targetMachine->addPassesToEmitFile(pm, *rawStream, nullptr,
-						llvm::CodeGenFileType::CGFT_ObjectFile);
-
-					pm.run(*this->linkedModule);
-				}
-
-				// flush and kill it.
-				rawStream->flush();
-			}
-
-
 			if(frontend::getOutputMode() == ProgOutputMode::ObjectFile)
 			{
+				// there's only one unit in this case; see getNumCodegenUnits().
+				auto buffer = emitObject(this->targetMachine, this->linkedModule.get());
+
 				// now memoryBuffer should contain the .object file
 				std::ofstream objectOutput(oname, std::ios::binary | std::ios::out);
 				objectOutput.write(buffer.data(), buffer.size_in_bytes());
@@ -269,13 +406,24 @@ namespace backend
 			}
 			else
 			{
-				std::string objname = platform::compiler::getObjectFileName(this->linkedModule->getModuleIdentifier());
+				auto base = this->linkedModule->getModuleIdentifier();
 
-				std::ofstream objectOutput(objname, std::ios::binary | std::ios::out);
-				objectOutput.write(buffer.data(), buffer.size_in_bytes());
-				objectOutput.close();
+				auto mods = this->getAllModules();
+				auto tms = std::vector<llvm::TargetMachine*>({ this->targetMachine }) + this->unitTargetMachines;
+
+				std::vector<std::string> objnames;
+				for(size_t i = 0; i < mods.size(); i++)
+					objnames.push_back(platform::compiler::getObjectFileName(i == 0 ? base : strprintf("%s.%d", base, i)));
+
+				util::parallelFor(mods.size(), [&mods, &tms, &objnames](size_t i) {
+					auto buffer = emitObject(tms[i], mods[i]);
+
+					std::ofstream objectOutput(objnames[i], std::ios::binary | std::ios::out);
+					objectOutput.write(buffer.data(), buffer.size_in_bytes());
+					objectOutput.close();
+				});
 
-				auto cmdline = platform::compiler::getCompilerCommandLine({ objname }, oname);
+				auto cmdline = platform::compiler::getCompilerCommandLine(objnames, oname);
 
 				// debuglogln("link cmdline:\n%s", cmdline);
 
@@ -315,7 +463,7 @@ namespace backend
 
 
 
-	void LLVMBackend::setupTargetMachine()
+	llvm::TargetMachine* LLVMBackend::createTargetMachine()
 	{
 		llvm::InitializeNativeTarget();
 		llvm::InitializeNativeTargetAsmParser();
@@ -383,7 +531,7 @@ namespace backend
 		if(frontend::getIsPositionIndependent())
 			relocModel = llvm::Reloc::Model::PIC_;
 
-		this->targetMachine = theTarget->createTargetMachine(targetTriple.getTriple(), "", "",
+		return theTarget->createTargetMachine(targetTriple.getTriple(), "", "",
 			targetOptions, relocModel, codeModel, llvm::CodeGenOpt::Default);
 	}
 
@@ -0,0 +1,104 @@
+// tiered.cpp
+// Copyright (c) 2019, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include <chrono>
+
+#ifdef _MSC_VER
+	#pragma warning(push, 0)
+#else
+	#pragma GCC diagnostic push
+	#pragma GCC diagnostic ignored "-Wold-style-cast"
+#endif
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TargetSelect.h"
+
+#ifdef _MSC_VER
+	#pragma warning(pop)
+#else
+	#pragma GCC diagnostic pop
+#endif
+
+#include "defs.h"
+#include "frontend.h"
+
+#include "ir/interp.h"
+#include "ir/module.h"
+#include "ir/function.h"
+
+#include "backends/llvm.h"
+#include "backends/interp.h"
+
+// how many calls (or loop iterations) a function gets in the interpreter before we compile it.
+#define TIER_UP_THRESHOLD       1000
+
+namespace backend
+{
+	FIRTieredBackend::FIRTieredBackend(CompiledData& dat, const std::vector<std::string>& inputs, const std::string& output)
+		: FIRInterpBackend(dat, inputs, output)
+	{
+	}
+
+	FIRTieredBackend::~FIRTieredBackend()
+	{
+		// the interpreter might still have pointers into the jit, so it must go first.
+		if(this->is) delete this->is;
+		this->is = 0;
+
+		if(this->jit) delete this->jit;
+	}
+
+	std::string FIRTieredBackend::str()
+	{
+		return "FIR Interpreter + LLVM JIT";
+	}
+
+	void FIRTieredBackend::performCompilation()
+	{
+		FIRInterpBackend::performCompilation();
+
+		this->is->tierUp.threshold = TIER_UP_THRESHOLD;
+		this->is->tierUp.compile = [this](fir::Function* fn) -> void* {
+			return this->compileFunction(fn);
+		};
+	}
+
+	void* FIRTieredBackend::compileFunction(fir::Function* fn)
+	{
+		// the first time something gets hot, translate the whole module and give it to the jit. the jit only
+		// compiles it when we first look a symbol up, and after that, promoting another function is just a lookup.
+		if(!this->addedModule)
+		{
+			auto ts = std::chrono::high_resolution_clock::now();
+
+			llvm::InitializeNativeTarget();
+			llvm::InitializeNativeTargetAsmParser();
+			llvm::InitializeNativeTargetAsmPrinter();
+
+			this->jit = LLVMJit::create();
+
+			auto mod = LLVMBackend::translateFIRtoLLVM(this->compiledData.module);
+			mod->setDataLayout(this->jit->getDataLayout());
+
+			this->jit->addModule(std::unique_ptr<llvm::Module>(mod));
+			this->addedModule = true;
+
+			if(frontend::getPrintProfileStats())
+			{
+				auto dur = std::chrono::high_resolution_clock::now() - ts;
+				printf("tiered: llvm translation took %.1f ms\n", static_cast<double>(dur.count()) / 1000000.0);
+			}
+		}
+
+		return reinterpret_cast<void*>(this->jit->getSymbolAddress(fn->getName().mangled()));
+	}
+
+	void FIRTieredBackend::writeOutput()
+	{
+		FIRInterpBackend::writeOutput();
+
+		if(frontend::getPrintProfileStats())
+			printf("tiered: promoted %zu function(s) to native code\n", this->is->stats.functionsPromoted);
+	}
+}
@@ -333,7 +333,19 @@ namespace backend
 	}
 
 
-	static llvm::Function* translateFunctionDecl(fir::Function* ffn, util::hash_map<size_t, llvm::Value*>& valueMap, llvm::Module* mod)
+	// when the module is split into codegen units, internal things can be defined in one unit and used from another, so
+	// they need to be visible to the linker -- but only inside this program.
+	static void exportFromUnit(llvm::GlobalValue* gv)
+	{
+		if(gv->hasInternalLinkage())
+		{
+			gv->setLinkage(llvm::GlobalValue::LinkageTypes::ExternalLinkage);
+			gv->setVisibility(llvm::GlobalValue::VisibilityTypes::HiddenVisibility);
+		}
+	}
+
+	static llvm::Function* translateFunctionDecl(fir::Function* ffn, util::hash_map<size_t, llvm::Value*>& valueMap, llvm::Module* mod,
+		const CodegenUnit* unit)
 	{
 		if(auto it = valueMap.find(ffn->id); it != valueMap.end())
 			return llvm::cast<llvm::Function>(it->second);
@@ -366,6 +378,16 @@ namespace backend
 
 		valueMap[ffn->id] = func;
 
+		if(unit)
+		{
+			if(!CodegenUnit::isReplicated(ffn))
+				exportFromUnit(func);
+
+			// the body lives in some other unit.
+			if(!unit->contains(ffn))
+				return func;
+		}
+
 		size_t i = 0;
 		for(auto it = func->arg_begin(); it != func->arg_end(); it++, i++)
 			valueMap[ffn->getArguments()[i]->id] = it;
@@ -568,7 +590,7 @@ namespace backend
 
 
 
-	llvm::Module* LLVMBackend::translateFIRtoLLVM(fir::Module* firmod)
+	llvm::Module* LLVMBackend::translateFIRtoLLVM(fir::Module* firmod, const CodegenUnit* unit)
 	{
 		auto& gc = LLVMBackend::getLLVMContext();
 
@@ -678,9 +700,23 @@ namespace backend
 
 		for(auto global : firmod->_getGlobals())
 		{
-			llvm::Constant* initval = 0;
 			llvm::Type* ty = typeToLlvm(global.second->getType(), module);
 
+			// globals are defined in the first unit, and everybody else just refers to them.
+			if(unit && unit->index > 0)
+			{
+				auto gv = new llvm::GlobalVariable(*module, ty, false, llvm::GlobalValue::LinkageTypes::ExternalLinkage, nullptr,
+					global.first.mangled());
+
+				if(global.second->linkageType != fir::LinkageType::External)
+					gv->setVisibility(llvm::GlobalValue::VisibilityTypes::HiddenVisibility);
+
+				valueMap[global.second->id] = gv;
+				continue;
+			}
+
+			llvm::Constant* initval = 0;
+
 			if(global.second->getInitialValue() != 0)
 				initval = constToLlvm(global.second->getInitialValue(), valueMap, module);
 
@@ -690,6 +726,9 @@ namespace backend
 			llvm::GlobalVariable* gv = new llvm::GlobalVariable(*module, ty, false, global.second->linkageType == fir::LinkageType::External ? llvm::GlobalValue::LinkageTypes::ExternalLinkage : llvm::GlobalValue::LinkageTypes::InternalLinkage, initval,
 				global.first.mangled());
 
+			if(unit)
+				exportFromUnit(gv);
+
 			valueMap[global.second->id] = gv;
 		}
 
@@ -815,7 +854,7 @@ namespace backend
 					}
 				}
 			}
-			else if(intr.first.name == "roundup_pow2")
+			else if(intr.first.getName() == "roundup_pow2")
 			{
 				llvm::FunctionType* ft = llvm::FunctionType::get(getNativeWordTy(), { getNativeWordTy() }, false);
 				fn = llvm::Function::Create(ft, llvm::GlobalValue::LinkageTypes::InternalLinkage, "fir.intrinsic.roundup_pow2", module);
@@ -898,7 +937,7 @@ namespace backend
 		// fprintf(stderr, "translating module %s\n", this->moduleName.c_str());
 		for(auto f : firmod->_getFunctions())
 		{
-			translateFunctionDecl(f.second, valueMap, module);
+			translateFunctionDecl(f.second, valueMap, module, unit);
 		}
 
 
@@ -911,9 +950,12 @@ namespace backend
 		#endif
 
 
+		std::vector<std::pair<llvm::PHINode*, fir::PHINode*>> pendingPhis;
 		for(auto fp : firmod->_getFunctions())
 		{
 			fir::Function* ffn = fp.second;
+			if(unit && !unit->contains(ffn))
+				continue;
 
 			// if(isGenericInAnyWay(ffn->getType()))
 				// continue;
@@ -1548,14 +1590,10 @@ namespace backend
 							auto phi = dcast(fir::PHINode, inst->realOutput);
 							iceAssert(phi);
 
+							// the incoming values can come from blocks we haven't translated yet (eg. loop back-edges),
+							// so fill them in once the whole function is done.
 							llvm::PHINode* ret = builder.CreatePHI(t, static_cast<unsigned int>(phi->getValues().size()));
-
-							for(auto v : phi->getValues())
-							{
-								ret->addIncoming(decay(v.second, getValue(v.second)),
-									llvm::cast<llvm::BasicBlock>(decay(v.first, getValue(v.first)))
-								);
-							}
+							pendingPhis.push_back({ ret, phi });
 
 							addValueToMap(ret, inst->realOutput);
 							break;
@@ -2424,6 +2462,26 @@ namespace backend
 					}
 				}
 			}
+
+			// moving the insert point around for the loads below shouldn't affect wherever we were emitting before.
+			{
+				llvm::IRBuilderBase::InsertPointGuard guard(builder);
+				for(auto [ lphi, fphi ] : pendingPhis)
+				{
+					for(const auto& [ fblk, fval ] : fphi->getValues())
+					{
+						auto bb = llvm::cast<llvm::BasicBlock>(getValue(fblk));
+
+						// lvalues need to be loaded at the end of the incoming block, not where the phi is.
+						if(fval->islvalue())
+							builder.SetInsertPoint(bb->getTerminator());
+
+						lphi->addIncoming(decay(fval, getValue(fval)), bb);
+					}
+				}
+			}
+
+			pendingPhis.clear();
 		}
 
 		return module;
@@ -0,0 +1,368 @@
+// assembler.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "defs.h"
+#include "errors.h"
+#include "backends/x64.h"
+
+namespace backend {
+namespace x64
+{
+	void Assembler::u32(uint32_t x)
+	{
+		for(int i = 0; i < 4; i++)
+			this->u8(static_cast<uint8_t>(x >> (8 * i)));
+	}
+
+	void Assembler::u64(uint64_t x)
+	{
+		for(int i = 0; i < 8; i++)
+			this->u8(static_cast<uint8_t>(x >> (8 * i)));
+	}
+
+	void Assembler::raw(std::initializer_list<uint8_t> bytes)
+	{
+		for(auto b : bytes)
+			this->u8(b);
+	}
+
+	void Assembler::emitRex(bool w, int reg, int base, bool force)
+	{
+		uint8_t rex = 0x40 | (w ? 0x08 : 0) | (((reg >> 3) & 1) << 2) | ((base >> 3) & 1);
+
+		// with a rex prefix, the byte registers 4-7 are spl/bpl/sil/dil instead of ah/ch/dh/bh. we never want the
+		// latter, so the byte ops always get one.
+		if(rex != 0x40 || force)
+			this->u8(rex);
+	}
+
+	void Assembler::emitMem(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, int reg, const Mem& m, bool byteReg)
+	{
+		if(prefix)
+			this->u8(prefix);
+
+		this->emitRex(w, reg, m.base == RIP ? 0 : m.base, byteReg);
+		for(auto b : opcode)
+			this->u8(b);
+
+		if(m.base == RIP)
+		{
+			this->u8(static_cast<uint8_t>(0x05 | ((reg & 7) << 3)));
+
+			// the displacement is relative to the end of the instruction, which (since nothing we emit has an
+			// immediate after a rip-relative operand) is right after it.
+			this->obj->text->relocations.push_back({ this->position(), m.symbol, m.reloc, static_cast<int64_t>(m.disp) - 4 });
+			this->u32(0);
+		}
+		else
+		{
+			this->u8(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (m.base & 7)));
+
+			// rsp and r12 need a sib byte.
+			if((m.base & 7) == RSP)
+				this->u8(0x24);
+
+			this->u32(static_cast<uint32_t>(m.disp));
+		}
+	}
+
+	void Assembler::emitRR(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, int reg, int rm, bool byteReg)
+	{
+		if(prefix)
+			this->u8(prefix);
+
+		this->emitRex(w, reg, rm, byteReg);
+		for(auto b : opcode)
+			this->u8(b);
+
+		this->u8(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+	}
+
+
+
+
+	Label Assembler::newLabel()
+	{
+		this->labels.push_back(-1);
+		return Label { this->labels.size() - 1 };
+	}
+
+	void Assembler::bind(Label l)
+	{
+		iceAssert(l.id < this->labels.size() && this->labels[l.id] == -1);
+		this->labels[l.id] = static_cast<int64_t>(this->position());
+	}
+
+	void Assembler::resolveLabels()
+	{
+		for(const auto& [ ofs, id ] : this->fixups)
+		{
+			iceAssert(this->labels[id] != -1);
+			this->patch32(ofs, static_cast<uint32_t>(this->labels[id] - static_cast<int64_t>(ofs + 4)));
+		}
+
+		this->labels.clear();
+		this->fixups.clear();
+	}
+
+	void Assembler::patch32(size_t ofs, uint32_t val)
+	{
+		for(int i = 0; i < 4; i++)
+			this->code[ofs + i] = static_cast<uint8_t>(val >> (8 * i));
+	}
+
+
+
+
+	void Assembler::movRR(Reg dst, Reg src)
+	{
+		this->emitRR(0, true, { 0x89 }, src, dst);
+	}
+
+	void Assembler::movRI(Reg dst, int64_t imm)
+	{
+		if(imm == static_cast<int32_t>(imm))
+		{
+			this->emitRR(0, true, { 0xC7 }, 0, dst);
+			this->u32(static_cast<uint32_t>(imm));
+		}
+		else if(imm == static_cast<uint32_t>(imm))
+		{
+			// writing the 32-bit register clears the top half.
+			this->emitRex(false, 0, dst, false);
+			this->u8(static_cast<uint8_t>(0xB8 + (dst & 7)));
+			this->u32(static_cast<uint32_t>(imm));
+		}
+		else
+		{
+			this->emitRex(true, 0, dst, false);
+			this->u8(static_cast<uint8_t>(0xB8 + (dst & 7)));
+			this->u64(static_cast<uint64_t>(imm));
+		}
+	}
+
+	void Assembler::load(Reg dst, const Mem& m, size_t size, bool sext)
+	{
+		switch(size)
+		{
+			case 8: this->emitMem(0, true, { 0x8B }, dst, m); break;
+			case 4: this->emitMem(0, sext, { static_cast<uint8_t>(sext ? 0x63 : 0x8B) }, dst, m); break;
+			case 2: this->emitMem(0, true, { 0x0F, static_cast<uint8_t>(sext ? 0xBF : 0xB7) }, dst, m); break;
+			case 1: this->emitMem(0, true, { 0x0F, static_cast<uint8_t>(sext ? 0xBE : 0xB6) }, dst, m); break;
+
+			default: error("x64: invalid load size %d", size);
+		}
+	}
+
+	void Assembler::store(const Mem& m, Reg src, size_t size)
+	{
+		switch(size)
+		{
+			case 8: this->emitMem(0, true, { 0x89 }, src, m); break;
+			case 4: this->emitMem(0, false, { 0x89 }, src, m); break;
+			case 2: this->emitMem(0x66, false, { 0x89 }, src, m); break;
+			case 1: this->emitMem(0, false, { 0x88 }, src, m, /* byteReg: */ true); break;
+
+			default: error("x64: invalid store size %d", size);
+		}
+	}
+
+	void Assembler::storeImm(const Mem& m, int32_t imm, size_t size)
+	{
+		// see emitMem(); the immediate would come after the displacement.
+		iceAssert(m.base != RIP);
+
+		switch(size)
+		{
+			case 8: this->emitMem(0, true, { 0xC7 }, 0, m); this->u32(static_cast<uint32_t>(imm)); break;
+			case 4: this->emitMem(0, false, { 0xC7 }, 0, m); this->u32(static_cast<uint32_t>(imm)); break;
+			case 2: this->emitMem(0x66, false, { 0xC7 }, 0, m); this->u8(imm & 0xFF); this->u8((imm >> 8) & 0xFF); break;
+			case 1: this->emitMem(0, false, { 0xC6 }, 0, m); this->u8(imm & 0xFF); break;
+
+			default: error("x64: invalid store size %d", size);
+		}
+	}
+
+	void Assembler::lea(Reg dst, const Mem& m)
+	{
+		this->emitMem(0, true, { 0x8D }, dst, m);
+	}
+
+	void Assembler::alu(AluOp op, Reg dst, Reg src)
+	{
+		this->emitRR(0, true, { static_cast<uint8_t>((static_cast<uint8_t>(op) << 3) | 1) }, src, dst);
+	}
+
+	void Assembler::aluImm(AluOp op, Reg dst, int32_t imm)
+	{
+		this->emitRR(0, true, { 0x81 }, static_cast<uint8_t>(op), dst);
+		this->u32(static_cast<uint32_t>(imm));
+	}
+
+	void Assembler::imul(Reg dst, Reg src)
+	{
+		this->emitRR(0, true, { 0x0F, 0xAF }, dst, src);
+	}
+
+	void Assembler::unary(UnaryOp op, Reg r)
+	{
+		this->emitRR(0, true, { 0xF7 }, static_cast<uint8_t>(op), r);
+	}
+
+	void Assembler::shift(ShiftOp op, Reg r)
+	{
+		this->emitRR(0, true, { 0xD3 }, static_cast<uint8_t>(op), r);
+	}
+
+	void Assembler::shiftImm(ShiftOp op, Reg r, uint8_t imm)
+	{
+		this->emitRR(0, true, { 0xC1 }, static_cast<uint8_t>(op), r);
+		this->u8(imm);
+	}
+
+	void Assembler::test(Reg a, Reg b)
+	{
+		this->emitRR(0, true, { 0x85 }, b, a);
+	}
+
+	void Assembler::cqo()
+	{
+		this->raw({ 0x48, 0x99 });
+	}
+
+	void Assembler::bsr(Reg dst, Reg src)
+	{
+		this->emitRR(0, true, { 0x0F, 0xBD }, dst, src);
+	}
+
+	void Assembler::setcc(Cond c, Reg dst)
+	{
+		this->emitRR(0, false, { 0x0F, static_cast<uint8_t>(0x90 + static_cast<uint8_t>(c)) }, 0, dst, true);
+	}
+
+	void Assembler::movzx8(Reg dst, Reg src)
+	{
+		this->emitRR(0, true, { 0x0F, 0xB6 }, dst, src, true);
+	}
+
+	void Assembler::movsx8(Reg dst, Reg src)
+	{
+		this->emitRR(0, true, { 0x0F, 0xBE }, dst, src, true);
+	}
+
+
+
+
+	void Assembler::jmp(Label l)
+	{
+		this->u8(0xE9);
+		this->fixups.push_back({ this->position(), l.id });
+		this->u32(0);
+	}
+
+	void Assembler::jcc(Cond c, Label l)
+	{
+		this->raw({ 0x0F, static_cast<uint8_t>(0x80 + static_cast<uint8_t>(c)) });
+		this->fixups.push_back({ this->position(), l.id });
+		this->u32(0);
+	}
+
+	void Assembler::call(size_t symbol)
+	{
+		this->u8(0xE8);
+		this->obj->text->relocations.push_back({ this->position(), symbol, RelocKind::PLT32, -4 });
+		this->u32(0);
+	}
+
+	void Assembler::callR(Reg r)
+	{
+		this->emitRR(0, false, { 0xFF }, 2, r);
+	}
+
+	void Assembler::push(Reg r)
+	{
+		if(r >= R8) this->u8(0x41);
+		this->u8(static_cast<uint8_t>(0x50 + (r & 7)));
+	}
+
+	void Assembler::pop(Reg r)
+	{
+		if(r >= R8) this->u8(0x41);
+		this->u8(static_cast<uint8_t>(0x58 + (r & 7)));
+	}
+
+	void Assembler::leave()     { this->u8(0xC9); }
+	void Assembler::ret()       { this->u8(0xC3); }
+	void Assembler::ud2()       { this->raw({ 0x0F, 0x0B }); }
+	void Assembler::repMovsb()  { this->raw({ 0xF3, 0xA4 }); }
+	void Assembler::repStosb()  { this->raw({ 0xF3, 0xAA }); }
+
+	size_t Assembler::subRspImm32()
+	{
+		this->raw({ 0x48, 0x81, 0xEC });
+
+		auto ret = this->position();
+		this->u32(0);
+
+		return ret;
+	}
+
+
+
+
+	void Assembler::sseLoad(XReg dst, const Mem& m, bool dbl)
+	{
+		this->emitMem(dbl ? 0xF2 : 0xF3, false, { 0x0F, 0x10 }, dst, m);
+	}
+
+	void Assembler::sseStore(const Mem& m, XReg src, bool dbl)
+	{
+		this->emitMem(dbl ? 0xF2 : 0xF3, false, { 0x0F, 0x11 }, src, m);
+	}
+
+	void Assembler::sseOp(SSEOp op, XReg dst, XReg src, bool dbl)
+	{
+		this->emitRR(dbl ? 0xF2 : 0xF3, false, { 0x0F, static_cast<uint8_t>(op) }, dst, src);
+	}
+
+	void Assembler::ucomis(XReg a, XReg b, bool dbl)
+	{
+		this->emitRR(dbl ? 0x66 : 0, false, { 0x0F, 0x2E }, a, b);
+	}
+
+	void Assembler::cvtsi2s(XReg dst, Reg src, bool dbl)
+	{
+		this->emitRR(dbl ? 0xF2 : 0xF3, true, { 0x0F, 0x2A }, dst, src);
+	}
+
+	void Assembler::cvtts2si(Reg dst, XReg src, bool dbl)
+	{
+		this->emitRR(dbl ? 0xF2 : 0xF3, true, { 0x0F, 0x2C }, dst, src);
+	}
+
+	void Assembler::cvtss2sd(XReg dst, XReg src)
+	{
+		this->emitRR(0xF3, false, { 0x0F, 0x5A }, dst, src);
+	}
+
+	void Assembler::cvtsd2ss(XReg dst, XReg src)
+	{
+		this->emitRR(0xF2, false, { 0x0F, 0x5A }, dst, src);
+	}
+
+	void Assembler::fld(const Mem& m, bool dbl)
+	{
+		this->emitMem(0, false, { static_cast<uint8_t>(dbl ? 0xDD : 0xD9) }, 0, m);
+	}
+
+	void Assembler::fstp(const Mem& m, bool dbl)
+	{
+		this->emitMem(0, false, { static_cast<uint8_t>(dbl ? 0xDD : 0xD9) }, 3, m);
+	}
+
+	void Assembler::fprem()     { this->raw({ 0xD9, 0xF8 }); }
+	void Assembler::fstpST1()   { this->raw({ 0xDD, 0xD9 }); }
+	void Assembler::fnstswAX()  { this->raw({ 0xDF, 0xE0 }); }
+}
+}
@@ -0,0 +1,1675 @@
+// codegen.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "defs.h"
+#include "backends/x64.h"
+
+#include "ir/block.h"
+#include "ir/module.h"
+#include "ir/passes.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/instruction.h"
+
+#include <algorithm>
+
+#define SLICE_DATA_INDEX            0
+#define SLICE_LENGTH_INDEX          1
+
+#define SAA_DATA_INDEX              0
+#define SAA_LENGTH_INDEX            1
+#define SAA_CAPACITY_INDEX          2
+#define SAA_REFCOUNTPTR_INDEX       3
+
+#define ANY_TYPEID_INDEX            0
+#define ANY_REFCOUNTPTR_INDEX       1
+#define ANY_DATA_ARRAY_INDEX        2
+
+// this is a very straightforward (read: slow) translation. every value gets its own stack slot, and every
+// instruction loads its operands from their slots into fixed registers, does its thing, and writes the result back.
+// there's no register allocation to speak of, but it doesn't need to look at anything except the instruction it's on.
+
+// things that fit in a register follow the sysv abi, so we can call (and be called from) c. aggregates are always
+// passed by pointer, and the callee makes its own copy; they get returned through a pointer that the caller passes
+// first, same as the abi does for big structs. that's only a problem for c functions that take or return structs by
+// value, which we refuse to compile.
+
+namespace backend {
+namespace x64
+{
+	static const Reg intArgRegs[] = { RDI, RSI, RDX, RCX, R8, R9 };
+
+	#define NUM_INT_ARG_REGS    6
+	#define NUM_SSE_ARG_REGS    8
+
+	// below this, copies and zeroing are done with moves; above it, with rep movs/stos.
+	#define INLINE_COPY_LIMIT   64
+
+	enum class ArgClass { Integer, SSE, Memory };
+
+	// native code has to lay things out the way c does, which isn't quite what the interpreter does; see TypeLayout.
+	static size_t sizeOf(fir::Type* ty)
+	{
+		return fir::getTypeLayout(ty).abiSize;
+	}
+
+	static bool isIntegral(fir::Type* ty)
+	{
+		return (ty->isPrimitiveType() && !ty->isFloatingPointType()) || ty->isBoolType() || ty->isPointerType()
+			|| ty->isFunctionType() || ty->isNullType();
+	}
+
+	static bool isDouble(fir::Type* ty)
+	{
+		auto sz = sizeOf(ty);
+		if(sz != 4 && sz != 8)
+			error("x64: unsupported floating-point type '%s'", ty);
+
+		return sz == 8;
+	}
+
+	static ArgClass classify(fir::Type* ty)
+	{
+		if(ty->isFloatingPointType())
+		{
+			isDouble(ty);
+			return ArgClass::SSE;
+		}
+		else if(isIntegral(ty) && sizeOf(ty) <= 8)
+		{
+			return ArgClass::Integer;
+		}
+
+		return ArgClass::Memory;
+	}
+
+	static size_t getFieldOffset(fir::Type* ty, size_t idx)
+	{
+		if(ty->isArrayType())
+			return idx * sizeOf(ty->getArrayElementType());
+
+		// only the id, see doExtractValue() in the interpreter.
+		else if(ty->isUnionType())
+			return 0;
+
+		auto& layout = fir::getTypeLayout(ty);
+		if(idx >= layout.abiFieldOffsets.size())
+			error("x64: invalid field index %d for type '%s'", idx, ty);
+
+		return layout.abiFieldOffsets[idx];
+	}
+
+	static size_t roundUp(size_t x, size_t a)
+	{
+		return (x + a - 1) / a * a;
+	}
+
+	static uint64_t getIndex(fir::Value* v)
+	{
+		auto ci = dcast(fir::ConstantInt, v);
+		iceAssert(ci);
+
+		return ci->getUnsignedValue();
+	}
+
+
+	// the bytes of a constant, and the pointers inside it that need to be relocated.
+	struct Blob
+	{
+		std::vector<uint8_t> bytes;
+		std::vector<Relocation> relocations;
+
+		void write(size_t ofs, uint64_t val, size_t size)
+		{
+			iceAssert(ofs + size <= this->bytes.size());
+			for(size_t i = 0; i < size; i++)
+				this->bytes[ofs + i] = static_cast<uint8_t>(val >> (8 * i));
+		}
+	};
+
+	struct Compiler
+	{
+		Compiler(fir::Module* mod, ObjectFile* obj) : mod(mod), obj(obj), as(obj) { }
+
+		fir::Module* mod = 0;
+		ObjectFile* obj = 0;
+		Assembler as;
+
+		util::hash_map<fir::Function*, size_t> functionSymbols;
+		util::hash_map<fir::GlobalVariable*, size_t> globalSymbols;
+
+		// global strings are pointers to the characters, which live in rodata at these offsets.
+		util::hash_map<fir::GlobalVariable*, size_t> globalStrings;
+		util::hash_map<std::string, size_t> stringOffsets;
+		util::hash_map<fir::ConstantValue*, Mem> constants;
+
+		// the current function.
+		fir::Function* fn = 0;
+		util::hash_map<fir::Value*, int32_t> slots;
+		util::hash_map<fir::Value*, int32_t> allocations;
+		util::hash_map<fir::PHINode*, int32_t> phiTemps;
+		util::hash_map<fir::IRBlock*, Label> blockLabels;
+
+		size_t frameSize = 0;
+		size_t frameFixup = 0;
+		size_t outgoingSize = 0;
+		int32_t returnPtrSlot = 0;
+
+
+		int32_t allocSlot(size_t size)
+		{
+			size = std::max(size, static_cast<size_t>(1));
+			this->frameSize = roundUp(this->frameSize + size, size >= 16 ? 16 : 8);
+
+			return -static_cast<int32_t>(this->frameSize);
+		}
+
+		Mem slot(fir::Value* v)
+		{
+			auto it = this->slots.find(v);
+			iceAssert(it != this->slots.end());
+
+			return Mem(RBP, it->second);
+		}
+
+		bool isGlobalString(fir::Value* v)
+		{
+			auto gv = dcast(fir::GlobalVariable, v);
+			return gv && this->globalStrings.find(gv) != this->globalStrings.end();
+		}
+
+		size_t getString(const std::string& s)
+		{
+			if(auto it = this->stringOffsets.find(s); it != this->stringOffsets.end())
+				return it->second;
+
+			auto ofs = this->obj->rodata->data.size();
+			this->obj->rodata->data.insert(this->obj->rodata->data.end(), s.begin(), s.end());
+			this->obj->rodata->data.push_back(0);
+
+			return (this->stringOffsets[s] = ofs);
+		}
+
+		size_t getFunctionSymbol(fir::Function* f)
+		{
+			if(auto it = this->functionSymbols.find(f); it != this->functionSymbols.end())
+				return it->second;
+
+			return this->obj->getExternalSymbol(f->getName().mangled(), f->linkageType == fir::LinkageType::ExternalWeak);
+		}
+
+
+
+		// constants.
+		void writeConstant(Blob& blob, size_t ofs, fir::ConstantValue* c)
+		{
+			auto ty = c->getType();
+			auto pointerTo = [&blob, ofs](size_t symbol, size_t at, int64_t addend) {
+				blob.relocations.push_back({ ofs + at, symbol, RelocKind::Abs64, addend });
+			};
+
+			if(auto ci = dcast(fir::ConstantInt, c))
+			{
+				blob.write(ofs, ci->getUnsignedValue(), sizeOf(ty));
+			}
+			else if(auto cf = dcast(fir::ConstantFP, c))
+			{
+				if(isDouble(ty))
+				{
+					double d = cf->getValue();
+					uint64_t bits = 0; memcpy(&bits, &d, sizeof(d));
+					blob.write(ofs, bits, 8);
+				}
+				else
+				{
+					float f = static_cast<float>(cf->getValue());
+					uint32_t bits = 0; memcpy(&bits, &f, sizeof(f));
+					blob.write(ofs, bits, 4);
+				}
+			}
+			else if(auto cb = dcast(fir::ConstantBool, c))
+			{
+				blob.write(ofs, cb->getValue() ? 1 : 0, 1);
+			}
+			else if(auto cbc = dcast(fir::ConstantBitcast, c))
+			{
+				this->writeConstant(blob, ofs, cbc->getValue());
+			}
+			else if(auto ca = dcast(fir::ConstantArray, c))
+			{
+				auto values = ca->getValues();
+				for(size_t i = 0; i < values.size(); i++)
+					this->writeConstant(blob, ofs + getFieldOffset(ty, i), values[i]);
+			}
+			else if(auto ct = dcast(fir::ConstantTuple, c))
+			{
+				auto values = ct->getValues();
+				for(size_t i = 0; i < values.size(); i++)
+					this->writeConstant(blob, ofs + getFieldOffset(ty, i), values[i]);
+			}
+			else if(auto cs = dcast(fir::ConstantStruct, c))
+			{
+				auto values = cs->getValues();
+				for(size_t i = 0; i < values.size(); i++)
+					this->writeConstant(blob, ofs + getFieldOffset(ty, i), values[i]);
+			}
+			else if(auto cec = dcast(fir::ConstantEnumCase, c))
+			{
+				this->writeConstant(blob, ofs + getFieldOffset(ty, 0), cec->getIndex());
+				this->writeConstant(blob, ofs + getFieldOffset(ty, 1), cec->getValue());
+			}
+			else if(auto ccs = dcast(fir::ConstantCharSlice, c))
+			{
+				pointerTo(this->obj->rodata->symbol, getFieldOffset(ty, SLICE_DATA_INDEX), this->getString(ccs->getValue()));
+				blob.write(ofs + getFieldOffset(ty, SLICE_LENGTH_INDEX), ccs->getValue().size(), 8);
+			}
+			else if(auto cds = dcast(fir::ConstantDynamicString, c))
+			{
+				// a capacity of -1 means we don't own the memory, and there's no refcount.
+				pointerTo(this->obj->rodata->symbol, getFieldOffset(ty, SAA_DATA_INDEX), this->getString(cds->getValue()));
+				blob.write(ofs + getFieldOffset(ty, SAA_LENGTH_INDEX), cds->getValue().size(), 8);
+				blob.write(ofs + getFieldOffset(ty, SAA_CAPACITY_INDEX), static_cast<uint64_t>(-1), 8);
+			}
+			else if(auto cas = dcast(fir::ConstantArraySlice, c))
+			{
+				this->writeConstant(blob, ofs + getFieldOffset(ty, SLICE_DATA_INDEX), cas->getData());
+				this->writeConstant(blob, ofs + getFieldOffset(ty, SLICE_LENGTH_INDEX), cas->getLength());
+			}
+			else if(auto cda = dcast(fir::ConstantDynamicArray, c))
+			{
+				if(auto arr = cda->getArray(); arr)
+				{
+					// the elements go in their own (writable) blob, and we point at it.
+					auto elms = this->placeConstant(arr, /* writable: */ true);
+
+					pointerTo(elms.symbol, getFieldOffset(ty, SAA_DATA_INDEX), elms.disp);
+					blob.write(ofs + getFieldOffset(ty, SAA_LENGTH_INDEX), arr->getValues().size(), 8);
+					blob.write(ofs + getFieldOffset(ty, SAA_CAPACITY_INDEX), static_cast<uint64_t>(-1), 8);
+				}
+				else
+				{
+					this->writeConstant(blob, ofs + getFieldOffset(ty, SAA_DATA_INDEX), cda->getData());
+					this->writeConstant(blob, ofs + getFieldOffset(ty, SAA_LENGTH_INDEX), cda->getLength());
+					this->writeConstant(blob, ofs + getFieldOffset(ty, SAA_CAPACITY_INDEX), cda->getCapacity());
+				}
+			}
+			else if(auto f = dcast(fir::Function, c))
+			{
+				pointerTo(this->getFunctionSymbol(f), 0, 0);
+			}
+			else if(auto gv = dcast(fir::GlobalVariable, c))
+			{
+				if(this->isGlobalString(gv))
+					pointerTo(this->obj->rodata->symbol, 0, this->globalStrings[gv]);
+
+				else if(auto it = this->globalSymbols.find(gv); it != this->globalSymbols.end())
+					pointerTo(it->second, 0, 0);
+
+				else
+					error("x64: global '%s' was not found", gv->getName().str());
+			}
+			else
+			{
+				// everything else is a zero value, which the blob already is.
+			}
+		}
+
+		Blob makeBlob(fir::ConstantValue* c)
+		{
+			Blob blob;
+			blob.bytes.resize(sizeOf(c->getType()));
+
+			this->writeConstant(blob, 0, c);
+			return blob;
+		}
+
+		// puts the constant somewhere in memory, and returns where.
+		Mem placeConstant(fir::ConstantValue* c, bool writable = false)
+		{
+			if(!writable)
+			{
+				if(auto it = this->constants.find(c); it != this->constants.end())
+					return it->second;
+			}
+
+			auto blob = this->makeBlob(c);
+
+			// things with pointers in them go in .data, so the dynamic linker can fix them up.
+			auto sec = (writable || !blob.relocations.empty()) ? this->obj->data : this->obj->rodata;
+			auto ofs = sec->align(blob.bytes.size() >= 16 ? 16 : 8);
+
+			sec->data.insert(sec->data.end(), blob.bytes.begin(), blob.bytes.end());
+			for(auto r : blob.relocations)
+			{
+				r.offset += ofs;
+				sec->relocations.push_back(r);
+			}
+
+			auto ret = Mem::symbolic(sec->symbol, static_cast<int32_t>(ofs));
+			if(!writable)
+				this->constants[c] = ret;
+
+			return ret;
+		}
+
+		// if the constant is a plain number that fits in a register.
+		bool getImmediate(fir::ConstantValue* c, bool sext, int64_t* out)
+		{
+			auto ty = c->getType();
+			if(!isIntegral(ty) || dcast(fir::GlobalValue, c))
+				return false;
+
+			auto sz = sizeOf(ty);
+			if(sz > 8)
+				return false;
+
+			auto blob = this->makeBlob(c);
+			if(!blob.relocations.empty())
+				return false;
+
+			uint64_t val = 0;
+			for(size_t i = 0; i < sz; i++)
+				val |= static_cast<uint64_t>(blob.bytes[i]) << (8 * i);
+
+			if(sz < 8 && sext && (val & (1ULL << (8 * sz - 1))))
+				val |= ~((1ULL << (8 * sz)) - 1);
+
+			*out = static_cast<int64_t>(val);
+			return true;
+		}
+
+
+
+		// where the (decayed) value lives. the scratch register is only used for lvalues, to hold the address.
+		Mem locate(fir::Value* v, Reg scratch)
+		{
+			if(auto it = this->slots.find(v); it != this->slots.end())
+			{
+				if(v->islvalue())
+				{
+					this->as.load(scratch, Mem(RBP, it->second), 8, false);
+					return Mem(scratch, 0);
+				}
+
+				return Mem(RBP, it->second);
+			}
+			else if(auto gv = dcast(fir::GlobalVariable, v); gv && !this->isGlobalString(gv))
+			{
+				auto it = this->globalSymbols.find(gv);
+				if(it == this->globalSymbols.end())
+					error("x64: global '%s' was not found", gv->getName().str());
+
+				return Mem::symbolic(it->second, 0);
+			}
+			else if(auto cv = dcast(fir::ConstantValue, v))
+			{
+				return this->placeConstant(cv);
+			}
+
+			error("x64: no value with id %d", v->id);
+		}
+
+		// the address of an lvalue; see getUndecayedArg() in the interpreter.
+		void loadAddress(Reg r, fir::Value* v)
+		{
+			if(auto it = this->slots.find(v); it != this->slots.end() && v->islvalue())
+			{
+				this->as.load(r, Mem(RBP, it->second), 8, false);
+			}
+			else if(auto gv = dcast(fir::GlobalVariable, v); gv && !this->isGlobalString(gv))
+			{
+				this->as.lea(r, this->locate(gv, r));
+			}
+			else
+			{
+				error("x64: value with id %d is not an lvalue", v->id);
+			}
+		}
+
+		void loadInt(Reg r, fir::Value* v, bool sext)
+		{
+			int64_t imm = 0;
+			if(auto f = dcast(fir::Function, v))
+			{
+				auto sym = this->getFunctionSymbol(f);
+
+				// things in other objects might be in a shared library, so we go through the got for those.
+				if(this->functionSymbols.find(f) != this->functionSymbols.end())
+					this->as.lea(r, Mem::symbolic(sym, 0));
+
+				else
+					this->as.load(r, Mem::symbolic(sym, 0, RelocKind::GOTPCREL), 8, false);
+			}
+			else if(this->isGlobalString(v))
+			{
+				this->as.lea(r, Mem::symbolic(this->obj->rodata->symbol,
+					static_cast<int32_t>(this->globalStrings[dcast(fir::GlobalVariable, v)])));
+			}
+			else if(auto c = dcast(fir::ConstantValue, v); c && this->getImmediate(c, sext, &imm))
+			{
+				this->as.movRI(r, imm);
+			}
+			else
+			{
+				auto sz = sizeOf(v->getType());
+				if(sz > 8)
+					error("x64: value of type '%s' does not fit in a register", v->getType());
+
+				this->as.load(r, this->locate(v, r), sz, sext);
+			}
+		}
+
+		void loadValue(Reg r, fir::Value* v)
+		{
+			this->loadInt(r, v, v->getType()->isSignedIntType());
+		}
+
+		void loadFloat(XReg x, fir::Value* v)
+		{
+			this->as.sseLoad(x, this->locate(v, R11), isDouble(v->getType()));
+		}
+
+		void storeResult(fir::Value* res, Reg r)
+		{
+			this->as.store(this->slot(res), r, res->islvalue() ? 8 : sizeOf(res->getType()));
+		}
+
+		void storeFloat(fir::Value* res, XReg x)
+		{
+			this->as.sseStore(this->slot(res), x, isDouble(res->getType()));
+		}
+
+		// the destination can't be based on rsi or r11, and the source can't be based on rdi or r11.
+		void copyMem(const Mem& dst, const Mem& src, size_t size)
+		{
+			iceAssert(dst.base != RSI && dst.base != R11 && src.base != RDI && src.base != R11);
+
+			if(size <= INLINE_COPY_LIMIT)
+			{
+				size_t i = 0;
+				for(size_t chunk : { 8, 4, 2, 1 })
+				{
+					for(; i + chunk <= size; i += chunk)
+					{
+						this->as.load(R11, src.offset(static_cast<int32_t>(i)), chunk, false);
+						this->as.store(dst.offset(static_cast<int32_t>(i)), R11, chunk);
+					}
+				}
+			}
+			else
+			{
+				this->as.lea(RSI, src);
+				this->as.lea(RDI, dst);
+				this->as.movRI(RCX, static_cast<int64_t>(size));
+				this->as.repMovsb();
+			}
+		}
+
+		void copyValue(const Mem& dst, fir::Value* v)
+		{
+			auto ty = v->getType();
+			auto sz = sizeOf(ty);
+
+			if(sz == 0)
+				return;
+
+			if(isIntegral(ty) && (sz == 1 || sz == 2 || sz == 4 || sz == 8))
+			{
+				iceAssert(dst.base != R11);
+
+				this->loadInt(R11, v, false);
+				this->as.store(dst, R11, sz);
+			}
+			else
+			{
+				this->copyMem(dst, this->locate(v, RSI), sz);
+			}
+		}
+
+		void zeroMem(const Mem& dst, size_t size)
+		{
+			if(size <= INLINE_COPY_LIMIT)
+			{
+				size_t i = 0;
+				for(size_t chunk : { 8, 4, 2, 1 })
+				{
+					for(; i + chunk <= size; i += chunk)
+						this->as.storeImm(dst.offset(static_cast<int32_t>(i)), 0, chunk);
+				}
+			}
+			else
+			{
+				this->as.lea(RDI, dst);
+				this->as.alu(AluOp::Xor, RAX, RAX);
+				this->as.movRI(RCX, static_cast<int64_t>(size));
+				this->as.repStosb();
+			}
+		}
+
+
+
+		void compileFunction(fir::Function* f);
+		void prepareFrame();
+		void emitPrologue();
+		void emitEdge(fir::IRBlock* from, fir::IRBlock* to);
+		void emitCall(fir::Instruction* inst);
+		void emitInstruction(fir::Instruction* inst);
+
+		void run();
+	};
+
+
+
+
+	void Compiler::prepareFrame()
+	{
+		this->frameSize = 0;
+		this->outgoingSize = 0;
+
+		if(classify(this->fn->getReturnType()) == ArgClass::Memory && !this->fn->getReturnType()->isVoidType())
+			this->returnPtrSlot = this->allocSlot(8);
+
+		for(auto arg : this->fn->getArguments())
+			this->slots[arg] = this->allocSlot(sizeOf(arg->getType()));
+
+		for(auto b : this->fn->getBlockList())
+		{
+			this->blockLabels[b] = this->as.newLabel();
+
+			for(auto inst : b->getInstructions())
+			{
+				auto out = inst->realOutput;
+				if(out->islvalue())
+					this->slots[out] = this->allocSlot(8);
+
+				else if(!out->getType()->isVoidType())
+					this->slots[out] = this->allocSlot(sizeOf(out->getType()));
+
+				if(inst->opKind == fir::OpKind::Value_StackAlloc || inst->opKind == fir::OpKind::Value_CreateLVal)
+				{
+					this->allocations[out] = this->allocSlot(sizeOf(inst->operands[0]->getType()));
+				}
+				else if(inst->opKind == fir::OpKind::Value_CreatePHI)
+				{
+					// the incoming values all get read before any of them are written, since one phi can be
+					// the incoming value of another.
+					auto phi = dcast(fir::PHINode, out);
+					this->phiTemps[phi] = this->allocSlot(out->islvalue() ? 8 : sizeOf(out->getType()));
+				}
+			}
+		}
+	}
+
+	void Compiler::emitPrologue()
+	{
+		this->as.push(RBP);
+		this->as.movRR(RBP, RSP);
+
+		// the frame size isn't known until we're done (the prologue and calls can make more slots).
+		this->frameFixup = this->as.subRspImm32();
+
+		size_t intIdx = 0;
+		size_t sseIdx = 0;
+
+		// the stack arguments start after the return address and the saved rbp.
+		int32_t stackOfs = 16;
+
+		if(classify(this->fn->getReturnType()) == ArgClass::Memory && !this->fn->getReturnType()->isVoidType())
+			this->as.store(Mem(RBP, this->returnPtrSlot), intArgRegs[intIdx++], 8);
+
+		// aggregates get copied after everything is out of the registers, since copying needs rsi and rdi.
+		std::vector<std::pair<fir::Argument*, int32_t>> copies;
+
+		for(auto arg : this->fn->getArguments())
+		{
+			auto ty = arg->getType();
+			auto sz = sizeOf(ty);
+			auto dst = this->slot(arg);
+
+			auto cls = classify(ty);
+			if(cls == ArgClass::SSE && sseIdx < NUM_SSE_ARG_REGS)
+			{
+				this->as.sseStore(dst, static_cast<XReg>(sseIdx++), isDouble(ty));
+				continue;
+			}
+
+			if(cls == ArgClass::Memory)
+			{
+				auto tmp = this->allocSlot(8);
+				copies.push_back({ arg, tmp });
+
+				dst = Mem(RBP, tmp);
+				sz = 8;
+			}
+
+			if(cls != ArgClass::SSE && intIdx < NUM_INT_ARG_REGS)
+			{
+				this->as.store(dst, intArgRegs[intIdx++], sz);
+			}
+			else
+			{
+				this->as.load(RAX, Mem(RBP, stackOfs), 8, false);
+				this->as.store(dst, RAX, sz);
+
+				stackOfs += 8;
+			}
+		}
+
+		for(const auto& [ arg, tmp ] : copies)
+		{
+			this->as.load(RSI, Mem(RBP, tmp), 8, false);
+			this->copyMem(this->slot(arg), Mem(RSI, 0), sizeOf(arg->getType()));
+		}
+	}
+
+	void Compiler::emitEdge(fir::IRBlock* from, fir::IRBlock* to)
+	{
+		auto phis = fir::passes::getPHIs(to);
+
+		auto copyIncoming = [this, from](fir::PHINode* phi, const Mem& dst) {
+			auto vals = phi->getValues();
+			auto it = vals.find(from);
+			if(it == vals.end())
+				error("x64: phi node (id %d) has no value for incoming block", phi->id);
+
+			if(phi->islvalue())
+			{
+				this->loadAddress(RAX, it->second);
+				this->as.store(dst, RAX, 8);
+			}
+			else
+			{
+				this->copyValue(dst, it->second);
+			}
+		};
+
+		auto size = [](fir::PHINode* phi) -> size_t {
+			return phi->islvalue() ? 8 : sizeOf(phi->getType());
+		};
+
+		if(phis.size() == 1)
+		{
+			copyIncoming(phis[0], this->slot(phis[0]));
+		}
+		else
+		{
+			for(auto phi : phis)
+				copyIncoming(phi, Mem(RBP, this->phiTemps[phi]));
+
+			for(auto phi : phis)
+				this->copyMem(this->slot(phi), Mem(RBP, this->phiTemps[phi]), size(phi));
+		}
+
+		this->as.jmp(this->blockLabels[to]);
+	}
+
+	void Compiler::emitCall(fir::Instruction* inst)
+	{
+		auto res = inst->realOutput;
+		auto ok = inst->opKind;
+
+		fir::FunctionType* ft = 0;
+		fir::Function* callee = 0;
+
+		std::vector<fir::Value*> args;
+		if(ok == fir::OpKind::Value_CallFunction)
+		{
+			callee = dcast(fir::Function, inst->operands[0]);
+			iceAssert(callee);
+
+			ft = callee->getType();
+			args = std::vector<fir::Value*>(inst->operands.begin() + 1, inst->operands.end());
+
+			// this one doesn't exist in libc, so just do it here.
+			if(callee->getBlockList().empty() && callee->getName().str() == "roundup_pow2"
+				&& this->mod->getIntrinsicFunction("roundup_pow2") == callee)
+			{
+				auto small = this->as.newLabel();
+				auto done = this->as.newLabel();
+
+				this->loadInt(RAX, args[0], false);
+				this->as.aluImm(AluOp::Cmp, RAX, 1);
+				this->as.jcc(Cond::BE, small);
+
+				this->as.aluImm(AluOp::Sub, RAX, 1);
+				this->as.bsr(RCX, RAX);
+				this->as.aluImm(AluOp::Add, RCX, 1);
+				this->as.movRI(RAX, 1);
+				this->as.shift(ShiftOp::Shl, RAX);
+				this->as.jmp(done);
+
+				this->as.bind(small);
+				this->as.movRI(RAX, 1);
+
+				this->as.bind(done);
+				this->storeResult(res, RAX);
+				return;
+			}
+		}
+		else if(ok == fir::OpKind::Value_CallFunctionPointer)
+		{
+			auto ty = inst->operands[0]->getType();
+			if(ty->isPointerType())
+				ty = ty->getPointerElementType();
+
+			ft = ty->toFunctionType();
+			args = std::vector<fir::Value*>(inst->operands.begin() + 1, inst->operands.end());
+		}
+		else
+		{
+			// 0. classtype, 1. index, 2. functiontype, 3...N args
+			ft = inst->operands[2]->getType()->toFunctionType();
+			args = std::vector<fir::Value*>(inst->operands.begin() + 3, inst->operands.end());
+		}
+
+		iceAssert(ft);
+		auto retty = ft->getReturnType();
+		bool returnsMemory = !retty->isVoidType() && classify(retty) == ArgClass::Memory;
+
+		// c only returns things through memory when they're bigger than 16 bytes; smaller ones come back in
+		// registers, in a way that we don't do.
+		if(returnsMemory && callee && callee->getBlockList().empty() && sizeOf(retty) <= 16)
+		{
+			error("x64: cannot return '%s' by value from external function '%s'; use the llvm backend",
+				retty, callee->getName().str());
+		}
+
+		bool cvararg = ft->isCStyleVarArg();
+		size_t numFixed = ft->getArgumentCount();
+
+		struct Loc { ArgClass cls; int index; bool promote; };
+		std::vector<Loc> locs;
+
+		size_t intIdx = (returnsMemory ? 1 : 0);
+		size_t sseIdx = 0;
+		size_t stackIdx = 0;
+
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			auto ty = args[i]->getType();
+			auto cls = classify(ty);
+
+			if(cls == ArgClass::Memory && callee && callee->getBlockList().empty())
+			{
+				error("x64: cannot pass '%s' by value to external function '%s'; use the llvm backend",
+					ty, callee->getName().str());
+			}
+
+			// c varargs get floats promoted to doubles.
+			bool promote = (cvararg && i >= numFixed && cls == ArgClass::SSE && !isDouble(ty));
+
+			if(cls == ArgClass::SSE && sseIdx < NUM_SSE_ARG_REGS)              locs.push_back({ cls, static_cast<int>(sseIdx++), promote });
+			else if(cls != ArgClass::SSE && intIdx < NUM_INT_ARG_REGS)         locs.push_back({ cls, static_cast<int>(intIdx++), promote });
+			else                                                                locs.push_back({ cls, -1 - static_cast<int>(stackIdx++), promote });
+		}
+
+		this->outgoingSize = std::max(this->outgoingSize, stackIdx * 8);
+
+		// stack arguments first, since they need scratch registers.
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			if(locs[i].index >= 0)
+				continue;
+
+			auto dst = Mem(RSP, 8 * (-1 - locs[i].index));
+			if(locs[i].cls == ArgClass::SSE)
+			{
+				this->loadFloat(XMM15, args[i]);
+				if(locs[i].promote)
+					this->as.cvtss2sd(XMM15, XMM15);
+
+				this->as.sseStore(dst, XMM15, locs[i].promote || isDouble(args[i]->getType()));
+			}
+			else if(locs[i].cls == ArgClass::Memory)
+			{
+				this->as.lea(RAX, this->locate(args[i], RAX));
+				this->as.store(dst, RAX, 8);
+			}
+			else
+			{
+				this->loadValue(RAX, args[i]);
+				this->as.store(dst, RAX, 8);
+			}
+		}
+
+		// each of these only touches its own register (and r11 for floats).
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			if(locs[i].index < 0)
+				continue;
+
+			if(locs[i].cls == ArgClass::SSE)
+			{
+				auto x = static_cast<XReg>(locs[i].index);
+
+				this->loadFloat(x, args[i]);
+				if(locs[i].promote)
+					this->as.cvtss2sd(x, x);
+			}
+			else
+			{
+				auto r = intArgRegs[locs[i].index];
+
+				if(locs[i].cls == ArgClass::Memory) this->as.lea(r, this->locate(args[i], r));
+				else                                this->loadValue(r, args[i]);
+			}
+		}
+
+		if(returnsMemory)
+			this->as.lea(RDI, this->slot(res));
+
+		// al tells varargs functions how many vector registers are used.
+		if(cvararg)
+			this->as.movRI(RAX, static_cast<int64_t>(sseIdx));
+
+		if(ok == fir::OpKind::Value_CallFunction)
+		{
+			this->as.call(this->getFunctionSymbol(callee));
+		}
+		else if(ok == fir::OpKind::Value_CallFunctionPointer)
+		{
+			this->loadValue(R11, inst->operands[0]);
+			this->as.callR(R11);
+		}
+		else
+		{
+			// the vtable pointer is the first thing in the class, and the vtable is just an array of function pointers.
+			auto idx = getIndex(inst->operands[1]);
+
+			this->loadValue(R11, args[0]);
+			this->as.load(R11, Mem(R11, 0), 8, false);
+			this->as.load(R11, Mem(R11, static_cast<int32_t>(8 * idx)), 8, false);
+			this->as.callR(R11);
+		}
+
+		if(!retty->isVoidType() && !returnsMemory)
+		{
+			if(classify(retty) == ArgClass::SSE)    this->storeFloat(res, XMM0);
+			else                                    this->storeResult(res, RAX);
+		}
+	}
+
+	void Compiler::emitInstruction(fir::Instruction* inst)
+	{
+		using fir::OpKind;
+
+		auto res = inst->realOutput;
+		auto& ops = inst->operands;
+
+		auto intBinary = [&](AluOp op) {
+			this->loadValue(RAX, ops[0]);
+			this->loadValue(RCX, ops[1]);
+			this->as.alu(op, RAX, RCX);
+			this->storeResult(res, RAX);
+		};
+
+		auto floatBinary = [&](SSEOp op) {
+			auto dbl = isDouble(res->getType());
+			this->loadFloat(XMM0, ops[0]);
+			this->loadFloat(XMM1, ops[1]);
+			this->as.sseOp(op, XMM0, XMM1, dbl);
+			this->storeFloat(res, XMM0);
+		};
+
+		auto intCompare = [&](Cond sgn, Cond uns) {
+			bool sext = ops[0]->getType()->isSignedIntType();
+			this->loadInt(RAX, ops[0], sext);
+			this->loadInt(RCX, ops[1], sext);
+			this->as.alu(AluOp::Cmp, RAX, RCX);
+			this->as.setcc(sext ? sgn : uns, RAX);
+			this->storeResult(res, RAX);
+		};
+
+		// without the 'unordered' flag, comparisons with nans are false.
+		auto floatCompare = [&](Cond c, bool swap, bool unordered) {
+			this->loadFloat(XMM0, ops[0]);
+			this->loadFloat(XMM1, ops[1]);
+
+			if(swap)    this->as.ucomis(XMM1, XMM0, isDouble(ops[0]->getType()));
+			else        this->as.ucomis(XMM0, XMM1, isDouble(ops[0]->getType()));
+
+			this->as.setcc(c, RAX);
+			if(unordered)
+			{
+				this->as.setcc(Cond::P, RCX);
+				this->as.alu(AluOp::Or, RAX, RCX);
+			}
+			else
+			{
+				this->as.setcc(Cond::NP, RCX);
+				this->as.alu(AluOp::And, RAX, RCX);
+			}
+
+			this->storeResult(res, RAX);
+		};
+
+		auto extract = [&](size_t idx) {
+			auto src = this->locate(ops[0], RSI);
+			this->copyMem(this->slot(res), src.offset(static_cast<int32_t>(getFieldOffset(ops[0]->getType(), idx))),
+				sizeOf(res->getType()));
+		};
+
+		auto insert = [&](size_t idx) {
+			auto dst = this->slot(res);
+			this->copyValue(dst, ops[0]);
+			this->copyValue(dst.offset(static_cast<int32_t>(getFieldOffset(ops[0]->getType(), idx))), ops[1]);
+		};
+
+		bool isFloat = res->getType()->isFloatingPointType();
+		switch(inst->opKind)
+		{
+			case OpKind::Signed_Add:
+			case OpKind::Unsigned_Add:
+			case OpKind::Floating_Add:
+				if(isFloat) floatBinary(SSEOp::Add);
+				else        intBinary(AluOp::Add);
+				break;
+
+			case OpKind::Signed_Sub:
+			case OpKind::Unsigned_Sub:
+			case OpKind::Floating_Sub:
+				if(isFloat) floatBinary(SSEOp::Sub);
+				else        intBinary(AluOp::Sub);
+				break;
+
+			case OpKind::Signed_Mul:
+			case OpKind::Unsigned_Mul:
+			case OpKind::Floating_Mul:
+				if(isFloat)
+				{
+					floatBinary(SSEOp::Mul);
+				}
+				else
+				{
+					this->loadValue(RAX, ops[0]);
+					this->loadValue(RCX, ops[1]);
+					this->as.imul(RAX, RCX);
+					this->storeResult(res, RAX);
+				}
+				break;
+
+			case OpKind::Signed_Div:
+			case OpKind::Unsigned_Div:
+			case OpKind::Floating_Div:
+			case OpKind::Signed_Mod:
+			case OpKind::Unsigned_Mod:
+			{
+				if(isFloat)
+				{
+					floatBinary(SSEOp::Div);
+					break;
+				}
+
+				// the operands are extended to 64 bits first, so this gives the same answer as the narrower ones.
+				bool sgn = (inst->opKind == OpKind::Signed_Div || inst->opKind == OpKind::Signed_Mod);
+				this->loadInt(RAX, ops[0], sgn);
+				this->loadInt(RCX, ops[1], sgn);
+
+				if(sgn)
+				{
+					this->as.cqo();
+					this->as.unary(UnaryOp::IDiv, RCX);
+				}
+				else
+				{
+					this->as.alu(AluOp::Xor, RDX, RDX);
+					this->as.unary(UnaryOp::Div, RCX);
+				}
+
+				bool mod = (inst->opKind == OpKind::Signed_Mod || inst->opKind == OpKind::Unsigned_Mod);
+				this->storeResult(res, mod ? RDX : RAX);
+				break;
+			}
+
+			case OpKind::Floating_Mod:
+			{
+				// sse doesn't have a remainder, and we don't want to drag in libm for fmod().
+				auto dbl = isDouble(res->getType());
+				this->as.fld(this->locate(ops[1], RSI), dbl);
+				this->as.fld(this->locate(ops[0], RSI), dbl);
+
+				auto loop = this->as.newLabel();
+				this->as.bind(loop);
+				this->as.fprem();
+				this->as.fnstswAX();
+				this->as.raw({ 0xF6, 0xC4, 0x04 });     // test ah, 4 (ie. C2, the remainder is incomplete)
+				this->as.jcc(Cond::NE, loop);
+
+				this->as.fstpST1();
+				this->as.fstp(this->slot(res), dbl);
+				break;
+			}
+
+
+			case OpKind::ICompare_Equal:            intCompare(Cond::E, Cond::E); break;
+			case OpKind::ICompare_NotEqual:         intCompare(Cond::NE, Cond::NE); break;
+			case OpKind::ICompare_Greater:          intCompare(Cond::G, Cond::A); break;
+			case OpKind::ICompare_Less:             intCompare(Cond::L, Cond::B); break;
+			case OpKind::ICompare_GreaterEqual:     intCompare(Cond::GE, Cond::AE); break;
+			case OpKind::ICompare_LessEqual:        intCompare(Cond::LE, Cond::BE); break;
+
+			case OpKind::FCompare_Equal_ORD:            floatCompare(Cond::E, false, false); break;
+			case OpKind::FCompare_Equal_UNORD:          floatCompare(Cond::E, false, true); break;
+			case OpKind::FCompare_NotEqual_ORD:         floatCompare(Cond::NE, false, false); break;
+			case OpKind::FCompare_NotEqual_UNORD:       floatCompare(Cond::NE, false, true); break;
+			case OpKind::FCompare_Greater_ORD:          floatCompare(Cond::A, false, false); break;
+			case OpKind::FCompare_Greater_UNORD:        floatCompare(Cond::A, false, true); break;
+			case OpKind::FCompare_GreaterEqual_ORD:     floatCompare(Cond::AE, false, false); break;
+			case OpKind::FCompare_GreaterEqual_UNORD:   floatCompare(Cond::AE, false, true); break;
+			case OpKind::FCompare_Less_ORD:             floatCompare(Cond::A, true, false); break;
+			case OpKind::FCompare_Less_UNORD:           floatCompare(Cond::A, true, true); break;
+			case OpKind::FCompare_LessEqual_ORD:        floatCompare(Cond::AE, true, false); break;
+			case OpKind::FCompare_LessEqual_UNORD:      floatCompare(Cond::AE, true, true); break;
+
+			case OpKind::ICompare_Multi:
+			case OpKind::FCompare_Multi:
+			{
+				// -1, 0, or 1.
+				Cond gt = Cond::A;
+				Cond lt = Cond::B;
+
+				if(ops[0]->getType()->isFloatingPointType())
+				{
+					this->loadFloat(XMM0, ops[0]);
+					this->loadFloat(XMM1, ops[1]);
+					this->as.ucomis(XMM0, XMM1, isDouble(ops[0]->getType()));
+				}
+				else
+				{
+					bool sext = ops[0]->getType()->isSignedIntType();
+					if(sext) gt = Cond::G, lt = Cond::L;
+
+					this->loadInt(RAX, ops[0], sext);
+					this->loadInt(RCX, ops[1], sext);
+					this->as.alu(AluOp::Cmp, RAX, RCX);
+				}
+
+				this->as.setcc(gt, RAX);
+				this->as.setcc(lt, RCX);
+				this->as.movzx8(RAX, RAX);
+				this->as.movzx8(RCX, RCX);
+				this->as.alu(AluOp::Sub, RAX, RCX);
+				this->storeResult(res, RAX);
+				break;
+			}
+
+
+			case OpKind::Bitwise_Xor:   intBinary(AluOp::Xor); break;
+			case OpKind::Bitwise_And:   intBinary(AluOp::And); break;
+			case OpKind::Bitwise_Or:    intBinary(AluOp::Or); break;
+
+			case OpKind::Bitwise_Shl:
+			case OpKind::Bitwise_Logical_Shr:
+			case OpKind::Bitwise_Arithmetic_Shr:
+			{
+				bool arith = (inst->opKind == OpKind::Bitwise_Arithmetic_Shr);
+				this->loadInt(RAX, ops[0], arith);
+				this->loadValue(RCX, ops[1]);
+
+				if(inst->opKind == OpKind::Bitwise_Shl) this->as.shift(ShiftOp::Shl, RAX);
+				else if(arith)                          this->as.shift(ShiftOp::Sar, RAX);
+				else                                    this->as.shift(ShiftOp::Shr, RAX);
+
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Signed_Neg:
+			case OpKind::Floating_Neg:
+			{
+				if(isFloat)
+				{
+					// just flip the sign bit.
+					this->loadInt(RAX, ops[0], false);
+					this->as.movRI(RCX, isDouble(res->getType()) ? static_cast<int64_t>(1ULL << 63) : (1LL << 31));
+					this->as.alu(AluOp::Xor, RAX, RCX);
+				}
+				else
+				{
+					this->loadValue(RAX, ops[0]);
+					this->as.unary(UnaryOp::Neg, RAX);
+				}
+
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Bitwise_Not:
+			{
+				this->loadValue(RAX, ops[0]);
+				this->as.unary(UnaryOp::Not, RAX);
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Logical_Not:
+			{
+				this->loadValue(RAX, ops[0]);
+				this->as.test(RAX, RAX);
+				this->as.setcc(Cond::E, RAX);
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Floating_Truncate:
+			case OpKind::Floating_Extend:
+			{
+				bool from = isDouble(ops[0]->getType());
+				bool to = isDouble(ops[1]->getType());
+
+				this->loadFloat(XMM0, ops[0]);
+				if(from && !to)         this->as.cvtsd2ss(XMM0, XMM0);
+				else if(!from && to)    this->as.cvtss2sd(XMM0, XMM0);
+
+				this->as.sseStore(this->slot(res), XMM0, to);
+				break;
+			}
+
+
+			case OpKind::Value_ReadPtr:
+			{
+				this->loadValue(RSI, ops[0]);
+				this->copyMem(this->slot(res), Mem(RSI, 0), sizeOf(res->getType()));
+				break;
+			}
+
+			case OpKind::Value_WritePtr:
+			{
+				this->loadValue(RDI, ops[1]);
+				this->copyValue(Mem(RDI, 0), ops[0]);
+				break;
+			}
+
+			case OpKind::Value_Store:
+			{
+				this->loadAddress(RDI, ops[1]);
+				this->copyValue(Mem(RDI, 0), ops[0]);
+				break;
+			}
+
+			case OpKind::Value_CreateLVal:
+			case OpKind::Value_StackAlloc:
+			{
+				// these are zeroed every time we get here, same as the interpreter.
+				auto mem = Mem(RBP, this->allocations[res]);
+				this->zeroMem(mem, sizeOf(ops[0]->getType()));
+
+				this->as.lea(RAX, mem);
+				this->as.store(this->slot(res), RAX, 8);
+				break;
+			}
+
+			case OpKind::Value_AddressOf:
+			case OpKind::RawUnion_GEP:
+			{
+				this->loadAddress(RAX, ops[0]);
+				this->as.store(this->slot(res), RAX, 8);
+				break;
+			}
+
+			case OpKind::Value_Dereference:
+			{
+				this->loadValue(RAX, ops[0]);
+				this->as.store(this->slot(res), RAX, 8);
+				break;
+			}
+
+			case OpKind::Value_GetStructMember:
+			{
+				auto ofs = getFieldOffset(ops[0]->getType(), getIndex(ops[1]));
+
+				this->loadAddress(RAX, ops[0]);
+				this->as.lea(RAX, Mem(RAX, static_cast<int32_t>(ofs)));
+				this->as.store(this->slot(res), RAX, 8);
+				break;
+			}
+
+			case OpKind::Value_GetPointer:
+			case OpKind::Value_GetGEP2:
+			{
+				auto ptrty = ops[0]->getType();
+				iceAssert(ptrty->isPointerType());
+
+				auto elmty = ptrty->getPointerElementType();
+
+				std::vector<std::pair<fir::Value*, size_t>> indices;
+				if(inst->opKind == OpKind::Value_GetPointer)
+				{
+					indices.push_back({ ops[1], sizeOf(elmty) });
+				}
+				else
+				{
+					indices.push_back({ ops[1], sizeOf(elmty) });
+					indices.push_back({ ops[2], sizeOf(elmty->getArrayElementType()) });
+				}
+
+				this->loadValue(RAX, ops[0]);
+				for(const auto& [ idx, scale ] : indices)
+				{
+					this->loadValue(RCX, idx);
+					this->as.movRI(RDX, static_cast<int64_t>(scale));
+					this->as.imul(RCX, RDX);
+					this->as.alu(AluOp::Add, RAX, RCX);
+				}
+
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Misc_Sizeof:
+			{
+				this->as.movRI(RAX, static_cast<int64_t>(sizeOf(ops[0]->getType())));
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Value_Select:
+			{
+				auto other = this->as.newLabel();
+				auto done = this->as.newLabel();
+
+				this->loadValue(RAX, ops[0]);
+				this->as.test(RAX, RAX);
+				this->as.jcc(Cond::E, other);
+
+				this->copyValue(this->slot(res), ops[1]);
+				this->as.jmp(done);
+
+				this->as.bind(other);
+				this->copyValue(this->slot(res), ops[2]);
+
+				this->as.bind(done);
+				break;
+			}
+
+			case OpKind::Value_InsertValue:
+			{
+				auto dst = this->slot(res);
+				this->copyValue(dst, ops[0]);
+				this->copyValue(dst.offset(static_cast<int32_t>(getFieldOffset(ops[0]->getType(), getIndex(ops[2])))), ops[1]);
+				break;
+			}
+
+			case OpKind::Value_ExtractValue:    extract(getIndex(ops[1])); break;
+
+			case OpKind::SAA_GetData:           extract(SAA_DATA_INDEX); break;
+			case OpKind::SAA_GetLength:         extract(SAA_LENGTH_INDEX); break;
+			case OpKind::SAA_GetCapacity:       extract(SAA_CAPACITY_INDEX); break;
+			case OpKind::SAA_GetRefCountPtr:    extract(SAA_REFCOUNTPTR_INDEX); break;
+			case OpKind::SAA_SetData:           insert(SAA_DATA_INDEX); break;
+			case OpKind::SAA_SetLength:         insert(SAA_LENGTH_INDEX); break;
+			case OpKind::SAA_SetCapacity:       insert(SAA_CAPACITY_INDEX); break;
+			case OpKind::SAA_SetRefCountPtr:    insert(SAA_REFCOUNTPTR_INDEX); break;
+
+			case OpKind::ArraySlice_GetData:    extract(SLICE_DATA_INDEX); break;
+			case OpKind::ArraySlice_GetLength:  extract(SLICE_LENGTH_INDEX); break;
+			case OpKind::ArraySlice_SetData:    insert(SLICE_DATA_INDEX); break;
+			case OpKind::ArraySlice_SetLength:  insert(SLICE_LENGTH_INDEX); break;
+
+			case OpKind::Any_GetTypeID:         extract(ANY_TYPEID_INDEX); break;
+			case OpKind::Any_GetRefCountPtr:    extract(ANY_REFCOUNTPTR_INDEX); break;
+			case OpKind::Any_GetData:           extract(ANY_DATA_ARRAY_INDEX); break;
+			case OpKind::Any_SetTypeID:         insert(ANY_TYPEID_INDEX); break;
+			case OpKind::Any_SetRefCountPtr:    insert(ANY_REFCOUNTPTR_INDEX); break;
+			case OpKind::Any_SetData:           insert(ANY_DATA_ARRAY_INDEX); break;
+
+			case OpKind::Range_GetLower:        extract(0); break;
+			case OpKind::Range_GetUpper:        extract(1); break;
+			case OpKind::Range_GetStep:         extract(2); break;
+			case OpKind::Range_SetLower:        insert(0); break;
+			case OpKind::Range_SetUpper:        insert(1); break;
+			case OpKind::Range_SetStep:         insert(2); break;
+
+			case OpKind::Enum_GetIndex:         extract(0); break;
+			case OpKind::Enum_GetValue:         extract(1); break;
+			case OpKind::Enum_SetIndex:         insert(0); break;
+			case OpKind::Enum_SetValue:         insert(1); break;
+
+			case OpKind::Union_GetVariantID:    extract(0); break;
+			case OpKind::Union_SetVariantID:    insert(0); break;
+
+			case OpKind::Union_GetValue:
+			{
+				// the id comes first, then the data.
+				auto word = static_cast<int32_t>(sizeOf(fir::Type::getNativeWord()));
+				auto src = this->locate(ops[0], RSI);
+
+				this->copyMem(this->slot(res), src.offset(word), sizeOf(res->getType()));
+				break;
+			}
+
+			case OpKind::Union_SetValue:
+			{
+				auto word = static_cast<int32_t>(sizeOf(fir::Type::getNativeWord()));
+				auto dst = this->slot(res);
+
+				this->copyValue(dst, ops[0]);
+
+				this->as.movRI(RAX, static_cast<int64_t>(getIndex(ops[1])));
+				this->as.store(dst, RAX, static_cast<size_t>(word));
+
+				this->copyValue(dst.offset(word), ops[2]);
+				break;
+			}
+
+
+			case OpKind::Cast_IntSize:
+			case OpKind::Integer_ZeroExt:
+			case OpKind::Integer_Truncate:
+			{
+				if(res->getType()->isBoolType())
+				{
+					this->loadValue(RAX, ops[0]);
+					this->as.test(RAX, RAX);
+					this->as.setcc(Cond::NE, RAX);
+				}
+				else
+				{
+					bool sext = (inst->opKind != OpKind::Integer_ZeroExt) && ops[0]->getType()->isSignedIntType();
+					this->loadInt(RAX, ops[0], sext);
+				}
+
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Cast_Bitcast:
+			case OpKind::Cast_Signedness:
+			case OpKind::Cast_IntSignedness:
+			case OpKind::Cast_PointerType:
+			case OpKind::Cast_PointerToInt:
+			case OpKind::Cast_IntToPointer:
+			{
+				auto from = ops[0]->getType();
+				auto fromSize = sizeOf(from);
+				auto toSize = sizeOf(res->getType());
+
+				if(res->islvalue())
+				{
+					this->loadAddress(RAX, ops[0]);
+					this->as.store(this->slot(res), RAX, 8);
+				}
+				else if(fromSize <= 8 && toSize <= 8 && (isIntegral(from) || from->isFloatingPointType()))
+				{
+					this->loadInt(RAX, ops[0], from->isSignedIntType());
+					this->storeResult(res, RAX);
+				}
+				else
+				{
+					this->copyMem(this->slot(res), this->locate(ops[0], RSI), std::min(fromSize, toSize));
+				}
+				break;
+			}
+
+			case OpKind::Cast_FloatToInt:
+			{
+				this->loadFloat(XMM0, ops[0]);
+				this->as.cvtts2si(RAX, XMM0, isDouble(ops[0]->getType()));
+				this->storeResult(res, RAX);
+				break;
+			}
+
+			case OpKind::Cast_IntToFloat:
+			{
+				auto from = ops[0]->getType();
+				bool dbl = isDouble(res->getType());
+
+				this->loadValue(RAX, ops[0]);
+				if(from->isSignedIntType() || sizeOf(from) < 8)
+				{
+					this->as.cvtsi2s(XMM0, RAX, dbl);
+				}
+				else
+				{
+					// cvtsi2sd is signed, so halve big numbers first (keeping the low bit, for rounding).
+					auto big = this->as.newLabel();
+					auto done = this->as.newLabel();
+
+					this->as.test(RAX, RAX);
+					this->as.jcc(Cond::S, big);
+					this->as.cvtsi2s(XMM0, RAX, dbl);
+					this->as.jmp(done);
+
+					this->as.bind(big);
+					this->as.movRR(RCX, RAX);
+					this->as.shiftImm(ShiftOp::Shr, RCX, 1);
+					this->as.aluImm(AluOp::And, RAX, 1);
+					this->as.alu(AluOp::Or, RCX, RAX);
+					this->as.cvtsi2s(XMM0, RCX, dbl);
+					this->as.sseOp(SSEOp::Add, XMM0, XMM0, dbl);
+
+					this->as.bind(done);
+				}
+
+				this->storeFloat(res, XMM0);
+				break;
+			}
+
+
+			case OpKind::Value_CallFunction:
+			case OpKind::Value_CallFunctionPointer:
+			case OpKind::Value_CallVirtualMethod:
+			{
+				this->emitCall(inst);
+				break;
+			}
+
+			case OpKind::Value_Return:
+			{
+				auto retty = this->fn->getReturnType();
+				if(!ops.empty() && !retty->isVoidType())
+				{
+					auto cls = classify(retty);
+					if(cls == ArgClass::SSE)
+					{
+						this->loadFloat(XMM0, ops[0]);
+					}
+					else if(cls == ArgClass::Integer)
+					{
+						this->loadValue(RAX, ops[0]);
+					}
+					else
+					{
+						this->as.load(RDI, Mem(RBP, this->returnPtrSlot), 8, false);
+						this->copyValue(Mem(RDI, 0), ops[0]);
+						this->as.load(RAX, Mem(RBP, this->returnPtrSlot), 8, false);
+					}
+				}
+				else
+				{
+					// so that a void main() exits with 0.
+					this->as.alu(AluOp::Xor, RAX, RAX);
+				}
+
+				this->as.leave();
+				this->as.ret();
+				break;
+			}
+
+			case OpKind::Branch_UnCond:
+			{
+				this->emitEdge(inst->getParentBlock(), dcast(fir::IRBlock, ops[0]));
+				break;
+			}
+
+			case OpKind::Branch_Cond:
+			{
+				auto blk = inst->getParentBlock();
+				auto iftrue = dcast(fir::IRBlock, ops[1]);
+				auto iffalse = dcast(fir::IRBlock, ops[2]);
+
+				this->loadValue(RAX, ops[0]);
+				this->as.test(RAX, RAX);
+
+				if(fir::passes::getPHIs(iftrue).empty())
+				{
+					this->as.jcc(Cond::NE, this->blockLabels[iftrue]);
+				}
+				else
+				{
+					auto other = this->as.newLabel();
+					this->as.jcc(Cond::E, other);
+
+					this->emitEdge(blk, iftrue);
+					this->as.bind(other);
+				}
+
+				this->emitEdge(blk, iffalse);
+				break;
+			}
+
+			case OpKind::Value_CreatePHI:
+			{
+				// these get their values on the way in, see emitEdge().
+				break;
+			}
+
+			case OpKind::Unreachable:
+			{
+				this->as.ud2();
+				break;
+			}
+
+			case OpKind::Value_GetPointerToStructMember:
+			case OpKind::Invalid:
+			default:
+			{
+				error("x64: unsupported instruction '%s' in function '%s'; use the llvm backend", inst->str(),
+					this->fn->getName().str());
+			}
+		}
+	}
+
+	void Compiler::compileFunction(fir::Function* f)
+	{
+		this->fn = f;
+		this->slots.clear();
+		this->allocations.clear();
+		this->phiTemps.clear();
+		this->blockLabels.clear();
+
+		auto sym = this->functionSymbols[f];
+		this->obj->text->align(16);
+		this->obj->symbols[sym].value = this->as.position();
+
+		this->prepareFrame();
+		this->emitPrologue();
+
+		for(auto b : f->getBlockList())
+		{
+			this->as.bind(this->blockLabels[b]);
+			for(auto inst : b->getInstructions())
+				this->emitInstruction(inst);
+		}
+
+		this->as.resolveLabels();
+
+		// rsp needs to stay 16-byte aligned for calls; pushing rbp already took care of the return address.
+		auto total = roundUp(this->frameSize + this->outgoingSize, 16);
+		this->as.patch32(this->frameFixup, static_cast<uint32_t>(total));
+
+		this->obj->symbols[sym].size = this->as.position() - this->obj->symbols[sym].value;
+	}
+	void Compiler::run()
+	{
+		auto byId = [](auto a, auto b) -> bool { return a->id < b->id; };
+
+		// symbols for everything first, since things can refer to each other in any order.
+		std::vector<fir::Function*> fns;
+		for(auto f : this->mod->getAllFunctions())
+		{
+			if(!f->getBlockList().empty())
+				fns.push_back(f);
+		}
+		std::sort(fns.begin(), fns.end(), byId);
+
+		for(auto f : fns)
+		{
+			Symbol sym;
+			sym.name = f->getName().mangled();
+			sym.section = this->obj->text;
+			sym.isLocal = (f->linkageType == fir::LinkageType::Internal);
+			sym.isWeak = (f->linkageType == fir::LinkageType::ExternalWeak);
+			sym.isFunction = true;
+
+			this->functionSymbols[f] = this->obj->addSymbol(sym);
+		}
+
+		for(const auto& [ str, gv ] : this->mod->_getGlobalStrings())
+			this->globalStrings[gv] = this->getString(str);
+
+		std::vector<std::pair<fir::Name, fir::GlobalVariable*>> globals(this->mod->_getGlobals().begin(),
+			this->mod->_getGlobals().end());
+
+		std::sort(globals.begin(), globals.end(), [&byId](const auto& a, const auto& b) -> bool {
+			return byId(a.second, b.second);
+		});
+
+		for(const auto& [ name, gv ] : globals)
+		{
+			auto sz = sizeOf(gv->getType());
+			auto ofs = this->obj->data->align(sz >= 16 ? 16 : 8);
+
+			this->obj->data->data.resize(ofs + sz);
+
+			Symbol sym;
+			sym.name = name.mangled();
+			sym.section = this->obj->data;
+			sym.value = ofs;
+			sym.size = sz;
+			sym.isLocal = (gv->linkageType == fir::LinkageType::Internal);
+			sym.isWeak = (gv->linkageType == fir::LinkageType::ExternalWeak);
+
+			this->globalSymbols[gv] = this->obj->addSymbol(sym);
+		}
+
+		// the initialisers can point at other globals, so they go in once all of them have symbols.
+		for(const auto& [ name, gv ] : globals)
+		{
+			auto init = gv->getInitialValue();
+			if(!init)
+				continue;
+
+			auto blob = this->makeBlob(init);
+			auto ofs = this->obj->symbols[this->globalSymbols[gv]].value;
+
+			std::copy(blob.bytes.begin(), blob.bytes.end(), this->obj->data->data.begin() + ofs);
+			for(auto r : blob.relocations)
+			{
+				r.offset += ofs;
+				this->obj->data->relocations.push_back(r);
+			}
+		}
+
+		for(auto f : fns)
+			this->compileFunction(f);
+
+		// the c runtime wants a main.
+		if(auto entry = this->mod->getEntryFunction(); entry && entry->getName().mangled() != "main")
+		{
+			auto it = this->functionSymbols.find(entry);
+			if(it == this->functionSymbols.end())
+				error("x64: entry function '%s' has no body", entry->getName().str());
+
+			auto sym = this->obj->symbols[it->second];
+			sym.name = "main";
+			sym.isLocal = false;
+			sym.isWeak = false;
+
+			this->obj->addSymbol(sym);
+		}
+	}
+
+
+	ObjectFile* compileModule(fir::Module* mod)
+	{
+		auto obj = new ObjectFile();
+
+		Compiler compiler(mod, obj);
+		compiler.run();
+
+		return obj;
+	}
+}
+}
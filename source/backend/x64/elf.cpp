@@ -0,0 +1,334 @@
+// elf.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "defs.h"
+#include "backends/x64.h"
+
+// just enough of ELF64 to make a relocatable object that the system linker is happy with.
+
+#define SHT_PROGBITS        1
+#define SHT_SYMTAB          2
+#define SHT_STRTAB          3
+#define SHT_RELA            4
+
+#define SHF_WRITE           0x01
+#define SHF_ALLOC           0x02
+#define SHF_EXECINSTR       0x04
+#define SHF_INFO_LINK       0x40
+
+#define STB_LOCAL           0
+#define STB_GLOBAL          1
+#define STB_WEAK            2
+
+#define STT_NOTYPE          0
+#define STT_OBJECT          1
+#define STT_FUNC            2
+#define STT_SECTION         3
+
+#define EM_X86_64           62
+
+namespace backend {
+namespace x64
+{
+	size_t Section::align(size_t a)
+	{
+		this->alignment = std::max(this->alignment, static_cast<uint64_t>(a));
+		while(this->data.size() % a != 0)
+			this->data.push_back(0);
+
+		return this->data.size();
+	}
+
+	ObjectFile::ObjectFile()
+	{
+		auto make = [this](const std::string& name, uint64_t flags, uint64_t align) -> Section* {
+			auto sec = new Section();
+			sec->name = name;
+			sec->type = SHT_PROGBITS;
+			sec->flags = flags;
+			sec->alignment = align;
+
+			Symbol sym;
+			sym.section = sec;
+			sym.isLocal = true;
+			sym.isSection = true;
+
+			sec->symbol = this->addSymbol(sym);
+
+			this->sections.push_back(sec);
+			return sec;
+		};
+
+		this->text = make(".text", SHF_ALLOC | SHF_EXECINSTR, 16);
+		this->rodata = make(".rodata", SHF_ALLOC, 16);
+		this->data = make(".data", SHF_ALLOC | SHF_WRITE, 16);
+
+		// so the linker doesn't think we want an executable stack.
+		make(".note.GNU-stack", 0, 1);
+	}
+
+	ObjectFile::~ObjectFile()
+	{
+		for(auto s : this->sections)
+			delete s;
+	}
+
+	size_t ObjectFile::addSymbol(const Symbol& sym)
+	{
+		this->symbols.push_back(sym);
+		return this->symbols.size() - 1;
+	}
+
+	size_t ObjectFile::getExternalSymbol(const std::string& name, bool weak)
+	{
+		if(auto it = this->externalSymbols.find(name); it != this->externalSymbols.end())
+			return it->second;
+
+		Symbol sym;
+		sym.name = name;
+		sym.isWeak = weak;
+
+		return (this->externalSymbols[name] = this->addSymbol(sym));
+	}
+
+
+
+
+	namespace {
+	struct Writer
+	{
+		std::vector<uint8_t> buf;
+
+		void u8(uint8_t x)      { this->buf.push_back(x); }
+		void u16(uint16_t x)    { for(int i = 0; i < 2; i++) this->u8(static_cast<uint8_t>(x >> (8 * i))); }
+		void u32(uint32_t x)    { for(int i = 0; i < 4; i++) this->u8(static_cast<uint8_t>(x >> (8 * i))); }
+		void u64(uint64_t x)    { for(int i = 0; i < 8; i++) this->u8(static_cast<uint8_t>(x >> (8 * i))); }
+
+		void bytes(const std::vector<uint8_t>& b) { this->buf.insert(this->buf.end(), b.begin(), b.end()); }
+
+		size_t align(size_t a)
+		{
+			while(this->buf.size() % a != 0)
+				this->buf.push_back(0);
+
+			return this->buf.size();
+		}
+	};
+
+	struct StringTable
+	{
+		std::vector<uint8_t> data = { 0 };
+
+		uint32_t add(const std::string& s)
+		{
+			if(s.empty())
+				return 0;
+
+			auto ret = static_cast<uint32_t>(this->data.size());
+			this->data.insert(this->data.end(), s.begin(), s.end());
+			this->data.push_back(0);
+
+			return ret;
+		}
+	};
+
+	struct SectionHeader
+	{
+		uint32_t name = 0;
+		uint32_t type = 0;
+		uint64_t flags = 0;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t link = 0;
+		uint32_t info = 0;
+		uint64_t alignment = 1;
+		uint64_t entsize = 0;
+	};
+	}
+
+	std::vector<uint8_t> ObjectFile::serialise()
+	{
+		// the section header indices: 0 is the null section, then ours, then the rela sections, and finally the
+		// symbol and string tables.
+		util::hash_map<Section*, uint16_t> sectionIndices;
+		for(size_t i = 0; i < this->sections.size(); i++)
+			sectionIndices[this->sections[i]] = static_cast<uint16_t>(i + 1);
+
+		// locals have to come before globals in the symbol table.
+		std::vector<size_t> order;
+		std::vector<uint32_t> symbolIndices(this->symbols.size());
+		{
+			for(size_t i = 0; i < this->symbols.size(); i++)
+				if(this->symbols[i].isLocal) order.push_back(i);
+
+			for(size_t i = 0; i < this->symbols.size(); i++)
+				if(!this->symbols[i].isLocal) order.push_back(i);
+
+			for(size_t i = 0; i < order.size(); i++)
+				symbolIndices[order[i]] = static_cast<uint32_t>(i + 1);
+		}
+
+		StringTable strtab;
+		StringTable shstrtab;
+
+		Writer symtab;
+		{
+			// the null symbol.
+			for(int i = 0; i < 24; i++)
+				symtab.u8(0);
+
+			for(auto i : order)
+			{
+				auto& sym = this->symbols[i];
+
+				uint8_t bind = (sym.isLocal ? STB_LOCAL : (sym.isWeak ? STB_WEAK : STB_GLOBAL));
+				uint8_t type = STT_NOTYPE;
+
+				if(sym.isSection)       type = STT_SECTION;
+				else if(!sym.section)   type = STT_NOTYPE;
+				else if(sym.isFunction) type = STT_FUNC;
+				else                    type = STT_OBJECT;
+
+				symtab.u32(strtab.add(sym.name));
+				symtab.u8(static_cast<uint8_t>((bind << 4) | type));
+				symtab.u8(0);
+				symtab.u16(sym.section ? sectionIndices[sym.section] : 0);
+				symtab.u64(sym.value);
+				symtab.u64(sym.size);
+			}
+		}
+
+		size_t firstGlobal = 1 + std::count_if(this->symbols.begin(), this->symbols.end(), [](const Symbol& s) -> bool {
+			return s.isLocal;
+		});
+
+
+		Writer out;
+
+		// the header gets filled in at the end.
+		out.buf.resize(64);
+
+		std::vector<SectionHeader> headers(1);
+		for(auto sec : this->sections)
+		{
+			SectionHeader sh;
+			sh.name = shstrtab.add(sec->name);
+			sh.type = sec->type;
+			sh.flags = sec->flags;
+			sh.alignment = sec->alignment;
+			sh.offset = out.align(std::max(sec->alignment, static_cast<uint64_t>(1)));
+			sh.size = sec->data.size();
+
+			out.bytes(sec->data);
+			headers.push_back(sh);
+		}
+
+		auto symtabIndex = static_cast<uint32_t>(headers.size() + std::count_if(this->sections.begin(), this->sections.end(),
+			[](Section* s) -> bool { return !s->relocations.empty(); }));
+
+		for(auto sec : this->sections)
+		{
+			if(sec->relocations.empty())
+				continue;
+
+			SectionHeader sh;
+			sh.name = shstrtab.add(".rela" + sec->name);
+			sh.type = SHT_RELA;
+			sh.flags = SHF_INFO_LINK;
+			sh.alignment = 8;
+			sh.entsize = 24;
+			sh.link = symtabIndex;
+			sh.info = sectionIndices[sec];
+			sh.offset = out.align(8);
+
+			for(const auto& r : sec->relocations)
+			{
+				out.u64(r.offset);
+				out.u64((static_cast<uint64_t>(symbolIndices[r.symbol]) << 32) | static_cast<uint32_t>(r.kind));
+				out.u64(static_cast<uint64_t>(r.addend));
+			}
+
+			sh.size = sec->relocations.size() * 24;
+			headers.push_back(sh);
+		}
+
+		iceAssert(headers.size() == symtabIndex);
+		{
+			SectionHeader sh;
+			sh.name = shstrtab.add(".symtab");
+			sh.type = SHT_SYMTAB;
+			sh.alignment = 8;
+			sh.entsize = 24;
+			sh.link = symtabIndex + 1;
+			sh.info = static_cast<uint32_t>(firstGlobal);
+			sh.offset = out.align(8);
+			sh.size = symtab.buf.size();
+
+			out.bytes(symtab.buf);
+			headers.push_back(sh);
+		}
+		{
+			SectionHeader sh;
+			sh.name = shstrtab.add(".strtab");
+			sh.type = SHT_STRTAB;
+			sh.offset = out.buf.size();
+			sh.size = strtab.data.size();
+
+			out.bytes(strtab.data);
+			headers.push_back(sh);
+		}
+		{
+			SectionHeader sh;
+			sh.name = shstrtab.add(".shstrtab");
+			sh.type = SHT_STRTAB;
+			sh.offset = out.buf.size();
+
+			// the name of this one needs to be in the table too, so it has to be added before we take the size.
+			sh.size = shstrtab.data.size();
+
+			out.bytes(shstrtab.data);
+			headers.push_back(sh);
+		}
+
+		auto shoff = out.align(8);
+		for(const auto& sh : headers)
+		{
+			out.u32(sh.name);
+			out.u32(sh.type);
+			out.u64(sh.flags);
+			out.u64(0);
+			out.u64(sh.offset);
+			out.u64(sh.size);
+			out.u32(sh.link);
+			out.u32(sh.info);
+			out.u64(sh.alignment);
+			out.u64(sh.entsize);
+		}
+
+
+		Writer hdr;
+		hdr.bytes({ 0x7F, 'E', 'L', 'F', /* 64-bit: */ 2, /* little endian: */ 1, /* version: */ 1, /* sysv abi: */ 0 });
+		hdr.bytes(std::vector<uint8_t>(8, 0));
+
+		hdr.u16(1);             // relocatable
+		hdr.u16(EM_X86_64);
+		hdr.u32(1);
+		hdr.u64(0);             // entry
+		hdr.u64(0);             // program headers
+		hdr.u64(shoff);
+		hdr.u32(0);             // flags
+		hdr.u16(64);            // size of this header
+		hdr.u16(0);
+		hdr.u16(0);
+		hdr.u16(64);            // size of a section header
+		hdr.u16(static_cast<uint16_t>(headers.size()));
+		hdr.u16(static_cast<uint16_t>(headers.size() - 1));
+
+		iceAssert(hdr.buf.size() == 64);
+		std::copy(hdr.buf.begin(), hdr.buf.end(), out.buf.begin());
+
+		return out.buf;
+	}
+}
+}
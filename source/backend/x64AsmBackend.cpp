@@ -2,28 +2,118 @@
 // Copyright (c) 2014 - 2016, zhiayang
 // Licensed under the Apache License Version 2.0.
 
+#include <chrono>
+#include <fstream>
+
+#include "defs.h"
 #include "backend.h"
+#include "frontend.h"
+#include "platform.h"
+
+#include "ir/module.h"
+#include "backends/x64.h"
+
+#include "tinyprocesslib/tinyprocess.h"
+
+template <typename T>
+static void _printTiming(T ts, const std::string& thing)
+{
+	if(frontend::getPrintProfileStats())
+	{
+		auto dur = std::chrono::high_resolution_clock::now() - ts;
+		auto ms = static_cast<double>(dur.count()) / 1000000.0;
+		printf("%s took %.1f ms%s\n", thing.c_str(), ms, ms > 3000 ? strprintf("  (aka %.2f s)", ms / 1000.0).c_str() : "");
+	}
+}
 
 namespace backend
 {
 	x64Backend::x64Backend(CompiledData& dat, const std::vector<std::string>& inputs, const std::string& output)
-		: Backend(0, dat, inputs, output)
+		: Backend(BackendCaps::EmitObject | BackendCaps::EmitProgram, dat, inputs, output)
+	{
+	}
+
+	x64Backend::~x64Backend()
 	{
+		delete this->object;
 	}
 
 	void x64Backend::performCompilation()
 	{
-		_error_and_exit("enotsup\n");
+		auto ts = std::chrono::high_resolution_clock::now();
+
+		this->object = x64::compileModule(this->compiledData.module);
+
+		_printTiming(ts, "x64 codegen");
 	}
 
 	void x64Backend::optimiseProgram()
 	{
-		_error_and_exit("enotsup\n");
+		// nothing to do here. main() runs the fir passes before picking a backend, but only above -O0, so the
+		// codegen can't count on them having run (and doesn't).
 	}
 
 	void x64Backend::writeOutput()
 	{
-		_error_and_exit("enotsup\n");
+		auto ts = std::chrono::high_resolution_clock::now();
+
+		if(frontend::getOutputMode() != ProgOutputMode::ObjectFile && !this->compiledData.module->getEntryFunction())
+			error("x64: no entry function marked, a program cannot be compiled");
+
+		auto base = this->compiledData.module->getModuleName();
+
+		std::string oname;
+		if(this->outputFilename.empty())
+		{
+			if(frontend::getOutputMode() == ProgOutputMode::ObjectFile)
+				oname = platform::compiler::getObjectFileName(base);
+
+			else
+				oname = platform::compiler::getExecutableName(base);
+		}
+		else
+		{
+			oname = this->outputFilename;
+		}
+
+		iceAssert(this->object);
+		auto buffer = this->object->serialise();
+
+		auto objname = (frontend::getOutputMode() == ProgOutputMode::ObjectFile ? oname : platform::compiler::getObjectFileName(base));
+		{
+			std::ofstream objectOutput(objname, std::ios::binary | std::ios::out);
+			objectOutput.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+			objectOutput.close();
+		}
+
+		if(frontend::getOutputMode() != ProgOutputMode::ObjectFile)
+		{
+			auto cmdline = platform::compiler::getCompilerCommandLine({ objname }, oname);
+
+			std::string sout;
+			std::string serr;
+
+			tinyproclib::Process proc(cmdline, "", [&sout](const char* bytes, size_t n) {
+				sout = std::string(bytes, n);
+			}, [&serr](const char* bytes, size_t n) {
+				serr = std::string(bytes, n);
+			});
+
+			// note: this waits for the process to finish.
+			int status = proc.get_exit_status();
+
+			if(status != 0)
+			{
+				if(!sout.empty()) fprintf(stderr, "%s\n", sout.c_str());
+				if(!serr.empty()) fprintf(stderr, "%s\n", serr.c_str());
+
+				fprintf(stderr, "linker returned non-zero (status = %d), exiting\n", status);
+				fprintf(stderr, "cmdline was: %s\n", cmdline.c_str());
+				exit(status);
+			}
+		}
+
+		_printTiming(ts, "outputting exe/obj");
 	}
 
 	std::string x64Backend::str()
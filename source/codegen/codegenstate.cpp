@@ -212,7 +212,7 @@ namespace cgn
 			// TODO
 			//! use constructClassWithArguments!!!
 
-			auto clsdef = dcast(sst::ClassDefn, this->typeDefnMap[type]);
+			auto clsdef = dcast(sst::ClassDefn, (*this->typeDefnMap)[type]);
 			iceAssert(clsdef);
 
 			clsdef->codegen(this);
@@ -381,7 +381,7 @@ namespace cgn
 			for(auto b : this->finalisedGlobalInitFunction->getBlockList())
 				delete b;
 
-			this->finalisedGlobalInitFunction->getBlockList().clear();
+			this->finalisedGlobalInitFunction->deleteBody();
 		}
 		else
 		{
@@ -48,7 +48,7 @@ fir::Value* cgn::CodegenState::getConstructedStructValue(fir::StructType* str, c
 
 fir::Value* cgn::CodegenState::constructClassWithArguments(fir::ClassType* cls, sst::FunctionDefn* constr, const std::vector<FnCallArgument>& args)
 {
-	if(auto c = this->typeDefnMap[cls])
+	if(auto c = (*this->typeDefnMap)[cls])
 		c->codegen(this);
 
 	auto initfn = cls->getInlineInitialiser();
@@ -2,16 +2,42 @@
 // Copyright (c) 2019, zhiayang
 // Licensed under the Apache License Version 2.0.
 
-#include <memory>
-
 #include "sst.h"
+#include "backend.h"
 #include "codegen.h"
 #include "platform.h"
+#include "frontend.h"
 
 #include "ir/interp.h"
+#include "ir/passes.h"
 
 #include "memorypool.h"
 
+// the interpreter state for #run is shared by the whole module (see CodegenState::interpState); it gets finalised
+// when codegen is done, in cgn::codegen().
+static fir::interp::InterpState* getCompileTimeInterpState(cgn::CodegenState* cs)
+{
+	if(!cs->interpState)
+		cs->interpState = new fir::interp::InterpState(cs->module);
+
+	auto is = cs->interpState;
+
+	// this only sets up globals that appeared since the last #run, and drops functions that changed.
+	is->initialise(/* runGlobalInit: */ false);
+
+	// instead of the whole global init function, run just the pieces that we haven't run yet -- so changes that
+	// an earlier #run made to a global don't get clobbered. if this #run is part of a global's initialiser, then
+	// its piece isn't finished yet, so leave it for later.
+	auto numPieces = cs->globalInitPieces.size() - (cs->isWithinGlobalInitFunction() ? 1 : 0);
+	for(; cs->globalInitPiecesRun < numPieces; cs->globalInitPiecesRun++)
+	{
+		auto piece = cs->globalInitPieces[cs->globalInitPiecesRun].second;
+		is->runFunction(is->compileFunction(piece), { });
+	}
+
+	return is;
+}
+
 fir::ConstantValue* magicallyRunExpressionAtCompileTime(cgn::CodegenState* cs, sst::Stmt* stmt, fir::Type* infer,
 	const fir::Name& fname, fir::interp::InterpState* is = 0)
 {
@@ -60,36 +86,36 @@ fir::ConstantValue* magicallyRunExpressionAtCompileTime(cgn::CodegenState* cs, s
 		if(restore) cs->irb.setCurrentBlock(restore);
 	}
 
-	// finalise the global init function if necessary:
-	cs->finishGlobalInitFunction();
-
 	// run the function:
 	fir::ConstantValue* ret = 0;
 	{
-		// this unique_ptr handles destructing the temporary interpState when we're done.
-		using unique_ptr_alias = std::unique_ptr<fir::interp::InterpState, std::function<void (fir::interp::InterpState*)>>;
-		auto ptr = unique_ptr_alias();
 		if(!is)
 		{
-			is = new fir::interp::InterpState(cs->module);
-			is->initialise(/* runGlobalInit: */ true);
-			ptr = unique_ptr_alias(is, [](fir::interp::InterpState* is) {
-				is->finalise();
-				delete is;
-			});
+			is = getCompileTimeInterpState(cs);
 		}
 		else
 		{
+			// finalise the global init function if necessary:
+			cs->finishGlobalInitFunction();
+
 			// new strategy: run the initialisers anyway.
 			is->initialise(/* runGlobalInit: */ true);
 
 			// caller code will finalise.
 		}
 
+		// the rest of the module isn't done yet so it can't go through the optimiser, but the runner itself can at
+		// least save on calls to the little helpers.
+		if(frontend::getOptLevel() > backend::OptimisationLevel::None)
+			fir::passes::inlineCalls(fn);
+
 		auto result = is->runFunction(is->compileFunction(fn), { });
 
 		if(!retty->isVoidType())
 			ret = is->unwrapInterpValueIntoConstant(result);
+
+		// the state outlives the runner function, so make sure it forgets about it.
+		is->compiledFunctions.erase(fn);
 	}
 
 	// please get rid of the runner function
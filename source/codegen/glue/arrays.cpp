@@ -603,6 +603,8 @@ namespace array
 				fir::FunctionType::get({ arrtype }, arrtype), fir::LinkageType::Internal);
 
 			func->setAlwaysInline();
+			if(increment)   func->setIsRefCountIncrement();
+			else            func->setIsRefCountDecrement();
 
 			fir::IRBlock* entry = cs->irb.addNewBlockInFunction("entry", func);
 			cs->irb.setCurrentBlock(entry);
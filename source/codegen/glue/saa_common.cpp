@@ -798,6 +798,9 @@ namespace saa_common
 				fir::FunctionType::get({ fir::Type::getNativeWord(), fir::Type::getNativeWord(), fir::Type::getCharSlice(false) },
 					fir::Type::getVoid()), fir::LinkageType::Internal);
 
+			// decomposition compares length against length, so the index can be one past the end.
+			func->setIsBoundsCheck(/* inclusive: */ isDecomp);
+
 			fir::IRBlock* entry = cs->irb.addNewBlockInFunction("entry", func);
 			fir::IRBlock* failb = cs->irb.addNewBlockInFunction("fail", func);
 			fir::IRBlock* checkneg = cs->irb.addNewBlockInFunction("checkneg", func);
@@ -271,7 +271,9 @@ CGResult sst::ForeachLoop::_codegen(cgn::CodegenState* cs, fir::Type* inferred)
 			this->body->preBodyCode = [cs, theptr, _array, iterptr, this]() {
 
 				// TODO: is this correct???
-				auto res = CGResult(cs->irb.Dereference(theptr));
+				// for ranges, the binding is a copy of the index; reading it (instead of going through the pointer)
+				// lets the optimiser keep the index in a register, and see what the loop does with it.
+				auto res = (_array->getType()->isRangeType() ? CGResult(cs->irb.ReadPtr(theptr)) : CGResult(cs->irb.Dereference(theptr)));
 				cs->generateDecompositionBindings(this->mappings, res, !(_array->getType()->isRangeType() || _array->getType()->isStringType()));
 
 				if(this->indexVar)
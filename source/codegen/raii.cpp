@@ -90,7 +90,7 @@ namespace cgn
 
 			iceAssert(trt->methods.size() == 1);
 
-			auto str = dcast(sst::StructDefn, cs->typeDefnMap[ty]);
+			auto str = dcast(sst::StructDefn, (*cs->typeDefnMap)[ty]);
 			iceAssert(str);
 
 			auto target = cs->findMatchingMethodInType(str, trt->methods[0]);
@@ -307,7 +307,7 @@ namespace cgn
 			return false;
 
 		auto str = ty->toStructType();
-		auto def = dcast(sst::StructDefn, cs->typeDefnMap[str]);
+		auto def = dcast(sst::StructDefn, (*cs->typeDefnMap)[str]);
 		iceAssert(def);
 
 		return zfu::matchAny(def->traits, [name](sst::TraitDefn* trt) -> bool {
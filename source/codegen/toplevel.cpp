@@ -30,7 +30,7 @@ namespace cgn
 		auto cs = new CodegenState(builder);
 		cs->module = mod;
 
-		cs->typeDefnMap = dtr->typeDefnMap;
+		cs->typeDefnMap = &dtr->typeDefnMap;
 		cs->compilerSupportDefinitions = dtr->compilerSupportDefinitions;
 
 		{
@@ -43,6 +43,13 @@ namespace cgn
 
 		mod->setEntryFunction(cs->entryFunction.first);
 
+		// write back whatever the #run directives did to the globals.
+		if(cs->interpState)
+		{
+			cs->interpState->finalise();
+			delete cs->interpState;
+		}
+
 		delete cs;
 		return mod;
 	}
@@ -30,7 +30,7 @@ CGResult sst::VarDefn::_codegen(cgn::CodegenState* cs, fir::Type* infer)
 		return nv;
 	};
 
-	if(auto it = cs->typeDefnMap.find(this->type); it != cs->typeDefnMap.end())
+	if(auto it = cs->typeDefnMap->find(this->type); it != cs->typeDefnMap->end())
 		it->second->codegen(cs);
 
 	if(this->global)
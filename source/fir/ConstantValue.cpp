@@ -16,6 +16,7 @@ namespace fir
 	ConstantValue::ConstantValue(Type* t) : Value(t)
 	{
 		this->kind = Kind::prvalue;
+		this->tracksUsers = false;
 	}
 
 	ConstantValue* ConstantValue::getZeroValue(Type* type)
@@ -78,20 +79,127 @@ namespace fir
 
 
 
-	ConstantNumber* ConstantNumber::get(ConstantNumberType* cnt, const mpfr::mpreal& n)
+	NumberValue NumberValue::ofSigned(int64_t x)
+	{
+		NumberValue ret;
+		ret.kind = Kind::Signed;
+		ret.sval = x;
+
+		return ret;
+	}
+
+	NumberValue NumberValue::ofUnsigned(uint64_t x)
+	{
+		NumberValue ret;
+		ret.kind = Kind::Unsigned;
+		ret.uval = x;
+
+		return ret;
+	}
+
+	NumberValue NumberValue::ofDouble(double x)
+	{
+		NumberValue ret;
+		ret.kind = Kind::Double;
+		ret.dval = x;
+
+		return ret;
+	}
+
+	NumberValue NumberValue::ofBig(const mpfr::mpreal& x)
+	{
+		NumberValue ret;
+		ret.kind = Kind::Big;
+		ret.big = new mpfr::mpreal(x);
+
+		return ret;
+	}
+
+	int64_t NumberValue::toLLong() const
+	{
+		switch(this->kind)
+		{
+			case Kind::Signed:      return this->sval;
+			case Kind::Unsigned:    return static_cast<int64_t>(std::min(this->uval, static_cast<uint64_t>(INT64_MAX)));
+			case Kind::Big:         return this->big->toLLong();
+
+			case Kind::Double:
+				// truncate towards zero, and saturate.
+				if(this->dval >= 0x1p63)        return INT64_MAX;
+				else if(this->dval < -0x1p63)   return INT64_MIN;
+				else                            return static_cast<int64_t>(this->dval);
+		}
+
+		return 0;
+	}
+
+	uint64_t NumberValue::toULLong() const
+	{
+		switch(this->kind)
+		{
+			case Kind::Signed:      return (this->sval < 0 ? 0 : static_cast<uint64_t>(this->sval));
+			case Kind::Unsigned:    return this->uval;
+			case Kind::Big:         return this->big->toULLong();
+
+			case Kind::Double:
+				if(this->dval >= 0x1p64)        return UINT64_MAX;
+				else if(this->dval <= -1.0)     return 0;
+				else                            return static_cast<uint64_t>(this->dval);
+		}
+
+		return 0;
+	}
+
+	float NumberValue::toFloat() const
+	{
+		// doubles come straight from the literal, so this is the only rounding that happens.
+		if(this->kind == Kind::Big) return this->big->toFloat();
+		else                        return static_cast<float>(this->toDouble());
+	}
+
+	double NumberValue::toDouble() const
+	{
+		switch(this->kind)
+		{
+			case Kind::Signed:      return static_cast<double>(this->sval);
+			case Kind::Unsigned:    return static_cast<double>(this->uval);
+			case Kind::Double:      return this->dval;
+			case Kind::Big:         return this->big->toDouble();
+		}
+
+		return 0;
+	}
+
+	std::string NumberValue::str() const
+	{
+		switch(this->kind)
+		{
+			case Kind::Signed:      return std::to_string(this->sval);
+			case Kind::Unsigned:    return std::to_string(this->uval);
+
+			// 6 decimal places, like default printf.
+			case Kind::Double:      return zpr::sprint("%.6f", this->dval);
+			case Kind::Big:         return this->big->toString("%.6Rf");
+		}
+
+		return "";
+	}
+
+
+
+	ConstantNumber* ConstantNumber::get(ConstantNumberType* cnt, const NumberValue& n)
 	{
 		return new ConstantNumber(cnt, n);
 	}
 
-	ConstantNumber::ConstantNumber(ConstantNumberType* cnt, const mpfr::mpreal& n) : ConstantValue(cnt)
+	ConstantNumber::ConstantNumber(ConstantNumberType* cnt, const NumberValue& n) : ConstantValue(cnt)
 	{
 		this->number = n;
 	}
 
 	std::string ConstantNumber::str()
 	{
-		// 6 decimal places, like default printf.
-		return this->number.toString("%.6R");
+		return this->number.str();
 	}
 
 
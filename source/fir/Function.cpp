@@ -86,11 +86,11 @@ namespace fir
 	{
 		for(auto a : this->fnArguments)
 		{
-			if(a->getName().name == name)
+			if(a->getName().getName() == name)
 				return a;
 		}
 
-		error("no argument named '%s' in function '%s'", name, this->getName().name);
+		error("no argument named '%s' in function '%s'", name, this->getName().getName());
 	}
 
 	bool Function::isCStyleVarArg()
@@ -112,6 +112,17 @@ namespace fir
 	void Function::deleteBody()
 	{
 		this->blocks.clear();
+		this->markModified();
+	}
+
+	size_t Function::getModificationCount()
+	{
+		return this->modificationCount;
+	}
+
+	void Function::markModified()
+	{
+		this->modificationCount += 1;
 	}
 
 	bool Function::isIntrinsicFunction()
@@ -168,6 +179,42 @@ namespace fir
 		this->alwaysInlined = true;
 	}
 
+	bool Function::isRefCountIncrement()
+	{
+		return this->refCountIncrement;
+	}
+
+	bool Function::isRefCountDecrement()
+	{
+		return this->refCountDecrement;
+	}
+
+	void Function::setIsRefCountIncrement()
+	{
+		this->refCountIncrement = true;
+	}
+
+	void Function::setIsRefCountDecrement()
+	{
+		this->refCountDecrement = true;
+	}
+
+	bool Function::isBoundsCheck()
+	{
+		return this->boundsCheck;
+	}
+
+	bool Function::isInclusiveBoundsCheck()
+	{
+		return this->boundsCheck && this->inclusiveBoundsCheck;
+	}
+
+	void Function::setIsBoundsCheck(bool inclusive)
+	{
+		this->boundsCheck = true;
+		this->inclusiveBoundsCheck = inclusive;
+	}
+
 
 
 
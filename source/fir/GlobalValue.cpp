@@ -43,6 +43,9 @@ namespace fir
 			error("storing value of '%s' in global var of type '%s'", constVal->getType(), this->getType());
 
 		this->initValue = constVal;
+
+		if(this->parentModule)
+			this->parentModule->_addChangedInitialValue(this);
 	}
 
 	ConstantValue* GlobalVariable::getInitialValue()
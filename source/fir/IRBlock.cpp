@@ -37,6 +37,7 @@ namespace fir
 			if(*it == this)
 			{
 				blist.erase(it);
+				this->parentFunction->markModified();
 				return;
 			}
 		}
@@ -44,6 +45,28 @@ namespace fir
 		iceAssert(0 && "not in function");
 	}
 
+	void IRBlock::addInstruction(Instruction* inst)
+	{
+		iceAssert(!inst->parentBlock && "already in a block");
+
+		this->instructions.push_back(inst);
+		inst->parentBlock = this;
+
+		if(this->parentFunction)
+			this->parentFunction->markModified();
+	}
+
+	void IRBlock::addInstructionAtFront(Instruction* inst)
+	{
+		iceAssert(!inst->parentBlock && "already in a block");
+
+		this->instructions.insert(this->instructions.begin(), inst);
+		inst->parentBlock = this;
+
+		if(this->parentFunction)
+			this->parentFunction->markModified();
+	}
+
 	std::vector<Instruction*>& IRBlock::getInstructions()
 	{
 		return this->instructions;
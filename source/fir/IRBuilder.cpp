@@ -84,10 +84,9 @@ namespace fir
 		iceAssert(this->currentBlock && "no current block");
 
 		// add instruction to the end of the block
-		this->currentBlock->instructions.push_back(instr);
+		this->currentBlock->addInstruction(instr);
 		Value* v = instr->realOutput;
 
-		// v->addUser(this->currentBlock);
 		v->setName(vname);
 		return v;
 	}
@@ -1164,13 +1163,13 @@ namespace fir
 		// this is an llvm requirement.
 
 		// MEMORY LEAK
-		instr->realOutput = new PHINode(type);
+		instr->setValue(new PHINode(type));
 		Value* ret = instr->realOutput;
 
 		ret->setName(vname);
 
 		// insert at the front (back = no guarantees)
-		this->currentBlock->instructions.insert(this->currentBlock->instructions.begin(), instr);
+		this->currentBlock->addInstructionAtFront(instr);
 		return dcast(PHINode, instr->realOutput);
 	}
 
@@ -1197,7 +1196,7 @@ namespace fir
 		iceAssert(entry);
 
 		// insert at the front (back = no guarantees)
-		entry->instructions.insert(entry->instructions.begin(), instr);
+		entry->addInstructionAtFront(instr);
 
 		return ret;
 	}
@@ -2109,7 +2108,7 @@ namespace fir
 		auto [ instr, entry ] = getInstrThatMakesLValue(this, type, vname);
 
 		// needs to be hoisted also
-		entry->instructions.insert(entry->instructions.begin(), instr);
+		entry->addInstructionAtFront(instr);
 
 		return instr->realOutput;
 	}
@@ -2250,6 +2249,7 @@ namespace fir
 		}
 
 		this->currentFunction->blocks.push_back(block);
+		this->currentFunction->markModified();
 
 		size_t cnt = 0;
 		for(auto b : this->currentFunction->blocks)
@@ -2285,6 +2285,7 @@ namespace fir
 				nb->setName(strprintf("%s%s", name, cnt > 0 ? strprintf(".%d", cnt) : ""));
 
 				this->currentFunction->blocks.insert(this->currentFunction->blocks.begin() + i + 1, nb);
+				this->currentFunction->markModified();
 				return nb;
 			}
 		}
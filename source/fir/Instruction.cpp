@@ -12,6 +12,14 @@
 namespace fir
 {
 	static util::MemoryPool<Value, 1 << 16> value_pool;
+
+	// see Function::markModified().
+	static void markModified(IRBlock* blk)
+	{
+		if(blk && blk->getParentFunction())
+			blk->getParentFunction()->markModified();
+	}
+
 	Instruction::Instruction(OpKind kind, bool sideeff, Type* out, const std::vector<Value*>& vals)
 		: Instruction(kind, sideeff, out, vals, Value::Kind::prvalue) { }
 
@@ -21,6 +29,10 @@ namespace fir
 		this->operands = vals;
 		this->sideEffects = sideeff;
 		this->realOutput = value_pool.construct(out, k);
+		this->realOutput->definingInstruction = this;
+
+		for(auto v : vals)
+			v->addUser(this);
 	}
 
 	Value* Instruction::getResult()
@@ -37,6 +49,87 @@ namespace fir
 	void Instruction::setValue(Value* v)
 	{
 		this->realOutput = v;
+		this->realOutput->definingInstruction = this;
+	}
+
+	IRBlock* Instruction::getParentBlock()
+	{
+		return this->parentBlock;
+	}
+
+	void Instruction::setOperand(size_t idx, Value* v)
+	{
+		iceAssert(idx < this->operands.size());
+
+		this->operands[idx]->removeUser(this);
+		this->operands[idx] = v;
+		v->addUser(this);
+
+		markModified(this->parentBlock);
+	}
+
+	void Instruction::replaceUsesOf(Value* from, Value* to)
+	{
+		for(size_t i = 0; i < this->operands.size(); i++)
+		{
+			if(this->operands[i] == from)
+				this->setOperand(i, to);
+		}
+	}
+
+	void Instruction::dropAllReferences()
+	{
+		for(auto op : this->operands)
+			op->removeUser(this);
+
+		this->operands.clear();
+
+		if(auto phi = dcast(PHINode, this->realOutput); phi)
+		{
+			for(const auto& [ blk, val ] : phi->getValues())
+				phi->removeIncoming(blk);
+		}
+	}
+
+	void Instruction::eraseFromParent()
+	{
+		iceAssert(this->parentBlock && "not in a block");
+		iceAssert(!this->realOutput->hasUsers() && "cannot erase instruction whose result is still used");
+
+		auto& insts = this->parentBlock->getInstructions();
+
+		auto it = std::find(insts.begin(), insts.end(), this);
+		iceAssert(it != insts.end());
+
+		insts.erase(it);
+		markModified(this->parentBlock);
+
+		this->dropAllReferences();
+		this->parentBlock = 0;
+	}
+
+	void Instruction::insertBefore(Instruction* pos)
+	{
+		iceAssert(!this->parentBlock && "already in a block");
+		iceAssert(pos->parentBlock && "not in a block");
+
+		auto& insts = pos->parentBlock->getInstructions();
+		insts.insert(std::find(insts.begin(), insts.end(), pos), this);
+
+		this->parentBlock = pos->parentBlock;
+		markModified(this->parentBlock);
+	}
+
+	void Instruction::insertAfter(Instruction* pos)
+	{
+		iceAssert(!this->parentBlock && "already in a block");
+		iceAssert(pos->parentBlock && "not in a block");
+
+		auto& insts = pos->parentBlock->getInstructions();
+		insts.insert(std::find(insts.begin(), insts.end(), pos) + 1, this);
+
+		this->parentBlock = pos->parentBlock;
+		markModified(this->parentBlock);
 	}
 
 	void Instruction::clearValue()
@@ -189,7 +282,7 @@ namespace fir
 			std::string nodes;
 
 			for(auto i : phi->getValues())
-				nodes += strprintf("[$%s -> %%%d], ", i.first->getName().name, i.second->id);
+				nodes += strprintf("[$%s -> %%%d], ", i.first->getName().getName(), i.second->id);
 
 			ops += nodes;
 		}
@@ -48,6 +48,7 @@ namespace fir
 
 			auto& blklist = entryfunc->getBlockList();
 			blklist.insert(blklist.begin(), newentry);
+			entryfunc->markModified();
 
 			builder.setCurrentBlock(newentry);
 
@@ -72,10 +73,13 @@ namespace fir
 	GlobalVariable* Module::createGlobalVariable(const Name& ident, Type* type, ConstantValue* initVal, bool isImmut, LinkageType linkage)
 	{
 		GlobalVariable* gv = new GlobalVariable(ident, this, type, isImmut, linkage, initVal);
+
 		if(this->globals.find(ident) != this->globals.end())
 			error("fir: already have a global with name '%s'", ident.str());
 
 		this->globals[ident] = gv;
+		this->globalsInOrder.push_back(gv);
+
 		return gv;
 	}
 
@@ -91,18 +95,18 @@ namespace fir
 
 	GlobalVariable* Module::tryGetGlobalVariable(const Name& id)
 	{
-		if(this->globals.find(id) == this->globals.end())
-			return 0;
+		if(auto it = this->globals.find(id); it != this->globals.end())
+			return it->second;
 
-		return this->globals[id];
+		return 0;
 	}
 
 	GlobalVariable* Module::getGlobalVariable(const Name& id)
 	{
-		if(this->globals.find(id) == this->globals.end())
-			error("fir: no such global with name '%s'", id.str());
+		if(auto it = this->globals.find(id); it != this->globals.end())
+			return it->second;
 
-		return this->globals[id];
+		error("fir: no such global with name '%s'", id.str());
 	}
 
 
@@ -163,10 +167,10 @@ namespace fir
 
 	Type* Module::getNamedType(const Name& id)
 	{
-		if(this->namedTypes.find(id) == this->namedTypes.end())
-			error("fir: no such type with name '%s'", id.str());
+		if(auto it = this->namedTypes.find(id); it != this->namedTypes.end())
+			return it->second;
 
-		return this->namedTypes[id];
+		error("fir: no such type with name '%s'", id.str());
 	}
 
 	void Module::addNamedType(const Name& id, Type* type)
@@ -211,10 +215,10 @@ namespace fir
 
 	Function* Module::getFunction(const Name& id)
 	{
-		if(this->functions.find(id) == this->functions.end())
-			return 0;
+		if(auto it = this->functions.find(id); it != this->functions.end())
+			return it->second;
 
-		return this->functions[id];
+		return 0;
 	}
 
 	std::vector<Function*> Module::getFunctionsWithName(const Name& id)
@@ -233,15 +237,15 @@ namespace fir
 
 	Function* Module::getOrCreateFunction(const Name& id, FunctionType* ftype, LinkageType linkage)
 	{
-		if(this->functions.find(id) != this->functions.end())
+		if(auto it = this->functions.find(id); it != this->functions.end())
 		{
-			if(!this->functions[id]->getType()->isTypeEqual(ftype))
+			if(!it->second->getType()->isTypeEqual(ftype))
 			{
 				error("fir: function '%s' redeclared with different type (have '%s', new '%s')", id.str(),
-					this->functions[id]->getType(), ftype);
+					it->second->getType(), ftype);
 			}
 
-			return this->functions[id];
+			return it->second;
 		}
 
 		Function* f = new Function(id, ftype, this, linkage);
@@ -286,6 +290,8 @@ namespace fir
 			Type::getInt8Ptr(), true, LinkageType::Internal, 0);
 
 		gs->setKind(Value::Kind::prvalue);
+		this->globalStringsInOrder.push_back({ str, gs });
+
 		return (this->globalStrings[str] = gs);
 	}
 
@@ -372,7 +378,7 @@ namespace fir
 			// do the args
 			for(auto arg : ffn->getArguments())
 			{
-				ret += strprintf("\n    arg %s (%%%d) :: %s", arg->getName().name, arg->id, arg->getType()->str());
+				ret += strprintf("\n    arg %s (%%%d) :: %s", arg->getName().getName(), arg->id, arg->getType()->str());
 			}
 
 
@@ -439,11 +445,10 @@ namespace fir
 			ft = FunctionType::get({ fir::Type::getNativeWord() }, fir::Type::getNativeWord());
 		}
 
-		if(this->intrinsicFunctions.find(name) != this->intrinsicFunctions.end())
-			return this->intrinsicFunctions[name];
+		if(auto it = this->intrinsicFunctions.find(name); it != this->intrinsicFunctions.end())
+			return it->second;
 
-		this->intrinsicFunctions[name] = new Function(name, ft, this, LinkageType::Internal);
-		return this->intrinsicFunctions[name];
+		return (this->intrinsicFunctions[name] = new Function(name, ft, this, LinkageType::Internal));
 	}
 
 
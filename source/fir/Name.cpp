@@ -6,9 +6,33 @@
 
 namespace fir
 {
+	size_t Name::hash() const
+	{
+		// most names (eg. of values) never get hashed, so don't do this in the constructor.
+		if(this->hashValue != 0)
+			return this->hashValue;
+
+		// types are unique, so hashing their pointers is fine.
+		size_t seed = 0;
+		_hash_combine(seed, static_cast<int>(this->kind));
+		_hash_combine(seed, this->name);
+
+		for(const auto& s : this->scope)
+			_hash_combine(seed, s);
+
+		for(auto p : this->params)
+			_hash_combine(seed, p);
+
+		_hash_combine(seed, this->retty);
+
+		this->hashValue = (seed == 0 ? 1 : seed);
+		return this->hashValue;
+	}
+
 	bool Name::operator== (const Name& other) const
 	{
-		return this->name == other.name
+		return this->hash() == other.hash()
+			&& this->name == other.name
 			&& this->scope == other.scope
 			&& this->params == other.params
 			&& this->retty == other.retty
@@ -58,7 +82,7 @@ namespace fir
 	{
 		bool first = true;
 		std::string ret;
-		for(const auto& s : id.scope)
+		for(const auto& s : id.getScope())
 		{
 			ret += (!first ? std::to_string(s.length()) : "") + s;
 			first = false;
@@ -74,7 +98,7 @@ namespace fir
 
 	static std::string mangleScopeName(const fir::Name& id)
 	{
-		return mangleScopeOnly(id) + lentypestr(id.name);
+		return mangleScopeOnly(id) + lentypestr(id.getName());
 	}
 
 	static std::string mangleType(fir::Type* t)
@@ -160,30 +184,30 @@ namespace fir
 
 	static std::string mangleName(const Name& id, bool includeScope)
 	{
-		if(id.kind == NameKind::Name || id.kind == NameKind::Type)
+		if(id.getKind() == NameKind::Name || id.getKind() == NameKind::Type)
 		{
 			std::string scp;
 			if(includeScope)
 				scp += mangleScopeOnly(id);
 
-			if(includeScope && id.scope.size() > 0)
-				scp += std::to_string(id.name.length());
+			if(includeScope && id.getScope().size() > 0)
+				scp += std::to_string(id.getName().length());
 
-			return scp + id.name;
+			return scp + id.getName();
 		}
 		else if(!includeScope)
 		{
-			if(id.kind == NameKind::Function)
+			if(id.getKind() == NameKind::Function)
 			{
-				std::string ret = id.name + "(";
+				std::string ret = id.getName() + "(";
 
-				if(id.params.empty())
+				if(id.getParams().empty())
 				{
 					ret += ")";
 				}
 				else
 				{
-					for(auto t : id.params)
+					for(auto t : id.getParams())
 						ret += t->str() + ",";
 
 					ret = ret.substr(0, ret.length() - 1);
@@ -201,22 +225,22 @@ namespace fir
 		{
 			std::string ret = "_F";
 
-			if(id.kind == NameKind::Function)     ret += "F";
-			else if(id.kind == NameKind::Type)    ret += "T";
+			if(id.getKind() == NameKind::Function)     ret += "F";
+			else if(id.getKind() == NameKind::Type)    ret += "T";
 			else                                ret += "U";
 
 			if(includeScope)
 				ret += mangleScopeOnly(id);
 
-			ret += lentypestr(id.name);
+			ret += lentypestr(id.getName());
 
-			if(id.kind == NameKind::Function)
+			if(id.getKind() == NameKind::Function)
 			{
 				ret += "_FA";
-				for(auto t : id.params)
+				for(auto t : id.getParams())
 					ret += "_" + mangleType(t);
 
-				if(id.params.empty())
+				if(id.getParams().empty())
 					ret += "v";
 			}
 
@@ -246,7 +270,10 @@ namespace fir
 
 	std::string Name::mangled() const
 	{
-		return mangleName(*this, true);
+		if(this->mangledName.empty())
+			this->mangledName = mangleName(*this, true);
+
+		return this->mangledName;
 	}
 
 	std::string Name::mangledWithoutScope() const
@@ -0,0 +1,635 @@
+// BoundsChecks.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/passes.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/instruction.h"
+
+#include <unordered_set>
+
+// every subscript calls the boundscheck glue, which is a lot of calls for a loop going over an array. we get rid
+// of the ones where we can tell the index is in range (constants, the same check done earlier, or an index that
+// can't leave the bounds of its loop), and move the ones in loops over ranges to just before the loop.
+
+namespace fir {
+namespace passes
+{
+	static size_t numRemoved = 0;
+	static size_t numHoisted = 0;
+
+	size_t getRemovedBoundsCheckCount()
+	{
+		return numRemoved;
+	}
+
+	size_t getHoistedBoundsCheckCount()
+	{
+		return numHoisted;
+	}
+
+	static Function* getCheck(Instruction* inst)
+	{
+		if(inst->opKind != OpKind::Value_CallFunction)
+			return 0;
+
+		auto fn = dcast(Function, inst->operands[0]);
+		return (fn && fn->isBoundsCheck()) ? fn : 0;
+	}
+
+	// ranges and slices are built up with the setters, then taken apart with the getters; look through that.
+	static Value* resolve(Value* v)
+	{
+		auto inst = v->getDefiningInstruction();
+		if(!inst || v->islvalue())
+			return v;
+
+		OpKind setter;
+		std::vector<OpKind> others;
+		switch(inst->opKind)
+		{
+			case OpKind::Range_GetLower:
+				setter = OpKind::Range_SetLower;
+				others = { OpKind::Range_SetUpper, OpKind::Range_SetStep };
+				break;
+
+			case OpKind::Range_GetUpper:
+				setter = OpKind::Range_SetUpper;
+				others = { OpKind::Range_SetLower, OpKind::Range_SetStep };
+				break;
+
+			case OpKind::Range_GetStep:
+				setter = OpKind::Range_SetStep;
+				others = { OpKind::Range_SetLower, OpKind::Range_SetUpper };
+				break;
+
+			case OpKind::ArraySlice_GetLength:
+				setter = OpKind::ArraySlice_SetLength;
+				others = { OpKind::ArraySlice_SetData };
+				break;
+
+			case OpKind::SAA_GetLength:
+				setter = OpKind::SAA_SetLength;
+				others = { OpKind::SAA_SetData, OpKind::SAA_SetCapacity, OpKind::SAA_SetRefCountPtr };
+				break;
+
+			default:
+				return v;
+		}
+
+		auto agg = inst->operands[0];
+		while(auto set = agg->getDefiningInstruction())
+		{
+			if(agg->islvalue())
+				break;
+
+			if(set->opKind == setter)
+				return resolve(set->operands[1]);
+
+			if(std::find(others.begin(), others.end(), set->opKind) == others.end())
+				break;
+
+			agg = set->operands[0];
+		}
+
+		return v;
+	}
+
+	// whether the two are definitely the same number. lvalues can change between reads, so they never are.
+	static bool isSameValue(Value* a, Value* b)
+	{
+		a = resolve(a);
+		b = resolve(b);
+
+		if(a->islvalue() || b->islvalue())
+			return false;
+
+		if(a == b)
+			return true;
+
+		auto ca = dcast(ConstantInt, a);
+		auto cb = dcast(ConstantInt, b);
+		if(ca || cb)
+			return ca && cb && ca->getSignedValue() == cb->getSignedValue();
+
+		// the length of the same array value is the same length.
+		auto x = a->getDefiningInstruction();
+		auto y = b->getDefiningInstruction();
+
+		return x && y && x->opKind == y->opKind
+			&& (x->opKind == OpKind::SAA_GetLength || x->opKind == OpKind::ArraySlice_GetLength)
+			&& isSameValue(x->operands[0], y->operands[0]);
+	}
+
+	// a value plus a constant; the base is null for constants.
+	struct Linear
+	{
+		Value* base = 0;
+		int64_t offset = 0;
+	};
+
+	static Linear getLinear(Value* v)
+	{
+		v = resolve(v);
+		if(auto ci = dcast(ConstantInt, v))
+			return { 0, ci->getSignedValue() };
+
+		auto inst = v->getDefiningInstruction();
+		if(inst && (inst->opKind == OpKind::Signed_Add || inst->opKind == OpKind::Signed_Sub))
+		{
+			auto a = dcast(ConstantInt, resolve(inst->operands[0]));
+			auto b = dcast(ConstantInt, resolve(inst->operands[1]));
+
+			if(b)
+			{
+				auto ret = getLinear(inst->operands[0]);
+				ret.offset += (inst->opKind == OpKind::Signed_Add ? b->getSignedValue() : -b->getSignedValue());
+				return ret;
+			}
+			else if(a && inst->opKind == OpKind::Signed_Add)
+			{
+				auto ret = getLinear(inst->operands[1]);
+				ret.offset += a->getSignedValue();
+				return ret;
+			}
+		}
+
+		return { v, 0 };
+	}
+
+	// idx < length (or <=), whether or not we know what either of them are.
+	static bool isBelow(Value* length, const Linear& idx, bool inclusive)
+	{
+		auto len = getLinear(length);
+		if(!idx.base != !len.base || (idx.base && !isSameValue(idx.base, len.base)))
+			return false;
+
+		return inclusive ? idx.offset <= len.offset : idx.offset < len.offset;
+	}
+
+	static bool isInRange(Value* length, const Linear& idx, bool inclusive)
+	{
+		return !idx.base && idx.offset >= 0 && isBelow(length, idx, inclusive);
+	}
+
+
+
+
+	struct Loop
+	{
+		IRBlock* header = 0;
+
+		// the only block outside the loop that jumps to the header, if there's just one.
+		IRBlock* preheader = 0;
+
+		std::vector<IRBlock*> latches;
+		std::unordered_set<IRBlock*> blocks;
+	};
+
+	static std::vector<Loop> findLoops(Function* fn, const util::hash_map<IRBlock*, IRBlock*>& idom)
+	{
+		std::vector<Loop> loops;
+		auto preds = getPredecessors(fn);
+
+		for(auto b : fn->getBlockList())
+		{
+			Loop loop;
+			loop.header = b;
+
+			for(auto p : preds[b])
+			{
+				if(dominates(idom, b, p))
+					loop.latches.push_back(p);
+			}
+
+			if(loop.latches.empty())
+				continue;
+
+			// everything that gets to a latch without going through the header.
+			loop.blocks.insert(b);
+
+			auto worklist = loop.latches;
+			while(!worklist.empty())
+			{
+				auto x = worklist.back();
+				worklist.pop_back();
+
+				if(!loop.blocks.insert(x).second)
+					continue;
+
+				for(auto p : preds[x])
+					worklist.push_back(p);
+			}
+
+			for(auto p : preds[b])
+			{
+				if(loop.blocks.find(p) != loop.blocks.end())
+					continue;
+
+				loop.preheader = (loop.preheader ? 0 : p);
+				if(!loop.preheader) break;
+			}
+
+			loops.push_back(loop);
+		}
+
+		return loops;
+	}
+
+	// what we know about a loop counter, inside the body of its loop.
+	struct Induction
+	{
+		Loop* loop = 0;
+
+		// where the loop goes when the condition holds; the counter is only in range in the blocks it dominates.
+		IRBlock* body = 0;
+
+		// the counter stays between these two (inclusive). if they're ordered, then the first one is the smaller one;
+		// otherwise it could be going either way.
+		Value* first = 0;
+		Linear firstLinear;
+
+		Value* last = 0;
+		Linear lastLinear;
+
+		bool ordered = false;
+
+		// for loops over ranges, the counter goes from the lower bound to the upper bound one at a time, and the
+		// loop always runs at least once; that means we can check the ends before the loop starts.
+		bool canHoist = false;
+	};
+
+	static bool isICmp(Value* v, OpKind op, Value* a, Value* b)
+	{
+		auto inst = v->getDefiningInstruction();
+		return inst && inst->opKind == op && inst->operands[0] == a && (!b || isSameValue(inst->operands[1], b));
+	}
+
+	static bool isSelect(Value* v, Value** cond, int64_t a, int64_t b)
+	{
+		auto inst = v->getDefiningInstruction();
+		if(!inst || inst->opKind != OpKind::Value_Select)
+			return false;
+
+		auto x = dcast(ConstantInt, inst->operands[1]);
+		auto y = dcast(ConstantInt, inst->operands[2]);
+		if(!x || !y || x->getSignedValue() != a || y->getSignedValue() != b)
+			return false;
+
+		*cond = inst->operands[0];
+		return true;
+	}
+
+	static bool getInduction(Value* idx, std::vector<Loop>& loops, Induction* out)
+	{
+		auto phi = dcast(PHINode, resolve(idx));
+		if(!phi)
+			return false;
+
+		auto loop = std::find_if(loops.begin(), loops.end(), [phi](const Loop& l) -> bool {
+			return l.header == phi->getDefiningInstruction()->getParentBlock();
+		});
+
+		if(loop == loops.end() || !loop->preheader || loop->latches.size() != 1 || phi->getValues().size() != 2)
+			return false;
+
+		Value* init = 0;
+		Value* next = 0;
+		for(const auto& [ blk, val ] : phi->getValues())
+		{
+			if(blk == loop->preheader)          init = val;
+			else if(blk == loop->latches[0])    next = val;
+		}
+
+		// the counter goes up (or down) by the same amount every time.
+		auto inc = (next ? next->getDefiningInstruction() : 0);
+		if(!init || !inc || (inc->opKind != OpKind::Signed_Add && inc->opKind != OpKind::Signed_Sub))
+			return false;
+
+		Value* step = 0;
+		if(inc->operands[0] == phi)                                             step = inc->operands[1];
+		else if(inc->operands[1] == phi && inc->opKind == OpKind::Signed_Add)   step = inc->operands[0];
+
+		if(!step)
+			return false;
+
+		auto term = getTerminator(loop->header);
+		if(!term || term->opKind != OpKind::Branch_Cond)
+			return false;
+
+		auto cond = term->operands[0];
+		auto body = dcast(IRBlock, term->operands[1]);
+		if(loop->blocks.find(body) == loop->blocks.end())
+			return false;
+
+		out->loop = &*loop;
+		out->body = body;
+		out->first = init;
+		out->firstLinear = getLinear(init);
+
+		auto stepValue = dcast(ConstantInt, resolve(step));
+		bool subtracts = (inc->opKind == OpKind::Signed_Sub);
+
+		// foreach over a range: select(step > 0, i < end, i > end), where end is one past the upper bound in the
+		// direction we're going. (the range is closed by now, and the step was picked so the range isn't empty.)
+		Value* dir = 0;
+		if(auto sel = cond->getDefiningInstruction(); !subtracts && sel && sel->opKind == OpKind::Value_Select
+			&& isICmp(sel->operands[0], OpKind::ICompare_Greater, step, ConstantInt::getNative(0)))
+		{
+			auto lt = sel->operands[1]->getDefiningInstruction();
+			if(!isICmp(sel->operands[1], OpKind::ICompare_Less, phi, 0) || !isICmp(sel->operands[2], OpKind::ICompare_Greater, phi, lt->operands[1]))
+				return false;
+
+			auto end = lt->operands[1]->getDefiningInstruction();
+			if(!end || end->opKind != OpKind::Signed_Add || !isSelect(end->operands[1], &dir, 1, -1)
+				|| !isICmp(dir, OpKind::ICompare_GreaterEqual, dir->getDefiningInstruction()->operands[0], ConstantInt::getNative(0))
+				|| !isSameValue(dir->getDefiningInstruction()->operands[0], step))
+			{
+				return false;
+			}
+
+			out->last = end->operands[0];
+			out->lastLinear = getLinear(out->last);
+
+			// the step is the default one (select(lower <= upper, 1, -1)), so we hit every number in between.
+			Value* order = 0;
+			if(isSelect(resolve(step), &order, 1, -1))
+			{
+				auto cmp = order->getDefiningInstruction();
+				out->canHoist = cmp && cmp->opKind == OpKind::ICompare_LessEqual && isSameValue(cmp->operands[0], init)
+					&& isSameValue(cmp->operands[1], out->last);
+			}
+
+			return true;
+		}
+
+		// a plain loop that counts up to something (or down), like a while loop.
+		if(auto cmp = cond->getDefiningInstruction(); stepValue && cmp && (cmp->operands[0] == phi || cmp->operands[1] == phi))
+		{
+			auto op = cmp->opKind;
+			auto bound = cmp->operands[1];
+
+			// flip it around so the counter is on the left.
+			if(cmp->operands[1] == phi)
+			{
+				bound = cmp->operands[0];
+				switch(op)
+				{
+					case OpKind::ICompare_Less:         op = OpKind::ICompare_Greater; break;
+					case OpKind::ICompare_LessEqual:    op = OpKind::ICompare_GreaterEqual; break;
+					case OpKind::ICompare_Greater:      op = OpKind::ICompare_Less; break;
+					case OpKind::ICompare_GreaterEqual: op = OpKind::ICompare_LessEqual; break;
+					default:                            return false;
+				}
+			}
+
+			auto lin = getLinear(bound);
+			bool up = (stepValue->getSignedValue() > 0) != subtracts;
+			if(stepValue->getSignedValue() == 0)
+				return false;
+
+			if(up && op == OpKind::ICompare_Less)                   lin.offset -= 1;
+			else if(up && op == OpKind::ICompare_LessEqual)         ;
+			else if(!up && op == OpKind::ICompare_Greater)          lin.offset += 1;
+			else if(!up && op == OpKind::ICompare_GreaterEqual)     ;
+			else                                                    return false;
+
+			out->last = bound;
+			out->lastLinear = lin;
+			out->ordered = true;
+
+			if(!up)
+			{
+				std::swap(out->first, out->last);
+				std::swap(out->firstLinear, out->lastLinear);
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	// whether the loop can only leave through the header, and doesn't call anything but bounds checks (and the
+	// refcounting glue). then checking everything up front only changes when we stop, not whether we do.
+	static bool canHoistOutOf(Loop* loop, IRBlock* exit)
+	{
+		for(auto b : loop->blocks)
+		{
+			for(auto s : getSuccessors(b))
+			{
+				if(loop->blocks.find(s) == loop->blocks.end() && !(b == loop->header && s == exit))
+					return false;
+			}
+
+			for(auto inst : b->getInstructions())
+			{
+				if(inst->opKind == OpKind::Value_CallFunctionPointer || inst->opKind == OpKind::Value_CallVirtualMethod)
+					return false;
+
+				if(inst->opKind == OpKind::Value_CallFunction)
+				{
+					auto fn = dcast(Function, inst->operands[0]);
+					if(!fn || !(fn->isBoundsCheck() || fn->isRefCountIncrement() || fn->isRefCountDecrement()))
+						return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// makes the value available before the loop, if it's the same every time around. if we're not making it, then
+	// this just says whether we could.
+	static Value* getInvariant(Value* v, Loop* loop, const util::hash_map<IRBlock*, IRBlock*>& idom, bool make)
+	{
+		auto inst = v->getDefiningInstruction();
+		if(!inst)
+			return v->islvalue() ? 0 : v;
+
+		if(loop->blocks.find(inst->getParentBlock()) == loop->blocks.end())
+			return (!v->islvalue() && dominates(idom, inst->getParentBlock(), loop->preheader)) ? v : 0;
+
+		// the length of an array that came from outside.
+		if(inst->opKind == OpKind::SAA_GetLength || inst->opKind == OpKind::ArraySlice_GetLength)
+		{
+			auto arr = getInvariant(inst->operands[0], loop, idom, make);
+			if(!arr || !make)
+				return arr ? v : 0;
+
+			auto clone = new Instruction(inst->opKind, false, v->getType(), { arr });
+			clone->insertBefore(getTerminator(loop->preheader));
+
+			return clone->realOutput;
+		}
+
+		return 0;
+	}
+
+	// a hoisted check on the far end of the loop should complain about the index that would have failed first, not
+	// wherever the loop would have ended up. the counter goes one at a time (in either direction) from an index that
+	// is already known to be fine, so that's the first one past either end -- ie. 'last', clamped to [-1, length].
+	static Value* clampToFirstFailure(Value* last, Value* length, bool inclusive, Instruction* pos)
+	{
+		auto make = [pos](OpKind op, Type* ty, const std::vector<Value*>& ops) -> Value* {
+			auto inst = new Instruction(op, false, ty, ops);
+			inst->insertBefore(pos);
+
+			return inst->realOutput;
+		};
+
+		auto ty = last->getType();
+		auto lo = ConstantInt::get(ty, static_cast<uint64_t>(-1));
+		auto hi = (inclusive ? make(OpKind::Signed_Add, ty, { length, ConstantInt::get(ty, 1) }) : length);
+
+		auto x = make(OpKind::Value_Select, ty, { make(OpKind::ICompare_Greater, Type::getBool(), { last, hi }), hi, last });
+		return make(OpKind::Value_Select, ty, { make(OpKind::ICompare_Less, Type::getBool(), { x, lo }), lo, x });
+	}
+
+	bool eliminateBoundsChecks(Function* fn)
+	{
+		std::vector<Instruction*> checks;
+		for(auto b : fn->getBlockList())
+		{
+			if(!getTerminator(b))
+				return false;
+
+			for(auto inst : b->getInstructions())
+			{
+				if(getCheck(inst))
+					checks.push_back(inst);
+			}
+		}
+
+		// same as mem2reg; we need the dominators to make sense.
+		if(checks.empty() || getReversePostOrder(fn).size() != fn->getBlockList().size())
+			return false;
+
+		auto idom = getImmediateDominators(fn);
+		auto loops = findLoops(fn, idom);
+
+		auto comesBefore = [&idom](Instruction* a, Instruction* b) -> bool {
+			if(a->getParentBlock() != b->getParentBlock())
+				return dominates(idom, a->getParentBlock(), b->getParentBlock());
+
+			auto& insts = a->getParentBlock()->getInstructions();
+			return std::find(insts.begin(), insts.end(), a) < std::find(insts.begin(), insts.end(), b);
+		};
+
+		enum class Action { Keep, Remove, Hoist };
+		std::vector<Action> actions(checks.size(), Action::Keep);
+		std::vector<Induction> inductions(checks.size());
+
+		for(size_t i = 0; i < checks.size(); i++)
+		{
+			auto check = checks[i];
+			auto inclusive = getCheck(check)->isInclusiveBoundsCheck();
+
+			auto length = check->operands[1];
+			auto index = check->operands[2];
+
+			if(isInRange(length, getLinear(index), inclusive))
+			{
+				actions[i] = Action::Remove;
+				continue;
+			}
+
+			// the same thing was checked before we got here. (an exclusive check covers an inclusive one too)
+			if(std::any_of(checks.begin(), checks.begin() + i, [&](Instruction* prev) -> bool {
+				return (inclusive || !getCheck(prev)->isInclusiveBoundsCheck()) && comesBefore(prev, check)
+					&& isSameValue(prev->operands[1], length) && isSameValue(prev->operands[2], index);
+			}))
+			{
+				actions[i] = Action::Remove;
+				continue;
+			}
+
+			auto& ind = inductions[i];
+			if(!getInduction(index, loops, &ind) || ind.loop->blocks.find(check->getParentBlock()) == ind.loop->blocks.end()
+				|| !dominates(idom, ind.body, check->getParentBlock()))
+			{
+				continue;
+			}
+
+			bool inRange = (ind.ordered
+				? !ind.firstLinear.base && ind.firstLinear.offset >= 0 && isBelow(length, ind.lastLinear, inclusive)
+				: isInRange(length, ind.firstLinear, inclusive) && isInRange(length, ind.lastLinear, inclusive));
+
+			if(inRange)
+			{
+				actions[i] = Action::Remove;
+			}
+			else if(ind.canHoist && getTerminator(ind.loop->preheader)->opKind == OpKind::Branch_UnCond
+				&& dominates(idom, check->getParentBlock(), ind.loop->latches[0])
+				&& canHoistOutOf(ind.loop, dcast(IRBlock, getTerminator(ind.loop->header)->operands[2]))
+				&& getInvariant(length, ind.loop, idom, false) && getInvariant(ind.first, ind.loop, idom, false)
+				&& getInvariant(ind.last, ind.loop, idom, false))
+			{
+				actions[i] = Action::Hoist;
+			}
+		}
+
+		// if something in the loop is still going to be checked every time around, then moving the others would change
+		// which one fails first.
+		for(size_t i = 0; i < checks.size(); i++)
+		{
+			if(actions[i] != Action::Hoist)
+				continue;
+
+			auto loop = inductions[i].loop;
+			for(size_t k = 0; k < checks.size(); k++)
+			{
+				if(actions[k] == Action::Keep && loop->blocks.find(checks[k]->getParentBlock()) != loop->blocks.end())
+				{
+					actions[i] = Action::Keep;
+					break;
+				}
+			}
+		}
+
+		size_t removed = 0;
+		size_t hoisted = 0;
+		for(size_t i = 0; i < checks.size(); i++)
+		{
+			auto check = checks[i];
+			if(actions[i] == Action::Hoist)
+			{
+				auto& ind = inductions[i];
+
+				auto length = getInvariant(check->operands[1], ind.loop, idom, true);
+				auto first = getInvariant(ind.first, ind.loop, idom, true);
+				auto last = getInvariant(ind.last, ind.loop, idom, true);
+
+				// the first index first, so if that's out of range we complain about the same thing as before.
+				auto pos = getTerminator(ind.loop->preheader);
+				if(last->getType() == length->getType())
+					last = clampToFirstFailure(last, length, getCheck(check)->isInclusiveBoundsCheck(), pos);
+
+				for(auto idx : { first, last })
+				{
+					auto call = new Instruction(OpKind::Value_CallFunction, true, Type::getVoid(),
+						{ check->operands[0], length, idx, check->operands[3] });
+
+					call->insertBefore(pos);
+				}
+
+				hoisted += 1;
+			}
+			else if(actions[i] != Action::Remove)
+			{
+				continue;
+			}
+
+			check->eraseFromParent();
+			removed += 1;
+		}
+
+		numRemoved += removed;
+		numHoisted += hoisted;
+
+		return removed > 0;
+	}
+}
+}
@@ -0,0 +1,273 @@
+// ConstantFolding.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/passes.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/irbuilder.h"
+#include "ir/instruction.h"
+
+#include <cmath>
+#include <optional>
+
+namespace fir {
+namespace passes
+{
+	// signed values are kept sign-extended to 64 bits, and unsigned ones zero-extended; that way we can do the
+	// arithmetic in 64 bits and just chop it back down to size at the end.
+	static uint64_t normalise(Type* type, uint64_t val)
+	{
+		auto bits = type->toPrimitiveType()->getIntegerBitWidth();
+		if(bits >= 64)
+			return val;
+
+		uint64_t mask = (1ULL << bits) - 1;
+		val &= mask;
+
+		if(type->isSignedIntType() && (val & (1ULL << (bits - 1))))
+			val |= ~mask;
+
+		return val;
+	}
+
+	static std::optional<uint64_t> foldIntegerOp(OpKind op, uint64_t a, uint64_t b)
+	{
+		auto sa = static_cast<int64_t>(a);
+		auto sb = static_cast<int64_t>(b);
+
+		switch(op)
+		{
+			case OpKind::Signed_Add:
+			case OpKind::Unsigned_Add:      return a + b;
+
+			case OpKind::Signed_Sub:
+			case OpKind::Unsigned_Sub:      return a - b;
+
+			case OpKind::Signed_Mul:
+			case OpKind::Unsigned_Mul:      return a * b;
+
+			case OpKind::Signed_Neg:        return 0 - a;
+
+			// leave the traps (and INT_MIN / -1) to the program.
+			case OpKind::Signed_Div:        if(sb == 0 || sb == -1) return std::nullopt; else return static_cast<uint64_t>(sa / sb);
+			case OpKind::Signed_Mod:        if(sb == 0 || sb == -1) return std::nullopt; else return static_cast<uint64_t>(sa % sb);
+			case OpKind::Unsigned_Div:      if(b == 0) return std::nullopt; else return a / b;
+			case OpKind::Unsigned_Mod:      if(b == 0) return std::nullopt; else return a % b;
+
+			case OpKind::Bitwise_Not:       return ~a;
+			case OpKind::Bitwise_And:       return a & b;
+			case OpKind::Bitwise_Or:        return a | b;
+			case OpKind::Bitwise_Xor:       return a ^ b;
+
+			default:                        return std::nullopt;
+		}
+	}
+
+	static std::optional<bool> foldIntegerCompare(OpKind op, bool isSigned, uint64_t a, uint64_t b)
+	{
+		auto sa = static_cast<int64_t>(a);
+		auto sb = static_cast<int64_t>(b);
+
+		switch(op)
+		{
+			case OpKind::ICompare_Equal:        return a == b;
+			case OpKind::ICompare_NotEqual:     return a != b;
+			case OpKind::ICompare_Greater:      return isSigned ? sa > sb : a > b;
+			case OpKind::ICompare_Less:         return isSigned ? sa < sb : a < b;
+			case OpKind::ICompare_GreaterEqual: return isSigned ? sa >= sb : a >= b;
+			case OpKind::ICompare_LessEqual:    return isSigned ? sa <= sb : a <= b;
+
+			default:                            return std::nullopt;
+		}
+	}
+
+	template <typename T>
+	static std::optional<T> foldFloatingOp(OpKind op, T a, T b)
+	{
+		switch(op)
+		{
+			case OpKind::Floating_Add:  return a + b;
+			case OpKind::Floating_Sub:  return a - b;
+			case OpKind::Floating_Mul:  return a * b;
+			case OpKind::Floating_Div:  return a / b;
+			case OpKind::Floating_Mod:  return std::fmod(a, b);
+			case OpKind::Floating_Neg:  return -a;
+
+			default:                    return std::nullopt;
+		}
+	}
+
+	static std::optional<bool> foldFloatingCompare(OpKind op, double a, double b)
+	{
+		bool unord = std::isnan(a) || std::isnan(b);
+		switch(op)
+		{
+			case OpKind::FCompare_Equal_ORD:            return !unord && a == b;
+			case OpKind::FCompare_Equal_UNORD:          return unord || a == b;
+			case OpKind::FCompare_NotEqual_ORD:         return !unord && a != b;
+			case OpKind::FCompare_NotEqual_UNORD:       return unord || a != b;
+			case OpKind::FCompare_Greater_ORD:          return !unord && a > b;
+			case OpKind::FCompare_Greater_UNORD:        return unord || a > b;
+			case OpKind::FCompare_Less_ORD:             return !unord && a < b;
+			case OpKind::FCompare_Less_UNORD:           return unord || a < b;
+			case OpKind::FCompare_GreaterEqual_ORD:     return !unord && a >= b;
+			case OpKind::FCompare_GreaterEqual_UNORD:   return unord || a >= b;
+			case OpKind::FCompare_LessEqual_ORD:        return !unord && a <= b;
+			case OpKind::FCompare_LessEqual_UNORD:      return unord || a <= b;
+
+			default:                                    return std::nullopt;
+		}
+	}
+
+	static std::optional<bool> foldBoolOp(OpKind op, bool a, bool b)
+	{
+		switch(op)
+		{
+			case OpKind::Logical_Not:       return !a;
+			case OpKind::Bitwise_And:       return a && b;
+			case OpKind::Bitwise_Or:        return a || b;
+			case OpKind::Bitwise_Xor:
+			case OpKind::ICompare_NotEqual: return a != b;
+			case OpKind::ICompare_Equal:    return a == b;
+
+			default:                        return std::nullopt;
+		}
+	}
+
+	// returns the constant that the instruction evaluates to, or null if it doesn't (or we can't tell).
+	static ConstantValue* foldInstruction(Instruction* inst)
+	{
+		auto& ops = inst->operands;
+		if(ops.empty() || ops.size() > 2)
+			return 0;
+
+		// the unary ops only have one operand, so just use it twice.
+		auto lhs = dcast(ConstantValue, ops[0]);
+		auto rhs = dcast(ConstantValue, ops.size() == 2 ? ops[1] : ops[0]);
+
+		if(!lhs || !rhs || lhs->getType() != rhs->getType())
+			return 0;
+
+		auto type = lhs->getType();
+		auto result = inst->realOutput->getType();
+
+		if(auto a = dcast(ConstantInt, lhs), b = dcast(ConstantInt, rhs); a && b)
+		{
+			if(!type->isIntegerType() || type->toPrimitiveType()->getIntegerBitWidth() > 64)
+				return 0;
+
+			auto av = normalise(type, a->getUnsignedValue());
+			auto bv = normalise(type, b->getUnsignedValue());
+
+			if(result->isBoolType())
+			{
+				if(auto r = foldIntegerCompare(inst->opKind, type->isSignedIntType(), av, bv); r)
+					return ConstantBool::get(*r);
+			}
+			else if(result == type)
+			{
+				if(auto r = foldIntegerOp(inst->opKind, av, bv); r)
+					return ConstantInt::get(type, normalise(type, *r));
+			}
+		}
+		else if(auto a = dcast(ConstantFP, lhs), b = dcast(ConstantFP, rhs); a && b)
+		{
+			auto bits = type->toPrimitiveType()->getFloatingPointBitWidth();
+			if(bits != 32 && bits != 64)
+				return 0;
+
+			if(result->isBoolType())
+			{
+				if(auto r = foldFloatingCompare(inst->opKind, a->getValue(), b->getValue()); r)
+					return ConstantBool::get(*r);
+			}
+			else if(result == type && bits == 32)
+			{
+				auto r = foldFloatingOp<float>(inst->opKind, static_cast<float>(a->getValue()), static_cast<float>(b->getValue()));
+				if(r) return ConstantFP::get(type, *r);
+			}
+			else if(result == type && bits == 64)
+			{
+				auto r = foldFloatingOp<double>(inst->opKind, a->getValue(), b->getValue());
+				if(r) return ConstantFP::get(type, *r);
+			}
+		}
+		else if(auto a = dcast(ConstantBool, lhs), b = dcast(ConstantBool, rhs); a && b)
+		{
+			if(result->isBoolType())
+			{
+				if(auto r = foldBoolOp(inst->opKind, a->getValue(), b->getValue()); r)
+					return ConstantBool::get(*r);
+			}
+		}
+
+		return 0;
+	}
+
+	bool foldConstants(Function* fn)
+	{
+		bool changed = false;
+
+		IRBuilder irb(fn->getParentModule());
+		for(auto b : fn->getBlockList())
+		{
+			// copy it, since we're going to be removing things.
+			auto insts = b->getInstructions();
+			for(auto inst : insts)
+			{
+				Value* folded = foldInstruction(inst);
+
+				if(!folded && inst->opKind == OpKind::Value_Select)
+				{
+					// the values are loaded when the select happens, so we can't forward an lvalue.
+					if(auto cond = dcast(ConstantBool, inst->operands[0]); cond)
+					{
+						auto v = inst->operands[cond->getValue() ? 1 : 2];
+						if(!v->islvalue())
+							folded = v;
+					}
+				}
+				else if(inst->opKind == OpKind::Branch_Cond)
+				{
+					if(auto cond = dcast(ConstantBool, inst->operands[0]); cond)
+					{
+						auto target = dcast(IRBlock, inst->operands[cond->getValue() ? 1 : 2]);
+						auto other = dcast(IRBlock, inst->operands[cond->getValue() ? 2 : 1]);
+
+						if(other != target)
+						{
+							for(auto phi : other->getInstructions())
+							{
+								if(phi->opKind != OpKind::Value_CreatePHI)
+									break;
+
+								dcast(PHINode, phi->realOutput)->removeIncoming(b);
+							}
+						}
+
+						inst->eraseFromParent();
+
+						irb.setCurrentBlock(b);
+						irb.UnCondBranch(target);
+
+						changed = true;
+					}
+				}
+
+				// since the users get updated right away, this also lets the folds cascade.
+				if(folded)
+				{
+					inst->realOutput->replaceAllUsesWith(folded);
+					inst->eraseFromParent();
+
+					changed = true;
+				}
+			}
+		}
+
+		return changed;
+	}
+}
+}
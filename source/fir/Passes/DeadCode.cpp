@@ -0,0 +1,84 @@
+// DeadCode.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/passes.h"
+#include "ir/function.h"
+#include "ir/instruction.h"
+
+#include <unordered_set>
+
+namespace fir {
+namespace passes
+{
+	bool eliminateDeadCode(Function* fn)
+	{
+		// everything with side effects (which includes the terminators) is alive, and so is everything those use,
+		// and so on. anything we don't reach that way can go. (just looking for things without users would miss
+		// cycles of phis and the arithmetic that feeds them, eg. a loop counter that nothing reads.)
+		std::unordered_set<Instruction*> alive;
+		std::vector<Instruction*> worklist;
+
+		size_t count = 0;
+		for(auto b : fn->getBlockList())
+			count += b->getInstructions().size();
+
+		alive.reserve(count);
+
+		for(auto b : fn->getBlockList())
+		{
+			for(auto inst : b->getInstructions())
+			{
+				if(inst->hasSideEffects())
+				{
+					alive.insert(inst);
+					worklist.push_back(inst);
+				}
+			}
+		}
+
+		auto markValue = [&](Value* v) {
+			if(auto def = v->getDefiningInstruction(); def && alive.insert(def).second)
+				worklist.push_back(def);
+		};
+
+		while(!worklist.empty())
+		{
+			auto inst = worklist.back();
+			worklist.pop_back();
+
+			for(auto op : inst->operands)
+				markValue(op);
+
+			if(auto phi = dcast(PHINode, inst->realOutput); phi)
+			{
+				for(const auto& [ blk, val ] : phi->getValues())
+					markValue(val);
+			}
+		}
+
+		if(alive.size() == count)
+			return false;
+
+		// the dead ones might be using each other, so let go of everything before taking them out.
+		std::vector<Instruction*> dead;
+		for(auto b : fn->getBlockList())
+		{
+			for(auto inst : b->getInstructions())
+			{
+				if(alive.find(inst) == alive.end())
+				{
+					inst->dropAllReferences();
+					dead.push_back(inst);
+				}
+			}
+		}
+
+		for(auto inst : dead)
+			inst->eraseFromParent();
+
+		return true;
+	}
+}
+}
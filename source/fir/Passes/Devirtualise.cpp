@@ -0,0 +1,322 @@
+// Devirtualise.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/module.h"
+#include "ir/passes.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/instruction.h"
+
+// virtual calls go through the vtable, which neither the inliner nor llvm can see through. we can call the method
+// directly if every class that could be behind the pointer puts the same thing in that slot, or if we can see which
+// vtable the object got (which is usually the case once its constructor has been inlined).
+
+namespace fir {
+namespace passes
+{
+	static size_t numDevirtualised = 0;
+
+	size_t getDevirtualisedCallCount()
+	{
+		return numDevirtualised;
+	}
+
+	// every class that gets instantiated makes its vtable (in its inline initialiser), and the whole program is in
+	// one module, so the classes with vtables are all the ones that can exist at runtime.
+	struct Hierarchy
+	{
+		Module* module = 0;
+		size_t numVtables = 0;
+
+		// for each class, itself and every class below it.
+		util::hash_map<ClassType*, std::vector<ClassType*>> subclasses;
+		util::hash_map<GlobalVariable*, ClassType*> vtableClasses;
+	};
+
+	static Hierarchy& getHierarchy(Module* mod)
+	{
+		static Hierarchy hierarchy;
+
+		// more classes can show up between runs (eg. in the repl), so redo it when they do.
+		auto& vtables = mod->_getVtables();
+		if(hierarchy.module != mod || hierarchy.numVtables != vtables.size())
+		{
+			hierarchy = Hierarchy();
+			hierarchy.module = mod;
+			hierarchy.numVtables = vtables.size();
+
+			for(const auto& [ cls, vt ] : vtables)
+			{
+				hierarchy.vtableClasses[vt.second] = cls;
+				for(auto c = cls; c; c = c->getBaseClass())
+					hierarchy.subclasses[c].push_back(cls);
+			}
+		}
+
+		return hierarchy;
+	}
+
+	// the method in the given slot, if every class that could be behind a pointer to cls agrees on it.
+	static Function* getOnlyImplementation(Hierarchy& hier, ClassType* cls, size_t index)
+	{
+		Function* ret = 0;
+		for(auto sub : hier.subclasses[cls])
+		{
+			auto& methods = hier.module->_getVtables().at(sub).first;
+			if(index >= methods.size())
+				return 0;
+
+			if(ret && methods[index] != ret)
+				return 0;
+
+			ret = methods[index];
+		}
+
+		return ret;
+	}
+
+	// follows the casts and the address-of/dereference pairs back to what the pointer (or lvalue) was made from.
+	static Value* getObject(Value* v)
+	{
+		while(auto inst = v->getDefiningInstruction())
+		{
+			if(inst->opKind != OpKind::Cast_PointerType && inst->opKind != OpKind::Value_AddressOf
+				&& inst->opKind != OpKind::Value_Dereference)
+			{
+				break;
+			}
+
+			v = inst->operands[0];
+		}
+
+		return v;
+	}
+
+	static bool isLocalVariable(Value* v)
+	{
+		auto inst = v->getDefiningInstruction();
+		return inst && (inst->opKind == OpKind::Value_StackAlloc || inst->opKind == OpKind::Value_CreateLVal);
+	}
+
+	static bool isRefCountCall(Instruction* inst)
+	{
+		auto fn = (inst->opKind == OpKind::Value_CallFunction ? dcast(Function, inst->operands[0]) : 0);
+		return fn && (fn->isRefCountIncrement() || fn->isRefCountDecrement());
+	}
+
+	static bool isCall(Instruction* inst)
+	{
+		return inst->opKind == OpKind::Value_CallFunction || inst->opKind == OpKind::Value_CallFunctionPointer
+			|| inst->opKind == OpKind::Value_CallVirtualMethod;
+	}
+
+	// whether something other than the function itself could have a pointer to the local by the time we get to
+	// 'call'. passing it to the call itself (or to anything after it in the same block) is fine.
+	static bool addressEscapes(Value* local, Instruction* call)
+	{
+		auto& insts = call->getParentBlock()->getInstructions();
+		auto callPos = std::find(insts.begin(), insts.end(), call);
+
+		std::vector<Value*> worklist = { local };
+		while(!worklist.empty())
+		{
+			auto val = worklist.back();
+			worklist.pop_back();
+
+			for(auto u : val->getUsers())
+			{
+				auto user = dcast(Instruction, u);
+				if(!user)
+					return true;
+
+				if(user->opKind == OpKind::Cast_PointerType || user->opKind == OpKind::Value_AddressOf
+					|| user->opKind == OpKind::Value_Dereference || user->opKind == OpKind::Value_GetStructMember)
+				{
+					worklist.push_back(user->realOutput);
+				}
+				else if(isCall(user))
+				{
+					if(val->islvalue())
+						continue;
+
+					if(user->getParentBlock() != call->getParentBlock() || std::find(insts.begin(), callPos, user) != callPos)
+						return true;
+				}
+				else if(user->opKind == OpKind::Value_Store || user->opKind == OpKind::Value_WritePtr)
+				{
+					// storing *to* it is fine, but not storing the pointer somewhere.
+					if(user->operands[0] == val && !val->islvalue())
+						return true;
+				}
+				else if(!val->islvalue() && user->opKind != OpKind::Value_ReadPtr)
+				{
+					// using an lvalue just reads it, but a pointer could go anywhere.
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	// walks backwards from the call, looking for the store that put the vtable into the receiver. objects get copied
+	// around by value (out of the constructor's self, for one), so we follow those copies too. anything that might
+	// change the vtable behind our back (calls, stores through pointers we can't see through) makes us give up.
+	static ClassType* getKnownClass(Hierarchy& hier, Instruction* call)
+	{
+		auto& insts = call->getParentBlock()->getInstructions();
+		auto pos = static_cast<size_t>(std::find(insts.begin(), insts.end(), call) - insts.begin());
+
+		auto obj = getObject(call->operands[3]);
+
+		Value* checked = 0;
+		bool escaped = false;
+
+		while(pos > 0)
+		{
+			auto inst = insts[--pos];
+
+			if(inst->opKind == OpKind::Value_Store || inst->opKind == OpKind::Value_WritePtr)
+			{
+				auto value = inst->operands[0];
+				auto target = inst->operands[1];
+
+				auto gep = target->getDefiningInstruction();
+				if(gep && gep->opKind != OpKind::Value_GetStructMember)
+					gep = 0;
+
+				auto dest = getObject(gep ? gep->operands[0] : target);
+				if(dest != obj)
+				{
+					if(isLocalVariable(dest) && isLocalVariable(obj))
+						continue;
+
+					return 0;
+				}
+
+				if(gep)
+				{
+					// only classes with virtual methods have the vtable at the front.
+					auto ty = gep->operands[0]->getType();
+					auto idx = dcast(ConstantInt, gep->operands[1]);
+					if(!ty->isClassType() || !idx || ty->toClassType()->getVirtualMethodCount() == 0)
+						return 0;
+
+					if(idx->getUnsignedValue() != 0)
+						continue;
+
+					auto vtable = dcast(GlobalVariable, getObject(value));
+					if(auto it = hier.vtableClasses.find(vtable); vtable && it != hier.vtableClasses.end())
+						return it->second;
+
+					return 0;
+				}
+
+				// a copy of the whole object; keep going from wherever it was read.
+				if(value->islvalue())
+				{
+					obj = getObject(value);
+				}
+				else if(auto read = value->getDefiningInstruction(); read && read->opKind == OpKind::Value_ReadPtr
+					&& read->getParentBlock() == call->getParentBlock())
+				{
+					obj = getObject(read->operands[0]);
+					pos = static_cast<size_t>(std::find(insts.begin(), insts.begin() + pos, read) - insts.begin());
+				}
+				else
+				{
+					return 0;
+				}
+			}
+			else if(inst->hasSideEffects() && !isRefCountCall(inst))
+			{
+				// nothing else can get at a local unless we gave its address away.
+				if(!isLocalVariable(obj))
+					return 0;
+
+				if(checked != obj)
+					checked = obj, escaped = addressEscapes(obj, call);
+
+				if(escaped)
+					return 0;
+			}
+		}
+
+		return 0;
+	}
+
+	bool devirtualiseCalls(Function* fn)
+	{
+		auto mod = fn->getParentModule();
+		if(!mod || mod->_getVtables().empty())
+			return false;
+
+		auto& hier = getHierarchy(mod);
+
+		std::vector<Instruction*> calls;
+		for(auto b : fn->getBlockList())
+		{
+			for(auto inst : b->getInstructions())
+			{
+				if(inst->opKind == OpKind::Value_CallVirtualMethod)
+					calls.push_back(inst);
+			}
+		}
+
+		size_t count = 0;
+		for(auto call : calls)
+		{
+			auto cls = call->operands[0]->getType()->toClassType();
+			auto index = dcast(ConstantInt, call->operands[1])->getUnsignedValue();
+			auto ft = call->operands[2]->getType()->toFunctionType();
+
+			auto target = getOnlyImplementation(hier, cls, index);
+			if(!target)
+			{
+				auto known = getKnownClass(hier, call);
+				if(known && known->hasParent(cls))
+					target = mod->_getVtables().at(known).first[index];
+			}
+
+			if(!target)
+				continue;
+
+			// overrides take a different self, but they could also have picked different (contravariant) parameter
+			// types, and then the call would need casts that we don't want to think about.
+			auto params = target->getType()->getArgumentTypes();
+			auto args = std::vector<Value*>(call->operands.begin() + 3, call->operands.end());
+
+			if(params.size() != args.size() || target->getReturnType() != ft->getReturnType()
+				|| !std::equal(params.begin() + 1, params.end(), ft->getArgumentTypes().begin() + 1))
+			{
+				continue;
+			}
+
+			if(args[0]->getType() != params[0])
+			{
+				auto cast = new Instruction(OpKind::Cast_PointerType, false, params[0],
+					{ args[0], ConstantValue::getZeroValue(params[0]) });
+
+				cast->insertBefore(call);
+				args[0] = cast->realOutput;
+			}
+
+			auto direct = new Instruction(OpKind::Value_CallFunction, true, ft->getReturnType(),
+				zfu::vectorOf<Value*>(target) + args);
+
+			direct->realOutput->setName(call->realOutput->getName());
+			direct->insertBefore(call);
+
+			call->realOutput->replaceAllUsesWith(direct->realOutput);
+			call->eraseFromParent();
+
+			count += 1;
+		}
+
+		numDevirtualised += count;
+		return count > 0;
+	}
+}
+}
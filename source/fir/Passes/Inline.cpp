@@ -0,0 +1,315 @@
+// Inline.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/passes.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/irbuilder.h"
+#include "ir/instruction.h"
+
+// functions that don't call anything get inlined if they're at most this big, even if nobody asked. (since we go
+// through the callees first, things that only call other small functions end up counting too.)
+#define INLINE_SIZE_BUDGET              32
+
+// always-inline functions get a bigger budget, but they still can't call anything. the refcounting glue (for one)
+// calls free() and friends, and inlining all of that everywhere makes the code a few times bigger without making
+// it any faster.
+#define ALWAYS_INLINE_SIZE_BUDGET       64
+
+// and we stop inlining into a function once it gets this big.
+#define MAX_INLINED_FUNCTION_SIZE       4096
+
+namespace fir {
+namespace passes
+{
+	static bool isCall(Instruction* inst)
+	{
+		return inst->opKind == OpKind::Value_CallFunction || inst->opKind == OpKind::Value_CallFunctionPointer
+			|| inst->opKind == OpKind::Value_CallVirtualMethod;
+	}
+
+	static size_t countInstructions(Function* fn)
+	{
+		size_t ret = 0;
+		for(auto b : fn->getBlockList())
+			ret += b->getInstructions().size();
+
+		return ret;
+	}
+
+	static bool shouldInline(Function* caller, Function* callee)
+	{
+		if(callee == caller || callee->getBlockList().empty() || callee->isIntrinsicFunction() || callee->isCStyleVarArg())
+			return false;
+
+		bool leaf = true;
+		bool returns = false;
+
+		size_t size = 0;
+		for(auto b : callee->getBlockList())
+		{
+			// if it doesn't end properly, we're probably still generating it (eg. for a #run inside it).
+			auto term = getTerminator(b);
+			if(!term)
+				return false;
+
+			if(term->opKind == OpKind::Value_Return)
+				returns = true;
+
+			for(auto inst : b->getInstructions())
+			{
+				if(isCall(inst))
+				{
+					if(inst->operands[0] == callee)
+						return false;
+
+					// calls on the way to an unreachable are the error paths (eg. a failed bounds check), which
+					// don't count.
+					if(term->opKind != OpKind::Unreachable)
+						leaf = false;
+				}
+			}
+
+			size += b->getInstructions().size();
+		}
+
+		// if it never comes back, there's nothing to replace the call with. leave it alone.
+		if(!returns)
+			return false;
+
+		if(!leaf)
+			return false;
+
+		return size <= (callee->isAlwaysInlined() ? ALWAYS_INLINE_SIZE_BUDGET : INLINE_SIZE_BUDGET);
+	}
+
+	static void inlineCall(Function* caller, Instruction* call, Function* callee)
+	{
+		IRBuilder irb(caller->getParentModule());
+
+		auto entry = caller->getBlockList().front();
+		auto callBlk = call->getParentBlock();
+
+		util::hash_map<Value*, Value*> valueMap;
+
+		// we make the blocks ourselves instead of going through irbuilder, since it looks at every other block in
+		// the function to come up with a unique name.
+		std::vector<IRBlock*> newBlocks;
+		for(auto b : callee->getBlockList())
+		{
+			auto blk = new IRBlock(caller);
+			blk->setName(b->getName());
+
+			valueMap[b] = blk;
+			newBlocks.push_back(blk);
+		}
+
+		// everything after the call moves to a new block, and the callee's returns jump there.
+		auto cont = new IRBlock(caller);
+		cont->setName("inline_cont");
+		newBlocks.push_back(cont);
+
+		{
+			auto& blocks = caller->getBlockList();
+			blocks.insert(std::find(blocks.begin(), blocks.end(), callBlk) + 1, newBlocks.begin(), newBlocks.end());
+
+			auto& insts = callBlk->getInstructions();
+			auto it = std::find(insts.begin(), insts.end(), call) + 1;
+
+			auto rest = std::vector<Instruction*>(it, insts.end());
+			insts.erase(it, insts.end());
+
+			for(auto inst : rest)
+			{
+				inst->parentBlock = 0;
+				cont->addInstruction(inst);
+			}
+
+			for(auto s : getSuccessors(cont))
+			{
+				for(auto phi : getPHIs(s))
+					phi->replaceIncomingBlock(callBlk, cont);
+			}
+		}
+
+		auto& args = callee->getArguments();
+		iceAssert(call->operands.size() == args.size() + 1);
+
+		irb.setCurrentBlock(callBlk);
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			// the call would have read the argument when it happened, but the callee's body can use it anywhere; so
+			// take a copy now. (a bitcast to the same type doesn't do anything else.)
+			auto arg = call->operands[i + 1];
+			if(arg->islvalue())
+				arg = irb.Bitcast(arg, arg->getType());
+
+			valueMap[args[i]] = arg;
+		}
+
+		std::vector<Instruction*> clones;
+		std::vector<std::pair<PHINode*, PHINode*>> phis;
+		std::vector<std::pair<IRBlock*, Value*>> returns;
+
+		for(auto b : callee->getBlockList())
+		{
+			auto blk = dcast(IRBlock, valueMap[b]);
+			for(auto inst : b->getInstructions())
+			{
+				auto out = inst->realOutput;
+				if(inst->opKind == OpKind::Value_CreatePHI)
+				{
+					irb.setCurrentBlock(blk);
+
+					auto phi = irb.CreatePHINode(out->getType());
+					phis.push_back({ dcast(PHINode, out), phi });
+
+					valueMap[out] = phi;
+					continue;
+				}
+				else if(inst->opKind == OpKind::Value_Return)
+				{
+					returns.push_back({ blk, inst->operands.empty() ? 0 : inst->operands[0] });
+					continue;
+				}
+
+				// the operands get fixed up once everything exists, since we might not have seen them yet.
+				auto clone = new Instruction(inst->opKind, inst->hasSideEffects(), out->getType(), inst->operands, out->getKind());
+				clone->realOutput->setName(out->getName());
+
+				if(out->isConst())
+					clone->realOutput->makeConst();
+
+				valueMap[out] = clone->realOutput;
+				clones.push_back(clone);
+
+				if(inst->opKind == OpKind::Value_StackAlloc || inst->opKind == OpKind::Value_CreateLVal)
+				{
+					// these need to stay in the entry block, but then they only get zeroed once -- and we might be
+					// in a loop. so zero them where the call was.
+					auto zero = inst->operands[0];
+					caller->addStackAllocation(zero->getType());
+
+					entry->addInstructionAtFront(clone);
+
+					auto op = (inst->opKind == OpKind::Value_StackAlloc ? OpKind::Value_WritePtr : OpKind::Value_Store);
+					callBlk->addInstruction(new Instruction(op, true, Type::getVoid(), { zero, clone->realOutput }));
+				}
+				else
+				{
+					blk->addInstruction(clone);
+				}
+			}
+		}
+
+		auto remap = [&valueMap](Value* v) -> Value* {
+			if(auto it = valueMap.find(v); it != valueMap.end())
+				return it->second;
+
+			return v;
+		};
+
+		for(auto clone : clones)
+		{
+			for(size_t i = 0; i < clone->operands.size(); i++)
+			{
+				if(auto v = remap(clone->operands[i]); v != clone->operands[i])
+					clone->setOperand(i, v);
+			}
+		}
+
+		for(const auto& [ orig, phi ] : phis)
+		{
+			for(const auto& [ blk, val ] : orig->getValues())
+				phi->addIncoming(remap(val), dcast(IRBlock, remap(blk)));
+		}
+
+
+		// with more than one return, we need a phi to pick the right value.
+		Value* result = 0;
+		PHINode* resultPhi = 0;
+
+		auto retty = call->realOutput->getType();
+		if(!retty->isVoidType() && returns.size() > 1)
+		{
+			irb.setCurrentBlock(cont);
+			result = resultPhi = irb.CreatePHINode(retty);
+		}
+
+		for(const auto& [ blk, ret ] : returns)
+		{
+			irb.setCurrentBlock(blk);
+			if(ret && !retty->isVoidType())
+			{
+				auto v = remap(ret);
+				if(v->islvalue())
+					v = irb.Bitcast(v, v->getType());
+
+				if(resultPhi)   resultPhi->addIncoming(v, blk);
+				else            result = v;
+			}
+
+			irb.UnCondBranch(cont);
+		}
+
+		irb.setCurrentBlock(callBlk);
+		irb.UnCondBranch(dcast(IRBlock, valueMap[callee->getBlockList().front()]));
+
+		if(result)
+			call->realOutput->replaceAllUsesWith(result);
+
+		call->eraseFromParent();
+	}
+
+	bool inlineCalls(Function* fn)
+	{
+		for(auto b : fn->getBlockList())
+		{
+			if(!getTerminator(b))
+				return false;
+		}
+
+		util::hash_map<Function*, bool> candidates;
+		std::vector<std::pair<Instruction*, Function*>> calls;
+
+		for(auto b : fn->getBlockList())
+		{
+			for(auto inst : b->getInstructions())
+			{
+				if(inst->opKind != OpKind::Value_CallFunction)
+					continue;
+
+				auto callee = dcast(Function, inst->operands[0]);
+				if(!callee)
+					continue;
+
+				auto it = candidates.find(callee);
+				if(it == candidates.end())
+					it = candidates.insert({ callee, shouldInline(fn, callee) }).first;
+
+				if(it->second)
+					calls.push_back({ inst, callee });
+			}
+		}
+
+		// only the calls that were there to begin with; the ones we bring in get looked at the next time around.
+		bool changed = false;
+
+		size_t size = countInstructions(fn);
+		for(const auto& [ call, callee ] : calls)
+		{
+			if(size > MAX_INLINED_FUNCTION_SIZE)
+				break;
+
+			inlineCall(fn, call, callee);
+			size += countInstructions(callee);
+
+			changed = true;
+		}
+
+		return changed;
+	}
+}
+}
@@ -0,0 +1,319 @@
+// Mem2Reg.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/passes.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/irbuilder.h"
+#include "ir/instruction.h"
+
+#include <unordered_set>
+
+// this is the usual thing -- find the dominance frontiers of the blocks that write to a variable, put phi nodes
+// there, then walk the dominator tree replacing every read with whatever was last written.
+
+namespace fir {
+namespace passes
+{
+	struct Variable
+	{
+		Instruction* alloc = 0;
+
+		// where it goes in the list of current definitions when renaming.
+		size_t index = 0;
+
+		// the type of the thing stored, not the pointer.
+		Type* type = 0;
+
+		bool isLValue = false;
+		bool promotable = true;
+	};
+
+	// these operands are used as addresses, not loaded from; see getUndecayedArg() in the interpreter, and
+	// getUndecayedOperand() in the llvm translator.
+	static bool isUndecayedOperand(OpKind op, size_t idx)
+	{
+		switch(op)
+		{
+			case OpKind::Value_Store:               return idx == 1;
+			case OpKind::Value_AddressOf:           return idx == 0;
+			case OpKind::Value_GetStructMember:     return idx == 0;
+			case OpKind::RawUnion_GEP:              return idx == 0;
+			case OpKind::Value_CallFunction:        return idx == 0;
+
+			default:                                return false;
+		}
+	}
+
+	// if the instruction writes to a variable, returns (variable, value). an lvalue as the pointer of a writeptr
+	// (eg. a local of pointer type) is decayed first, so that writes to wherever it points, not to the lvalue.
+	static std::pair<Value*, Value*> getStore(Instruction* inst)
+	{
+		if(inst->opKind == OpKind::Value_Store || (inst->opKind == OpKind::Value_WritePtr && !inst->operands[1]->islvalue()))
+			return { inst->operands[1], inst->operands[0] };
+
+		return { 0, 0 };
+	}
+
+	static util::hash_map<Value*, Variable> findVariables(Function* fn)
+	{
+		// irbuilder always puts these at the top of the entry block.
+		util::hash_map<Value*, Variable> vars;
+		for(auto inst : fn->getBlockList().front()->getInstructions())
+		{
+			if(inst->opKind == OpKind::Value_StackAlloc || inst->opKind == OpKind::Value_CreateLVal)
+			{
+				auto& var = vars[inst->realOutput];
+				var.alloc = inst;
+				var.type = inst->operands[0]->getType();
+				var.isLValue = (inst->opKind == OpKind::Value_CreateLVal);
+			}
+		}
+
+		if(vars.empty())
+			return vars;
+
+		// stored values that are themselves lvalues; the target is only promotable if the source is.
+		std::vector<std::pair<Value*, Value*>> lvalueStores;
+
+		for(auto& [ v, var ] : vars)
+		{
+			for(auto user : v->getUsers())
+			{
+				// the only other thing that can use it is a phi, and that would need the address.
+				auto inst = dcast(Instruction, user);
+				if(!inst)
+				{
+					var.promotable = false;
+					break;
+				}
+
+				for(size_t i = 0; i < inst->operands.size(); i++)
+				{
+					if(inst->operands[i] != v)
+						continue;
+
+					if(var.isLValue)
+					{
+						// reading it is fine, and so is storing to it.
+						if(isUndecayedOperand(inst->opKind, i) && !(inst->opKind == OpKind::Value_Store && i == 1))
+							var.promotable = false;
+					}
+					else
+					{
+						// the pointer can only be used to read and write directly -- anything else lets it escape.
+						if(!(inst->opKind == OpKind::Value_ReadPtr && i == 0) && !(inst->opKind == OpKind::Value_WritePtr && i == 1))
+							var.promotable = false;
+					}
+				}
+
+				if(auto [ target, value ] = getStore(inst); target == v && value->islvalue())
+				{
+					// we'd be reading it when the store happens, which we can only replicate if it's also a variable.
+					if(vars.find(value) == vars.end())
+						var.promotable = false;
+
+					else
+						lvalueStores.push_back({ target, value });
+				}
+			}
+		}
+
+		for(bool changed = true; changed; )
+		{
+			changed = false;
+			for(const auto& [ target, value ] : lvalueStores)
+			{
+				if(vars[target].promotable && !vars[value].promotable)
+					vars[target].promotable = false, changed = true;
+			}
+		}
+
+		size_t index = 0;
+		for(auto it = vars.begin(); it != vars.end(); )
+		{
+			if(!it->second.promotable) it = vars.erase(it);
+			else                       (it++)->second.index = index++;
+		}
+
+		return vars;
+	}
+
+	bool promoteAllocations(Function* fn)
+	{
+		auto& blocks = fn->getBlockList();
+		for(auto b : blocks)
+		{
+			if(!getTerminator(b))
+				return false;
+		}
+
+		// we need every block to be reachable, otherwise the dominators don't make sense. simplifyControlFlow()
+		// gets rid of those, so just wait for it.
+		auto rpo = getReversePostOrder(fn);
+		if(rpo.size() != blocks.size())
+			return false;
+
+		auto vars = findVariables(fn);
+		if(vars.empty())
+			return false;
+
+		// a phi in the entry block wouldn't have anything to take on the way in.
+		auto preds = getPredecessors(fn);
+		if(!preds[rpo[0]].empty())
+			return false;
+
+		auto entry = rpo[0];
+		auto idom = getImmediateDominators(fn);
+
+		util::hash_map<IRBlock*, std::vector<IRBlock*>> domChildren;
+		util::hash_map<IRBlock*, std::unordered_set<IRBlock*>> frontiers;
+		for(auto b : rpo)
+		{
+			if(b != entry)
+				domChildren[idom[b]].push_back(b);
+
+			if(preds[b].size() < 2)
+				continue;
+
+			for(auto p : preds[b])
+			{
+				for(auto runner = p; runner != idom[b]; runner = idom[runner])
+					frontiers[runner].insert(b);
+			}
+		}
+
+
+		// place the phis.
+		util::hash_map<PHINode*, size_t> phiVars;
+		{
+			util::hash_map<Value*, std::unordered_set<IRBlock*>> defBlocks;
+			for(const auto& [ v, var ] : vars)
+			{
+				for(auto user : v->getUsers())
+				{
+					if(auto [ target, value ] = getStore(dcast(Instruction, user)); target == v)
+						defBlocks[v].insert(dcast(Instruction, user)->getParentBlock());
+				}
+			}
+
+			IRBuilder irb(fn->getParentModule());
+			for(const auto& [ v, blks ] : defBlocks)
+			{
+				std::unordered_set<IRBlock*> hasPhi;
+				std::vector<IRBlock*> worklist(blks.begin(), blks.end());
+
+				while(!worklist.empty())
+				{
+					auto b = worklist.back();
+					worklist.pop_back();
+
+					for(auto f : frontiers[b])
+					{
+						if(!hasPhi.insert(f).second)
+							continue;
+
+						irb.setCurrentBlock(f);
+						phiVars[irb.CreatePHINode(vars[v].type)] = vars[v].index;
+
+						if(blks.find(f) == blks.end())
+							worklist.push_back(f);
+					}
+				}
+			}
+		}
+
+
+		// rename. each block starts with whatever its immediate dominator ended up with.
+		// the current definition of each variable, by its index.
+		std::vector<std::pair<IRBlock*, std::vector<Value*>>> worklist;
+		{
+			std::vector<Value*> initial(vars.size());
+			for(const auto& [ v, var ] : vars)
+				initial[var.index] = var.alloc->operands[0];
+
+			worklist.push_back({ entry, initial });
+		}
+
+		auto getVar = [&vars](Value* v) -> Variable* {
+			if(auto it = vars.find(v); it != vars.end())
+				return &it->second;
+
+			return 0;
+		};
+
+		while(!worklist.empty())
+		{
+			auto [ blk, defs ] = std::move(worklist.back());
+			worklist.pop_back();
+
+			// copy it, since we're going to be removing things.
+			auto insts = blk->getInstructions();
+			for(auto inst : insts)
+			{
+				if(inst->opKind == OpKind::Value_CreatePHI)
+				{
+					if(auto it = phiVars.find(dcast(PHINode, inst->realOutput)); it != phiVars.end())
+						defs[it->second] = it->first;
+
+					continue;
+				}
+
+				// the allocations themselves go at the end, once nothing is using them.
+				if(getVar(inst->realOutput))
+					continue;
+
+				if(auto [ target, value ] = getStore(inst); target && getVar(target))
+				{
+					// if we're storing another variable, it's the value at this point that counts.
+					if(auto src = getVar(value); src)
+						defs[getVar(target)->index] = defs[src->index];
+
+					else
+						defs[getVar(target)->index] = value;
+
+					inst->eraseFromParent();
+					continue;
+				}
+
+				// same as above; a readptr of an lvalue reads through its value, so that's just a normal use.
+				if(auto var = (inst->opKind == OpKind::Value_ReadPtr ? getVar(inst->operands[0]) : 0); var && !var->isLValue)
+				{
+					inst->realOutput->replaceAllUsesWith(defs[var->index]);
+					inst->eraseFromParent();
+					continue;
+				}
+
+				for(size_t i = 0; i < inst->operands.size(); i++)
+				{
+					if(auto var = getVar(inst->operands[i]); var)
+						inst->setOperand(i, defs[var->index]);
+				}
+			}
+
+			for(auto s : getSuccessors(blk))
+			{
+				for(auto inst : s->getInstructions())
+				{
+					if(inst->opKind != OpKind::Value_CreatePHI)
+						break;
+
+					auto phi = dcast(PHINode, inst->realOutput);
+					if(auto it = phiVars.find(phi); it != phiVars.end())
+						phi->addIncoming(defs[it->second], blk);
+				}
+			}
+
+			for(auto c : domChildren[blk])
+				worklist.push_back({ c, defs });
+		}
+
+		for(const auto& [ v, var ] : vars)
+			var.alloc->eraseFromParent();
+
+		return true;
+	}
+}
+}
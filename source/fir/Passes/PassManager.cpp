@@ -0,0 +1,314 @@
+// PassManager.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/module.h"
+#include "ir/passes.h"
+#include "ir/function.h"
+#include "ir/instruction.h"
+
+#include <unordered_set>
+
+// if a function is still changing after this many trips through the pipeline, give up on it.
+#define MAX_PIPELINE_ITERATIONS 8
+
+namespace fir {
+namespace passes
+{
+	Instruction* getTerminator(IRBlock* blk)
+	{
+		auto& insts = blk->getInstructions();
+		if(insts.empty())
+			return 0;
+
+		auto last = insts.back();
+		switch(last->opKind)
+		{
+			case OpKind::Branch_Cond:
+			case OpKind::Branch_UnCond:
+			case OpKind::Value_Return:
+			case OpKind::Unreachable:
+				return last;
+
+			default:
+				return 0;
+		}
+	}
+
+	std::vector<IRBlock*> getSuccessors(IRBlock* blk)
+	{
+		auto term = getTerminator(blk);
+		if(!term) return { };
+
+		if(term->opKind == OpKind::Branch_UnCond)
+		{
+			return { dcast(IRBlock, term->operands[0]) };
+		}
+		else if(term->opKind == OpKind::Branch_Cond)
+		{
+			auto a = dcast(IRBlock, term->operands[1]);
+			auto b = dcast(IRBlock, term->operands[2]);
+
+			if(a == b)  return { a };
+			else        return { a, b };
+		}
+
+		return { };
+	}
+
+	std::vector<PHINode*> getPHIs(IRBlock* blk)
+	{
+		// irbuilder puts these at the top of the block.
+		std::vector<PHINode*> ret;
+		for(auto inst : blk->getInstructions())
+		{
+			if(inst->opKind != OpKind::Value_CreatePHI)
+				break;
+
+			ret.push_back(dcast(PHINode, inst->realOutput));
+		}
+
+		return ret;
+	}
+
+	util::hash_map<IRBlock*, std::vector<IRBlock*>> getPredecessors(Function* fn)
+	{
+		util::hash_map<IRBlock*, std::vector<IRBlock*>> ret;
+		for(auto b : fn->getBlockList())
+		{
+			// make sure every block has an entry, even if it's empty.
+			ret[b];
+
+			for(auto s : getSuccessors(b))
+				ret[s].push_back(b);
+		}
+
+		return ret;
+	}
+
+	std::vector<IRBlock*> getReversePostOrder(Function* fn)
+	{
+		if(fn->getBlockList().empty())
+			return { };
+
+		std::vector<IRBlock*> postorder;
+		std::unordered_set<IRBlock*> visited;
+
+		// (block, index of the next successor to visit)
+		std::vector<std::pair<IRBlock*, size_t>> stack;
+
+		auto entry = fn->getBlockList().front();
+		stack.push_back({ entry, 0 });
+		visited.insert(entry);
+
+		while(!stack.empty())
+		{
+			auto& [ blk, next ] = stack.back();
+			auto succs = getSuccessors(blk);
+
+			if(next < succs.size())
+			{
+				auto s = succs[next++];
+				if(visited.insert(s).second)
+					stack.push_back({ s, 0 });
+			}
+			else
+			{
+				postorder.push_back(blk);
+				stack.pop_back();
+			}
+		}
+
+		return std::vector<IRBlock*>(postorder.rbegin(), postorder.rend());
+	}
+
+	util::hash_map<IRBlock*, IRBlock*> getImmediateDominators(Function* fn)
+	{
+		// this is from "A Simple, Fast Dominance Algorithm" (Cooper, Harvey, Kennedy).
+		auto rpo = getReversePostOrder(fn);
+		auto preds = getPredecessors(fn);
+
+		util::hash_map<IRBlock*, size_t> order;
+		for(size_t i = 0; i < rpo.size(); i++)
+			order[rpo[i]] = i;
+
+		util::hash_map<IRBlock*, IRBlock*> idom;
+		if(rpo.empty())
+			return idom;
+
+		auto entry = rpo[0];
+		idom[entry] = entry;
+
+		auto intersect = [&idom, &order](IRBlock* a, IRBlock* b) -> IRBlock* {
+			while(a != b)
+			{
+				while(order[a] > order[b]) a = idom[a];
+				while(order[b] > order[a]) b = idom[b];
+			}
+			return a;
+		};
+
+		for(bool changed = true; changed; )
+		{
+			changed = false;
+			for(size_t i = 1; i < rpo.size(); i++)
+			{
+				auto b = rpo[i];
+
+				IRBlock* newIdom = 0;
+				for(auto p : preds[b])
+				{
+					// unreachable predecessors don't count.
+					if(idom.find(p) == idom.end())
+						continue;
+
+					newIdom = (newIdom ? intersect(p, newIdom) : p);
+				}
+
+				iceAssert(newIdom);
+				if(idom[b] != newIdom)
+					idom[b] = newIdom, changed = true;
+			}
+		}
+
+		return idom;
+	}
+
+	bool dominates(const util::hash_map<IRBlock*, IRBlock*>& idom, IRBlock* a, IRBlock* b)
+	{
+		while(true)
+		{
+			if(a == b)
+				return true;
+
+			auto it = idom.find(b);
+			if(it == idom.end() || it->second == b)
+				return false;
+
+			b = it->second;
+		}
+	}
+
+
+
+
+	void PassManager::addPass(const std::string& name, FunctionPass pass)
+	{
+		this->passes.push_back({ name, pass });
+	}
+
+	static void countThings(Module* mod, size_t* insts, size_t* blocks)
+	{
+		for(auto fn : mod->getAllFunctions())
+		{
+			*blocks += fn->getBlockList().size();
+			for(auto b : fn->getBlockList())
+				*insts += b->getInstructions().size();
+		}
+	}
+
+	// callees come before their callers (apart from recursion), so by the time something gets inlined, it's
+	// already been cleaned up.
+	static std::vector<Function*> getBottomUpOrder(Module* mod)
+	{
+		std::vector<Function*> order;
+		std::unordered_set<Function*> visited;
+
+		// (function, index of the next instruction to look at), going through the blocks in order.
+		struct Item { Function* fn; size_t blk; size_t inst; };
+		std::vector<Item> stack;
+
+		for(auto root : mod->getAllFunctions())
+		{
+			if(!visited.insert(root).second)
+				continue;
+
+			stack.push_back({ root, 0, 0 });
+			while(!stack.empty())
+			{
+				auto& it = stack.back();
+				auto& blocks = it.fn->getBlockList();
+
+				if(it.blk == blocks.size())
+				{
+					order.push_back(it.fn);
+					stack.pop_back();
+					continue;
+				}
+
+				auto& insts = blocks[it.blk]->getInstructions();
+				if(it.inst == insts.size())
+				{
+					it.blk++, it.inst = 0;
+					continue;
+				}
+
+				auto inst = insts[it.inst++];
+				if(inst->opKind == OpKind::Value_CallFunction)
+				{
+					if(auto callee = dcast(Function, inst->operands[0]); callee && visited.insert(callee).second)
+						stack.push_back({ callee, 0, 0 });
+				}
+			}
+		}
+
+		return order;
+	}
+
+	void PassManager::run(Module* mod)
+	{
+		countThings(mod, &this->stats.instructionsBefore, &this->stats.blocksBefore);
+		auto refCountsBefore = getElidedRefCountCount();
+		auto devirtualisedBefore = getDevirtualisedCallCount();
+		auto boundsChecksBefore = getRemovedBoundsCheckCount();
+		auto hoistedBefore = getHoistedBoundsCheckCount();
+
+		for(auto fn : getBottomUpOrder(mod))
+		{
+			if(fn->getBlockList().empty())
+				continue;
+
+			for(size_t i = 0; i < MAX_PIPELINE_ITERATIONS; i++)
+			{
+				bool changed = false;
+				for(const auto& [ name, pass ] : this->passes)
+					changed |= pass(fn);
+
+				if(!changed)
+					break;
+
+				// the passes edit the block and instruction lists directly.
+				fn->markModified();
+			}
+		}
+
+		countThings(mod, &this->stats.instructionsAfter, &this->stats.blocksAfter);
+		this->stats.refCountsElided = getElidedRefCountCount() - refCountsBefore;
+		this->stats.callsDevirtualised = getDevirtualisedCallCount() - devirtualisedBefore;
+		this->stats.boundsChecksRemoved = getRemovedBoundsCheckCount() - boundsChecksBefore;
+		this->stats.boundsChecksHoisted = getHoistedBoundsCheckCount() - hoistedBefore;
+	}
+
+	PassManager PassManager::getDefaultPipeline()
+	{
+		PassManager pm;
+
+		// get rid of unreachable blocks first, so the others don't have to think about them.
+		pm.addPass("simplify-cfg", simplifyControlFlow);
+		pm.addPass("mem2reg", promoteAllocations);
+		// this needs to see the refcounting calls before they get inlined.
+		pm.addPass("elide-refcounts", elideRefCounts);
+		// before inlining, so the calls it makes direct can be inlined straight away. it also needs constructors to
+		// have been inlined to see the vtables, which happens on the next time around.
+		pm.addPass("devirtualise", devirtualiseCalls);
+		// the checks are calls until they get inlined, and then they're just branches.
+		pm.addPass("bounds-checks", eliminateBoundsChecks);
+		pm.addPass("inline", inlineCalls);
+		pm.addPass("constant-fold", foldConstants);
+		pm.addPass("dce", eliminateDeadCode);
+
+		return pm;
+	}
+}
+}
@@ -0,0 +1,134 @@
+// RefCounts.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/passes.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/instruction.h"
+
+// codegen increments the refcount of a value whenever it gets copied, and decrements it when the copy goes out of
+// scope; a lot of the time those end up right next to each other, and cancel out. if nothing in between could
+// look at the refcount (or bring it down to zero), then we don't need either of them.
+
+namespace fir {
+namespace passes
+{
+	static size_t numElided = 0;
+
+	size_t getElidedRefCountCount()
+	{
+		return numElided;
+	}
+
+	static Function* getCallee(Instruction* inst)
+	{
+		if(inst->opKind != OpKind::Value_CallFunction)
+			return 0;
+
+		return dcast(Function, inst->operands[0]);
+	}
+
+	// codegen does the members of structs and tuples one at a time, extracting them each time.
+	static bool isSameValue(Value* a, Value* b)
+	{
+		// an lvalue can be a different thing every time we read from it.
+		if(a->islvalue() || b->islvalue())
+			return false;
+
+		if(a == b)
+			return true;
+
+		auto x = a->getDefiningInstruction();
+		auto y = b->getDefiningInstruction();
+
+		if(!x || !y || x->opKind != OpKind::Value_ExtractValue || y->opKind != OpKind::Value_ExtractValue)
+			return false;
+
+		auto i = dcast(ConstantInt, x->operands[1]);
+		auto k = dcast(ConstantInt, y->operands[1]);
+
+		return i && k && i->getUnsignedValue() == k->getUnsignedValue() && isSameValue(x->operands[0], y->operands[0]);
+	}
+
+	// whether the instruction might look at (or change) something in memory.
+	static bool touchesMemory(Instruction* inst)
+	{
+		if(inst->hasSideEffects() || inst->opKind == OpKind::Value_ReadPtr)
+			return true;
+
+		// lvalues get read from when they're used.
+		return std::any_of(inst->operands.begin(), inst->operands.end(), [](Value* v) -> bool {
+			return v->islvalue();
+		});
+	}
+
+	bool elideRefCounts(Function* fn)
+	{
+		std::vector<Instruction*> dead;
+		for(auto b : fn->getBlockList())
+		{
+			// the increments that we haven't found a decrement for yet. if some other decrement comes along, then it
+			// might be for the same thing; without the increment it would go to zero (and get freed) there instead
+			// of at the decrement we're removing. that's fine, as long as nothing uses it in between -- so after
+			// that, the increment is stuck unless we only see other decrements.
+			struct Pending { Instruction* incr; bool afterDecrement; };
+			std::vector<Pending> pending;
+
+			for(auto inst : b->getInstructions())
+			{
+				auto callee = getCallee(inst);
+				if(callee && callee->isRefCountIncrement())
+				{
+					if(!inst->operands[1]->islvalue())
+						pending.push_back({ inst, false });
+				}
+				else if(callee && callee->isRefCountDecrement())
+				{
+					auto it = std::find_if(pending.rbegin(), pending.rend(), [inst](const Pending& p) -> bool {
+						return isSameValue(p.incr->operands[1], inst->operands[1]);
+					});
+
+					if(it != pending.rend())
+					{
+						dead.push_back(it->incr);
+						dead.push_back(inst);
+
+						pending.erase(std::next(it).base());
+					}
+					else
+					{
+						for(auto& p : pending)
+							p.afterDecrement = true;
+					}
+				}
+				else if(callee || inst->opKind == OpKind::Value_CallFunctionPointer || inst->opKind == OpKind::Value_CallVirtualMethod
+					|| inst->opKind == OpKind::SAA_GetRefCountPtr || inst->opKind == OpKind::Any_GetRefCountPtr)
+				{
+					// we don't know what calls do with the refcounts, and these are the only ways to get at them.
+					pending.clear();
+				}
+				else if(touchesMemory(inst))
+				{
+					pending.erase(std::remove_if(pending.begin(), pending.end(), [](const Pending& p) -> bool {
+						return p.afterDecrement;
+					}), pending.end());
+				}
+			}
+		}
+
+		for(auto inst : dead)
+		{
+			// the array ones give back the array.
+			if(inst->realOutput->hasUsers())
+				inst->realOutput->replaceAllUsesWith(inst->operands[1]);
+
+			inst->eraseFromParent();
+		}
+
+		numElided += dead.size();
+		return !dead.empty();
+	}
+}
+}
@@ -0,0 +1,163 @@
+// SimplifyCFG.cpp
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include "ir/block.h"
+#include "ir/passes.h"
+#include "ir/function.h"
+#include "ir/irbuilder.h"
+#include "ir/instruction.h"
+
+#include <unordered_set>
+
+namespace fir {
+namespace passes
+{
+	// 'if(x) goto A else goto A' is just 'goto A'.
+	static bool foldRedundantBranches(Function* fn)
+	{
+		bool changed = false;
+
+		IRBuilder irb(fn->getParentModule());
+		for(auto b : fn->getBlockList())
+		{
+			auto term = getTerminator(b);
+			if(term->opKind == OpKind::Branch_Cond && term->operands[1] == term->operands[2])
+			{
+				auto target = dcast(IRBlock, term->operands[1]);
+				term->eraseFromParent();
+
+				irb.setCurrentBlock(b);
+				irb.UnCondBranch(target);
+
+				changed = true;
+			}
+		}
+
+		return changed;
+	}
+
+	static bool removeUnreachableBlocks(Function* fn, const std::vector<IRBlock*>& rpo)
+	{
+		auto& blocks = fn->getBlockList();
+		if(rpo.size() == blocks.size())
+			return false;
+
+		std::unordered_set<IRBlock*> reachable(rpo.begin(), rpo.end());
+		for(auto b : blocks)
+		{
+			if(reachable.find(b) != reachable.end())
+				continue;
+
+			// the phis in the blocks we keep can't come from here any more.
+			for(auto s : getSuccessors(b))
+			{
+				if(reachable.find(s) != reachable.end())
+				{
+					for(auto phi : getPHIs(s))
+						phi->removeIncoming(b);
+				}
+			}
+
+			// they might still be using things in the blocks we keep (or each other), so let go of those.
+			for(auto inst : b->getInstructions())
+				inst->dropAllReferences();
+		}
+
+		blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [&reachable](IRBlock* b) -> bool {
+			return reachable.find(b) == reachable.end();
+		}), blocks.end());
+
+		return true;
+	}
+
+	// if B's only predecessor is P, and P always jumps to B, then we can just stick B onto the end of P.
+	static bool mergeBlocks(Function* fn)
+	{
+		bool changed = false;
+
+		auto& blocks = fn->getBlockList();
+		auto preds = getPredecessors(fn);
+
+		for(size_t i = 0; i < blocks.size(); )
+		{
+			auto pred = blocks[i];
+			auto term = getTerminator(pred);
+
+			IRBlock* blk = 0;
+			if(term->opKind == OpKind::Branch_UnCond)
+				blk = dcast(IRBlock, term->operands[0]);
+
+			if(!blk || blk == pred || blk == blocks.front() || preds[blk].size() != 1)
+			{
+				i++;
+				continue;
+			}
+
+			// with only one way in, the phis don't have anything to choose from.
+			while(!blk->getInstructions().empty() && blk->getInstructions().front()->opKind == OpKind::Value_CreatePHI)
+			{
+				auto inst = blk->getInstructions().front();
+				auto phi = dcast(PHINode, inst->realOutput);
+				iceAssert(phi->getValues().size() == 1);
+
+				phi->replaceAllUsesWith(phi->getValues().begin()->second);
+				inst->eraseFromParent();
+			}
+
+			term->eraseFromParent();
+
+			auto binsts = blk->getInstructions();
+			blk->getInstructions().clear();
+
+			for(auto inst : binsts)
+			{
+				inst->parentBlock = 0;
+				pred->addInstruction(inst);
+			}
+
+			// the only things still pointing at B are the phis in its successors.
+			blk->replaceAllUsesWith(pred);
+
+			for(auto s : getSuccessors(pred))
+				std::replace(preds[s].begin(), preds[s].end(), blk, pred);
+
+			auto bidx = std::find(blocks.begin(), blocks.end(), blk) - blocks.begin();
+			blocks.erase(blocks.begin() + bidx);
+
+			if(static_cast<size_t>(bidx) < i)
+				i--;
+
+			// don't move on -- 'pred' might be able to swallow its new successor as well.
+			changed = true;
+		}
+
+		return changed;
+	}
+
+	bool simplifyControlFlow(Function* fn)
+	{
+		// this shouldn't happen, but if some block doesn't end properly then we can't reason about any of this.
+		for(auto b : fn->getBlockList())
+		{
+			if(!getTerminator(b))
+				return false;
+		}
+
+		bool changed = foldRedundantBranches(fn);
+		changed |= removeUnreachableBlocks(fn, getReversePostOrder(fn));
+		changed |= mergeBlocks(fn);
+
+		// put the blocks in reverse post-order, so that definitions always come before their uses
+		// (not counting the phis) when we go through the blocks from top to bottom.
+		auto rpo = getReversePostOrder(fn);
+		if(rpo != fn->getBlockList())
+		{
+			fn->getBlockList() = rpo;
+			changed = true;
+		}
+
+		return changed;
+	}
+}
+}
@@ -64,9 +64,26 @@ namespace fir
 		return this->isVariadic;
 	}
 
+	template <typename Make>
+	static ArraySliceType* getOrCreate(Type* elementType, bool mut, bool variadic, Make&& make)
+	{
+		size_t hash = static_cast<size_t>(TypeKind::ArraySlice);
+		_hash_combine(hash, elementType);
+		_hash_combine(hash, mut);
+		_hash_combine(hash, variadic);
+
+		return TypeCache::get().getOrAddCachedType<ArraySliceType>(hash,
+			[elementType, mut, variadic](ArraySliceType* t) -> bool {
+				return t->getElementType() == elementType && t->isMutable() == mut && t->isVariadicType() == variadic;
+			},
+			make);
+	}
+
 	ArraySliceType* ArraySliceType::get(Type* elementType, bool mut)
 	{
-		return TypeCache::get().getOrAddCachedType(new ArraySliceType(elementType, mut));
+		return getOrCreate(elementType, mut, false, [elementType, mut]() -> ArraySliceType* {
+			return new ArraySliceType(elementType, mut);
+		});
 	}
 
 	ArraySliceType* ArraySliceType::getMutable(Type* elementType)
@@ -81,10 +98,12 @@ namespace fir
 
 	ArraySliceType* ArraySliceType::getVariadic(Type* elementType)
 	{
-		auto a = new ArraySliceType(elementType, false);
-		a->isVariadic = true;
+		return getOrCreate(elementType, false, true, [elementType]() -> ArraySliceType* {
+			auto a = new ArraySliceType(elementType, false);
+			a->isVariadic = true;
 
-		return TypeCache::get().getOrAddCachedType(a);
+			return a;
+		});
 	}
 
 
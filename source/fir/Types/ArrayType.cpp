@@ -14,7 +14,13 @@ namespace fir
 
 	ArrayType* ArrayType::get(Type* elementType, size_t num)
 	{
-		return TypeCache::get().getOrAddCachedType(new ArrayType(elementType, num));
+		size_t hash = static_cast<size_t>(TypeKind::Array);
+		_hash_combine(hash, elementType);
+		_hash_combine(hash, num);
+
+		return TypeCache::get().getOrAddCachedType<ArrayType>(hash,
+			[elementType, num](ArrayType* t) -> bool { return t->arrayElementType == elementType && t->arraySize == num; },
+			[elementType, num]() -> ArrayType* { return new ArrayType(elementType, num); });
 	}
 
 	std::string ArrayType::str()
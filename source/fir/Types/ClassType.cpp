@@ -41,7 +41,7 @@ namespace fir
 	// various
 	std::string ClassType::str()
 	{
-		return "class(" + this->className.name + ")";
+		return "class(" + this->className.getName() + ")";
 	}
 
 	std::string ClassType::encodedStr()
@@ -94,6 +94,8 @@ namespace fir
 
 	void ClassType::setMembers(const std::vector<std::pair<std::string, Type*>>& members)
 	{
+		invalidateTypeLayouts();
+
 		size_t i = 0;
 		{
 			auto cls = this->baseClass;
@@ -260,7 +262,7 @@ namespace fir
 		for(auto m : methods)
 		{
 			this->methodList.push_back(m);
-			this->classMethodMap[m->getName().name].push_back(m);
+			this->classMethodMap[m->getName().getName()].push_back(m);
 		}
 	}
 
@@ -270,7 +272,7 @@ namespace fir
 		for(auto m : inits)
 		{
 			this->initialiserList.push_back(m);
-			this->classMethodMap[m->getName().name].push_back(m);
+			this->classMethodMap[m->getName().getName()].push_back(m);
 		}
 	}
 
@@ -301,6 +303,8 @@ namespace fir
 
 	void ClassType::setBaseClass(ClassType* ty)
 	{
+		invalidateTypeLayouts();
+
 		this->baseClass = ty;
 
 		//* keeps things simple.
@@ -314,6 +318,8 @@ namespace fir
 
 	void ClassType::addVirtualMethod(Function* method)
 	{
+		invalidateTypeLayouts();
+
 		//* note: the 'reverse' virtual method map is to allow us, at translation time, to easily create the vtable without
 		//* unnecessary searching. When we set a base class, we copy its 'reverse' map; thus, if we don't override anything,
 		//* our vtable will just refer to the methods in the base class.
@@ -327,10 +333,10 @@ namespace fir
 		bool found = false;
 		for(const auto& vm : this->virtualMethodMap)
 		{
-			if(vm.first.first == method->getName().name && areTypeListsContravariant(vm.first.second, list, /* trait checking: */ false))
+			if(vm.first.first == method->getName().getName() && areTypeListsContravariant(vm.first.second, list, /* trait checking: */ false))
 			{
 				found = true;
-				this->virtualMethodMap[{ method->getName().name, list }] = vm.second;
+				this->virtualMethodMap[{ method->getName().getName(), list }] = vm.second;
 				this->reverseVirtualMethodMap[vm.second] = method;
 				break;
 			}
@@ -339,7 +345,7 @@ namespace fir
 		if(!found)
 		{
 			// just make a new one.
-			this->virtualMethodMap[{ method->getName().name, list }] = this->virtualMethodCount;
+			this->virtualMethodMap[{ method->getName().getName(), list }] = this->virtualMethodCount;
 			this->reverseVirtualMethodMap[this->virtualMethodCount] = method;
 			this->virtualMethodCount++;
 		}
@@ -361,7 +367,7 @@ namespace fir
 		else
 		{
 			error("no method named '%s' matching signature '%s' in virtual method table of class '%s'",
-				name, ft, this->getTypeName().name);
+				name, ft, this->getTypeName().getName());
 		}
 	}
 
@@ -37,7 +37,12 @@ namespace fir
 
 	DynamicArrayType* DynamicArrayType::get(Type* elementType)
 	{
-		return TypeCache::get().getOrAddCachedType(new DynamicArrayType(elementType));
+		size_t hash = static_cast<size_t>(TypeKind::DynamicArray);
+		_hash_combine(hash, elementType);
+
+		return TypeCache::get().getOrAddCachedType<DynamicArrayType>(hash,
+			[elementType](DynamicArrayType* t) -> bool { return t->arrayElementType == elementType; },
+			[elementType]() -> DynamicArrayType* { return new DynamicArrayType(elementType); });
 	}
 
 	fir::Type* DynamicArrayType::substitutePlaceholders(const util::hash_map<fir::Type*, fir::Type*>& subst)
@@ -27,7 +27,7 @@ namespace fir
 
 	std::string EnumType::str()
 	{
-		return "enum(" + this->typeName.name + ")";
+		return "enum(" + this->typeName.getName() + ")";
 	}
 
 	std::string EnumType::encodedStr()
@@ -66,6 +66,8 @@ namespace fir
 
 	void EnumType::setCaseType(Type* t)
 	{
+		invalidateTypeLayouts();
+
 		if(!this->caseType->isVoidType())
 			error("cannot modify enum type! was previously '%s'", this->caseType);
 
@@ -24,10 +24,24 @@ namespace fir
 
 
 
+	template <typename Make>
+	static FunctionType* getOrCreate(const std::vector<Type*>& args, Type* ret, bool iscva, Make&& make)
+	{
+		size_t hash = TypeCache::hashTypeList(static_cast<size_t>(TypeKind::Function), args);
+		_hash_combine(hash, ret);
+		_hash_combine(hash, iscva);
+
+		return TypeCache::get().getOrAddCachedType<FunctionType>(hash,
+			[&args, ret, iscva](FunctionType* t) -> bool {
+				return t->getReturnType() == ret && t->isCStyleVarArg() == iscva && t->getArgumentTypes() == args;
+			},
+			make);
+	}
+
 	// functions
 	FunctionType* FunctionType::getCVariadicFunc(const std::vector<Type*>& args, Type* ret)
 	{
-		return TypeCache::get().getOrAddCachedType(new FunctionType(args, ret, true));
+		return getOrCreate(args, ret, true, [&args, ret]() -> FunctionType* { return new FunctionType(args, ret, true); });
 	}
 
 	FunctionType* FunctionType::getCVariadicFunc(const std::initializer_list<Type*>& args, Type* ret)
@@ -37,7 +51,7 @@ namespace fir
 
 	FunctionType* FunctionType::get(const std::vector<Type*>& args, Type* ret)
 	{
-		return TypeCache::get().getOrAddCachedType(new FunctionType(args, ret, false));
+		return getOrCreate(args, ret, false, [&args, ret]() -> FunctionType* { return new FunctionType(args, ret, false); });
 	}
 
 	FunctionType* FunctionType::get(const std::initializer_list<Type*>& args, Type* ret)
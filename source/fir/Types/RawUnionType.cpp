@@ -40,7 +40,7 @@ namespace fir
 	// various
 	std::string RawUnionType::str()
 	{
-		return "raw_union(" + this->unionName.name + ")";
+		return "raw_union(" + this->unionName.getName() + ")";
 	}
 
 	std::string RawUnionType::encodedStr()
@@ -93,6 +93,8 @@ namespace fir
 
 	void RawUnionType::setBody(const util::hash_map<std::string, Type*>& members)
 	{
+		invalidateTypeLayouts();
+
 		this->variants = members;
 	}
 
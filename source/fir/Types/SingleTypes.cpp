@@ -80,7 +80,16 @@ namespace fir
 	}
 	ConstantNumberType* ConstantNumberType::get(bool neg, bool flt, size_t bits)
 	{
-		return TypeCache::get().getOrAddCachedType(new ConstantNumberType(neg, flt, bits));
+		size_t hash = static_cast<size_t>(TypeKind::ConstantNumber);
+		_hash_combine(hash, neg);
+		_hash_combine(hash, flt);
+		_hash_combine(hash, bits);
+
+		return TypeCache::get().getOrAddCachedType<ConstantNumberType>(hash,
+			[neg, flt, bits](ConstantNumberType* t) -> bool {
+				return t->isSigned() == neg && t->isFloating() == flt && t->getMinBits() == bits;
+			},
+			[neg, flt, bits]() -> ConstantNumberType* { return new ConstantNumberType(neg, flt, bits); });
 	}
 	ConstantNumberType::ConstantNumberType(bool neg, bool flt, size_t bits) : Type(TypeKind::ConstantNumber)
 	{
@@ -40,7 +40,7 @@ namespace fir
 	// various
 	std::string StructType::str()
 	{
-		return "struct(" + this->structName.name + ")";
+		return "struct(" + this->structName.getName() + ")";
 	}
 
 	std::string StructType::encodedStr()
@@ -127,6 +127,8 @@ namespace fir
 
 	void StructType::setBody(const std::vector<std::pair<std::string, Type*>>& members)
 	{
+		invalidateTypeLayouts();
+
 		size_t i = 0;
 		for(const auto& [ name, ty ] : members)
 		{
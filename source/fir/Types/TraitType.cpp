@@ -34,7 +34,7 @@ namespace fir
 	// various
 	std::string TraitType::str()
 	{
-		return "trait(" + this->traitName.name + ")";
+		return "trait(" + this->traitName.getName() + ")";
 	}
 
 	std::string TraitType::encodedStr()
@@ -52,7 +52,11 @@ namespace fir
 
 	TupleType* TupleType::get(const std::vector<Type*>& mems)
 	{
-		return TypeCache::get().getOrAddCachedType(new TupleType(mems));
+		size_t hash = TypeCache::hashTypeList(static_cast<size_t>(TypeKind::Tuple), mems);
+
+		return TypeCache::get().getOrAddCachedType<TupleType>(hash,
+			[&mems](TupleType* t) -> bool { return t->members == mems; },
+			[&mems]() -> TupleType* { return new TupleType(mems); });
 	}
 
 	TupleType* TupleType::get(const std::initializer_list<Type*>& mems)
@@ -1005,28 +1005,31 @@ namespace fir
 
 
 
-	static size_t getAggregateSize(const std::vector<Type*>& tys, bool packed = false)
+	// lays out 'tys' one after the other, padding each to its alignment (unless packed), and pads the whole thing
+	// to the largest alignment. the offset of each element is put into 'offsets', if given.
+	static size_t layoutAggregate(const std::vector<Type*>& tys, bool packed, std::vector<size_t>* offsets = 0)
 	{
 		size_t ptr = 0;
 		size_t aln = 0;
 
 		if(packed)
 		{
-			// gg
-			// return util::foldl(0, tys, [](Type* a, Type* b) -> size_t {
-			// 	return getSizeOfType(a) + getSizeOfType(b);
-			// });
-
-			size_t ret = 0;
 			for(const auto& t : tys)
-				ret += getSizeOfType(t);
+			{
+				if(offsets) offsets->push_back(ptr);
+				ptr += getSizeOfType(t);
+			}
 
-			return ret;
+			return ptr;
 		}
 		else
 		{
 			for(auto ty : tys)
 			{
+				// note: the offset of a field is taken *before* it is padded to its own alignment. this is what the
+				// interpreter has always done (it builds constant aggregates without padding, too), so keep it.
+				if(offsets) offsets->push_back(ptr);
+
 				auto a = getAlignmentOfType(ty);
 				iceAssert(a > 0);
 
@@ -1037,62 +1040,196 @@ namespace fir
 				aln = std::max(aln, a);
 			}
 
-			iceAssert(aln > 0);
-			if(ptr % aln > 0)
+			// (an empty aggregate is empty)
+			if(aln > 0 && ptr % aln > 0)
 				ptr += (aln - (ptr % aln));
 
 			return ptr;
 		}
 	}
 
-	size_t getSizeOfType(Type* type)
+	// the fields of the aggregate-ish types, in the order they live in memory. these are the same types that the
+	// translator and the interpreter use when they build these things.
+	static std::vector<Type*> getLayoutFields(Type* type, bool* packed)
 	{
-		auto ptrt = fir::Type::getInt8Ptr();
 		auto wordty = fir::Type::getNativeWord();
 
-		if(type->isVoidType())                                      return 0;
-		else if(type->isBoolType())                                 return 1;
-		else if(type->isPrimitiveType())                            return type->getBitWidth() / 8;
-		else if(type->isArraySliceType())                           return getAggregateSize({ ptrt, wordty });
-		else if(type->isStringType() || type->isDynamicArrayType()) return getAggregateSize({ ptrt, wordty, wordty, ptrt });
-		else if(type->isRangeType())                                return getAggregateSize({ wordty, wordty, wordty });
-		else if(type->isPointerType() || type->isFunctionType() || type->isNullType())
+		if(type->isStructType())
 		{
-			return getSizeOfType(wordty);
+			*packed = type->toStructType()->isPackedStruct();
+			return type->toStructType()->getElements();
 		}
-		else if(type->isArrayType())
+		else if(type->isClassType())
 		{
-			return type->toArrayType()->getArraySize() * getSizeOfType(type->getArrayElementType());
+			// the vtable goes at the front, but only if there is one.
+			auto ret = type->toClassType()->getAllElementsIncludingBase();
+			if(type->toClassType()->getVirtualMethodCount() > 0)
+				ret.insert(ret.begin(), fir::Type::getInt8Ptr());
+
+			return ret;
+		}
+		else if(type->isTupleType())
+		{
+			return type->toTupleType()->getElements();
+		}
+		else if(type->isArraySliceType())
+		{
+			if(type->toArraySliceType()->isMutable())
+				return { type->getArrayElementType()->getMutablePointerTo(), wordty };
+
+			else
+				return { type->getArrayElementType()->getPointerTo(), wordty };
+		}
+		else if(type->isStringType() || type->isDynamicArrayType())
+		{
+			// data, length, capacity, refcount
+			auto data = type->isDynamicArrayType() ? type->getArrayElementType()->getMutablePointerTo() : fir::Type::getMutInt8Ptr();
+			return { data, wordty, wordty, fir::Type::getNativeWordPtr() };
+		}
+		else if(type->isRangeType())
+		{
+			return { wordty, wordty, wordty };
 		}
 		else if(type->isEnumType())
 		{
-			return getAggregateSize({ wordty, type->toEnumType()->getCaseType() });
+			return { wordty, type->toEnumType()->getCaseType() };
 		}
 		else if(type->isAnyType())
 		{
-			return getAggregateSize({ wordty, ptrt, fir::ArrayType::get(fir::Type::getInt8(), BUILTIN_ANY_DATA_BYTECOUNT) });
+			return {
+				fir::Type::getNativeUWord(), fir::Type::getNativeWordPtr(),
+				fir::ArrayType::get(fir::Type::getInt8(), BUILTIN_ANY_DATA_BYTECOUNT)
+			};
 		}
-		else if(type->isClassType() || type->isStructType() || type->isTupleType())
-		{
-			bool packed = false;
-			std::vector<Type*> tys;
 
-			if(type->isClassType())
+		return { };
+	}
+
+	// like layoutAggregate(), but using the abi sizes and alignments; see TypeLayout.
+	static void layoutAggregateForABI(const std::vector<Type*>& tys, bool packed, TypeLayout* layout)
+	{
+		size_t ptr = 0;
+		size_t aln = 1;
+
+		for(auto ty : tys)
+		{
+			auto& fl = getTypeLayout(ty);
+			if(!packed)
 			{
-				tys = type->toClassType()->getAllElementsIncludingBase();
-				tys.insert(tys.begin(), fir::Type::getInt8Ptr());
+				if(ptr % fl.abiAlignment > 0)
+					ptr += (fl.abiAlignment - (ptr % fl.abiAlignment));
+
+				aln = std::max(aln, fl.abiAlignment);
 			}
-			else if(type->isStructType())
+
+			layout->abiFieldOffsets.push_back(ptr);
+			ptr += fl.abiSize;
+		}
+
+		if(ptr % aln > 0)
+			ptr += (aln - (ptr % aln));
+
+		layout->abiSize = ptr;
+		layout->abiAlignment = aln;
+	}
+
+	static void computeABILayout(Type* type, TypeLayout* layout)
+	{
+		if(type->isArrayType())
+		{
+			auto& el = getTypeLayout(type->getArrayElementType());
+			layout->abiSize = type->toArrayType()->getArraySize() * el.abiSize;
+			layout->abiAlignment = el.abiAlignment;
+		}
+		else if(!layout->fieldTypes.empty())
+		{
+			bool packed = type->isStructType() && type->toStructType()->isPackedStruct();
+			layoutAggregateForABI(layout->fieldTypes, packed, layout);
+		}
+		else if(type->isUnionType() || type->isRawUnionType())
+		{
+			// the variants all start at the same place, so it's as big (and as aligned) as the biggest one.
+			std::vector<Type*> variants;
+			if(type->isUnionType())
 			{
-				packed = type->toStructType()->isPackedStruct();
-				tys = type->toStructType()->getElements();
+				for(auto v : type->toUnionType()->getVariants())
+					variants.push_back(v.second->getInteriorType());
 			}
 			else
 			{
-				tys = type->toTupleType()->getElements();
+				for(const auto& v : type->toRawUnionType()->getVariants())
+					variants.push_back(v.second);
+			}
+
+			size_t sz = 0;
+			size_t aln = 1;
+			for(auto v : variants)
+			{
+				sz = std::max(sz, getTypeLayout(v).abiSize);
+				aln = std::max(aln, getTypeLayout(v).abiAlignment);
+			}
+
+			// tagged unions have the id in front, and the value right after it.
+			if(type->isUnionType())
+			{
+				auto word = getSizeOfType(fir::Type::getNativeWord());
+				aln = std::max(aln, word);
+				sz += word;
 			}
 
-			return getAggregateSize(tys, packed);
+			if(sz % aln > 0)
+				sz += (aln - (sz % aln));
+
+			layout->abiSize = sz;
+			layout->abiAlignment = aln;
+		}
+		else if(type->isUnionVariantType())
+		{
+			auto& il = getTypeLayout(type->toUnionVariantType()->getInteriorType());
+			layout->abiSize = il.abiSize;
+			layout->abiAlignment = il.abiAlignment;
+		}
+		else
+		{
+			// scalars (and empty aggregates) are the same either way.
+			layout->abiSize = layout->size;
+			layout->abiAlignment = std::max(layout->alignment, static_cast<size_t>(1));
+		}
+	}
+
+	static size_t computeSizeOfType(Type* type, TypeLayout* layout)
+	{
+		auto wordty = fir::Type::getNativeWord();
+
+		if(type->isVoidType())                                      return 0;
+		else if(type->isBoolType())                                 return 1;
+		else if(type->isPrimitiveType())                            return type->getBitWidth() / 8;
+		else if(type->isPointerType() || type->isFunctionType() || type->isNullType())
+		{
+			return getSizeOfType(wordty);
+		}
+		else if(type->isArrayType())
+		{
+			return type->toArrayType()->getArraySize() * getSizeOfType(type->getArrayElementType());
+		}
+		else if(type->isClassType())
+		{
+			// note: the size always has room for the vtable pointer, even if the class doesn't have one.
+			auto tys = type->toClassType()->getAllElementsIncludingBase();
+			tys.insert(tys.begin(), fir::Type::getInt8Ptr());
+
+			layout->fieldTypes = getLayoutFields(type, /* packed: */ 0);
+			layoutAggregate(layout->fieldTypes, false, &layout->fieldOffsets);
+
+			return layoutAggregate(tys, false);
+		}
+		else if(type->isStructType() || type->isTupleType() || type->isArraySliceType() || type->isStringType()
+			|| type->isDynamicArrayType() || type->isRangeType() || type->isEnumType() || type->isAnyType())
+		{
+			bool packed = false;
+			layout->fieldTypes = getLayoutFields(type, &packed);
+
+			return layoutAggregate(layout->fieldTypes, packed, &layout->fieldOffsets);
 		}
 		else if(type->isUnionType() )
 		{
@@ -1107,11 +1244,11 @@ namespace fir
 
 			if(maxSz > 0)
 			{
-				return getAggregateSize({ wordty, ArrayType::get(Type::getInt8(), maxSz) });
+				return layoutAggregate({ wordty, ArrayType::get(Type::getInt8(), maxSz) }, false);
 			}
 			else
 			{
-				return getAggregateSize({ wordty });
+				return layoutAggregate({ wordty }, false);
 			}
 		}
 		else if(type->isRawUnionType())
@@ -1123,7 +1260,7 @@ namespace fir
 				maxSz = std::max(maxSz, getSizeOfType(v.second));
 
 			iceAssert(maxSz > 0);
-			return getAggregateSize({ ArrayType::get(Type::getInt8(), maxSz) });
+			return layoutAggregate({ ArrayType::get(Type::getInt8(), maxSz) }, false);
 		}
 		else if(type->isUnionVariantType())
 		{
@@ -1139,10 +1276,46 @@ namespace fir
 		}
 	}
 
+
+	// bumped whenever the body of some type changes. since types can contain other types by value, we don't try to
+	// work out which layouts are affected -- everything is recomputed on next use. this only really happens during
+	// codegen, so by the time anyone is asking about layouts in earnest, it has settled down.
+	static size_t layoutGeneration = 1;
+	void invalidateTypeLayouts()
+	{
+		layoutGeneration += 1;
+	}
+
+	const TypeLayout& getTypeLayout(Type* type)
+	{
+		if(type->layout && type->layoutGeneration == layoutGeneration)
+			return *type->layout;
+
+		if(!type->layout)
+			type->layout = new TypeLayout();
+
+		// we might have a stale one, clear it out first.
+		auto layout = type->layout;
+		*layout = TypeLayout();
+
+		layout->size = computeSizeOfType(type, layout);
+		if(type->isArrayType()) layout->alignment = getAlignmentOfType(type->getArrayElementType());
+		else                    layout->alignment = layout->size;
+
+		computeABILayout(type, layout);
+
+		type->layoutGeneration = layoutGeneration;
+		return *layout;
+	}
+
+	size_t getSizeOfType(Type* type)
+	{
+		return getTypeLayout(type).size;
+	}
+
 	size_t getAlignmentOfType(Type* type)
 	{
-		if(type->isArrayType())     return getAlignmentOfType(type->getArrayElementType());
-		else                        return getSizeOfType(type);
+		return getTypeLayout(type).alignment;
 	}
 
 
@@ -39,7 +39,7 @@ namespace fir
 	// various
 	std::string UnionType::str()
 	{
-		return "union(" + this->unionName.name + ")";
+		return "union(" + this->unionName.getName() + ")";
 	}
 
 	std::string UnionType::encodedStr()
@@ -110,6 +110,8 @@ namespace fir
 
 	void UnionType::setBody(const util::hash_map<std::string, std::pair<size_t, Type*>>& members)
 	{
+		invalidateTypeLayouts();
+
 		for(const auto& [ n, p ] : members)
 		{
 			auto uvt = new UnionVariantType(this, p.first, n, p.second);
@@ -2,7 +2,9 @@
 // Copyright (c) 2014 - 2016, zhiayang
 // Licensed under the Apache License Version 2.0.
 
+#include "ir/block.h"
 #include "ir/value.h"
+#include "ir/function.h"
 #include "ir/constant.h"
 
 namespace fir
@@ -45,12 +47,53 @@ namespace fir
 		return vnames;
 	}
 
+	void Value::addUser(Value* user)
+	{
+		if(this->tracksUsers)
+			this->users.push_back(user);
+	}
+
+	void Value::removeUser(Value* user)
+	{
+		if(!this->tracksUsers)
+			return;
+
+		// the order doesn't matter, so don't bother shifting everything down.
+		auto it = std::find(this->users.begin(), this->users.end(), user);
+		iceAssert(it != this->users.end() && "not a user");
+
+		*it = this->users.back();
+		this->users.pop_back();
+	}
+
+	void Value::replaceAllUsesWith(Value* v)
+	{
+		iceAssert(v != this && "cannot replace value with itself");
+
+		// each user takes out all of its own entries, so this terminates.
+		while(!this->users.empty())
+			this->users.back()->replaceUsesOf(this, v);
+	}
+
+	void Value::replaceUsesOf(Value* from, Value* to)
+	{
+		error("value %d does not use anything", this->id);
+	}
+
 
 
 
 
 
 
+	// changing the incoming values changes the function, see Function::markModified().
+	static void markModified(PHINode* phi)
+	{
+		auto inst = phi->getDefiningInstruction();
+		if(inst && inst->getParentBlock() && inst->getParentBlock()->getParentFunction())
+			inst->getParentBlock()->getParentFunction()->markModified();
+	}
+
 	void PHINode::addIncoming(Value* v, IRBlock* block)
 	{
 		iceAssert(v->getType() == this->valueType && "types not identical");
@@ -58,6 +101,11 @@ namespace fir
 			iceAssert(0 && "block already has incoming value");
 
 		this->incoming[block] = v;
+
+		v->addUser(this);
+		block->addUser(this);
+
+		markModified(this);
 	}
 
 	std::map<IRBlock*, Value*> PHINode::getValues()
@@ -65,6 +113,61 @@ namespace fir
 		return this->incoming;
 	}
 
+	void PHINode::setIncoming(Value* v, IRBlock* block)
+	{
+		iceAssert(v->getType() == this->valueType && "types not identical");
+
+		auto it = this->incoming.find(block);
+		iceAssert(it != this->incoming.end() && "block has no incoming value");
+
+		it->second->removeUser(this);
+		it->second = v;
+		v->addUser(this);
+
+		markModified(this);
+	}
+
+	void PHINode::removeIncoming(IRBlock* block)
+	{
+		if(auto it = this->incoming.find(block); it != this->incoming.end())
+		{
+			it->second->removeUser(this);
+			block->removeUser(this);
+
+			this->incoming.erase(it);
+			markModified(this);
+		}
+	}
+
+	void PHINode::replaceIncomingBlock(IRBlock* from, IRBlock* to)
+	{
+		if(auto it = this->incoming.find(from); it != this->incoming.end())
+		{
+			auto v = it->second;
+			this->incoming.erase(it);
+
+			iceAssert(this->incoming.find(to) == this->incoming.end() && "block already has incoming value");
+			this->incoming[to] = v;
+
+			from->removeUser(this);
+			to->addUser(this);
+
+			markModified(this);
+		}
+	}
+
+	void PHINode::replaceUsesOf(Value* from, Value* to)
+	{
+		if(auto blk = dcast(IRBlock, from); blk)
+			this->replaceIncomingBlock(blk, dcast(IRBlock, to));
+
+		for(auto& [ blk, val ] : this->incoming)
+		{
+			if(val == from)
+				this->setIncoming(to, blk);
+		}
+	}
+
 	PHINode::PHINode(Type* t) : fir::Value(t)
 	{
 	}
@@ -12,7 +12,103 @@
 namespace fir {
 namespace interp
 {
-	static interp::Instruction compileInstruction(InterpState* is, fir::Function* parent, fir::Instruction* finstr)
+	// while compiling a function, this tracks the registers and constants we've handed out so far.
+	struct FunctionLowering
+	{
+		interp::Function* func = 0;
+
+		std::unordered_map<fir::Value*, size_t> registers;
+		std::unordered_map<fir::Value*, size_t> constants;
+		std::unordered_map<fir::IRBlock*, size_t> blocks;
+	};
+
+	// some operands are only there to carry a type (eg. the target of a cast, or the type of a stack allocation),
+	// and the interpreter never reads their value. we don't want to put those in the constant pool, because
+	// we might not even be able to make a value of that type.
+	static bool isTypeOnlyOperand(OpKind ok, size_t idx)
+	{
+		switch(ok)
+		{
+			case OpKind::Floating_Truncate:
+			case OpKind::Floating_Extend:
+			case OpKind::Cast_Bitcast:
+			case OpKind::Cast_Signedness:
+			case OpKind::Cast_IntSignedness:
+			case OpKind::Cast_PointerType:
+			case OpKind::Cast_PointerToInt:
+			case OpKind::Cast_IntToPointer:
+			case OpKind::Value_GetStructMember:
+			case OpKind::Union_GetValue:
+			case OpKind::Union_SetValue:
+			case OpKind::RawUnion_GEP:
+				return idx == 1;
+
+			case OpKind::Misc_Sizeof:
+			case OpKind::Value_StackAlloc:
+			case OpKind::Value_CreateLVal:
+			case OpKind::Value_CallFunction:
+				return idx == 0;
+
+			case OpKind::Value_CallVirtualMethod:
+				return idx == 0 || idx == 2;
+
+			default:
+				return false;
+		}
+	}
+
+	static interp::Operand lowerOperand(InterpState* is, FunctionLowering* fl, fir::Value* val)
+	{
+		interp::Operand ret;
+		ret.value = val;
+
+		if(auto it = fl->registers.find(val); it != fl->registers.end())
+		{
+			ret.kind = Operand::Kind::Register;
+			ret.index = static_cast<uint32_t>(it->second);
+		}
+		else if(auto blk = dcast(fir::IRBlock, val); blk)
+		{
+			auto it2 = fl->blocks.find(blk);
+			if(it2 == fl->blocks.end())
+				error("interp: branch to block %d not in function '%s'", blk->id, fl->func->func->getName().str());
+
+			ret.kind = Operand::Kind::Block;
+			ret.index = static_cast<uint32_t>(it2->second);
+		}
+		else if(dcast(fir::GlobalValue, val) && !dcast(fir::Function, val))
+		{
+			// these are resolved when we run, through InterpState::globals.
+			ret.kind = Operand::Kind::Global;
+		}
+		else if(auto cv = dcast(fir::ConstantValue, val); cv)
+		{
+			ret.kind = Operand::Kind::Constant;
+
+			if(auto it2 = fl->constants.find(val); it2 != fl->constants.end())
+			{
+				ret.index = static_cast<uint32_t>(it2->second);
+			}
+			else
+			{
+				auto c = is->makeConstant(cv);
+
+				ret.index = static_cast<uint32_t>(fl->func->constants.size());
+				fl->func->constants.push_back(c);
+				fl->constants[val] = ret.index;
+			}
+		}
+		else
+		{
+			// we don't know where this came from, so defer the lookup to runtime (which will most likely
+			// complain, but only if we actually get there).
+			ret.kind = Operand::Kind::Global;
+		}
+
+		return ret;
+	}
+
+	static interp::Instruction compileInstruction(InterpState* is, FunctionLowering* fl, fir::Instruction* finstr)
 	{
 		iceAssert(finstr);
 
@@ -24,19 +120,72 @@ namespace interp
 		for(auto a : finstr->operands)
 			ret.args.push_back(a);
 
+		ret.resultSlot = fl->registers[finstr->realOutput];
+
+		// phi nodes don't have any operands of their own; see compileBlock().
+		if(finstr->opKind != OpKind::Value_CreatePHI)
+		{
+			for(size_t i = 0; i < finstr->operands.size(); i++)
+			{
+				if(isTypeOnlyOperand(finstr->opKind, i))
+					ret.operands.push_back(interp::Operand());
+
+				else
+					ret.operands.push_back(lowerOperand(is, fl, finstr->operands[i]));
+			}
+		}
+
+		decodeInstruction(&ret);
 		return ret;
 	}
 
-	static interp::Block compileBlock(InterpState* is, fir::Function* parent, fir::IRBlock* fib)
+	static interp::Block compileBlock(InterpState* is, FunctionLowering* fl, fir::IRBlock* fib)
 	{
 		iceAssert(fib);
 
 		interp::Block ret;
 		ret.blk = fib;
-		ret.instructions = zfu::map(fib->getInstructions(), [is, parent](fir::Instruction* i) -> interp::Instruction {
-			return compileInstruction(is, parent, i);
+		ret.instructions = zfu::map(fib->getInstructions(), [is, fl](fir::Instruction* i) -> interp::Instruction {
+			return compileInstruction(is, fl, i);
 		});
 
+		std::vector<fir::PHINode*> phis;
+		for(auto inst : fib->getInstructions())
+		{
+			if(inst->opKind != OpKind::Value_CreatePHI)
+				break;
+
+			phis.push_back(dcast(fir::PHINode, inst->realOutput));
+		}
+
+		// flip the phis around, so we have a list of values for each incoming edge instead.
+		ret.numPhis = phis.size();
+		if(!phis.empty())
+		{
+			for(const auto& [ pred, _ ] : phis[0]->getValues())
+			{
+				std::vector<interp::Operand> ops;
+				for(auto phi : phis)
+				{
+					auto vals = phi->getValues();
+					auto it = vals.find(pred);
+
+					if(it == vals.end())
+						error("interp: predecessor was not listed in the PHI node (id %d)!", phi->id);
+
+					if(it->second->getType() != phi->getType())
+					{
+						error("interp: cannot set value, conflicting types '%s' and '%s'", phi->getType(),
+							it->second->getType());
+					}
+
+					ops.push_back(lowerOperand(is, fl, it->second));
+				}
+
+				ret.phiIncoming.push_back({ lowerOperand(is, fl, pred).index, ops });
+			}
+		}
+
 		return ret;
 	}
 
@@ -44,23 +193,44 @@ namespace interp
 	{
 		iceAssert(fn);
 
-		interp::Function ret;
+		// add it first -- lowering the body might refer to this function (eg. taking its address), and
+		// that needs to find it instead of compiling it again.
+		auto& ret = this->compiledFunctions[fn];
+		ret = interp::Function();
 		ret.func = fn;
-
-		ret.blocks = zfu::map(fn->getBlockList(), [fn, this](fir::IRBlock* b) -> interp::Block {
-			return compileBlock(this, fn, b);
+		ret.generation = this->generation;
+		ret.modificationCount = fn->getModificationCount();
+
+		FunctionLowering fl;
+		fl.func = &ret;
+
+		// number the registers: first the arguments, then the results of every instruction. we don't bother
+		// skipping void results, since calls still expect somewhere to put them.
+		size_t numSlots = 0;
+		for(auto a : fn->getArguments())
+			fl.registers[a] = numSlots++;
+
+		for(size_t i = 0; i < fn->getBlockList().size(); i++)
+		{
+			auto b = fn->getBlockList()[i];
+			fl.blocks[b] = i;
+
+			for(auto inst : b->getInstructions())
+				fl.registers[inst->realOutput] = numSlots++;
+		}
+
+		ret.numSlots = numSlots;
+		ret.blocks = zfu::map(fn->getBlockList(), [&fl, this](fir::IRBlock* b) -> interp::Block {
+			return compileBlock(this, &fl, b);
 		});
 
 		if(fn->isCStyleVarArg())
 			iceAssert(ret.blocks.empty());
 
 		if(ret.blocks.empty())
-			ret.isExternal = true, ret.extFuncName = fn->getName().name;
+			ret.isExternal = true, ret.extFuncName = fn->getName().getName();
 
-
-		// add it.
-		this->compiledFunctions[ret.func] = ret;
-		return this->compiledFunctions[ret.func];
+		return ret;
 	}
 }
 }
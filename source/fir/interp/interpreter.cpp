@@ -13,6 +13,8 @@
 #include "gluecode.h"
 #include "platform.h"
 
+#include <unordered_set>
+
 #define FFI_BUILDING
 #include <ffi.h>
 
@@ -62,8 +64,91 @@ namespace interp
 	//* whole interpreter anyway.
 
 
+	constexpr size_t ARENA_CHUNK_SIZE = 64 * 1024;
+	constexpr size_t ARENA_ALIGNMENT = 16;
+
+	ValueArena::~ValueArena()
+	{
+		for(auto& [ mem, sz ] : this->chunks)
+			delete[] mem;
+	}
+
+	void* ValueArena::allocate(size_t sz)
+	{
+		sz = (sz + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+		// find the first chunk (from the current one) that can fit us.
+		while(this->currentChunk < this->chunks.size())
+		{
+			auto& [ mem, cap ] = this->chunks[this->currentChunk];
+			if(this->currentOffset + sz <= cap)
+			{
+				auto ret = mem + this->currentOffset;
+				this->currentOffset += sz;
+				this->used += sz;
+
+				return ret;
+			}
+
+			this->currentChunk += 1;
+			this->currentOffset = 0;
+		}
+
+		auto cap = std::max(ARENA_CHUNK_SIZE, sz);
+		this->chunks.push_back({ new uint8_t[cap], cap });
+
+		this->currentChunk = this->chunks.size() - 1;
+		this->currentOffset = sz;
+		this->used += sz;
+
+		return this->chunks.back().first;
+	}
+
+	ValueArena::Mark ValueArena::mark() const
+	{
+		Mark ret;
+		ret.chunk = this->currentChunk;
+		ret.offset = this->currentOffset;
+		ret.used = this->used;
+
+		return ret;
+	}
+
+	void ValueArena::release(const Mark& m)
+	{
+		this->currentChunk = m.chunk;
+		this->currentOffset = m.offset;
+		this->used = m.used;
+	}
+
+
+	// the payloads of large values come from here. while a function is running they come from the value arena,
+	// and go away when its frame is popped; outside of that they belong to the InterpState until finalise().
+	// if 'is' is null, the memory is never freed -- that's only for constants, which get cached forever.
+	static void* allocateValueData(InterpState* is, size_t sz)
+	{
+		if(!is)
+			return malloc(sz);
+
+		void* ret = 0;
+		if(!is->stackFrames.empty())
+		{
+			ret = is->valueArena.allocate(sz);
+		}
+		else
+		{
+			ret = malloc(sz);
+			is->valueAllocs.push_back(ret);
+			is->valueAllocBytes += sz;
+		}
+
+		is->stats.peakHeapUsage = std::max(is->stats.peakHeapUsage, is->valueArena.used + is->valueAllocBytes);
+		return ret;
+	}
+
+
 	template <typename T>
-	static interp::Value makeValue(fir::Value* fv, const T& val)
+	static interp::Value makeValue(InterpState* is, fir::Value* fv, const T& val)
 	{
 		interp::Value ret;
 		ret.val = fv;
@@ -77,7 +162,7 @@ namespace interp
 
 		if(sizeof(T) > LARGE_DATA_SIZE)
 		{
-			ret.ptr = malloc(sizeof(T));
+			ret.ptr = allocateValueData(is, sizeof(T));
 			memmove(ret.ptr, &val, sizeof(T));
 		}
 		else
@@ -90,7 +175,7 @@ namespace interp
 
 
 	// this lets us specify the type, instead of using the one in the Value
-	static interp::Value makeValueOfType(fir::Value* fv, fir::Type* ty)
+	static interp::Value makeValueOfType(InterpState* is, fir::Value* fv, fir::Type* ty)
 	{
 		interp::Value ret;
 		ret.val = fv;
@@ -100,7 +185,10 @@ namespace interp
 		memset(&ret.data[0], 0, LARGE_DATA_SIZE);
 
 		if(ret.dataSize > LARGE_DATA_SIZE)
-			ret.ptr = calloc(1, ret.dataSize);
+		{
+			ret.ptr = allocateValueData(is, ret.dataSize);
+			memset(ret.ptr, 0, ret.dataSize);
+		}
 
 		return ret;
 	}
@@ -108,7 +196,7 @@ namespace interp
 
 	interp::Value InterpState::makeValue(fir::Value* fv)
 	{
-		return makeValueOfType(fv, fv->getType());
+		return makeValueOfType(this, fv, fv->getType());
 	}
 
 
@@ -126,29 +214,35 @@ namespace interp
 	}
 
 
-	static interp::Value cloneValue(const interp::Value& v)
+	// note: the source may overlap the new memory (see the return handling in runBlock), so this must not
+	// clear the allocation before copying.
+	static interp::Value cloneValue(InterpState* is, const interp::Value& v)
 	{
 		interp::Value ret = v;
 
 		if(v.dataSize > LARGE_DATA_SIZE)
 		{
-			ret.ptr = calloc(1, v.dataSize);
+			ret.ptr = allocateValueData(is, v.dataSize);
 			memmove(ret.ptr, v.ptr, v.dataSize);
 		}
 		return ret;
 	}
 
-	static interp::Value cloneValue(fir::Value* fv, const interp::Value& v)
+	static interp::Value cloneValue(InterpState* is, fir::Value* fv, const interp::Value& v)
 	{
-		interp::Value ret = v;
+		auto ret = cloneValue(is, v);
+		ret.val = fv;
+
+		return ret;
+	}
+
+	// once a value is made, nothing writes to its payload (instructions that "modify" a value clone it first),
+	// so when the source is a temporary we can just take it over instead of making a copy.
+	static interp::Value moveValue(fir::Value* fv, interp::Value&& v)
+	{
+		interp::Value ret = std::move(v);
 		ret.val = fv;
-		ret.globalValTracker = v.globalValTracker;
 
-		if(v.dataSize > LARGE_DATA_SIZE)
-		{
-			ret.ptr = calloc(1, v.dataSize);
-			memmove(ret.ptr, v.ptr, v.dataSize);
-		}
 		return ret;
 	}
 
@@ -160,7 +254,7 @@ namespace interp
 		if(sz > LARGE_DATA_SIZE)
 		{
 			if(!target->ptr)
-				target->ptr = calloc(1, sz);
+				target->ptr = allocateValueData(is, sz);
 
 			memmove(target->ptr, value, sz);
 		}
@@ -170,18 +264,6 @@ namespace interp
 		}
 	}
 
-	static void setValue(InterpState* is, interp::Value* target, const interp::Value& val)
-	{
-		if(target->type != val.type)
-			error("interp: cannot set value, conflicting types '%s' and '%s'", target->type, val.type);
-
-		if(val.dataSize > LARGE_DATA_SIZE)
-			memmove(target->ptr, val.ptr, val.dataSize);
-
-		else
-			memmove(&target->data[0], &val.data[0], val.dataSize);
-	}
-
 	static char* makeGlobalString(InterpState* is, const std::string& str)
 	{
 		auto s = new char[str.size() + 1];
@@ -193,7 +275,7 @@ namespace interp
 		return s;
 	}
 
-	static interp::Value loadFromPtr(const interp::Value& x, fir::Type* ty)
+	static interp::Value loadFromPtr(InterpState* is, const interp::Value& x, fir::Type* ty)
 	{
 		auto ptr = reinterpret_cast<void*>(getActualValue<uintptr_t>(x));
 
@@ -204,7 +286,7 @@ namespace interp
 		if(ret.dataSize > LARGE_DATA_SIZE)
 		{
 			// clone the memory and store it.
-			auto newmem = malloc(ret.dataSize);
+			auto newmem = allocateValueData(is, ret.dataSize);
 			memmove(newmem, ptr, ret.dataSize);
 			ret.ptr = newmem;
 		}
@@ -221,6 +303,10 @@ namespace interp
 	static std::map<ConstantValue*, interp::Value> cachedConstants;
 	static interp::Value makeConstant(InterpState* is, ConstantValue* c)
 	{
+		// constants are cached (see above) past the lifetime of any single function (or InterpState, for that
+		// matter), so their payloads must not come from the value arena.
+		InterpState* const noArena = 0;
+
 		auto constructStructThingy2 = [](fir::Value* val, size_t datasize, const std::vector<interp::Value>& inserts) -> interp::Value {
 
 			uint8_t* buffer = 0;
@@ -230,7 +316,7 @@ namespace interp
 			ret.type = val->getType();
 			ret.val = val;
 
-			if(datasize > LARGE_DATA_SIZE)  { buffer = new uint8_t[datasize]; ret.ptr = buffer; }
+			if(datasize > LARGE_DATA_SIZE)  { buffer = static_cast<uint8_t*>(allocateValueData(0, datasize)); ret.ptr = buffer; }
 			else                            { buffer = &ret.data[0]; }
 
 			iceAssert(buffer);
@@ -264,25 +350,25 @@ namespace interp
 		{
 			interp::Value ret;
 
-			if(ci->getType() == fir::Type::getInt8())        ret = makeValue(c, static_cast<int8_t>(ci->getSignedValue()));
-			else if(ci->getType() == fir::Type::getInt16())  ret = makeValue(c, static_cast<int16_t>(ci->getSignedValue()));
-			else if(ci->getType() == fir::Type::getInt32())  ret = makeValue(c, static_cast<int32_t>(ci->getSignedValue()));
-			else if(ci->getType() == fir::Type::getInt64())  ret = makeValue(c, static_cast<int64_t>(ci->getSignedValue()));
-			else if(ci->getType() == fir::Type::getUint8())  ret = makeValue(c, static_cast<uint8_t>(ci->getUnsignedValue()));
-			else if(ci->getType() == fir::Type::getUint16()) ret = makeValue(c, static_cast<uint16_t>(ci->getUnsignedValue()));
-			else if(ci->getType() == fir::Type::getUint32()) ret = makeValue(c, static_cast<uint32_t>(ci->getUnsignedValue()));
-			else if(ci->getType() == fir::Type::getUint64()) ret = makeValue(c, static_cast<uint64_t>(ci->getUnsignedValue()));
+			if(ci->getType() == fir::Type::getInt8())        ret = makeValue(noArena, c, static_cast<int8_t>(ci->getSignedValue()));
+			else if(ci->getType() == fir::Type::getInt16())  ret = makeValue(noArena, c, static_cast<int16_t>(ci->getSignedValue()));
+			else if(ci->getType() == fir::Type::getInt32())  ret = makeValue(noArena, c, static_cast<int32_t>(ci->getSignedValue()));
+			else if(ci->getType() == fir::Type::getInt64())  ret = makeValue(noArena, c, static_cast<int64_t>(ci->getSignedValue()));
+			else if(ci->getType() == fir::Type::getUint8())  ret = makeValue(noArena, c, static_cast<uint8_t>(ci->getUnsignedValue()));
+			else if(ci->getType() == fir::Type::getUint16()) ret = makeValue(noArena, c, static_cast<uint16_t>(ci->getUnsignedValue()));
+			else if(ci->getType() == fir::Type::getUint32()) ret = makeValue(noArena, c, static_cast<uint32_t>(ci->getUnsignedValue()));
+			else if(ci->getType() == fir::Type::getUint64()) ret = makeValue(noArena, c, static_cast<uint64_t>(ci->getUnsignedValue()));
 			else error("interp: unsupported type '%s' for integer constant", ci->getType());
 
 			return (cachedConstants[c] = ret);
 		}
 		else if(auto cf = dcast(fir::ConstantFP, c))
 		{
-			return cachedConstants[c] = makeValue(c, cf->getValue());
+			return cachedConstants[c] = makeValue(noArena, c, cf->getValue());
 		}
 		else if(auto cb = dcast(fir::ConstantBool, c))
 		{
-			return cachedConstants[c] = makeValue(c, cb->getValue());
+			return cachedConstants[c] = makeValue(noArena, c, cb->getValue());
 		}
 		else if(auto cs = dcast(fir::ConstantCharSlice, c))
 		{
@@ -299,7 +385,7 @@ namespace interp
 		else if(auto cbc = dcast(fir::ConstantBitcast, c))
 		{
 			auto thing = makeConstant(is, cbc->getValue());
-			auto ret = cloneValue(cbc, thing);
+			auto ret = cloneValue(noArena, cbc, thing);
 
 			return (cachedConstants[c] = ret);
 		}
@@ -409,9 +495,10 @@ namespace interp
 			// normally. if not, then we will use libffi to call it.
 
 			// make sure we compile it first, so it gets added to InterpState::compiledFunctions
-			is->compileFunction(fn);
+			if(is->compiledFunctions.find(fn) == is->compiledFunctions.end())
+				is->compileFunction(fn);
 
-			auto ret = makeValue(fn, reinterpret_cast<uintptr_t>(fn));
+			auto ret = makeValue(noArena, fn, reinterpret_cast<uintptr_t>(fn));
 			return (cachedConstants[c] = ret);
 		}
 		else if(auto glob = dcast(fir::GlobalValue, c))
@@ -426,26 +513,94 @@ namespace interp
 		{
 			iceAssert(c);
 
-			auto ret = is->makeValue(c);
+			auto ret = makeValueOfType(noArena, c, c->getType());
 			return (cachedConstants[c] = ret);
 		}
 	}
 
 
 
+	interp::Value InterpState::makeConstant(fir::ConstantValue* c)
+	{
+		return interp::makeConstant(this, c);
+	}
+
+
 	InterpState::InterpState(Module* mod) : module(mod)
 	{
 	}
 
 	InterpState::~InterpState()
 	{
+		for(void* p : this->valueAllocs)
+			free(p);
+
+		for(auto& [ fnty, infos ] : this->ffiCallInfos)
+		{
+			for(auto info : infos)
+				delete info;
+		}
+	}
+
+	// codegen can keep adding to a function after we've compiled it (eg. a #run in the middle of it), or throw away
+	// its blocks and make new ones (eg. the global init function), so check that it hasn't changed since.
+	static bool isCompiledFunctionStale(const interp::Function& cf)
+	{
+		return cf.func->getModificationCount() != cf.modificationCount;
+	}
+
+	// what we compiled for fn (if anything). checking every compiled function for staleness in initialise() gets
+	// slow once there are a lot of them (eg. a long repl session), so each one only gets checked the first time it's
+	// used after an initialise(), and recompiled if it changed.
+	static interp::Function* getCompiledFunction(InterpState* is, fir::Value* fn)
+	{
+		auto it = is->compiledFunctions.find(fn);
+		if(it == is->compiledFunctions.end())
+			return 0;
+
+		auto& cf = it->second;
+		if(cf.generation != is->generation)
+		{
+			if(isCompiledFunctionStale(cf))
+			{
+				// intrinsics are mapped to the function that implements them, so compile that and map it again.
+				auto impl = cf.func;
+				auto& ret = is->compileFunction(impl);
+
+				return (impl == fn ? &ret : &(is->compiledFunctions[fn] = ret));
+			}
+
+			cf.generation = is->generation;
+		}
+
+		return &cf;
+	}
+
+	static void writeInitialValue(InterpState* is, void* buffer, fir::GlobalVariable* glob)
+	{
+		if(auto init = glob->getInitialValue(); init)
+		{
+			auto x = is->makeConstant(init);
+			if(x.dataSize > LARGE_DATA_SIZE)    memmove(buffer, x.ptr, x.dataSize);
+			else                                memmove(buffer, &x.data[0], x.dataSize);
+		}
 	}
 
+	// this can be called more than once on the same state (eg. for every #run while generating a module); things that
+	// were already set up the last time are kept, and only the new (or changed) stuff is done.
 	void InterpState::initialise(bool runGlobalInit)
 	{
 		iceAssert(this->module);
-		for(const auto& [ str, glob ] : this->module->_getGlobalStrings())
+
+		// functions compiled before now might have changed; see getCompiledFunction().
+		this->generation += 1;
+
+		// globals only ever get added to the module, so we only need to look at the ones after where we got to.
+		auto& strs = this->module->_getGlobalStringsInOrder();
+		for(; this->numGlobalStringsSeen < strs.size(); this->numGlobalStringsSeen++)
 		{
+			const auto& [ str, glob ] = strs[this->numGlobalStringsSeen];
+
 			auto val = makeValue(glob);
 			auto s = makeGlobalString(this, str);
 
@@ -455,8 +610,24 @@ namespace interp
 			this->globals[glob] = { val, false };
 		}
 
-		for(const auto& [ id, glob ] : this->module->_getGlobals())
+		// codegen can also give a global we already set up a (new) initial value, eg. when its initialiser was a #run.
+		// the ones we haven't set up yet get it below anyway.
+		for(auto glob : this->module->_getChangedInitialValues())
+		{
+			if(auto it = this->globals.find(glob); it != this->globals.end())
+			{
+				auto buffer = getActualValue<void*>(it->second.first);
+				writeInitialValue(this, buffer, glob);
+			}
+		}
+
+		this->module->_clearChangedInitialValues();
+
+		auto& globs = this->module->_getGlobalsInOrder();
+		for(; this->numGlobalsSeen < globs.size(); this->numGlobalsSeen++)
 		{
+			auto glob = globs[this->numGlobalsSeen];
+
 			auto ty = glob->getType();
 			auto sz = getSizeOfType(ty);
 
@@ -464,15 +635,9 @@ namespace interp
 			memset(buffer, 0, sz);
 
 			this->globalAllocs.push_back(buffer);
+			writeInitialValue(this, buffer, glob);
 
-			if(auto init = glob->getInitialValue(); init)
-			{
-				auto x = makeConstant(this, init);
-				if(x.dataSize > LARGE_DATA_SIZE)    memmove(buffer, x.ptr, x.dataSize);
-				else                                memmove(buffer, &x.data[0], x.dataSize);
-			}
-
-			auto ret = makeValueOfType(glob, ty->getPointerTo());
+			auto ret = makeValueOfType(this, glob, ty->getPointerTo());
 			setValueRaw(this, &ret, &buffer, sizeof(void*));
 
 			ret.globalValTracker = glob;
@@ -481,6 +646,9 @@ namespace interp
 
 		for(const auto& [ id, intr ] : this->module->_getIntrinsicFunctions())
 		{
+			if(this->compiledFunctions.find(intr) != this->compiledFunctions.end())
+				continue;
+
 			auto fname = Name::of(zpr::sprint("__interp_intrinsic_%s", id.str()));
 			auto fn = this->module->getOrCreateFunction(fname, intr->getType(), fir::LinkageType::ExternalWeak);
 
@@ -506,7 +674,7 @@ namespace interp
 			for(const auto& name : names)
 			{
 				auto fn = this->module->getFunction(Name::of(name));
-				if(fn)
+				if(fn && this->compiledFunctions.find(fn) == this->compiledFunctions.end())
 				{
 					auto wrapper = this->module->getOrCreateFunction(Name::of(zpr::sprint("__interp_wrapper_%s", name)),
 						fn->getType()->toFunctionType(), fir::LinkageType::ExternalWeak);
@@ -529,6 +697,31 @@ namespace interp
 	}
 
 
+	// whether unwrapInterpValueIntoConstant() knows what to do with it (it warns, and gives zero, if not); keep the two in sync.
+	static bool canUnwrapIntoConstant(fir::Type* ty)
+	{
+		if(ty->isBoolType() || ty == fir::Type::getFloat32() || ty == fir::Type::getFloat64())
+			return true;
+
+		else if(ty->isIntegerType())
+			return ty->getBitWidth() <= 64;
+
+		else if(ty->isCharSliceType() || ty->isStringType())
+			return true;
+
+		else if(ty->isTupleType())
+			return zfu::matchAll(ty->toTupleType()->getElements(), [](fir::Type* t) -> bool { return canUnwrapIntoConstant(t); });
+
+		else if(ty->isStructType())
+			return zfu::matchAll(ty->toStructType()->getElements(), [](fir::Type* t) -> bool { return canUnwrapIntoConstant(t); });
+
+		else if(ty->isArrayType())
+			return canUnwrapIntoConstant(ty->getArrayElementType());
+
+		// the data pointer of these can't be unwrapped.
+		return false;
+	}
+
 	// the purpose of this function is to write-back any changes we made to globals while interpreting,
 	// back to the "value" of the global -- mainly for compile-time execution, so modifications will
 	// propagate to the backend code generation.
@@ -544,13 +737,14 @@ namespace interp
 			{
 				// printf("found: %s\n", id.str().c_str());
 
-				// only write-back if we modified the global.
-				if(it->second.second)
+				// only write-back if we modified the global, and we can. (classes, say, are set up by the global init
+				// function when the program starts, so their initial value doesn't matter anyway.)
+				if(it->second.second && canUnwrapIntoConstant(glob->getType()))
 				{
-					auto val = loadFromPtr(it->second.first, it->first->getType());
+					auto val = loadFromPtr(this, it->second.first, it->first->getType());
 					auto x = this->unwrapInterpValueIntoConstant(val);
 
-					// printf("write-back: %s = %s\n", id.name.c_str(), x->str().c_str());
+					// printf("write-back: %s = %s\n", id.getName().c_str(), x->str().c_str());
 					glob->setInitialValue(x);
 
 					it->second.second = false;
@@ -561,7 +755,23 @@ namespace interp
 		for(void* p : this->globalAllocs)
 			delete[] p;
 
+		this->globals.clear();
 		this->globalAllocs.clear();
+
+		// everything gets set up again from scratch next time, with the initial values as they are now.
+		this->numGlobalsSeen = 0;
+		this->numGlobalStringsSeen = 0;
+		this->module->_clearChangedInitialValues();
+
+		for(void* p : this->valueAllocs)
+			free(p);
+
+		this->valueAllocs.clear();
+		this->valueAllocBytes = 0;
+
+		// the constant pools of compiled functions can point into globalAllocs, so they must go too.
+		// (they'll get recompiled on demand if we're initialised again)
+		this->compiledFunctions.clear();
 	}
 
 
@@ -608,89 +818,10 @@ namespace interp
 
 
 
-	static size_t getOffsetOfTypeInTypeList(const std::vector<fir::Type*>& elms, size_t idx)
-	{
-		size_t ofs = 0;
-		for(uint64_t i = 0; i < idx; i++)
-		{
-			auto aln = getAlignmentOfType(elms[i]);
-			if(ofs % aln > 0)
-				ofs += (aln - (ofs % aln));
-
-			ofs += getSizeOfType(elms[i]);
-		}
-
-		return ofs;
-	}
-
-	static std::vector<fir::Type*> getTypeListOfType(fir::Type* ty)
-	{
-		if(ty->isStructType())
-		{
-			return ty->toStructType()->getElements();
-		}
-		else if(ty->isClassType())
-		{
-			auto ret = ty->toClassType()->getAllElementsIncludingBase();
-			if(ty->toClassType()->getVirtualMethodCount() > 0)
-				ret.insert(ret.begin(), fir::Type::getInt8Ptr());
-
-			return ret;
-		}
-		else if(ty->isTupleType())
-		{
-			return ty->toTupleType()->getElements();
-		}
-		else if(ty->isArraySliceType())
-		{
-			if(ty->toArraySliceType()->isMutable())
-				return { ty->getArrayElementType()->getMutablePointerTo(), fir::Type::getNativeWord() };
-
-			else
-				return { ty->getArrayElementType()->getPointerTo(), fir::Type::getNativeWord() };
-		}
-		else if(ty->isAnyType())
-		{
-			return {
-				fir::Type::getNativeUWord(), fir::Type::getNativeWordPtr(),
-				fir::ArrayType::get(fir::Type::getInt8(), BUILTIN_ANY_DATA_BYTECOUNT)
-			};
-		}
-		else if(ty->isRangeType())
-		{
-			return {
-				fir::Type::getNativeWord(), fir::Type::getNativeWord(), fir::Type::getNativeWord()
-			};
-		}
-		else if(ty->isEnumType())
-		{
-			return {
-				fir::Type::getNativeWord(), ty->toEnumType()->getCaseType()
-			};
-		}
-		else if(ty->isStringType() || ty->isDynamicArrayType())
-		{
-			std::vector<fir::Type*> mems(4);
-
-			if(ty->isDynamicArrayType())    mems[SAA_DATA_INDEX] = ty->getArrayElementType()->getMutablePointerTo();
-			else                            mems[SAA_DATA_INDEX] = fir::Type::getMutInt8Ptr();
-
-			mems[SAA_LENGTH_INDEX]      = fir::Type::getNativeWord();
-			mems[SAA_CAPACITY_INDEX]    = fir::Type::getNativeWord();
-			mems[SAA_REFCOUNTPTR_INDEX] = fir::Type::getNativeWordPtr();
-
-			return mems;
-		}
-		else
-		{
-			error("interp: unsupported type '%s' for insert/extractvalue", ty);
-		}
-	}
-
 	static interp::Value doInsertValue(interp::InterpState* is, fir::Value* res, const interp::Value& str, const interp::Value& elm, size_t idx)
 	{
 		// we clone the value first
-		auto ret = cloneValue(res, str);
+		auto ret = cloneValue(is, res, str);
 
 		size_t ofs = 0;
 
@@ -709,10 +840,12 @@ namespace interp
 		}
 		else
 		{
-			auto typelist = getTypeListOfType(str.type);
-			iceAssert(idx < typelist.size());
+			auto& layout = getTypeLayout(str.type);
+			if(layout.fieldOffsets.empty())
+				error("interp: unsupported type '%s' for insert/extractvalue", str.type);
 
-			ofs = getOffsetOfTypeInTypeList(typelist, idx);
+			iceAssert(idx < layout.fieldOffsets.size());
+			ofs = layout.fieldOffsets[idx];
 		}
 
 		uintptr_t dst = 0;
@@ -751,11 +884,13 @@ namespace interp
 		}
 		else
 		{
-			auto typelist = getTypeListOfType(str.type);
-			iceAssert(idx < typelist.size());
+			auto& layout = getTypeLayout(str.type);
+			if(layout.fieldOffsets.empty())
+				error("interp: unsupported type '%s' for insert/extractvalue", str.type);
 
-			ofs = getOffsetOfTypeInTypeList(typelist, idx);
-			elm = typelist[idx];
+			iceAssert(idx < layout.fieldOffsets.size());
+			ofs = layout.fieldOffsets[idx];
+			elm = layout.fieldTypes[idx];
 		}
 
 		auto ret = is->makeValue(res);
@@ -993,310 +1128,302 @@ namespace interp
 	}
 
 
-	static interp::Value runFunctionWithLibFFI(InterpState* is, void* fnptr, fir::FunctionType* fnty, const std::vector<interp::Value>& args,
-		const std::string& nameIfAvailable = "")
+	// a prepared call interface for one function type. for c-style variadic functions, the cif also depends on the
+	// types of the variadic arguments, so there can be a few of these for one function type -- 'argTypes' has the
+	// types of all the arguments, so we can tell them apart.
+	struct FFICallInfo
 	{
-		complainAboutFFIEscape(fnptr, fnty, nameIfAvailable);
+		ffi_cif cif;
+		ffi_type* retType = 0;
 
-		// we are assuming the values in 'args' are correct!
-		ffi_type** arg_types = new ffi_type*[args.size()];
-		{
-			std::vector<ffi_type*> tmp;
-			for(size_t i = 0; i < args.size(); i++)
-			{
-				tmp.push_back(convertTypeToLibFFI(args[i].type));
-				arg_types[i] = tmp[i];
-			}
-		}
+		std::vector<fir::Type*> argTypes;
+		std::vector<ffi_type*> ffiArgTypes;
+	};
 
-		ffi_type* ffi_retty = 0;
-		ffi_cif fn_cif;
+	static FFICallInfo* getFFICallInfo(InterpState* is, fir::FunctionType* fnty, const std::vector<interp::Value>& args)
+	{
+		auto& infos = is->ffiCallInfos[fnty];
+		for(auto info : infos)
 		{
-			ffi_retty = convertTypeToLibFFI(fnty->getReturnType());
+			if(info->argTypes.size() != args.size())
+				continue;
 
-			if(args.size() > fnty->getArgumentCount())
-			{
-				iceAssert(fnty->isCStyleVarArg());
-				auto st = ffi_prep_cif_var(&fn_cif, FFI_DEFAULT_ABI, fnty->getArgumentCount(), args.size(), ffi_retty, arg_types);
-				if(st != FFI_OK)
-					error("interp: ffi_prep_cif_var failed! (%d)", st);
-			}
-			else
-			{
-				auto st = ffi_prep_cif(&fn_cif, FFI_DEFAULT_ABI, args.size(), ffi_retty, arg_types);
-				if(st != FFI_OK)
-					error("interp: ffi_prep_cif failed! (%d)", st);
-			}
+			bool match = true;
+			for(size_t i = 0; i < args.size() && match; i++)
+				match = (info->argTypes[i] == args[i].type);
+
+			if(match)
+				return info;
 		}
 
-		void** arg_pointers = new void*[args.size()];
+		// we are assuming the values in 'args' are correct!
+		auto info = new FFICallInfo();
+		for(const auto& a : args)
 		{
-			void** arg_values = new void*[args.size()];
-
-			// because this thing is dumb
-			for(size_t i = 0; i < args.size(); i++)
-			{
-				if(args[i].dataSize <= LARGE_DATA_SIZE)
-					arg_values[i] = reinterpret_cast<void*>(const_cast<uint8_t*>(&args[i].data[0]));
-			}
-
-			for(size_t i = 0; i < args.size(); i++)
-			{
-				if(args[i].dataSize <= LARGE_DATA_SIZE)
-					arg_pointers[i] = reinterpret_cast<void*>(arg_values[i]);
-
-				else
-					arg_pointers[i] = reinterpret_cast<void*>(args[i].ptr);
-			}
-
-			delete[] arg_values;
+			info->argTypes.push_back(a.type);
+			info->ffiArgTypes.push_back(convertTypeToLibFFI(a.type));
 		}
 
-		void* ret_buffer = new uint8_t[std::max(ffi_retty->size, size_t(8))];
-		ffi_call(&fn_cif, reinterpret_cast<void(*)()>(fnptr), ret_buffer, arg_pointers);
-
-		interp::Value ret = { 0 };
-		ret.type = fnty->getReturnType();
-		ret.dataSize = ffi_retty->size;
+		info->retType = convertTypeToLibFFI(fnty->getReturnType());
 
-		setValueRaw(is, &ret, ret_buffer, ret.dataSize);
-		delete[] ret_buffer;
+		if(args.size() > fnty->getArgumentCount())
+		{
+			iceAssert(fnty->isCStyleVarArg());
+			auto st = ffi_prep_cif_var(&info->cif, FFI_DEFAULT_ABI, fnty->getArgumentCount(), args.size(), info->retType,
+				info->ffiArgTypes.data());
 
-		delete[] arg_types;
-		delete[] arg_pointers;
+			if(st != FFI_OK)
+				error("interp: ffi_prep_cif_var failed! (%d)", st);
+		}
+		else
+		{
+			auto st = ffi_prep_cif(&info->cif, FFI_DEFAULT_ABI, args.size(), info->retType, info->ffiArgTypes.data());
+			if(st != FFI_OK)
+				error("interp: ffi_prep_cif failed! (%d)", st);
+		}
 
-		return ret;
+		infos.push_back(info);
+		return info;
 	}
 
-	static interp::Value runFunctionWithLibFFI(InterpState* is, fir::Function* fn, const std::vector<interp::Value>& args)
+	static void* getExternalSymbol(InterpState* is, fir::Function* fn)
 	{
+		if(auto it = is->externalSymbols.find(fn); it != is->externalSymbols.end())
+			return it->second;
+
 		void* fnptr = platform::compiler::getSymbol(fn->getName().str());
 		if(!fnptr) error("interp: failed to find symbol named '%s'\n", fn->getName().str());
 
-		return runFunctionWithLibFFI(is, fnptr, fn->getType(), args, /* name: */ fn->getName().str());
+		return (is->externalSymbols[fn] = fnptr);
 	}
 
-	static interp::Value runFunctionWithLibFFI(InterpState* is, const interp::Function& fn, const std::vector<interp::Value>& args)
-	{
-		void* fnptr = platform::compiler::getSymbol(fn.func->getName().str());
-		if(!fnptr) error("interp: failed to find symbol named '%s'\n", fn.func->getName().str());
 
-		return runFunctionWithLibFFI(is, fnptr, fn.func->getType(), args, /* name: */ fn.extFuncName);
-	}
+	static interp::Value callWithLibFFI(InterpState* is, void* fnptr, fir::FunctionType* fnty, const std::vector<interp::Value>& args)
+	{
+		auto info = getFFICallInfo(is, fnty, args);
 
+		// most calls don't have that many arguments, so avoid going to the heap for them.
+		constexpr size_t MAX_STACK_ARGS = 16;
 
-	static const interp::Block* prepareFunctionToRun(InterpState* is, const interp::Function& fn, const std::vector<interp::Value>& args)
-	{
-		iceAssert(args.size() == fn.func->getArgumentCount());
+		void* stackArgPointers[MAX_STACK_ARGS];
+		std::vector<void*> heapArgPointers;
 
-		// when we start a function, clear the "stack frame".
-		is->stackFrames.push_back({ });
+		void** arg_pointers = stackArgPointers;
+		if(args.size() > MAX_STACK_ARGS)
+		{
+			heapArgPointers.resize(args.size());
+			arg_pointers = heapArgPointers.data();
+		}
 
 		for(size_t i = 0; i < args.size(); i++)
 		{
-			auto farg = fn.func->getArguments()[i];
-			is->stackFrames.back().values[farg] = cloneValue(farg, args[i]);
+			if(args[i].dataSize <= LARGE_DATA_SIZE)
+				arg_pointers[i] = reinterpret_cast<void*>(const_cast<uint8_t*>(&args[i].data[0]));
+
+			else
+				arg_pointers[i] = reinterpret_cast<void*>(args[i].ptr);
 		}
 
-		iceAssert(!fn.blocks.empty());
+		// we only pass scalars through libffi (see convertTypeToLibFFI), so this is always big enough.
+		uint64_t ret_buffer[2] = { 0, 0 };
+		iceAssert(info->retType->size <= sizeof(ret_buffer));
 
-		auto entry = &fn.blocks[0];
-		is->stackFrames.back().currentFunction = &fn;
-		is->stackFrames.back().currentBlock = entry;
-		is->stackFrames.back().previousBlock = 0;
+		ffi_call(&info->cif, reinterpret_cast<void(*)()>(fnptr), &ret_buffer[0], arg_pointers);
 
-		return entry;
+		interp::Value ret = { 0 };
+		ret.type = fnty->getReturnType();
+		ret.dataSize = info->retType->size;
+
+		setValueRaw(is, &ret, &ret_buffer[0], ret.dataSize);
+		return ret;
 	}
 
-	static void leaveFunction(InterpState* is)
+	static interp::Value runFunctionWithLibFFI(InterpState* is, void* fnptr, fir::FunctionType* fnty, const std::vector<interp::Value>& args,
+		const std::string& nameIfAvailable = "")
 	{
-		auto frame = is->stackFrames.back();
+		complainAboutFFIEscape(fnptr, fnty, nameIfAvailable);
+		return callWithLibFFI(is, fnptr, fnty, args);
+	}
 
-		for(void* alloca : frame.stackAllocs)
-			delete[] alloca;
+	static interp::Value runFunctionWithLibFFI(InterpState* is, fir::Function* fn, const std::vector<interp::Value>& args)
+	{
+		void* fnptr = getExternalSymbol(is, fn);
+		return runFunctionWithLibFFI(is, fnptr, fn->getType(), args, /* name: */ fn->getName().str());
+	}
 
-		is->stackFrames.pop_back();
+	static interp::Value runFunctionWithLibFFI(InterpState* is, const interp::Function& fn, const std::vector<interp::Value>& args)
+	{
+		void* fnptr = getExternalSymbol(is, fn.func);
+		return runFunctionWithLibFFI(is, fnptr, fn.func->getType(), args, /* name: */ fn.extFuncName);
 	}
 
 
 
-	constexpr int FLOW_NORMAL = 0;
-	constexpr int FLOW_RETURN = 1;
-	constexpr int FLOW_BRANCH = 2;
-	constexpr int FLOW_FNCALL = 3;
-	constexpr int FLOW_DYCALL = 4;
 
 
-	struct InstrResult
+	// whether we can pass values of this type to and from native code (see convertTypeToLibFFI). function pointers
+	// are out, since ours are really fir::Function*s.
+	static bool isPromotableType(fir::Type* ty)
 	{
-		// for ret
-		interp::Value returnValue;
-
-		// for branches
-		const interp::Block* targetBlk = 0;
-
-		// for calls
-		interp::Function* callTarget = 0;
-		std::vector<interp::Value> callArguments;
-		fir::Value* callResultValue = 0;
+		if(ty->isPointerType())
+			return !ty->getPointerElementType()->isFunctionType();
 
-		// for virtual calls. the args and resultvalue are shared.
-		interp::Value virtualCallTarget;
-	};
+		if(ty->isVoidType() || ty->isBoolType())
+			return true;
 
-	static int runInstruction(InterpState* is, const interp::Instruction& inst, InstrResult* instrRes);
+		return ty == Type::getInt8() || ty == Type::getInt16() || ty == Type::getInt32() || ty == Type::getInt64()
+			|| ty == Type::getUint8() || ty == Type::getUint16() || ty == Type::getUint32() || ty == Type::getUint64()
+			|| ty == Type::getFloat32() || ty == Type::getFloat64();
+	}
 
-	static interp::Value runBlock(InterpState* is, const interp::Block* blk)
+	// whether a function, and everything it calls, can run natively without us. the native code has its own
+	// copies of the globals, and can't call through our function pointers or vtables, so anything that touches
+	// those has to stay in the interpreter.
+	static bool canPromoteFunction(InterpState* is, fir::Function* fn)
 	{
-		for(size_t i = 0; i < blk->instructions.size();)
-		{
-			is->stackFrames.back().currentInstrIndex = i;
+		if(auto it = is->tierUp.eligible.find(fn); it != is->tierUp.eligible.end())
+			return it->second;
 
-			InstrResult res;
-			int flow = runInstruction(is, blk->instructions[i], &res);
+		bool ok = !fn->isCStyleVarArg() && isPromotableType(fn->getReturnType());
+		for(auto a : fn->getArguments())
+			ok = ok && isPromotableType(a->getType());
 
-			switch(flow)
-			{
-				case FLOW_NORMAL: {
-					i += 1;
-				} break;
+		std::unordered_set<fir::Function*> seen = { fn };
+		std::vector<fir::Function*> worklist = { fn };
 
-				case FLOW_BRANCH: {
-					is->stackFrames.back().previousBlock = blk;
-					is->stackFrames.back().currentBlock = res.targetBlk;
+		while(ok && !worklist.empty())
+		{
+			auto f = worklist.back();
+			worklist.pop_back();
 
-					blk = res.targetBlk; i = 0;
-				} break;
+			for(auto b : f->getBlockList())
+			{
+				for(auto inst : b->getInstructions())
+				{
+					if(inst->opKind == OpKind::Value_CallFunctionPointer || inst->opKind == OpKind::Value_CallVirtualMethod)
+						ok = false;
 
-				case FLOW_FNCALL: {
-					if(res.callTarget->isExternal)
-					{
-						is->stackFrames.back().values[res.callResultValue] = runFunctionWithLibFFI(is, *res.callTarget, res.callArguments);
-						i += 1;
-					}
-					else
+					for(size_t i = 0; ok && i < inst->operands.size(); i++)
 					{
-						is->stackFrames.back().callResultOutput = res.callResultValue;
+						auto op = inst->operands[i];
+						if(auto callee = dcast(fir::Function, op); callee)
+						{
+							// taking the address of a function gives a different thing natively.
+							if(inst->opKind != OpKind::Value_CallFunction || i != 0)
+								ok = false;
 
-						auto newblk = prepareFunctionToRun(is, *res.callTarget, res.callArguments);
-						blk = newblk; i = 0;
+							else if(seen.insert(callee).second)
+								worklist.push_back(callee);
+						}
+						else if(dcast(fir::GlobalValue, op))
+						{
+							ok = false;
+						}
 					}
-				} break;
 
-				case FLOW_DYCALL: {
-					auto ptr = getActualValue<uintptr_t>(res.virtualCallTarget);
-					auto firfn = reinterpret_cast<fir::Function*>(ptr);
+					if(!ok) break;
+				}
 
-					if(auto it = is->compiledFunctions.find(firfn); it != is->compiledFunctions.end())
-					{
-						is->stackFrames.back().callResultOutput = res.callResultValue;
+				if(!ok) break;
+			}
+		}
 
-						auto newblk = prepareFunctionToRun(is, it->second, res.callArguments);
-						blk = newblk; i = 0;
-					}
-					else
-					{
-						auto targ = res.virtualCallTarget;
+		return (is->tierUp.eligible[fn] = ok);
+	}
 
-						// uwu. use libffi.
-						fir::FunctionType* fnty = 0;
-						if(targ.type->isFunctionType())
-							fnty = targ.type->toFunctionType();
+	// count a call (or a back-edge) against a function, and promote it if it's gotten hot enough.
+	static void countTowardsPromotion(InterpState* is, interp::Function* fn)
+	{
+		if(fn->cannotPromote || fn->nativeCode || ++fn->hotness < is->tierUp.threshold)
+			return;
 
-						else if(targ.type->isPointerType() && targ.type->getPointerElementType()->isFunctionType())
-							fnty = targ.type->getPointerElementType()->toFunctionType();
+		if(fn->isExternal || !canPromoteFunction(is, fn->func))
+		{
+			fn->cannotPromote = true;
+			return;
+		}
 
-						else
-							error("interp: call to function pointer with invalid type '%s'", targ.type);
+		if(auto code = is->tierUp.compile(fn->func); code)
+		{
+			fn->nativeCode = code;
+			is->stats.functionsPromoted += 1;
+		}
+		else
+		{
+			fn->cannotPromote = true;
+		}
+	}
 
-						is->stackFrames.back().values[res.callResultValue] = runFunctionWithLibFFI(is, reinterpret_cast<void*>(ptr),
-							fnty, res.callArguments, /* name: */ res.callTarget->extFuncName);
 
-						i += 1;
-					}
-				} break;
+	static const interp::Block* prepareFunctionToRun(InterpState* is, const interp::Function& fn, std::vector<interp::Value>&& args)
+	{
+		iceAssert(args.size() == fn.func->getArgumentCount());
 
-				case FLOW_RETURN: {
-					if(is->stackFrames.size() > 1)
-					{
-						leaveFunction(is);
-						auto& frm = is->stackFrames.back();
+		// when we start a function, clear the "stack frame".
+		is->stackFrames.push_back({ });
+		is->stackFrames.back().values.resize(fn.numSlots);
+		is->stackFrames.back().arenaMark = is->valueArena.mark();
 
-						res.returnValue.val = frm.callResultOutput;
-						frm.values[frm.callResultOutput] = res.returnValue;
+		// the arguments occupy the first registers. their payloads (if any) belong to the caller's frame, which
+		// outlives ours, so we don't need copies.
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			auto farg = fn.func->getArguments()[i];
+			is->stackFrames.back().values[i] = moveValue(farg, std::move(args[i]));
+		}
 
-						blk = frm.currentBlock;
-						i   = frm.currentInstrIndex + 1;
-						break;
-					}
-					else
-					{
-						return res.returnValue;
-					}
-				}
+		iceAssert(!fn.blocks.empty());
 
-				default: {
-					error("interp: invalid flow state");
-				} break;
-			}
-		}
+		auto entry = &fn.blocks[0];
+		is->stackFrames.back().currentFunction = &fn;
+		is->stackFrames.back().currentBlock = entry;
 
-		error("interp: invalid state");
+		return entry;
 	}
 
+	static void leaveFunction(InterpState* is)
+	{
+		is->valueArena.release(is->stackFrames.back().arenaMark);
+		is->stackFrames.pop_back();
+	}
 
 
 
-	interp::Value InterpState::runFunction(const interp::Function& fn, const std::vector<interp::Value>& args)
+	// the slow path, for things that aren't in registers or the constant pool.
+	static interp::Value* getGlobal(InterpState* is, fir::Value* fv)
 	{
-		auto ffn = fn.func;
-		if((!fn.func->isCStyleVarArg() && args.size() != fn.func->getArgumentCount())
-			|| (fn.func->isCStyleVarArg() && args.size() < fn.func->getArgumentCount()))
-		{
-			error("interp: mismatched argument count in call to '%s': need %d, received %d",
-				fn.func->getName().str(), fn.func->getArgumentCount(), args.size());
-		}
+		if(auto it = is->globals.find(fv); it != is->globals.end())
+			return &it->second.first;
 
-		if(fn.blocks.empty() || fn.func->isCStyleVarArg())
-		{
-			// it's probably an extern!
-			// use libffi.
-			return runFunctionWithLibFFI(this, ffn, args);
-		}
 		else
-		{
-			auto entry = prepareFunctionToRun(this, fn, args);
-			auto ret = runBlock(this, entry);
-			leaveFunction(this);
-
-			return ret;
-		}
+			return 0;
 	}
 
-
-
-	static interp::Value* getVal2(InterpState* is, fir::Value* fv)
+	static interp::Value* getVal2(InterpState* is, const interp::Operand& op)
 	{
-		if(auto it = is->stackFrames.back().values.find(fv); it != is->stackFrames.back().values.end())
-			return &it->second;
+		auto& frame = is->stackFrames.back();
 
-		else if(auto it2 = is->globals.find(fv); it2 != is->globals.end())
-			return &it2->second.first;
-
-		else
-			return 0;
+		switch(op.kind)
+		{
+			case Operand::Kind::Register:   return &frame.values[op.index];
+			case Operand::Kind::Global:     return getGlobal(is, op.value);
+			default:                        return 0;
+		}
 	}
 
-	static interp::Value getVal(InterpState* is, fir::Value* fv)
+	static interp::Value getVal(InterpState* is, const interp::Operand& op)
 	{
-		if(auto hmm = getVal2(is, fv); hmm)
+		if(op.kind == Operand::Kind::Constant)
+			return is->stackFrames.back().currentFunction->constants[op.index];
+
+		else if(auto hmm = getVal2(is, op); hmm)
 			return *hmm;
 
-		else if(auto cnst = dcast(fir::ConstantValue, fv); cnst)
+		else if(auto cnst = dcast(fir::ConstantValue, op.value); cnst)
 			return makeConstant(is, cnst);
 
 		else
-			error("interp: no value with id %d", fv->id);
+			error("interp: no value with id %d", op.value->id);
 	}
 
 
@@ -1333,13 +1460,14 @@ namespace interp
 		if(!strty->isStructType() && !strty->isClassType() && !strty->isTupleType())
 			error("interp: unsupported type '%s' for struct gep", strty);
 
-		std::vector<fir::Type*> elms = getTypeListOfType(strty);
+		auto& layout = getTypeLayout(strty);
+		iceAssert(idx < layout.fieldOffsets.size());
 
-		size_t ofs = getOffsetOfTypeInTypeList(elms, idx);
+		size_t ofs = layout.fieldOffsets[idx];
 		uintptr_t src = getActualValue<uintptr_t>(str);
 		src += ofs;
 
-		auto ret = cloneValue(str);
+		auto ret = cloneValue(is, str);
 		ret.type = resty;
 		setValueRaw(is, &ret, &src, sizeof(src));
 
@@ -1347,11 +1475,11 @@ namespace interp
 		return ret;
 	}
 
-	static interp::Value decay(const interp::Value& val)
+	static interp::Value decay(InterpState* is, const interp::Value& val)
 	{
 		if(val.val && val.val->islvalue())
 		{
-			auto ret = loadFromPtr(val, val.val->getType());
+			auto ret = loadFromPtr(is, val, val.val->getType());
 			ret.val = val.val;
 
 			return ret;
@@ -1365,7 +1493,7 @@ namespace interp
 	static interp::Value& getUndecayedArg(InterpState* is, const interp::Instruction& inst, size_t i)
 	{
 		iceAssert(i < inst.args.size());
-		auto ret = getVal2(is, inst.args[i]);
+		auto ret = getVal2(is, inst.operands[i]);
 		iceAssert(ret);
 
 		return *ret;
@@ -1374,12 +1502,12 @@ namespace interp
 	static interp::Value getArg(InterpState* is, const interp::Instruction& inst, size_t i)
 	{
 		iceAssert(i < inst.args.size());
-		return decay(getVal(is, inst.args[i]));
+		return decay(is, getVal(is, inst.operands[i]));
 	}
 
 	static void setRet(InterpState* is, const interp::Instruction& inst, const interp::Value& val)
 	{
-		is->stackFrames.back().values[inst.result] = val;
+		is->stackFrames.back().values[inst.resultSlot] = val;
 	}
 
 	static bool areTypesSufficientlyEqual(fir::Type* a, fir::Type* b)
@@ -1388,8 +1516,9 @@ namespace interp
 	}
 
 
-	// returns either FLOW_NORMAL, FLOW_BRANCH or FLOW_RETURN.
-	static int runInstruction(InterpState* is, const interp::Instruction& inst, InstrResult* instrRes)
+	// this handles everything except the instructions that change control flow, which the interpreter
+	// loop in runBlock() deals with directly.
+	static void runInstruction(InterpState* is, const interp::Instruction& inst)
 	{
 		auto ok = static_cast<OpKind>(inst.opcode);
 		switch(ok)
@@ -1697,10 +1826,10 @@ namespace interp
 
 				interp::Value ret;
 				if(a.type == Type::getFloat64() && t == Type::getFloat32())
-					ret = makeValue(inst.result, static_cast<float>(getActualValue<double>(a)));
+					ret = makeValue(is, inst.result, static_cast<float>(getActualValue<double>(a)));
 
-				else if(a.type == Type::getFloat32())   ret = makeValue(inst.result, getActualValue<float>(a));
-				else if(a.type == Type::getFloat64())   ret = makeValue(inst.result, getActualValue<double>(a));
+				else if(a.type == Type::getFloat32())   ret = makeValue(is, inst.result, getActualValue<float>(a));
+				else if(a.type == Type::getFloat64())   ret = makeValue(is, inst.result, getActualValue<double>(a));
 				else                                    error("interp: unsupported");
 
 				setRet(is, inst, ret);
@@ -1715,10 +1844,10 @@ namespace interp
 
 				interp::Value ret;
 				if(a.type == Type::getFloat32() && t == Type::getFloat64())
-					ret = makeValue(inst.result, static_cast<double>(getActualValue<float>(a)));
+					ret = makeValue(is, inst.result, static_cast<double>(getActualValue<float>(a)));
 
-				else if(a.type == Type::getFloat32())   ret = makeValue(inst.result, getActualValue<float>(a));
-				else if(a.type == Type::getFloat64())   ret = makeValue(inst.result, getActualValue<double>(a));
+				else if(a.type == Type::getFloat32())   ret = makeValue(is, inst.result, getActualValue<float>(a));
+				else if(a.type == Type::getFloat64())   ret = makeValue(is, inst.result, getActualValue<double>(a));
 				else                                    error("interp: unsupported");
 
 				setRet(is, inst, ret);
@@ -1759,7 +1888,7 @@ namespace interp
 
 				auto ty = a.type->getPointerElementType();
 
-				auto ret = loadFromPtr(a, ty);
+				auto ret = loadFromPtr(is, a, ty);
 				ret.val = inst.result;
 
 				setRet(is, inst, ret);
@@ -1770,28 +1899,8 @@ namespace interp
 
 			case OpKind::Value_CreatePHI:
 			{
-				iceAssert(inst.args.size() == 1);
-				auto phi = dcast(fir::PHINode, inst.result);
-				iceAssert(phi);
-
-				// make the empty thing first
-				auto val = is->makeValue(inst.result);
-
-				bool found = false;
-				for(auto [ blk, v ] : phi->getValues())
-				{
-					if(blk == is->stackFrames.back().previousBlock->blk)
-					{
-						setValue(is, &val, decay(getVal(is, v)));
-						found = true;
-						break;
-					}
-				}
-
-				if(!found) error("interp: predecessor was not listed in the PHI node (id %d)!", phi->id);
-
-				setRet(is, inst, val);
-				break;
+				// these are set when we branch into the block (see setPhis()), and the branch skips over them.
+				error("interp: fell into a PHI node (id %d)", inst.result->id);
 			}
 
 
@@ -1799,150 +1908,13 @@ namespace interp
 
 
 			case OpKind::Value_Return:
-			{
-				if(!inst.args.empty())
-					instrRes->returnValue = getArg(is, inst, 0);
-
-				return FLOW_RETURN;
-			}
-
 			case OpKind::Branch_UnCond:
-			{
-				iceAssert(inst.args.size() == 1);
-				auto blk = inst.args[0];
-
-				const interp::Block* target = 0;
-				for(const auto& b : is->stackFrames.back().currentFunction->blocks)
-				{
-					if(b.blk == blk)
-					{
-						target = &b;
-						break;
-					}
-				}
-
-				if(!target) error("interp: branch to block %d not in current function", blk->id);
-
-				instrRes->targetBlk = target;
-				return FLOW_BRANCH;
-			}
-
 			case OpKind::Branch_Cond:
-			{
-				iceAssert(inst.args.size() == 3);
-				auto cond = getArg(is, inst, 0);
-				iceAssert(cond.type->isBoolType());
-
-				const interp::Block* trueblk = 0;
-				const interp::Block* falseblk = 0;
-				for(const auto& b : is->stackFrames.back().currentFunction->blocks)
-				{
-					if(b.blk == inst.args[1])
-						trueblk = &b;
-
-					else if(b.blk == inst.args[2])
-						falseblk = &b;
-
-					if(trueblk && falseblk)
-						break;
-				}
-
-				if(!trueblk || !falseblk) error("interp: branch to blocks %d or %d not in current function", trueblk->blk->id, falseblk->blk->id);
-
-
-				if(getActualValue<bool>(cond))
-					instrRes->targetBlk = trueblk;
-
-				else
-					instrRes->targetBlk = falseblk;
-
-				return FLOW_BRANCH;
-			}
-
-
 			case OpKind::Value_CallFunction:
-			{
-				iceAssert(inst.args.size() >= 1);
-				auto fn = inst.args[0];
-
-				interp::Function* target = 0;
-
-				// we probably only compiled the entry function, so if we haven't compiled the target then please do
-				if(auto it = is->compiledFunctions.find(fn); it != is->compiledFunctions.end())
-				{
-					target = &it->second;
-				}
-				else
-				{
-					for(auto f : is->module->getAllFunctions())
-					{
-						if(f == fn)
-						{
-							target = &is->compileFunction(f);
-							break;
-						}
-					}
-
-					if(!target) error("interp: no function %d (name '%s')", fn->id, fn->getName().str());
-				}
-
-				iceAssert(target);
-
-				std::vector<interp::Value> args;
-				for(size_t i = 1; i < inst.args.size(); i++)
-					args.push_back(getArg(is, inst, i));
-
-				instrRes->callTarget = target;
-				instrRes->callArguments = args;
-				instrRes->callResultValue = inst.result;
-
-				return FLOW_FNCALL;
-			}
-
-
-
 			case OpKind::Value_CallFunctionPointer:
-			{
-				iceAssert(inst.args.size() >= 1);
-				auto fn = getArg(is, inst, 0);
-
-				std::vector<interp::Value> args;
-				for(size_t i = 1; i < inst.args.size(); i++)
-					args.push_back(getArg(is, inst, i));
-
-				instrRes->callArguments = args;
-				instrRes->virtualCallTarget = fn;
-				instrRes->callResultValue = inst.result;
-
-				return FLOW_DYCALL;
-			}
-
-
 			case OpKind::Value_CallVirtualMethod:
 			{
-				// args are: 0. classtype, 1. index, 2. functiontype, 3...N args
-				auto clsty = inst.args[0]->getType()->toClassType();
-				auto fnty = inst.args[2]->getType()->toFunctionType();
-				iceAssert(clsty);
-
-				std::vector<interp::Value> args;
-				for(size_t i = 3; i < inst.args.size(); i++)
-					args.push_back(getArg(is, inst, i));
-
-				//* this is very hacky! we rely on these things not using ::val, because it's null!!
-				auto vtable = loadFromPtr(performStructGEP(is, fir::Type::getInt8Ptr(), args[0], 0), fir::Type::getInt8Ptr());
-				auto vtablety = fir::ArrayType::get(fir::FunctionType::get({ }, fir::Type::getVoid())->getPointerTo(), clsty->getVirtualMethodCount());
-				vtable.type = vtablety->getPointerTo();
-
-				vtable = performGEP2(is, vtablety->getPointerTo(), vtable, makeConstant(is, fir::ConstantInt::getNative(0)), getArg(is, inst, 1));
-
-				auto fnptr = loadFromPtr(vtable, fnty->getPointerTo());
-
-				instrRes->callArguments = args;
-				instrRes->virtualCallTarget = fnptr;
-				instrRes->callResultValue = inst.result;
-
-				return FLOW_DYCALL;
+				error("interp: control flow instruction (opcode %d) should have been dispatched by the interpreter loop", inst.opcode);
 			}
 
 
@@ -1998,7 +1970,7 @@ namespace interp
 			{
 				iceAssert(inst.args.size() == 2);
 
-				auto v = cloneValue(inst.result, getArg(is, inst, 0));
+				auto v = moveValue(inst.result, getArg(is, inst, 0));
 				v.type = inst.args[1]->getType();
 
 				setRet(is, inst, v);
@@ -2104,10 +2076,10 @@ namespace interp
 
 				auto ci = fir::ConstantInt::getNative(getSizeOfType(ty));
 
-				if(fir::getNativeWordSizeInBits() == 64) setRet(is, inst, makeValue(inst.result, static_cast<int64_t>(ci->getSignedValue())));
-				if(fir::getNativeWordSizeInBits() == 32) setRet(is, inst, makeValue(inst.result, static_cast<int32_t>(ci->getSignedValue())));
-				if(fir::getNativeWordSizeInBits() == 16) setRet(is, inst, makeValue(inst.result, static_cast<int16_t>(ci->getSignedValue())));
-				if(fir::getNativeWordSizeInBits() == 8)  setRet(is, inst, makeValue(inst.result, static_cast<int8_t>(ci->getSignedValue())));
+				if(fir::getNativeWordSizeInBits() == 64) setRet(is, inst, makeValue(is, inst.result, static_cast<int64_t>(ci->getSignedValue())));
+				if(fir::getNativeWordSizeInBits() == 32) setRet(is, inst, makeValue(is, inst.result, static_cast<int32_t>(ci->getSignedValue())));
+				if(fir::getNativeWordSizeInBits() == 16) setRet(is, inst, makeValue(is, inst.result, static_cast<int16_t>(ci->getSignedValue())));
+				if(fir::getNativeWordSizeInBits() == 8)  setRet(is, inst, makeValue(is, inst.result, static_cast<int8_t>(ci->getSignedValue())));
 
 				break;
 			}
@@ -2121,12 +2093,11 @@ namespace interp
 				auto ty = inst.args[0]->getType();
 				auto sz = getSizeOfType(ty);
 
-				void* buffer = new uint8_t[sz];
+				// these live in the value arena, so they go away with the frame.
+				void* buffer = allocateValueData(is, sz);
 				memset(buffer, 0, sz);
 
-				is->stackFrames.back().stackAllocs.push_back(buffer);
-
-				auto ret = makeValueOfType(inst.result, ty->getPointerTo());
+				auto ret = makeValueOfType(is, inst.result, ty->getPointerTo());
 				setValueRaw(is, &ret, &buffer, sizeof(void*));
 
 				setRet(is, inst, ret);
@@ -2154,7 +2125,7 @@ namespace interp
 			case OpKind::Value_AddressOf:
 			{
 				iceAssert(inst.args.size() == 1);
-				auto ret = cloneValue(inst.result, getUndecayedArg(is, inst, 0));
+				auto ret = cloneValue(is, inst.result, getUndecayedArg(is, inst, 0));
 
 				setRet(is, inst, ret);
 				break;
@@ -2164,7 +2135,7 @@ namespace interp
 			{
 				iceAssert(inst.args.size() == 1);
 				auto a = getArg(is, inst, 0);
-				auto ret = cloneValue(inst.result, a);
+				auto ret = moveValue(inst.result, std::move(a));
 
 				setRet(is, inst, ret);
 				break;
@@ -2506,7 +2477,7 @@ namespace interp
 				// twist ourselves through hoops like with llvm.
 
 				// first we just get the argument:
-				auto theUnion = cloneValue(inst.result, getArg(is, inst, 0));
+				auto theUnion = cloneValue(is, inst.result, getArg(is, inst, 0));
 
 				// then, get the array:
 				uintptr_t baseAddr = 0;
@@ -2541,7 +2512,7 @@ namespace interp
 				auto unn = getUndecayedArg(is, inst, 0);
 				auto buffer = getActualValue<uintptr_t>(unn);
 
-				auto ret = makeValueOfType(inst.result, targtype->getPointerTo());
+				auto ret = makeValueOfType(is, inst.result, targtype->getPointerTo());
 				setValueRaw(is, &ret, &buffer, sizeof(uintptr_t));
 
 				setRet(is, inst, ret);
@@ -2563,8 +2534,540 @@ namespace interp
 				error("interp: invalid opcode %d!", inst.opcode);
 			}
 		}
+	}
+
+
+
+	// type-specialised handlers. when compileInstruction() can see that both operands of an arithmetic op (or a
+	// comparison) have the same primitive type, it gets one of these instead of runInstruction, so the hot path
+	// is just a native operation on the raw bytes without going through twoArgumentOp.
+	using InstrHandler = void (*)(InterpState*, const interp::Instruction&);
+
+	template <typename T>
+	static T getNativeArg(InterpState* is, const interp::Instruction& inst, size_t i)
+	{
+		const auto& op = inst.operands[i];
+		const auto& frame = is->stackFrames.back();
+
+		const interp::Value& v = (op.kind == Operand::Kind::Register
+			? frame.values[op.index]
+			: frame.currentFunction->constants[op.index]);
+
+		// registers can hold lvalues, which need to be loaded through -- let the normal path handle those.
+		if(v.val && v.val->islvalue())
+			return getActualValue<T>(getArg(is, inst, i));
+
+		T ret;
+		memmove(&ret, &v.data[0], sizeof(T));
+		return ret;
+	}
+
+	template <typename T, typename R, typename Op>
+	static void runNativeBinaryOp(InterpState* is, const interp::Instruction& inst)
+	{
+		auto a = getNativeArg<T>(is, inst, 0);
+		auto b = getNativeArg<T>(is, inst, 1);
+
+		R res = static_cast<R>(Op()(a, b));
+
+		auto& ret = is->stackFrames.back().values[inst.resultSlot];
+		ret.val = inst.result;
+		ret.type = inst.result->getType();
+		ret.dataSize = sizeof(R);
+		ret.globalValTracker = 0;
+
+		memset(&ret.data[0], 0, sizeof(uint64_t));
+		memmove(&ret.data[0], &res, sizeof(R));
+	}
+
+	namespace ops
+	{
+		struct Add { template <typename T> auto operator () (T a, T b) { return a + b; } };
+		struct Sub { template <typename T> auto operator () (T a, T b) { return a - b; } };
+		struct Mul { template <typename T> auto operator () (T a, T b) { return a * b; } };
+		struct Div { template <typename T> auto operator () (T a, T b) { return a / b; } };
+		struct Mod { template <typename T> auto operator () (T a, T b) { return a % b; } };
+		struct FMod { template <typename T> auto operator () (T a, T b) { return fmod(a, b); } };
+
+		struct And { template <typename T> auto operator () (T a, T b) { return a & b; } };
+		struct Or  { template <typename T> auto operator () (T a, T b) { return a | b; } };
+		struct Xor { template <typename T> auto operator () (T a, T b) { return a ^ b; } };
+		struct Shl { template <typename T> auto operator () (T a, T b) { return a << b; } };
+		struct Shr { template <typename T> auto operator () (T a, T b) { return a >> b; } };
+
+		struct CmpEQ { template <typename T> bool operator () (T a, T b) { return a == b; } };
+		struct CmpNE { template <typename T> bool operator () (T a, T b) { return a != b; } };
+		struct CmpGT { template <typename T> bool operator () (T a, T b) { return a > b; } };
+		struct CmpLT { template <typename T> bool operator () (T a, T b) { return a < b; } };
+		struct CmpGE { template <typename T> bool operator () (T a, T b) { return a >= b; } };
+		struct CmpLE { template <typename T> bool operator () (T a, T b) { return a <= b; } };
+	}
+
+	// if 'Same' is true, the result has the operand type (arithmetic); otherwise it's a bool (comparisons).
+	template <typename Op, bool Same>
+	static InstrHandler getNativeIntHandler(fir::Type* ty)
+	{
+		#define Case(fty, T) if(ty == (fty)) return &runNativeBinaryOp<T, std::conditional_t<Same, T, bool>, Op>
+
+		Case(Type::getInt8(), int8_t);      Case(Type::getUint8(), uint8_t);
+		Case(Type::getInt16(), int16_t);    Case(Type::getUint16(), uint16_t);
+		Case(Type::getInt32(), int32_t);    Case(Type::getUint32(), uint32_t);
+		Case(Type::getInt64(), int64_t);    Case(Type::getUint64(), uint64_t);
+
+		#undef Case
+		return 0;
+	}
+
+	template <typename Op, bool Same>
+	static InstrHandler getNativeFloatHandler(fir::Type* ty)
+	{
+		if(ty == Type::getFloat32()) return &runNativeBinaryOp<float, std::conditional_t<Same, float, bool>, Op>;
+		if(ty == Type::getFloat64()) return &runNativeBinaryOp<double, std::conditional_t<Same, double, bool>, Op>;
+
+		return 0;
+	}
+
+	template <typename Op, bool Same>
+	static InstrHandler getNativeHandler(fir::Type* ty)
+	{
+		if(auto h = getNativeIntHandler<Op, Same>(ty); h)
+			return h;
+
+		return getNativeFloatHandler<Op, Same>(ty);
+	}
+
+	static InstrHandler getSpecialisedHandler(const interp::Instruction& inst)
+	{
+		if(inst.args.size() != 2 || !inst.result)
+			return 0;
+
+		for(const auto& op : inst.operands)
+		{
+			if(op.kind != Operand::Kind::Register && op.kind != Operand::Kind::Constant)
+				return 0;
+		}
+
+		auto ty = inst.args[0]->getType();
+		if(ty != inst.args[1]->getType())
+			return 0;
+
+		auto resty = inst.result->getType();
+
+		// the arithmetic ops must produce the same type, and the comparisons must produce a bool.
+		bool arith = (resty == ty);
+		bool cmp = resty->isBoolType();
+
+		switch(static_cast<OpKind>(inst.opcode))
+		{
+			case OpKind::Signed_Add:
+			case OpKind::Unsigned_Add:
+			case OpKind::Floating_Add:              return arith ? getNativeHandler<ops::Add, true>(ty) : 0;
+
+			case OpKind::Signed_Sub:
+			case OpKind::Unsigned_Sub:
+			case OpKind::Floating_Sub:              return arith ? getNativeHandler<ops::Sub, true>(ty) : 0;
+
+			case OpKind::Signed_Mul:
+			case OpKind::Unsigned_Mul:
+			case OpKind::Floating_Mul:              return arith ? getNativeHandler<ops::Mul, true>(ty) : 0;
+
+			case OpKind::Signed_Div:
+			case OpKind::Unsigned_Div:
+			case OpKind::Floating_Div:              return arith ? getNativeHandler<ops::Div, true>(ty) : 0;
+
+			case OpKind::Signed_Mod:
+			case OpKind::Unsigned_Mod:              return arith ? getNativeIntHandler<ops::Mod, true>(ty) : 0;
+			case OpKind::Floating_Mod:              return arith ? getNativeFloatHandler<ops::FMod, true>(ty) : 0;
+
+			case OpKind::Bitwise_And:               return arith ? getNativeIntHandler<ops::And, true>(ty) : 0;
+			case OpKind::Bitwise_Or:                return arith ? getNativeIntHandler<ops::Or, true>(ty) : 0;
+			case OpKind::Bitwise_Xor:               return arith ? getNativeIntHandler<ops::Xor, true>(ty) : 0;
+			case OpKind::Bitwise_Shl:               return arith ? getNativeIntHandler<ops::Shl, true>(ty) : 0;
+			case OpKind::Bitwise_Logical_Shr:
+			case OpKind::Bitwise_Arithmetic_Shr:    return arith ? getNativeIntHandler<ops::Shr, true>(ty) : 0;
+
+			case OpKind::ICompare_Equal:
+			case OpKind::FCompare_Equal_ORD:
+			case OpKind::FCompare_Equal_UNORD:      return cmp ? getNativeHandler<ops::CmpEQ, false>(ty) : 0;
+
+			case OpKind::ICompare_NotEqual:
+			case OpKind::FCompare_NotEqual_ORD:
+			case OpKind::FCompare_NotEqual_UNORD:   return cmp ? getNativeHandler<ops::CmpNE, false>(ty) : 0;
+
+			case OpKind::ICompare_Greater:
+			case OpKind::FCompare_Greater_ORD:
+			case OpKind::FCompare_Greater_UNORD:    return cmp ? getNativeHandler<ops::CmpGT, false>(ty) : 0;
+
+			case OpKind::ICompare_Less:
+			case OpKind::FCompare_Less_ORD:
+			case OpKind::FCompare_Less_UNORD:       return cmp ? getNativeHandler<ops::CmpLT, false>(ty) : 0;
+
+			case OpKind::ICompare_GreaterEqual:
+			case OpKind::FCompare_GreaterEqual_ORD:
+			case OpKind::FCompare_GreaterEqual_UNORD: return cmp ? getNativeHandler<ops::CmpGE, false>(ty) : 0;
+
+			case OpKind::ICompare_LessEqual:
+			case OpKind::FCompare_LessEqual_ORD:
+			case OpKind::FCompare_LessEqual_UNORD:  return cmp ? getNativeHandler<ops::CmpLE, false>(ty) : 0;
+
+			default:
+				return 0;
+		}
+	}
+
+
+
+	constexpr uint32_t DISPATCH_NORMAL          = 0;
+	constexpr uint32_t DISPATCH_RETURN          = 1;
+	constexpr uint32_t DISPATCH_BRANCH          = 2;
+	constexpr uint32_t DISPATCH_CONDBRANCH      = 3;
+	constexpr uint32_t DISPATCH_CALL            = 4;
+	constexpr uint32_t DISPATCH_CALLPTR         = 5;
+	constexpr uint32_t DISPATCH_CALLVIRTUAL     = 6;
+
+	void decodeInstruction(interp::Instruction* inst)
+	{
+		switch(static_cast<OpKind>(inst->opcode))
+		{
+			case OpKind::Value_Return:              inst->dispatch = DISPATCH_RETURN; break;
+			case OpKind::Branch_UnCond:             inst->dispatch = DISPATCH_BRANCH; break;
+			case OpKind::Branch_Cond:               inst->dispatch = DISPATCH_CONDBRANCH; break;
+			case OpKind::Value_CallFunction:        inst->dispatch = DISPATCH_CALL; break;
+			case OpKind::Value_CallFunctionPointer: inst->dispatch = DISPATCH_CALLPTR; break;
+			case OpKind::Value_CallVirtualMethod:   inst->dispatch = DISPATCH_CALLVIRTUAL; break;
+			default:                                inst->dispatch = DISPATCH_NORMAL; break;
+		}
+
+		if(auto h = getSpecialisedHandler(*inst); h)
+			inst->handler = h;
+
+		else
+			inst->handler = &runInstruction;
+	}
+
+
+	static interp::Function* getCallTarget(InterpState* is, fir::Value* fn)
+	{
+		// we probably only compiled the entry function, so if we haven't compiled the target then please do
+		if(auto cf = getCompiledFunction(is, fn); cf)
+			return cf;
+
+		if(auto f = dcast(fir::Function, fn); f && f->getParentModule() == is->module && is->module->getFunction(f->getName()) == f)
+			return &is->compileFunction(f);
+
+		error("interp: no function %d (name '%s')", fn->id, fn->getName().str());
+	}
+
+	static std::vector<interp::Value> getCallArguments(InterpState* is, const interp::Instruction& inst, size_t first)
+	{
+		std::vector<interp::Value> args;
+		args.reserve(inst.args.size() - first);
+
+		for(size_t i = first; i < inst.args.size(); i++)
+			args.push_back(getArg(is, inst, i));
+
+		return args;
+	}
+
+	static fir::FunctionType* getFunctionPointerType(const interp::Value& targ)
+	{
+		if(targ.type->isFunctionType())
+			return targ.type->toFunctionType();
+
+		else if(targ.type->isPointerType() && targ.type->getPointerElementType()->isFunctionType())
+			return targ.type->getPointerElementType()->toFunctionType();
+
+		else
+			error("interp: call to function pointer with invalid type '%s'", targ.type);
+	}
+
+
+	// on gcc and clang, we thread the dispatch with computed gotos (one indirect jump per instruction, from the
+	// end of each handler); elsewhere, we fall back to a switch in a loop.
+	#if defined(__GNUC__) || defined(__clang__)
+		#define INTERP_COMPUTED_GOTO 1
+	#else
+		#define INTERP_COMPUTED_GOTO 0
+	#endif
+
+	// when we go from 'from' to 'to', all the phis at the top of 'to' take their values at once -- one of them might
+	// want the old value of another (eg. when two variables are swapped in a loop), so we read everything first.
+	static void setPhis(InterpState* is, const interp::Block* from, const interp::Block* to)
+	{
+		static std::vector<interp::Value> scratch;
+
+		auto& frame = is->stackFrames.back();
+		auto prev = static_cast<size_t>(from - &frame.currentFunction->blocks[0]);
+
+		for(const auto& [ pred, ops ] : to->phiIncoming)
+		{
+			if(pred != prev)
+				continue;
+
+			scratch.clear();
+			for(size_t i = 0; i < ops.size(); i++)
+				scratch.push_back(moveValue(to->instructions[i].result, decay(is, getVal(is, ops[i]))));
+
+			for(size_t i = 0; i < ops.size(); i++)
+				frame.values[to->instructions[i].resultSlot] = std::move(scratch[i]);
+
+			if(is->stats.countInstructions)
+				is->stats.instructionsExecuted += ops.size();
+
+			return;
+		}
+
+		error("interp: predecessor was not listed in the PHI node (id %d)!", to->instructions[0].result->id);
+	}
+
+	static interp::Value runBlock(InterpState* is, const interp::Block* blk)
+	{
+		// the frame that runFunction() set up for us; when we return from it, we're done.
+		const size_t baseDepth = is->stackFrames.size();
+
+		const interp::Instruction* inst = 0;
+		size_t idx = 0;
+
+		// for calls through function pointers, which might land in the interpreter or in native code.
+		interp::Value dynamicTarget;
+		std::vector<interp::Value> callArgs;
+
+		// only -profile wants the count, so everything else just pays for a (predictable) branch.
+		const bool counting = is->stats.countInstructions;
+
+		#define FETCH() do {                                                \
+			if(idx >= blk->instructions.size())                             \
+				error("interp: invalid state");                             \
+			inst = &blk->instructions[idx];                                 \
+			if(counting)                                                    \
+				is->stats.instructionsExecuted += 1;                        \
+		} while(0)
+
+		#if INTERP_COMPUTED_GOTO
+
+			static void* dispatchTable[] = {
+				&&op_NORMAL, &&op_RETURN, &&op_BRANCH, &&op_CONDBRANCH, &&op_CALL, &&op_CALLPTR, &&op_CALLVIRTUAL
+			};
+
+			#define DISPATCH()  do { FETCH(); goto *dispatchTable[inst->dispatch]; } while(0)
+			#define OP(x)       op_##x:
+
+			DISPATCH();
+			{
+		#else
+			#define DISPATCH()  continue
+			#define OP(x)       case DISPATCH_##x:
+
+			while(true)
+			{
+				FETCH();
+				switch(inst->dispatch)
+				{
+					default: error("interp: invalid dispatch %d", inst->dispatch);
+		#endif
+
+		OP(NORMAL)
+		{
+			inst->handler(is, *inst);
+			idx += 1;
+
+			DISPATCH();
+		}
+
+		OP(BRANCH)
+		{
+			auto& frame = is->stackFrames.back();
+			auto target = &frame.currentFunction->blocks[inst->operands[0].index];
+
+			// a jump backwards is (most likely) a loop; the promotion only takes effect from the next call, but
+			// it lets a function that's called once and loops a lot get compiled for next time.
+			if(is->tierUp.compile && target <= blk)
+				countTowardsPromotion(is, const_cast<interp::Function*>(frame.currentFunction));
+
+			if(target->numPhis > 0)
+				setPhis(is, blk, target);
+
+			frame.currentBlock = blk = target;
+
+			idx = blk->numPhis;
+			DISPATCH();
+		}
+
+		OP(CONDBRANCH)
+		{
+			auto cond = getArg(is, *inst, 0);
+			iceAssert(cond.type->isBoolType());
+
+			auto& frame = is->stackFrames.back();
+			auto target = &frame.currentFunction->blocks[(getActualValue<bool>(cond) ? inst->operands[1] : inst->operands[2]).index];
+
+			if(is->tierUp.compile && target <= blk)
+				countTowardsPromotion(is, const_cast<interp::Function*>(frame.currentFunction));
+
+			if(target->numPhis > 0)
+				setPhis(is, blk, target);
+
+			frame.currentBlock = blk = target;
+
+			idx = blk->numPhis;
+			DISPATCH();
+		}
+
+		OP(CALL)
+		{
+			iceAssert(inst->args.size() >= 1);
+
+			auto target = getCallTarget(is, inst->args[0]);
+			auto args = getCallArguments(is, *inst, 1);
+
+			if(is->tierUp.compile)
+				countTowardsPromotion(is, target);
+
+			if(target->isExternal)
+			{
+				is->stackFrames.back().values[inst->resultSlot] = runFunctionWithLibFFI(is, *target, args);
+				idx += 1;
+			}
+			else if(target->nativeCode)
+			{
+				is->stackFrames.back().values[inst->resultSlot] = callWithLibFFI(is, target->nativeCode,
+					target->func->getType(), args);
+
+				idx += 1;
+			}
+			else
+			{
+				auto& frame = is->stackFrames.back();
+				frame.currentInstrIndex = idx;
+				frame.callResultSlot = inst->resultSlot;
+
+				blk = prepareFunctionToRun(is, *target, std::move(args));
+				idx = 0;
+			}
+
+			DISPATCH();
+		}
+
+		OP(CALLPTR)
+		{
+			iceAssert(inst->args.size() >= 1);
+
+			dynamicTarget = getArg(is, *inst, 0);
+			callArgs = getCallArguments(is, *inst, 1);
+
+			goto do_dynamic_call;
+		}
 
-		return FLOW_NORMAL;
+		OP(CALLVIRTUAL)
+		{
+			// args are: 0. classtype, 1. index, 2. functiontype, 3...N args
+			auto clsty = inst->args[0]->getType()->toClassType();
+			auto fnty = inst->args[2]->getType()->toFunctionType();
+			iceAssert(clsty);
+
+			callArgs = getCallArguments(is, *inst, 3);
+
+			//* this is very hacky! we rely on these things not using ::val, because it's null!!
+			auto vtable = loadFromPtr(is, performStructGEP(is, fir::Type::getInt8Ptr(), callArgs[0], 0), fir::Type::getInt8Ptr());
+			auto vtablety = fir::ArrayType::get(fir::FunctionType::get({ }, fir::Type::getVoid())->getPointerTo(), clsty->getVirtualMethodCount());
+			vtable.type = vtablety->getPointerTo();
+
+			vtable = performGEP2(is, vtablety->getPointerTo(), vtable, makeConstant(is, fir::ConstantInt::getNative(0)), getArg(is, *inst, 1));
+
+			dynamicTarget = loadFromPtr(is, vtable, fnty->getPointerTo());
+			goto do_dynamic_call;
+		}
+
+		do_dynamic_call:
+		{
+			auto ptr = getActualValue<uintptr_t>(dynamicTarget);
+			auto firfn = reinterpret_cast<fir::Function*>(ptr);
+
+			if(auto cf = getCompiledFunction(is, firfn); cf)
+			{
+				auto& frame = is->stackFrames.back();
+				frame.currentInstrIndex = idx;
+				frame.callResultSlot = inst->resultSlot;
+
+				blk = prepareFunctionToRun(is, *cf, std::move(callArgs));
+				idx = 0;
+			}
+			else
+			{
+				// uwu. use libffi.
+				is->stackFrames.back().values[inst->resultSlot] = runFunctionWithLibFFI(is, reinterpret_cast<void*>(ptr),
+					getFunctionPointerType(dynamicTarget), callArgs);
+
+				idx += 1;
+			}
+
+			DISPATCH();
+		}
+
+		OP(RETURN)
+		{
+			interp::Value ret;
+			if(!inst->args.empty())
+				ret = getArg(is, *inst, 0);
+
+			if(is->stackFrames.size() <= baseDepth)
+				return ret;
+
+			leaveFunction(is);
+			auto& frame = is->stackFrames.back();
+
+			blk = frame.currentBlock;
+			idx = frame.currentInstrIndex;
+
+			// the payload of the return value might live in the frame we just left. the arena doesn't actually
+			// free anything when it's rolled back, so it's still there; copy it into the caller's part of the arena
+			// before anything else gets allocated over it.
+			frame.values[frame.callResultSlot] = cloneValue(is, blk->instructions[idx].result, ret);
+
+			idx += 1;
+			DISPATCH();
+		}
+
+		#if INTERP_COMPUTED_GOTO
+			}
+		#else
+				}
+			}
+		#endif
+
+		#undef OP
+		#undef FETCH
+		#undef DISPATCH
+	}
+
+
+
+
+	interp::Value InterpState::runFunction(const interp::Function& fn, const std::vector<interp::Value>& args)
+	{
+		auto ffn = fn.func;
+		if((!fn.func->isCStyleVarArg() && args.size() != fn.func->getArgumentCount())
+			|| (fn.func->isCStyleVarArg() && args.size() < fn.func->getArgumentCount()))
+		{
+			error("interp: mismatched argument count in call to '%s': need %d, received %d",
+				fn.func->getName().str(), fn.func->getArgumentCount(), args.size());
+		}
+
+		if(fn.blocks.empty() || fn.func->isCStyleVarArg())
+		{
+			// it's probably an extern!
+			// use libffi.
+			return runFunctionWithLibFFI(this, ffn, args);
+		}
+		else
+		{
+			auto entry = prepareFunctionToRun(this, fn, std::vector<interp::Value>(args));
+			auto ret = runBlock(this, entry);
+			leaveFunction(this);
+
+			// same deal as returning in runBlock().
+			return cloneValue(this, ret);
+		}
 	}
 
 
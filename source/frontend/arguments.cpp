@@ -10,6 +10,7 @@
 
 #define ARG_COMPILE_ONLY                        "-c"
 #define ARG_BACKEND                             "-backend"
+#define ARG_CODEGEN_UNITS                       "-codegen-units"
 #define ARG_EMIT_LLVM_IR                        "-emit-llvm"
 #define ARG_LINK_FRAMEWORK                      "-framework"
 #define ARG_FRAMEWORK_SEARCH_PATH               "-F"
@@ -55,6 +56,7 @@ static void setupMap()
 {
 	helpList.push_back({ ARG_COMPILE_ONLY, "output an object file; do not call the linker" });
 	helpList.push_back({ ARG_BACKEND + std::string(" <backend>"), "change the backend used for compilation" });
+	helpList.push_back({ ARG_CODEGEN_UNITS + std::string(" <n>"), "split llvm code generation into <n> units, emitted in parallel" });
 	helpList.push_back({ ARG_EMIT_LLVM_IR, "emit a bitcode (.bc) file instead of a program" });
 	helpList.push_back({ ARG_LINK_FRAMEWORK + std::string(" <framework>"), "link to a framework (macOS only)" });
 	helpList.push_back({ ARG_LINK_FRAMEWORK + std::string(" <path>"), "link to a framework (macOS only)" });
@@ -175,6 +177,7 @@ namespace frontend
 
 	static std::string _mcModel;
 	static std::string _targetArch;
+	static std::string _codegenUnits;
 	static std::string _sysrootPath;
 	static const std::string _prefixPath = "/usr/local/";
 
@@ -284,6 +287,9 @@ namespace frontend
 		else if(name == "targetarch")
 			return _targetArch;
 
+		else if(name == "codegen-units")
+			return _codegenUnits;
+
 		else if(name == "sysroot")
 			return _sysrootPath;
 
@@ -309,6 +315,7 @@ namespace frontend
 		mutualExclusions[ARG_REPL].insert(ARG_TARGET);
 		mutualExclusions[ARG_REPL].insert(ARG_BACKEND);
 		mutualExclusions[ARG_REPL].insert(ARG_MCMODEL);
+		mutualExclusions[ARG_REPL].insert(ARG_CODEGEN_UNITS);
 		mutualExclusions[ARG_REPL].insert(ARG_JITPROGRAM);
 		mutualExclusions[ARG_REPL].insert(ARG_OUTPUT_FILE);
 		mutualExclusions[ARG_REPL].insert(ARG_COMPILE_ONLY);
@@ -319,6 +326,7 @@ namespace frontend
 		// don't try to run/jit and compile/output at the same time
 		mutualExclusions[ARG_RUNPROGRAM].insert(ARG_TARGET);
 		mutualExclusions[ARG_RUNPROGRAM].insert(ARG_MCMODEL);
+		mutualExclusions[ARG_RUNPROGRAM].insert(ARG_CODEGEN_UNITS);
 		mutualExclusions[ARG_RUNPROGRAM].insert(ARG_OUTPUT_FILE);
 		mutualExclusions[ARG_RUNPROGRAM].insert(ARG_COMPILE_ONLY);
 		mutualExclusions[ARG_RUNPROGRAM].insert(ARG_FREESTANDING);
@@ -525,6 +533,10 @@ namespace frontend
 						{
 							frontend::_backendCodegen = BackendOption::Interpreter;
 						}
+						else if(str == "tiered")
+						{
+							frontend::_backendCodegen = BackendOption::Tiered;
+						}
 						else if(str == "x64asm")
 						{
 							frontend::_backendCodegen = BackendOption::Assembly_x64;
@@ -535,7 +547,7 @@ namespace frontend
 						}
 						else
 						{
-							_error_and_exit("error: '%s' is not a valid backend (valid options are 'llvm' and 'x64asm')\n", str);
+							_error_and_exit("error: '%s' is not a valid backend (valid options are 'llvm', 'interp', 'tiered' and 'x64asm')\n", str);
 						}
 
 						continue;
@@ -584,6 +596,24 @@ namespace frontend
 						_error_and_exit("error: expected mcmodel name after '-mcmodel' option\n");
 					}
 				}
+				else if(!strcmp(argv[i], ARG_CODEGEN_UNITS))
+				{
+					if(i != argc - 1)
+					{
+						i++;
+						std::string n = parseQuotedString(argv, i);
+						if(n.empty() || n.find_first_not_of("0123456789") != std::string::npos || std::stoul(n) == 0)
+						{
+							_error_and_exit("error: expected a positive number after '-codegen-units' option\n");
+						}
+
+						frontend::_codegenUnits = n;
+					}
+					else
+					{
+						_error_and_exit("error: expected a number after '-codegen-units' option\n");
+					}
+				}
 				else if(!strcmp(argv[i], WARNINGS_AS_ERRORS))
 				{
 					// frontend::Flags |= (uint64_t) frontend::Flag::WarningsAsErrors;
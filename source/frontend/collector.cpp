@@ -10,6 +10,7 @@
 #include "codegen.h"
 #include "frontend.h"
 #include "typecheck.h"
+#include "parallel.h"
 
 namespace frontend
 {
@@ -38,10 +39,11 @@ namespace frontend
 
 	void parseFiles(CollectorState* state)
 	{
-		// parse
+		// first, collect the custom operators. a file can use the ones declared in it, and in the files that come
+		// before it (ie. its imports, and theirs) -- so each file gets a copy of what we had when we got to it.
+		std::vector<parser::CustomOperators> visibleOps;
 		for(const auto& file : state->allFiles)
 		{
-			// parse it all
 			auto opers = parser::parseOperators(frontend::getFileTokens(file));
 
 			{
@@ -60,22 +62,42 @@ namespace frontend
 					}
 				};
 
-				checkDupes(state->binaryOps, std::get<0>(opers), "infix");
-				checkDupes(state->prefixOps, std::get<1>(opers), "prefix");
-				checkDupes(state->postfixOps, std::get<2>(opers), "postfix");
+				auto& ops = state->operators;
+
+				checkDupes(ops.binaryOps, std::get<0>(opers), "infix");
+				checkDupes(ops.prefixOps, std::get<1>(opers), "prefix");
+				checkDupes(ops.postfixOps, std::get<2>(opers), "postfix");
 
 				for(const auto& op : std::get<0>(opers))
-					state->binaryOps[op.first] = op.second;
+					ops.binaryOps[op.first] = op.second;
 
 				for(const auto& op : std::get<1>(opers))
-					state->prefixOps[op.first] = op.second;
+					ops.prefixOps[op.first] = op.second;
 
 				for(const auto& op : std::get<2>(opers))
-					state->postfixOps[op.first] = op.second;
+					ops.postfixOps[op.first] = op.second;
 			}
 
+			visibleOps.push_back(state->operators);
+		}
+
+		// now parse them all at once. the parser doesn't touch the collector state, so the only thing we need to
+		// be careful about is where the results go.
+		std::vector<parser::ParsedFile> parsed(state->allFiles.size());
+		util::parallelFor(state->allFiles.size(), [state, &parsed, &visibleOps](size_t i) {
+			const auto& file = state->allFiles[i];
+			parsed[i] = parser::parseFile(file, frontend::getFileState(file), visibleOps[i]);
+		});
+
+		// go through them in the same order we used to parse them in, so if more than one file sets the word size,
+		// the last one still wins.
+		for(size_t i = 0; i < state->allFiles.size(); i++)
+		{
+			const auto& pf = parsed[i];
+			if(pf.nativeWordSize != 0)
+				state->nativeWordSize = pf.nativeWordSize;
 
-			state->parsed[file] = parser::parseFile(file, frontend::getFileState(file), *state);
+			state->parsed[state->allFiles[i]] = pf;
 		}
 	}
 
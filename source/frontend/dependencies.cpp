@@ -208,25 +208,73 @@ namespace frontend
 		return fulls;
 	}
 
-	frontend::DependencyGraph* buildDependencyGraph(frontend::DependencyGraph* graph, const std::string& full,
-		util::hash_map<std::string, bool>& visited)
+	// the imports of a file, and the files they resolved to.
+	using ImportList = std::pair<std::vector<frontend::ImportThing>, std::vector<std::string>>;
+
+	// lex everything reachable from 'full' a level at a time (everything the files in the last level import, all at
+	// once), so we start one lot of threads per level, instead of one for every file that imports something.
+	static util::hash_map<std::string, ImportList> findAllImports(const std::string& full)
 	{
-		auto tokens = frontend::getFileTokens(full);
-		auto imports = parser::parseImports(full, tokens);
+		util::hash_map<std::string, ImportList> ret;
+		util::hash_map<std::string, bool> seen;
+
+		std::vector<std::string> level = { full };
+		seen[full] = true;
+
+		while(!level.empty())
+		{
+			std::vector<std::string> next;
+			for(const auto& file : level)
+			{
+				auto imports = parser::parseImports(file, frontend::getFileTokens(file));
+
+				std::vector<std::string> fullpaths;
+				for(const auto& imp : imports)
+				{
+					fullpaths.push_back(resolveImport(imp.name, imp.loc, file));
+					if(!seen[fullpaths.back()])
+					{
+						seen[fullpaths.back()] = true;
+						next.push_back(fullpaths.back());
+					}
+				}
+
+				ret[file] = { imports, fullpaths };
+			}
+
+			// files that were already lexed get skipped.
+			frontend::lexFilesInParallel(next);
+			level = std::move(next);
+		}
 
-		// get the proper import of each 'import'
-		std::vector<std::string> fullpaths;
-		for(const auto& imp : imports)
+		return ret;
+	}
+
+	static void addDependencies(frontend::DependencyGraph* graph, const std::string& full,
+		util::hash_map<std::string, ImportList>& allImports, util::hash_map<std::string, bool>& visited)
+	{
+		const auto& [ imports, fullpaths ] = allImports[full];
+		for(size_t i = 0; i < imports.size(); i++)
 		{
-			auto tovisit = resolveImport(imp.name, imp.loc, full);
+			const auto& imp = imports[i];
+			const auto& tovisit = fullpaths[i];
+
 			graph->addModuleDependency(full, tovisit, imp);
 
 			if(!visited[tovisit])
 			{
 				visited[tovisit] = true;
-				buildDependencyGraph(graph, tovisit, visited);
+				addDependencies(graph, tovisit, allImports, visited);
 			}
 		}
+	}
+
+	frontend::DependencyGraph* buildDependencyGraph(frontend::DependencyGraph* graph, const std::string& full,
+		util::hash_map<std::string, bool>& visited)
+	{
+		// the graph still gets built depth-first, so the files end up in the same order as they always did.
+		auto allImports = findAllImports(full);
+		addDependencies(graph, full, allImports, visited);
 
 		return graph;
 	}
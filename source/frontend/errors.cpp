@@ -227,7 +227,10 @@ static std::string typestr(MsgType t)
 template <typename... Ts>
 static size_t strprinterrf(const char* fmt, Ts... ts)
 {
-	return static_cast<size_t>(fprintf(stderr, "%s", strprintf(fmt, ts...).c_str()));
+	auto s = strprintf(fmt, ts...);
+	writeErrorOutput(s);
+
+	return s.size();
 }
 
 // template <typename... Ts>
@@ -476,8 +479,30 @@ void OverloadError::post()
 
 
 
+// only set on the worker threads of util::parallelFor.
+static thread_local std::string* errorOutputBuffer = 0;
+
+void writeErrorOutput(const std::string& s)
+{
+	if(errorOutputBuffer)   errorOutputBuffer->append(s);
+	else                    fputs(s.c_str(), stderr);
+}
+
+std::string* setErrorOutputBuffer(std::string* buf)
+{
+	auto old = errorOutputBuffer;
+	errorOutputBuffer = buf;
+
+	return old;
+}
+
 [[noreturn]] void doTheExit(bool trace)
 {
+	// exiting from a worker thread would pull everything out from under the other ones, so just stop this one;
+	// the thread that started it prints what we wrote and exits once everybody is done.
+	if(errorOutputBuffer)
+		throw WorkerExit();
+
 	fprintf(stderr, "\nthere were errors, compilation cannot continue\n");
 
 	if(frontend::getAbortOnError()) abort();
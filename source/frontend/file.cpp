@@ -2,61 +2,74 @@
 // Copyright (c) 2014 - 2017, zhiayang
 // Licensed under the Apache License Version 2.0.
 
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <fstream>
 #include <unordered_map>
 
 #include <fcntl.h>
+#include <string.h>
 #include <assert.h>
 #include <sys/stat.h>
 
 #include "lexer.h"
 #include "errors.h"
 #include "frontend.h"
+#include "parallel.h"
 
 namespace frontend
 {
+	// lexing happens on several threads, and reporting an error from any of them comes back here to get
+	// the lines of the file. the map only hands out references, and unordered_map doesn't move its values
+	// around, so we only need to hold the lock while we're looking things up or adding them.
+	static std::mutex fileListLock;
 	static util::hash_map<std::string, FileInnards> fileList;
 
 
+	// for -profile. lexing happens on several threads, so the time is the total across all of them.
+	static std::atomic<size_t> lexedBytes = 0;
+	static std::atomic<size_t> lexingNanos = 0;
+
 	static void getRawLines(const std::string_view& fileContents, bool* crlf, util::FastInsertVector<std::string_view>* rawlines)
 	{
-		std::string_view view = fileContents;
+		auto start = std::chrono::high_resolution_clock::now();
 
-		bool first = true;
-		while(true)
-		{
-			size_t ln = 0;
+		const char* begin = fileContents.data();
+		const char* end = begin + fileContents.size();
 
-			if(first || *crlf)
-			{
-				ln = view.find("\r\n");
-				if(ln != std::string_view::npos && first)
-					*crlf = true;
-			}
+		// the first line decides whether the whole file uses \r\n.
+		if(auto nl = static_cast<const char*>(memchr(begin, '\n', fileContents.size())); nl)
+			*crlf = (nl > begin && nl[-1] == '\r');
 
-			if((!first && !*crlf) || (first && !*crlf && ln == std::string_view::npos))
-				ln = view.find('\n');
+		const char* line = begin;
+		const char* cur = begin;
+		while(cur < end)
+		{
+			auto nl = static_cast<const char*>(memchr(cur, '\n', static_cast<size_t>(end - cur)));
+			if(!nl)
+				break;
 
-			first = false;
+			cur = nl + 1;
 
-			if(ln != std::string_view::npos)
-			{
-				new (rawlines->getNextSlotAndIncrement()) std::string_view(view.data(), ln + (*crlf ? 2 : 1));
-				view.remove_prefix(ln + (*crlf ? 2 : 1));
-			}
-			else
-			{
-				break;
-			}
+			// in a crlf file, a \n on its own doesn't end the line.
+			if(*crlf && (nl == line || nl[-1] != '\r'))
+				continue;
+
+			new (rawlines->getNextSlotAndIncrement()) std::string_view(line, static_cast<size_t>(cur - line));
+			line = cur;
 		}
 
 		// account for the case when there's no trailing newline, and we still have some stuff stuck in the view.
-		if(!view.empty())
+		if(line < end)
 		{
-			new (rawlines->getNextSlotAndIncrement()) std::string_view(view.data(), view.length());
+			new (rawlines->getNextSlotAndIncrement()) std::string_view(line, static_cast<size_t>(end - line));
 		}
+
+		lexingNanos += static_cast<size_t>((std::chrono::high_resolution_clock::now() - start).count());
 	}
 
 	static void tokenise(lexer::TokenList* ts, bool crlf, const std::string_view& fileContents,
@@ -111,10 +124,20 @@ namespace frontend
 
 	static void lex(FileInnards* innards, bool crlf, Location* pos)
 	{
+		auto start = std::chrono::high_resolution_clock::now();
+
 		lexer::TokenList& ts = innards->tokens;
 		tokenise(&ts, crlf, innards->fileContents, innards->lines, pos, &innards->importIndices);
 
 		innards->didLex = true;
+
+		lexedBytes += innards->fileContents.size();
+		lexingNanos += static_cast<size_t>((std::chrono::high_resolution_clock::now() - start).count());
+	}
+
+	std::pair<size_t, double> getLexerStats()
+	{
+		return { lexedBytes.load(), static_cast<double>(lexingNanos.load()) / 1000.0 / 1000.0 };
 	}
 
 	FileInnards lexTokensFromString(const std::string& fakename, const std::string_view& fileContents)
@@ -142,6 +165,8 @@ namespace frontend
 	{
 		// break early if we can
 		{
+			std::lock_guard<std::mutex> lk(fileListLock);
+
 			auto it = fileList.find(fullPath);
 			if(it != fileList.end())
 				return it->second;
@@ -156,16 +181,63 @@ namespace frontend
 		getRawLines(fileContents, &crlf, &rawlines);
 
 		Location pos;
-		FileInnards& innards = fileList[fullPath];
+		pos.fileID = getFileIDFromFilename(fullPath);
+
+		FileInnards* innards = 0;
 		{
-			pos.fileID = getFileIDFromFilename(fullPath);
+			std::lock_guard<std::mutex> lk(fileListLock);
 
-			innards.fileContents = fileContents;
-			innards.lines = std::move(rawlines);
+			innards = &fileList[fullPath];
+			innards->fileContents = fileContents;
+			innards->lines = std::move(rawlines);
 		}
 
-		lex(&innards, crlf, &pos);
-		return innards;
+		lex(innards, crlf, &pos);
+		return *innards;
+	}
+
+	void lexFilesInParallel(const std::vector<std::string>& fullPaths)
+	{
+		struct work_t
+		{
+			FileInnards* innards = 0;
+			bool crlf = false;
+			Location pos;
+		};
+
+		// reading the file and handing out its id both touch global state, so do that first, here. the
+		// lines have to be in place before we start lexing, since that's what errors use to show the source.
+		std::vector<work_t> work;
+		for(const auto& path : fullPaths)
+		{
+			{
+				std::lock_guard<std::mutex> lk(fileListLock);
+				if(fileList.find(path) != fileList.end())
+					continue;
+			}
+
+			work_t w;
+			w.pos.fileID = getFileIDFromFilename(path);
+
+			std::string_view fileContents = platform::readEntireFile(path);
+
+			util::FastInsertVector<std::string_view> rawlines;
+			getRawLines(fileContents, &w.crlf, &rawlines);
+
+			{
+				std::lock_guard<std::mutex> lk(fileListLock);
+
+				w.innards = &fileList[path];
+				w.innards->fileContents = fileContents;
+				w.innards->lines = std::move(rawlines);
+			}
+
+			work.push_back(w);
+		}
+
+		util::parallelFor(work.size(), [&work](size_t i) {
+			lex(work[i].innards, work[i].crlf, &work[i].pos);
+		});
 	}
 
 	FileInnards& getFileState(const std::string& name)
@@ -184,24 +256,31 @@ namespace frontend
 	}
 
 
-	static std::vector<std::string> fileNames { "null" };
+	// a deque, so the references we give out stay put when somebody else adds a name.
+	static std::mutex fileNamesLock;
+	static std::deque<std::string> fileNames { "null" };
 	static util::hash_map<std::string, size_t> existingNames;
 	void cachePreExistingFilename(const std::string& name)
 	{
+		std::lock_guard<std::mutex> lk(fileNamesLock);
 		fileNames.push_back(name);
 	}
 
 	const std::string& getFilenameFromID(size_t fileID)
 	{
+		std::lock_guard<std::mutex> lk(fileNamesLock);
+
 		iceAssert(fileID > 0 && fileID < fileNames.size());
 		return fileNames[fileID];
 	}
 
 	size_t getFileIDFromFilename(const std::string& name)
 	{
-		if(existingNames.find(name) != existingNames.end())
+		std::lock_guard<std::mutex> lk(fileNamesLock);
+
+		if(auto it = existingNames.find(name); it != existingNames.end())
 		{
-			return existingNames[name];
+			return it->second;
 		}
 		else
 		{
@@ -219,6 +298,7 @@ namespace frontend
 
 	const std::vector<size_t>& getImportTokenLocationsForFile(const std::string& filename)
 	{
+		std::lock_guard<std::mutex> lk(fileListLock);
 		return fileList[filename].importIndices;
 	}
 
@@ -2,6 +2,9 @@
 // Copyright (c) 2014 - 2015, zhiayang
 // Licensed under the Apache License Version 2.0.
 
+#include <mutex>
+#include <array>
+
 #include "lexer.h"
 #include "errors.h"
 
@@ -46,8 +49,9 @@ namespace lexer
 
 
 
-	static TokenType prevType = TokenType::Invalid;
-	static size_t prevID = 0;
+	// files get lexed on more than one thread, so each one needs its own idea of the previous token.
+	static thread_local TokenType prevType = TokenType::Invalid;
+	static thread_local size_t prevID = 0;
 	static bool shouldConsiderUnaryLiteral(string_view& stream, Location& pos)
 	{
 		// check the previous token
@@ -77,10 +81,11 @@ namespace lexer
 	}
 
 
+	static std::once_flag keywordMapFlag;
 	static util::hash_map<std::string_view, TokenType> keywordMap;
+	static size_t maxKeywordLength = 0;
 	static void initKeywordMap()
 	{
-		if(keywordMap.size() > 0) return;
 
 		keywordMap["as"]        = TokenType::As;
 		keywordMap["do"]        = TokenType::Do;
@@ -126,6 +131,178 @@ namespace lexer
 		keywordMap["extension"] = TokenType::Extension;
 		keywordMap["namespace"] = TokenType::Namespace;
 		keywordMap["ffi"]       = TokenType::ForeignFunc;
+
+		for(const auto& [ kw, _ ] : keywordMap)
+			maxKeywordLength = std::max(maxKeywordLength, kw.size());
+	}
+
+
+
+	// what each byte can be the start (or part) of. anything with the top bit set isn't ascii, and goes through utf8rewind.
+	enum CharClass : uint8_t
+	{
+		CC_None         = 0x00,
+		CC_Ident        = 0x01,
+		CC_IdentStart   = 0x02,
+		CC_Digit        = 0x04,
+	};
+
+	static constexpr std::array<uint8_t, 256> makeCharClasses()
+	{
+		std::array<uint8_t, 256> ret = { };
+		for(int c = 'a'; c <= 'z'; c++) ret[c] = CC_Ident | CC_IdentStart;
+		for(int c = 'A'; c <= 'Z'; c++) ret[c] = CC_Ident | CC_IdentStart;
+		for(int c = '0'; c <= '9'; c++) ret[c] = CC_Ident | CC_Digit;
+
+		ret['_'] = CC_Ident | CC_IdentStart;
+		return ret;
+	}
+
+	static constexpr std::array<TokenType, 128> makeSingleCharTokens()
+	{
+		std::array<TokenType, 128> ret = { };
+
+		ret['\n'] = TokenType::NewLine;
+		ret['{']  = TokenType::LBrace;
+		ret['}']  = TokenType::RBrace;
+		ret['(']  = TokenType::LParen;
+		ret[')']  = TokenType::RParen;
+		ret['[']  = TokenType::LSquare;
+		ret[']']  = TokenType::RSquare;
+		ret['<']  = TokenType::LAngle;
+		ret['>']  = TokenType::RAngle;
+		ret['+']  = TokenType::Plus;
+		ret['-']  = TokenType::Minus;
+		ret['*']  = TokenType::Asterisk;
+		ret['/']  = TokenType::Divide;
+		ret['\''] = TokenType::SQuote;
+		ret['.']  = TokenType::Period;
+		ret[',']  = TokenType::Comma;
+		ret[':']  = TokenType::Colon;
+		ret['=']  = TokenType::Equal;
+		ret['?']  = TokenType::Question;
+		ret['!']  = TokenType::Exclamation;
+		ret[';']  = TokenType::Semicolon;
+		ret['&']  = TokenType::Ampersand;
+		ret['%']  = TokenType::Percent;
+		ret['|']  = TokenType::Pipe;
+		ret['@']  = TokenType::At;
+		ret['#']  = TokenType::Pound;
+		ret['~']  = TokenType::Tilde;
+		ret['^']  = TokenType::Caret;
+		ret['$']  = TokenType::Dollar;
+
+		return ret;
+	}
+
+	static constexpr auto charClasses = makeCharClasses();
+	static constexpr auto singleCharTokens = makeSingleCharTokens();
+
+	static bool isClass(char c, uint8_t cls)
+	{
+		return charClasses[static_cast<uint8_t>(c)] & cls;
+	}
+
+
+	struct CompoundToken
+	{
+		std::string_view text;
+		TokenType type;
+	};
+
+	// the tokens that are more than one byte, by their first byte. the first one that matches wins, so if one of
+	// them is a prefix of another, it has to come later.
+	static const std::array<std::vector<CompoundToken>, 256>& getCompoundTokens()
+	{
+		static const auto table = []() -> auto {
+			std::array<std::vector<CompoundToken>, 256> ret;
+			auto add = [&ret](std::string_view text, TokenType type) {
+				ret[static_cast<uint8_t>(text[0])].push_back(CompoundToken { text, type });
+			};
+
+			// '<=' is always less-than-equals, so there's no way to get a FatLeftArrow.
+			add("==",   TokenType::EqualsTo);
+			add("=>",   TokenType::FatRightArrow);
+			add(">=",   TokenType::GreaterEquals);
+			add("<=",   TokenType::LessThanEquals);
+			add("<-",   TokenType::LeftArrow);
+			add("!=",   TokenType::NotEquals);
+			add("||",   TokenType::LogicalOr);
+			add("|=",   TokenType::PipeEq);
+			add("&&",   TokenType::LogicalAnd);
+			add("&=",   TokenType::AmpersandEq);
+			add("->",   TokenType::RightArrow);
+			add("--",   TokenType::DoubleMinus);
+			add("-=",   TokenType::MinusEq);
+			add("++",   TokenType::DoublePlus);
+			add("+=",   TokenType::PlusEq);
+			add("*=",   TokenType::MultiplyEq);
+			add("/=",   TokenType::DivideEq);
+			add("%=",   TokenType::ModEq);
+			add("^=",   TokenType::CaretEq);
+			add("::",   TokenType::DoubleColon);
+			add("...",  TokenType::Ellipsis);
+			add("..<",  TokenType::HalfOpenEllipsis);
+
+			add("@nomangle",    TokenType::Attr_NoMangle);
+			add("@entry",       TokenType::Attr_EntryFn);
+			add("@packed",      TokenType::Attr_Packed);
+			add("@raw",         TokenType::Attr_Raw);
+			add("@operator",    TokenType::Attr_Operator);
+			add("@platform",    TokenType::Attr_Platform);
+
+			add("#if",  TokenType::Directive_If);
+			add("#run", TokenType::Directive_Run);
+
+			// these are one character wide, but more than one byte.
+			add("ƒ",    TokenType::Func);
+			add("ﬁ",    TokenType::ForeignFunc);
+			add("÷",    TokenType::Divide);
+			add("≠",    TokenType::NotEquals);
+			add("≤",    TokenType::LessThanEquals);
+			add("≥",    TokenType::GreaterEquals);
+
+			return ret;
+		}();
+
+		return table;
+	}
+
+	static const CompoundToken* matchCompoundToken(const string_view& stream)
+	{
+		for(const auto& ct : getCompoundTokens()[static_cast<uint8_t>(stream[0])])
+		{
+			if(stream.size() >= ct.text.size() && stream.compare(0, ct.text.size(), ct.text) == 0)
+				return &ct;
+		}
+
+		return 0;
+	}
+
+	// returns the length in bytes, and the number of codepoints in *width (which we assume are one column each).
+	static size_t getIdentifierLength(const string_view& stream, size_t* width)
+	{
+		size_t len = 0;
+		while(len < stream.size() && isClass(stream[len], CC_Ident))
+			len++;
+
+		// only bother with utf8rewind if there's something that isn't ascii.
+		if(len < stream.size() && static_cast<uint8_t>(stream[len]) >= 0x80)
+		{
+			len += utf8iscategory(stream.data() + len, stream.size() - len,
+				UTF8_CATEGORY_LETTER | UTF8_CATEGORY_PUNCTUATION_CONNECTOR | UTF8_CATEGORY_NUMBER);
+
+			// continuation bytes look like 10xxxxxx.
+			*width = std::count_if(stream.begin(), stream.begin() + len, [](char c) -> bool {
+				return (static_cast<uint8_t>(c) & 0xC0) != 0x80;
+			});
+		}
+		else
+		{
+			*width = len;
+		}
+
+		return len;
 	}
 
 
@@ -163,7 +340,9 @@ namespace lexer
 		tok.loc = pos;
 		tok.type = TokenType::Invalid;
 
-		// check compound symbols first.
+		auto first = static_cast<uint8_t>(stream[0]);
+
+		// comments first, since they start with the same thing as '/='.
 		if(hasPrefix(stream, "//"))
 		{
 			tok.type = TokenType::Comment;
@@ -179,144 +358,6 @@ namespace lexer
 			flag = false;
 			tok.text = "";
 		}
-		else if(hasPrefix(stream, "=="))
-		{
-			tok.type = TokenType::EqualsTo;
-			tok.text = "==";
-			read = 2;
-		}
-		else if(hasPrefix(stream, ">="))
-		{
-			tok.type = TokenType::GreaterEquals;
-			tok.text = ">=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "<="))
-		{
-			tok.type = TokenType::LessThanEquals;
-			tok.text = "<=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "!="))
-		{
-			tok.type = TokenType::NotEquals;
-			tok.text = "!=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "||"))
-		{
-			tok.type = TokenType::LogicalOr;
-			tok.text = "||";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "&&"))
-		{
-			tok.type = TokenType::LogicalAnd;
-			tok.text = "&&";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "<-"))
-		{
-			tok.type = TokenType::LeftArrow;
-			tok.text = "<-";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "->"))
-		{
-			tok.type = TokenType::RightArrow;
-			tok.text = "->";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "<="))
-		{
-			tok.type = TokenType::FatLeftArrow;
-			tok.text = "<=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "=>"))
-		{
-			tok.type = TokenType::FatRightArrow;
-			tok.text = "=>";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "++"))
-		{
-			tok.type = TokenType::DoublePlus;
-			tok.text = "++";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "--"))
-		{
-			tok.type = TokenType::DoubleMinus;
-			tok.text = "--";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "+="))
-		{
-			tok.type = TokenType::PlusEq;
-			tok.text = "+=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "-="))
-		{
-			tok.type = TokenType::MinusEq;
-			tok.text = "-=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "*="))
-		{
-			tok.type = TokenType::MultiplyEq;
-			tok.text = "*=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "/="))
-		{
-			tok.type = TokenType::DivideEq;
-			tok.text = "/=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "%="))
-		{
-			tok.type = TokenType::ModEq;
-			tok.text = "%=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "&="))
-		{
-			tok.type = TokenType::AmpersandEq;
-			tok.text = "&=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "|="))
-		{
-			tok.type = TokenType::PipeEq;
-			tok.text = "|=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "^="))
-		{
-			tok.type = TokenType::CaretEq;
-			tok.text = "^=";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "::"))
-		{
-			tok.type = TokenType::DoubleColon;
-			tok.text = "::";
-			read = 2;
-		}
-		else if(hasPrefix(stream, "..."))
-		{
-			tok.type = TokenType::Ellipsis;
-			tok.text = "...";
-			read = 3;
-		}
-		else if(hasPrefix(stream, "..<"))
-		{
-			tok.type = TokenType::HalfOpenEllipsis;
-			tok.text = "..<";
-			read = 3;
-		}
 		else if(hasPrefix(stream, "/*"))
 		{
 			int currentNest = 1;
@@ -382,113 +423,16 @@ namespace lexer
 		{
 			error(tok.loc, "unexpected '*/'");
 		}
-
-
-
-		// attrs
-		else if(hasPrefix(stream, "@nomangle"))
-		{
-			tok.type = TokenType::Attr_NoMangle;
-			tok.text = "@nomangle";
-			read = 9;
-		}
-		else if(hasPrefix(stream, "@entry"))
-		{
-			tok.type = TokenType::Attr_EntryFn;
-			tok.text = "@entry";
-			read = 6;
-		}
-		else if(hasPrefix(stream, "@packed"))
-		{
-			tok.type = TokenType::Attr_Packed;
-			tok.text = "@packed";
-			read = 7;
-		}
-		else if(hasPrefix(stream, "@raw"))
-		{
-			tok.type = TokenType::Attr_Raw;
-			tok.text = "@raw";
-			read = 4;
-		}
-		else if(hasPrefix(stream, "@operator"))
-		{
-			tok.type = TokenType::Attr_Operator;
-			tok.text = "@operator";
-			read = 9;
-		}
-		else if(hasPrefix(stream, "@platform"))
-		{
-			tok.type = TokenType::Attr_Platform;
-			tok.text = "@platform";
-			read = 9;
-		}
-
-		// directives
-		else if(hasPrefix(stream, "#if"))
-		{
-			tok.type = TokenType::Directive_If;
-			tok.text = "#if";
-			read = 3;
-		}
-		else if(hasPrefix(stream, "#run"))
-		{
-			tok.type = TokenType::Directive_Run;
-			tok.text = "#run";
-			read = 4;
-		}
-
-
-		// unicode stuff
-		else if(hasPrefix(stream, "ƒ"))
-		{
-			tok.type = TokenType::Func;
-			read = std::string("ƒ").length();
-			tok.text = "ƒ";
-
-			unicodeLength = 1;
-		}
-		else if(hasPrefix(stream, "ﬁ"))
-		{
-			tok.type = TokenType::ForeignFunc;
-			read = std::string("ﬁ").length();
-			tok.text = "ﬁ";
-
-			unicodeLength = 1;
-		}
-		else if(hasPrefix(stream, "÷"))
-		{
-			tok.type = TokenType::Divide;
-			read = std::string("÷").length();
-			tok.text = "÷";
-
-			unicodeLength = 1;
-		}
-		else if(hasPrefix(stream, "≠"))
+		else if(auto ct = matchCompoundToken(stream); ct)
 		{
-			tok.type = TokenType::NotEquals;
-			read = std::string("≠").length();
-			tok.text = "≠";
+			tok.type = ct->type;
+			tok.text = stream.substr(0, ct->text.size());
+			read = ct->text.size();
 
-			unicodeLength = 1;
-		}
-		else if(hasPrefix(stream, "≤"))
-		{
-			tok.type = TokenType::LessThanEquals;
-			read = std::string("≤").length();
-			tok.text = "≤";
-
-			unicodeLength = 1;
-		}
-		else if(hasPrefix(stream, "≥"))
-		{
-			tok.type = TokenType::GreaterEquals;
-			read = std::string("≥").length();
-			tok.text = "≥";
-
-			unicodeLength = 1;
+			if(first >= 0x80)
+				unicodeLength = 1;
 		}
-
-		else if(hasPrefix(stream, "'") && stream.size() > 2)
+		else if(first == '\'' && stream.size() > 2)
 		{
 			tok.type = TokenType::CharacterLiteral;
 
@@ -524,11 +468,8 @@ namespace lexer
 		// cases where we want binary:
 		// ...) + 3   |   ...] + 3   |   ident + 3   |   number + 3   |   string + 3
 		// so in every other case we want unary +/-.
-		// note: a sane implementation would just return false if isdigit() was passed something weird, like a negative number
-		// (because we tried to dissect a UTF-8 codepoint). so we just check if it's ascii first, which would solve the issue.
-		else if((!stream.empty() && ((isascii(stream[0]) && isdigit(stream[0])) || shouldConsiderUnaryLiteral(stream, pos)))
-			/* handle cases like '+ 3' or '- 14' (ie. space between sign and number) */
-			&& ((isascii(stream[0]) && isdigit(stream[0]) ? true : false) || (stream.size() > 1 && isascii(stream[1]) && isdigit(stream[1]))))
+		// note: the table only has ascii digits, so we don't need to worry about isdigit() getting half a codepoint.
+		else if(isClass(stream[0], CC_Digit) || (stream.size() > 1 && isClass(stream[1], CC_Digit) && shouldConsiderUnaryLiteral(stream, pos)))
 		{
 			// copy it.
 			auto tmp = stream;
@@ -560,8 +501,13 @@ namespace lexer
 				if(base != 10)
 					error("exponential form is supported with neither hexadecimal nor binary literals");
 
+				// the exponent can have a sign, as long as there's a number after it (otherwise '1e-x' is '1e - x').
+				auto start = tmp.begin() + 1;
+				if(tmp.size() > 2 && (tmp[1] == '-' || tmp[1] == '+') && isdigit(tmp[2]))
+					start++;
+
 				// find that shit
-				auto next = std::find_if_not(tmp.begin() + 1, tmp.end(), isdigit);
+				auto next = std::find_if_not(start, tmp.end(), isdigit);
 
 				// this does the 'e' as well.
 				tmp.remove_prefix(next - tmp.begin());
@@ -611,28 +557,19 @@ namespace lexer
 
 			read = didRead;
 		}
-		else if(!stream.empty() && (stream[0] == '_'  || utf8iscategory(stream.data(), stream.size(), UTF8_CATEGORY_LETTER) > 0))
+		else if(isClass(stream[0], CC_IdentStart) || (first >= 0x80 && utf8iscategory(stream.data(), stream.size(), UTF8_CATEGORY_LETTER) > 0))
 		{
-			// get as many letters as possible first
-			size_t identLength = utf8iscategory(stream.data(), stream.size(),
-				UTF8_CATEGORY_LETTER | UTF8_CATEGORY_PUNCTUATION_CONNECTOR | UTF8_CATEGORY_NUMBER);
-
-			read = identLength;
-			tok.text = stream.substr(0, identLength);
+			read = getIdentifierLength(stream, &unicodeLength);
+			tok.text = stream.substr(0, read);
 
-			initKeywordMap();
-			if(auto it = keywordMap.find(tok.text); it != keywordMap.end())
+			std::call_once(keywordMapFlag, initKeywordMap);
+			if(auto it = (tok.text.size() <= maxKeywordLength ? keywordMap.find(tok.text) : keywordMap.end()); it != keywordMap.end())
 				tok.type = it->second;
 
 			else
 				tok.type = TokenType::Identifier;
-
-			// again, assume that one codepoint is 1 character wide?
-			// note: we convert to std::string because I believe utf8len expects null-term strings, but
-			// tok.text is a string_view.
-			unicodeLength = utf8len(std::string(tok.text).c_str());
 		}
-		else if(!stream.empty() && stream[0] == '"')
+		else if(first == '"')
 		{
 			// string literal
 			// because we want to avoid using std::string (ie. copying) in the lexer (Token), we must send the string over verbatim.
@@ -729,72 +666,34 @@ namespace lexer
 			tok.type = TokenType::NewLine;
 			tok.text = "\n";
 		}
-		else if(!stream.empty())
+		else if(first < 0x80)
 		{
-			if(isascii(stream[0]))
-			{
-				// check the first char
-				switch(stream[0])
-				{
-					// for single-char things
-					case '\n':  tok.type = TokenType::NewLine;      break;
-					case '{':   tok.type = TokenType::LBrace;       break;
-					case '}':   tok.type = TokenType::RBrace;       break;
-					case '(':   tok.type = TokenType::LParen;       break;
-					case ')':   tok.type = TokenType::RParen;       break;
-					case '[':   tok.type = TokenType::LSquare;      break;
-					case ']':   tok.type = TokenType::RSquare;      break;
-					case '<':   tok.type = TokenType::LAngle;       break;
-					case '>':   tok.type = TokenType::RAngle;       break;
-					case '+':   tok.type = TokenType::Plus;         break;
-					case '-':   tok.type = TokenType::Minus;        break;
-					case '*':   tok.type = TokenType::Asterisk;     break;
-					case '/':   tok.type = TokenType::Divide;       break;
-					case '\'':  tok.type = TokenType::SQuote;       break;
-					case '.':   tok.type = TokenType::Period;       break;
-					case ',':   tok.type = TokenType::Comma;        break;
-					case ':':   tok.type = TokenType::Colon;        break;
-					case '=':   tok.type = TokenType::Equal;        break;
-					case '?':   tok.type = TokenType::Question;     break;
-					case '!':   tok.type = TokenType::Exclamation;  break;
-					case ';':   tok.type = TokenType::Semicolon;    break;
-					case '&':   tok.type = TokenType::Ampersand;    break;
-					case '%':   tok.type = TokenType::Percent;      break;
-					case '|':   tok.type = TokenType::Pipe;         break;
-					case '@':   tok.type = TokenType::At;           break;
-					case '#':   tok.type = TokenType::Pound;        break;
-					case '~':   tok.type = TokenType::Tilde;        break;
-					case '^':   tok.type = TokenType::Caret;        break;
-					case '$':   tok.type = TokenType::Dollar;       break;
+			tok.type = singleCharTokens[first];
+			if(tok.type == TokenType::Invalid)
+				error(tok.loc, "unknown token '%c'", stream[0]);
 
-					default:
-						error(tok.loc, "unknown token '%c'", stream[0]);
-				}
-
-				tok.text = stream.substr(0, 1);
-				// tok.loc.col += 1;
-				read = 1;
-			}
-			else if(utf8iscategory(stream.data(), stream.size(), UTF8_CATEGORY_SYMBOL_MATH | UTF8_CATEGORY_PUNCTUATION_OTHER) > 0)
-			{
-				read = utf8iscategory(stream.data(), stream.size(), UTF8_CATEGORY_SYMBOL_MATH | UTF8_CATEGORY_PUNCTUATION_OTHER);
+			tok.text = stream.substr(0, 1);
+			read = 1;
+		}
+		else if(utf8iscategory(stream.data(), stream.size(), UTF8_CATEGORY_SYMBOL_MATH | UTF8_CATEGORY_PUNCTUATION_OTHER) > 0)
+		{
+			read = utf8iscategory(stream.data(), stream.size(), UTF8_CATEGORY_SYMBOL_MATH | UTF8_CATEGORY_PUNCTUATION_OTHER);
 
-				tok.text = stream.substr(0, read);
-				tok.type = TokenType::UnicodeSymbol;
+			tok.text = stream.substr(0, read);
+			tok.type = TokenType::UnicodeSymbol;
 
-				// assume that everything is one character wide only!
-				unicodeLength = 1;
-			}
-			else
-			{
-				// one char wide, at least. not in bytes.
-				auto l = tok.loc; l.len = 1;
+			// assume that everything is one character wide only!
+			unicodeLength = 1;
+		}
+		else
+		{
+			// one char wide, at least. not in bytes.
+			auto l = tok.loc; l.len = 1;
 
-				// get the number of bytes of the next codepoint, by seeking +1 and subtracting the pointer.
-				auto cplen = utf8seek(stream.data(), stream.size(), stream.data(), 1, SEEK_SET) - stream.data();
+			// get the number of bytes of the next codepoint, by seeking +1 and subtracting the pointer.
+			auto cplen = utf8seek(stream.data(), stream.size(), stream.data(), 1, SEEK_SET) - stream.data();
 
-				error(l, "unknown token '%s'", stream.substr(0, cplen));
-			}
+			error(l, "unknown token '%s'", stream.substr(0, cplen));
 		}
 
 		stream.remove_prefix(read);
@@ -830,10 +729,3 @@ namespace lexer
 		return prevType;
 	}
 }
-
-
-
-
-
-
-
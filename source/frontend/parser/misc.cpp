@@ -277,8 +277,9 @@ namespace parser
 			if(sz <= 0)     expected(st.ploc(), "non-zero and non-negative size", num);
 			else if(sz < 8) error(st.ploc(), "types less than 8-bits wide are currently not supported");
 
+			// files are parsed in parallel, so the collector sets it once they're all done.
 			//? should we warn if it was already set?
-			st.cState->nativeWordSize = sz;
+			st.nativeWordSize = sz;
 
 			return 0;
 		}
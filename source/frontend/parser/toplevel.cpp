@@ -301,18 +301,16 @@ namespace parser
 		return root;
 	}
 
-	ParsedFile parseFile(const std::string& fullname, const frontend::FileInnards& file, frontend::CollectorState& cs)
+	ParsedFile parseFile(const std::string& fullname, const frontend::FileInnards& file, const CustomOperators& ops)
 	{
 		const TokenList& tokens = file.tokens;
 		auto state = State(tokens);
 		state.currentFilePath = fullname;
 
 		// copy this stuff over.
-		state.binaryOps = cs.binaryOps;
-		state.prefixOps = cs.prefixOps;
-		state.postfixOps = cs.postfixOps;
-
-		state.cState = &cs;
+		state.binaryOps = ops.binaryOps;
+		state.prefixOps = ops.prefixOps;
+		state.postfixOps = ops.postfixOps;
 
 		auto [ modname, modpath ] = parseModuleName(fullname, file);
 		auto toplevel = parseTopLevel(state, "");
@@ -323,6 +321,7 @@ namespace parser
 			modname,
 			modpath,
 			toplevel,
+			state.nativeWordSize,
 		};
 	}
 }
@@ -2,6 +2,8 @@
 // Copyright (c) 2014 - 2017, zhiayang
 // Licensed under the Apache License Version 2.0.
 
+#include <atomic>
+
 #include "pts.h"
 #include "parser_internal.h"
 
@@ -174,7 +176,7 @@ namespace parser
 
 	PResult<StructDefn> parseStruct(State& st, bool nameless)
 	{
-		static size_t anon_counter = 0;
+		static std::atomic<size_t> anon_counter = 0;
 
 		iceAssert(st.front() == TT::Struct);
 		st.eat();
@@ -313,7 +315,7 @@ namespace parser
 
 	UnionDefn* parseUnion(State& st, bool israw, bool nameless)
 	{
-		static size_t anon_counter = 0;
+		static std::atomic<size_t> anon_counter = 0;
 		iceAssert(st.front() == TT::Union);
 		st.eat();
 
@@ -121,11 +121,10 @@ namespace pts
 	}
 
 
-	static InferredType* it = 0;
 	InferredType* InferredType::get()
 	{
-		if(it) return it;
-		return (it = util::pool<InferredType>(Location()));
+		static InferredType* it = util::pool<InferredType>(Location());
+		return it;
 	}
 
 	NamedType* NamedType::create(const Location& l, const std::string& s)
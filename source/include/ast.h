@@ -87,6 +87,11 @@ namespace ast
 		std::vector<std::pair<std::string, TypeConstraints_t>> generics;
 		std::vector<std::pair<sst::Defn*, std::vector<TypeParamMap_t>>> genericVersions;
 
+		// indices into genericVersions, keyed by the hash of every suffix of their generic context stack.
+		// see checkForExistingDeclaration() for why it's the suffixes.
+		util::hash_map<size_t, std::vector<size_t>> genericVersionIndex;
+		void addGenericVersion(sst::Defn* defn, const std::vector<TypeParamMap_t>& gcs);
+
 		// kind of a hack.
 		std::unordered_set<sst::Defn*> finishedTypechecking;
 
@@ -61,10 +61,18 @@ namespace backend
 		LLVM,
 		Interpreter,
 		Assembly_x64,
+
+		// starts in the interpreter, moves hot functions to the llvm jit.
+		Tiered,
 	};
 
 	std::string capabilitiesToString(BackendCaps::Capabilities caps);
 
+	namespace x64
+	{
+		struct ObjectFile;
+	}
+
 	struct Backend
 	{
 		BackendCaps::Capabilities getCapabilities() { return static_cast<BackendCaps::Capabilities>(this->capabilities); }
@@ -95,13 +103,16 @@ namespace backend
 	struct x64Backend : Backend
 	{
 		x64Backend(CompiledData& dat, const std::vector<std::string>& inputs, const std::string& output);
-		virtual ~x64Backend() { }
+		virtual ~x64Backend();
 
 		virtual void performCompilation() override;
 		virtual void optimiseProgram() override;
 		virtual void writeOutput() override;
 
 		virtual std::string str() override;
+
+		private:
+		x64::ObjectFile* object = 0;
 	};
 }
 
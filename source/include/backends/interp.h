@@ -26,4 +26,25 @@ namespace backend
 		protected:
 			fir::interp::InterpState* is = 0;
 	};
+
+	struct LLVMJit;
+
+	// runs the program in the interpreter, but once a function gets hot (see InterpState::tierUp), it is
+	// compiled with llvm and called natively from then on.
+	struct FIRTieredBackend : FIRInterpBackend
+	{
+		FIRTieredBackend(CompiledData& dat, const std::vector<std::string>& inputs, const std::string& output);
+		virtual ~FIRTieredBackend();
+
+		virtual void performCompilation() override;
+		virtual void writeOutput() override;
+
+		virtual std::string str() override;
+
+		private:
+			void* compileFunction(fir::Function* fn);
+
+			LLVMJit* jit = 0;
+			bool addedModule = false;
+	};
 }
@@ -51,6 +51,8 @@
 
 #include "backend.h"
 
+#include <unordered_set>
+
 
 namespace llvm
 {
@@ -66,6 +68,19 @@ namespace backend
 {
 	using EntryPoint_t = int (*)(int, const char**);
 
+	// a slice of the program that gets translated into its own llvm module (with its own context), so that it can be
+	// optimised and emitted on its own thread. everything else in the program is only declared in that module.
+	struct CodegenUnit
+	{
+		size_t index = 0;
+		std::unordered_set<fir::Function*> functions;
+
+		bool contains(fir::Function* fn) const { return this->functions.find(fn) != this->functions.end(); }
+
+		// internal always-inline functions get a copy in every unit, instead of being exported from one of them.
+		static bool isReplicated(fir::Function* fn);
+	};
+
 	struct LLVMJit
 	{
 		using OptimiseFunction = std::function<std::unique_ptr<llvm::Module>(std::unique_ptr<llvm::Module>)>;
@@ -73,6 +88,7 @@ namespace backend
 		void addModule(std::unique_ptr<llvm::Module> mod);
 		llvm::JITEvaluatedSymbol findSymbol(const std::string& name);
 		llvm::JITTargetAddress getSymbolAddress(const std::string& name);
+		const llvm::DataLayout& getDataLayout() const { return this->DL; }
 
 		static LLVMJit* create();
 
@@ -106,16 +122,24 @@ namespace backend
 
 		static llvm::LLVMContext& getLLVMContext();
 
-		static llvm::Module* translateFIRtoLLVM(fir::Module* mod);
+		// if the unit is null, the whole module goes into one llvm module.
+		static llvm::Module* translateFIRtoLLVM(fir::Module* mod, const CodegenUnit* unit = 0);
 
 		private:
-		void setupTargetMachine();
+		llvm::TargetMachine* createTargetMachine();
 		EntryPoint_t getEntryFunctionFromJIT();
+		std::vector<llvm::Module*> getAllModules();
 
 		llvm::Function* entryFunction = 0;
 		llvm::TargetMachine* targetMachine = 0;
 		std::unique_ptr<llvm::Module> linkedModule;
 
+		// if codegen was split, linkedModule is the first unit, and these are the rest. the contexts need to outlive
+		// the modules, so they come first.
+		std::vector<std::unique_ptr<llvm::LLVMContext>> unitContexts;
+		std::vector<std::unique_ptr<llvm::Module>> unitModules;
+		std::vector<llvm::TargetMachine*> unitTargetMachines;
+
 		LLVMJit* jitInstance = 0;
 	};
 }
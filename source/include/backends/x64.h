@@ -0,0 +1,260 @@
+// x64.h
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#pragma once
+#include "backend.h"
+
+namespace fir
+{
+	struct Module;
+}
+
+namespace backend {
+namespace x64
+{
+	enum Reg : uint8_t
+	{
+		RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+		R8, R9, R10, R11, R12, R13, R14, R15,
+
+		// for memory operands, the address is relative to a symbol instead of a register.
+		RIP = 0xFF,
+	};
+
+	enum XReg : uint8_t
+	{
+		XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+		XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15,
+	};
+
+	// in the order of their encodings, so we can just add these to the base opcode.
+	enum class Cond : uint8_t
+	{
+		O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G
+	};
+
+	// the ones with the same /r encoding; see Assembler::alu().
+	enum class AluOp : uint8_t
+	{
+		Add = 0, Or = 1, And = 4, Sub = 5, Xor = 6, Cmp = 7
+	};
+
+	// the ones that take a single operand (F7 /n).
+	enum class UnaryOp : uint8_t
+	{
+		Not = 2, Neg = 3, Mul = 4, IMul = 5, Div = 6, IDiv = 7
+	};
+
+	enum class ShiftOp : uint8_t
+	{
+		Shl = 4, Shr = 5, Sar = 7
+	};
+
+	enum class SSEOp : uint8_t
+	{
+		Add = 0x58, Mul = 0x59, Sub = 0x5C, Div = 0x5E
+	};
+
+	// the relocations we use, with their ELF numbers.
+	enum class RelocKind : uint32_t
+	{
+		Abs64       = 1,    // R_X86_64_64
+		PC32        = 2,    // R_X86_64_PC32
+		PLT32       = 4,    // R_X86_64_PLT32
+		GOTPCREL    = 9,    // R_X86_64_GOTPCREL
+	};
+
+	struct Relocation
+	{
+		size_t offset;
+		size_t symbol;
+		RelocKind kind;
+		int64_t addend;
+	};
+
+	struct Section
+	{
+		std::string name;
+		uint32_t type = 0;
+		uint64_t flags = 0;
+		uint64_t alignment = 1;
+
+		std::vector<uint8_t> data;
+		std::vector<Relocation> relocations;
+
+		// the section symbol, which relocations to things without names (constants and such) go through.
+		size_t symbol = 0;
+
+		// pads to the alignment, and returns the offset there.
+		size_t align(size_t a);
+	};
+
+	struct Symbol
+	{
+		std::string name;
+
+		// 0 if the symbol is undefined.
+		Section* section = 0;
+		uint64_t value = 0;
+		uint64_t size = 0;
+
+		bool isLocal = false;
+		bool isWeak = false;
+		bool isFunction = false;
+		bool isSection = false;
+	};
+
+	// a relocatable ELF object, kept in memory until we write it out.
+	struct ObjectFile
+	{
+		ObjectFile();
+		~ObjectFile();
+
+		Section* text = 0;
+		Section* rodata = 0;
+		Section* data = 0;
+
+		std::vector<Symbol> symbols;
+
+		size_t addSymbol(const Symbol& sym);
+
+		// undefined symbols get made on first use.
+		size_t getExternalSymbol(const std::string& name, bool weak);
+
+		std::vector<uint8_t> serialise();
+
+		private:
+		std::vector<Section*> sections;
+		util::hash_map<std::string, size_t> externalSymbols;
+	};
+
+	struct Label
+	{
+		size_t id = 0;
+	};
+
+	// a memory operand: [base + disp], or [rip + symbol + disp] if the base is RIP.
+	struct Mem
+	{
+		Reg base = RBP;
+		int32_t disp = 0;
+
+		size_t symbol = 0;
+		RelocKind reloc = RelocKind::PC32;
+
+		Mem() { }
+		Mem(Reg b, int32_t d) : base(b), disp(d) { }
+
+		static Mem symbolic(size_t sym, int32_t d, RelocKind rk = RelocKind::PC32)
+		{
+			auto ret = Mem(RIP, d);
+			ret.symbol = sym;
+			ret.reloc = rk;
+
+			return ret;
+		}
+
+		Mem offset(int32_t ofs) const
+		{
+			auto ret = *this;
+			ret.disp += ofs;
+
+			return ret;
+		}
+	};
+
+	// writes machine code into the text section of an object. all memory operands use a 32-bit displacement,
+	// which wastes a few bytes but means we never have to think about which encoding to use.
+	struct Assembler
+	{
+		Assembler(ObjectFile* obj) : obj(obj), code(obj->text->data) { }
+
+		size_t position() { return this->code.size(); }
+
+		Label newLabel();
+		void bind(Label l);
+
+		// fixes up the jumps to labels; must be called before the labels are reused (ie. at the end of every function).
+		void resolveLabels();
+
+		void movRR(Reg dst, Reg src);
+		void movRI(Reg dst, int64_t imm);
+
+		// loads of less than 8 bytes are either sign- or zero-extended to 64 bits.
+		void load(Reg dst, const Mem& m, size_t size, bool sext);
+		void store(const Mem& m, Reg src, size_t size);
+		void storeImm(const Mem& m, int32_t imm, size_t size);
+		void lea(Reg dst, const Mem& m);
+
+		void alu(AluOp op, Reg dst, Reg src);
+		void aluImm(AluOp op, Reg dst, int32_t imm);
+		void imul(Reg dst, Reg src);
+		void unary(UnaryOp op, Reg r);
+		void shift(ShiftOp op, Reg r);    // by cl
+		void shiftImm(ShiftOp op, Reg r, uint8_t imm);
+		void test(Reg a, Reg b);
+		void cqo();
+		void bsr(Reg dst, Reg src);
+
+		void setcc(Cond c, Reg dst);     // sets the low byte only
+		void movzx8(Reg dst, Reg src);
+		void movsx8(Reg dst, Reg src);
+
+		void jmp(Label l);
+		void jcc(Cond c, Label l);
+		void call(size_t symbol);
+		void callR(Reg r);
+
+		void push(Reg r);
+		void pop(Reg r);
+		void leave();
+		void ret();
+		void ud2();
+
+		// returns the offset of the immediate, so it can be patched once we know how big the frame is.
+		size_t subRspImm32();
+		void patch32(size_t ofs, uint32_t val);
+
+		void repMovsb();
+		void repStosb();
+
+		void sseLoad(XReg dst, const Mem& m, bool dbl);
+		void sseStore(const Mem& m, XReg src, bool dbl);
+		void sseOp(SSEOp op, XReg dst, XReg src, bool dbl);
+		void ucomis(XReg a, XReg b, bool dbl);
+		void cvtsi2s(XReg dst, Reg src, bool dbl);
+		void cvtts2si(Reg dst, XReg src, bool dbl);
+		void cvtss2sd(XReg dst, XReg src);
+		void cvtsd2ss(XReg dst, XReg src);
+
+		// x87, only for fmod.
+		void fld(const Mem& m, bool dbl);
+		void fstp(const Mem& m, bool dbl);
+		void fprem();
+		void fstpST1();
+		void fnstswAX();
+
+		void raw(std::initializer_list<uint8_t> bytes);
+
+		private:
+		void emitRex(bool w, int reg, int base, bool force);
+		void emitMem(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, int reg, const Mem& m, bool byteReg = false);
+		void emitRR(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, int reg, int rm, bool byteReg = false);
+
+		void u8(uint8_t x)      { this->code.push_back(x); }
+		void u32(uint32_t x);
+		void u64(uint64_t x);
+
+		ObjectFile* obj = 0;
+		std::vector<uint8_t>& code;
+
+		// for each label, where it ended up (or -1 if it hasn't been bound), and the places that jump to it.
+		std::vector<int64_t> labels;
+		std::vector<std::pair<size_t, size_t>> fixups;
+	};
+
+	// turns every function in the module into machine code, and the globals into data.
+	ObjectFile* compileModule(fir::Module* mod);
+}
+}
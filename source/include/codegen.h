@@ -84,7 +84,9 @@ namespace cgn
 
 		util::hash_map<fir::Function*, fir::Type*> methodList;
 
-		util::hash_map<fir::Type*, sst::TypeDefn*> typeDefnMap;
+		// this belongs to whoever set us up (usually the definition tree), so the repl doesn't need to copy it over
+		// for every line.
+		util::hash_map<fir::Type*, sst::TypeDefn*>* typeDefnMap = 0;
 		util::hash_map<std::string, sst::Defn*> compilerSupportDefinitions;
 
 
@@ -160,6 +162,12 @@ namespace cgn
 		// where each piece probably corresponds to the initialisation of a single global value.
 		std::vector<std::pair<fir::GlobalValue*, fir::Function*>> globalInitPieces;
 
+		// the interpreter state for #run directives. it lives until the module is done, so that functions and globals
+		// only need to be compiled (and initialised) once; 'globalInitPiecesRun' is how many of the pieces above
+		// it has run so far.
+		fir::interp::InterpState* interpState = 0;
+		size_t globalInitPiecesRun = 0;
+
 		bool isWithinGlobalInitFunction();
 		fir::IRBlock* enterGlobalInitFunction(fir::GlobalValue* val);
 		void leaveGlobalInitFunction(fir::IRBlock* restore);
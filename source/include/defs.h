@@ -50,11 +50,18 @@ namespace zpr
 
 [[noreturn]] void doTheExit(bool trace = true);
 
+// everything that errors (and warnings) print goes through here. on the worker threads of util::parallelFor it
+// goes into a buffer instead, and doTheExit() throws a WorkerExit rather than exiting; see parallel.h.
+void writeErrorOutput(const std::string& s);
+std::string* setErrorOutputBuffer(std::string* buf);
+
+struct WorkerExit { };
+
 template <typename... Ts>
 [[noreturn]] inline void _error_and_exit(const char* fmt, Ts&&... ts)
 {
 	// tinyformat::format(std::cerr, fmt, ts...);
-	fprintf(stderr, "%s\n", zpr::sprint(fmt, ts...).c_str());
+	writeErrorOutput(zpr::sprint(fmt, ts...) + "\n");
 	doTheExit();
 }
 namespace platform { void printStackTrace(); }
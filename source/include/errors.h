@@ -84,13 +84,13 @@ std::string __error_gen(const Location& loc, const char* msg, const char* type,
 
 #define ERROR_FUNCTION(name, type, attr, doexit)                                                                        \
 template <typename... Ts> [[attr]] void name (const char* fmt, Ts&&... ts)                                              \
-{ fputs(__error_gen(Location(), fmt, type, doexit, ts...).c_str(), stderr); if(doexit) doTheExit(false); }              \
+{ writeErrorOutput(__error_gen(Location(), fmt, type, doexit, ts...)); if(doexit) doTheExit(false); }                   \
 																														\
 template <typename... Ts> [[attr]] void name (Locatable* e, const char* fmt, Ts&&... ts)                                \
-{ fputs(__error_gen(e ? e->loc : Location(), fmt, type, doexit, ts...).c_str(), stderr); if(doexit) doTheExit(false); } \
+{ writeErrorOutput(__error_gen(e ? e->loc : Location(), fmt, type, doexit, ts...)); if(doexit) doTheExit(false); }      \
 																														\
 template <typename... Ts> [[attr]] void name (const Location& loc, const char* fmt, Ts&&... ts)                         \
-{ fputs(__error_gen(loc, fmt, type, doexit, ts...).c_str(), stderr); if(doexit) doTheExit(false); }
+{ writeErrorOutput(__error_gen(loc, fmt, type, doexit, ts...)); if(doexit) doTheExit(false); }
 
 
 
@@ -68,9 +68,7 @@ namespace frontend
 		std::map<std::string, parser::ParsedFile> parsed;
 		util::hash_map<std::string, sst::DefinitionTree*> dtrees;
 
-		util::hash_map<std::string, parser::CustomOperatorDecl> binaryOps;
-		util::hash_map<std::string, parser::CustomOperatorDecl> prefixOps;
-		util::hash_map<std::string, parser::CustomOperatorDecl> postfixOps;
+		parser::CustomOperators operators;
 
 		DependencyGraph* graph = 0;
 		std::string fullMainFile;
@@ -115,6 +113,10 @@ namespace frontend
 	const std::string& getFilenameFromID(size_t fileID);
 	size_t getFileIDFromFilename(const std::string& name);
 	lexer::TokenList& getFileTokens(const std::string& fullPath);
+	void lexFilesInParallel(const std::vector<std::string>& fullPaths);
+
+	// the number of bytes lexed so far, and how long it took (in ms, summed over all threads).
+	std::pair<size_t, double> getLexerStats();
 	const util::FastInsertVector<std::string_view>& getFileLines(size_t id);
 	const std::vector<size_t>& getImportTokenLocationsForFile(const std::string& filename);
 
@@ -27,9 +27,12 @@ namespace fir
 		Function* getParentFunction();
 
 		void setFunction(Function* fn);
-		void addInstruction(Instruction* inst);
 		void eraseFromParentFunction();
 
+		// these also set the instruction's parent block.
+		void addInstruction(Instruction* inst);
+		void addInstructionAtFront(Instruction* inst);
+
 		bool isTerminated();
 
 		std::vector<Instruction*>& getInstructions();
@@ -16,6 +16,41 @@ namespace fir
 	struct Value;
 	struct ConstantValue;
 
+	// the value of a number literal. almost all of them are integers that fit in 64 bits or plain doubles, so those
+	// are kept as they are, and only the ones that don't fit get an mpreal (which is a lot slower to make). the
+	// conversions behave like mpreal's: integers saturate, and unsigned ones clamp negative values to 0.
+	struct NumberValue
+	{
+		NumberValue() : sval(0) { }
+
+		static NumberValue ofSigned(int64_t x);
+		static NumberValue ofUnsigned(uint64_t x);
+		static NumberValue ofDouble(double x);
+		static NumberValue ofBig(const mpfr::mpreal& x);
+
+		bool isBig() const  { return this->kind == Kind::Big; }
+
+		int64_t toLLong() const;
+		uint64_t toULLong() const;
+		float toFloat() const;
+		double toDouble() const;
+
+		std::string str() const;
+
+		private:
+		enum class Kind { Signed, Unsigned, Double, Big };
+
+		Kind kind = Kind::Signed;
+		union {
+			int64_t sval;
+			uint64_t uval;
+			double dval;
+
+			// constants are never freed, and this is shared by every copy, so it isn't either.
+			const mpfr::mpreal* big;
+		};
+	};
+
 	// base class implicitly stores null
 	struct ConstantValue : Value
 	{
@@ -36,7 +71,7 @@ namespace fir
 	{
 		friend struct Module;
 
-		static ConstantNumber* get(ConstantNumberType* cnt, const mpfr::mpreal& n);
+		static ConstantNumber* get(ConstantNumberType* cnt, const NumberValue& n);
 
 		int8_t getInt8()        { return static_cast<int8_t>(this->number.toLLong()); }
 		int16_t getInt16()      { return static_cast<int16_t>(this->number.toLLong()); }
@@ -53,9 +88,9 @@ namespace fir
 		virtual std::string str() override;
 
 		protected:
-		ConstantNumber(ConstantNumberType* cnt, const mpfr::mpreal& n);
+		ConstantNumber(ConstantNumberType* cnt, const NumberValue& n);
 
-		mpfr::mpreal number;
+		NumberValue number;
 	};
 
 	struct ConstantBool : ConstantValue
@@ -147,6 +182,8 @@ namespace fir
 
 		static ConstantStruct* get(StructType* st, const std::vector<ConstantValue*>& members);
 
+		std::vector<ConstantValue*> getValues() { return this->members; }
+
 		virtual std::string str() override;
 
 		protected:
@@ -59,6 +59,13 @@ namespace fir
 		std::vector<IRBlock*>& getBlockList();
 		void deleteBody();
 
+		// bumped whenever the body changes: blocks or instructions added or removed, or operands changed. the
+		// interpreter uses it to tell if what it compiled is out of date. the methods on IRBlock, Instruction and
+		// IRBuilder do this themselves, but anything that edits getBlockList() or getInstructions() directly needs
+		// to call markModified().
+		size_t getModificationCount();
+		void markModified();
+
 		bool wasDeclaredWithBodyElsewhere();
 		void setHadBodyElsewhere();
 
@@ -68,6 +75,19 @@ namespace fir
 		bool isIntrinsicFunction();
 		void setIsIntrinsic();
 
+		// the glue that changes refcounts is marked, so the optimiser can pair them up. these take the value as
+		// their only argument, and either return nothing or return it back.
+		bool isRefCountIncrement();
+		bool isRefCountDecrement();
+		void setIsRefCountIncrement();
+		void setIsRefCountDecrement();
+
+		// so is the glue for bounds checks. these take (length, index, location), and abort unless 0 <= index < length;
+		// the inclusive one (for slicing and destructuring) allows index == length.
+		bool isBoundsCheck();
+		bool isInclusiveBoundsCheck();
+		void setIsBoundsCheck(bool inclusive);
+
 		// this is used so the function knows how much space it needs to reserve for
 		// allocas.
 		void addStackAllocation(Type* ty);
@@ -88,9 +108,15 @@ namespace fir
 		std::vector<IRBlock*> blocks;
 		std::vector<Type*> stackAllocs;
 
+		size_t modificationCount = 0;
+
 		bool alwaysInlined = false;
 		bool hadBodyElsewhere = false;
 		bool fnIsIntrinsicFunction = false;
+		bool refCountIncrement = false;
+		bool refCountDecrement = false;
+		bool boundsCheck = false;
+		bool inclusiveBoundsCheck = false;
 	};
 }
 
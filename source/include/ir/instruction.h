@@ -188,6 +188,24 @@ namespace fir
 		void clearValue();
 		bool hasSideEffects();
 
+		IRBlock* getParentBlock();
+
+		// 'operands' can be read directly, but changing them needs to go through here (or replaceUsesOf), so the
+		// use lists of the values stay correct.
+		void setOperand(size_t idx, Value* v);
+		virtual void replaceUsesOf(Value* from, Value* to) override;
+
+		// stops using all the operands. the instruction is useless afterwards, but it means we can throw away
+		// a bunch of instructions that use each other without worrying about the order.
+		void dropAllReferences();
+
+		// removes the instruction from its block and drops its operands; nothing can be using its result.
+		void eraseFromParent();
+
+		// puts the instruction (which must not already be in a block) just before or after 'pos', in pos's block.
+		void insertBefore(Instruction* pos);
+		void insertAfter(Instruction* pos);
+
 		// static Instruction* GetBinaryOpInstruction(Ast::ArithmeticOp ao, Value* lhs, Value* rhs);
 
 
@@ -197,6 +215,8 @@ namespace fir
 		bool sideEffects;
 		Value* realOutput;
 		std::vector<Value*> operands;
+
+		IRBlock* parentBlock = 0;
 	};
 }
 
@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <string>
+#include <functional>
 #include <unordered_map>
 
 namespace fir
@@ -20,6 +21,7 @@ namespace fir
 	struct Function;
 	struct GlobalValue;
 	struct ConstantValue;
+	struct FunctionType;
 
 	namespace interp
 	{
@@ -42,17 +44,58 @@ namespace fir
 			fir::GlobalValue* globalValTracker = 0;
 		};
 
+		// when a function is compiled, every fir::Value it refers to is resolved to one of these. arguments and the
+		// results of instructions live in registers (ie. a flat array of slots in the frame), constants are made once
+		// into a per-function pool, and globals are looked up in the InterpState (since they are (re)created by
+		// InterpState::initialise(), we cannot bake them into the function).
+		struct Operand
+		{
+			enum class Kind : uint32_t
+			{
+				None,
+				Register,
+				Constant,
+				Global,
+				Block,
+			};
+
+			Kind kind = Kind::None;
+			uint32_t index = 0;
+
+			fir::Value* value = 0;
+		};
+
+		struct InterpState;
+		struct FFICallInfo;
+
 		struct Instruction
 		{
 			size_t opcode;
 			fir::Value* result = 0;
 			std::vector<fir::Value*> args;
+
+			// the lowered forms of 'result' and 'args'. note that 'operands' does not necessarily correspond 1-to-1 with
+			// 'args' -- see compileInstruction() in fir/interp/compiler.cpp for the details.
+			size_t resultSlot = 0;
+			std::vector<interp::Operand> operands;
+
+			// filled in by decodeInstruction(). 'dispatch' selects the label in the interpreter loop (control flow
+			// gets its own, everything else goes through 'handler').
+			uint32_t dispatch = 0;
+			void (*handler)(InterpState* is, const interp::Instruction& inst) = 0;
 		};
 
+		void decodeInstruction(interp::Instruction* inst);
+
 		struct Block
 		{
 			fir::IRBlock* blk = 0;
 			std::vector<interp::Instruction> instructions;
+
+			// the phi nodes at the top of the block are all set at once, when we branch here; for each
+			// predecessor (by index), the values they get, in order.
+			size_t numPhis = 0;
+			std::vector<std::pair<size_t, std::vector<interp::Operand>>> phiIncoming;
 		};
 
 		struct Function
@@ -63,6 +106,52 @@ namespace fir
 			std::string extFuncName;
 			interp::Block* entryBlock = 0;
 			std::vector<interp::Block> blocks;
+
+			// the number of registers a frame of this function needs; the first N are the arguments.
+			size_t numSlots = 0;
+			std::vector<interp::Value> constants;
+
+			// for tiered execution: calls and loop back-edges seen so far, and the native code for this function
+			// once it has been promoted.
+			size_t hotness = 0;
+			bool cannotPromote = false;
+			void* nativeCode = 0;
+
+			// the InterpState::generation when we last made sure this is still up to date with func, and what
+			// func->getModificationCount() was when we compiled it.
+			size_t generation = 0;
+			size_t modificationCount = 0;
+		};
+
+		// the backing memory for the payloads of large values (and stack allocations) made while a function is
+		// running. it is a bump allocator: each frame remembers where the arena was when it was entered, and
+		// leaveFunction() rolls it back to that point. chunks are kept around to be reused.
+		struct ValueArena
+		{
+			struct Mark
+			{
+				size_t chunk = 0;
+				size_t offset = 0;
+				size_t used = 0;
+			};
+
+			ValueArena() { }
+			~ValueArena();
+
+			ValueArena(const ValueArena&) = delete;
+			ValueArena& operator = (const ValueArena&) = delete;
+
+			void* allocate(size_t sz);
+
+			Mark mark() const;
+			void release(const Mark& m);
+
+			// the number of bytes currently handed out.
+			size_t used = 0;
+
+			std::vector<std::pair<uint8_t*, size_t>> chunks;
+			size_t currentChunk = 0;
+			size_t currentOffset = 0;
 		};
 
 		struct InterpState
@@ -77,6 +166,7 @@ namespace fir
 			interp::Value runFunction(const interp::Function& fn, const std::vector<interp::Value>& args);
 
 			interp::Value makeValue(fir::Value* ty);
+			interp::Value makeConstant(fir::ConstantValue* c);
 
 			fir::ConstantValue* unwrapInterpValueIntoConstant(const interp::Value& val);
 
@@ -84,14 +174,15 @@ namespace fir
 			{
 				size_t currentInstrIndex = 0;
 				const interp::Block* currentBlock = 0;
-				const interp::Block* previousBlock = 0;
 				const interp::Function* currentFunction = 0;
 
-				std::vector<void*> stackAllocs;
+				// where the value arena was when we entered this frame.
+				ValueArena::Mark arenaMark;
 
-				fir::Value* callResultOutput = 0;
+				size_t callResultSlot = 0;
 
-				std::unordered_map<fir::Value*, interp::Value> values;
+				// indexed by the register numbers assigned in compileFunction().
+				std::vector<interp::Value> values;
 			};
 
 			// this is the executing state.
@@ -100,13 +191,51 @@ namespace fir
 			std::unordered_map<fir::Value*, std::pair<interp::Value, bool>> globals;
 			std::vector<void*> globalAllocs;
 
+			// how many of the module's globals (and strings) we've set up; see initialise().
+			size_t numGlobalsSeen = 0;
+			size_t numGlobalStringsSeen = 0;
+
 			std::vector<char*> strings;
 
+			ValueArena valueArena;
+
+			// payloads of large values made outside of any frame (eg. the result of runFunction()); these are
+			// freed in finalise().
+			std::vector<void*> valueAllocs;
+			size_t valueAllocBytes = 0;
+
 			// map from the id to the real function.
 			// we don't want 'inheritance' here
 			std::unordered_map<fir::Value*, interp::Function> compiledFunctions;
 
+			// bumped by every initialise(); compiled functions are checked against it before they're used.
+			size_t generation = 0;
+
+			// for calling external functions: libffi call interfaces by function type, and the addresses of
+			// the functions we've looked up.
+			std::unordered_map<fir::FunctionType*, std::vector<FFICallInfo*>> ffiCallInfos;
+			std::unordered_map<fir::Function*, void*> externalSymbols;
+
 			fir::Module* module = 0;
+
+			// for the tiered backend. if 'compile' is set, once a function has been called (or has looped) more than
+			// 'threshold' times, we ask it for native code, and call that (through libffi) from then on. it can
+			// return null if it couldn't do it. only functions that don't touch any of our state (globals, function
+			// pointers, etc.) are offered up -- see canPromoteFunction().
+			struct {
+				std::function<void* (fir::Function*)> compile;
+				size_t threshold = 0;
+
+				std::unordered_map<fir::Function*, bool> eligible;
+			} tierUp;
+
+			// for -profile. instructions are only counted if 'countInstructions' is set.
+			struct {
+				bool countInstructions = false;
+				size_t instructionsExecuted = 0;
+				size_t peakHeapUsage = 0;
+				size_t functionsPromoted = 0;
+			} stats;
 		};
 	}
 }
@@ -11,6 +11,8 @@
 #include "value.h"
 #include "function.h"
 
+#include <unordered_set>
+
 
 namespace fir
 {
@@ -67,6 +69,16 @@ namespace fir
 		const util::hash_map<Name, Function*>& _getFunctions() { return this->functions; }
 		const util::hash_map<Name, Type*>& _getNamedTypes() { return this->namedTypes; }
 
+		// the same globals, but in the order they were made. globals are never removed, so something that wants to
+		// keep up with the module (eg. the interpreter, across repl lines) can just remember how far it got.
+		const std::vector<GlobalVariable*>& _getGlobalsInOrder() { return this->globalsInOrder; }
+		const std::vector<std::pair<std::string, GlobalVariable*>>& _getGlobalStringsInOrder() { return this->globalStringsInOrder; }
+
+		// the globals whose initial value was set since the last time someone (ie. the interpreter) cleared this.
+		const std::unordered_set<GlobalVariable*>& _getChangedInitialValues() { return this->changedInitialValues; }
+		void _addChangedInitialValue(GlobalVariable* gv) { this->changedInitialValues.insert(gv); }
+		void _clearChangedInitialValues() { this->changedInitialValues.clear(); }
+
 
 		private:
 		std::string moduleName;
@@ -79,6 +91,10 @@ namespace fir
 
 		util::hash_map<Name, Function*> intrinsicFunctions;
 
+		std::vector<GlobalVariable*> globalsInOrder;
+		std::vector<std::pair<std::string, GlobalVariable*>> globalStringsInOrder;
+		std::unordered_set<GlobalVariable*> changedInitialValues;
+
 		Function* entryFunction = 0;
 	};
 }
@@ -0,0 +1,114 @@
+// passes.h
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "defs.h"
+
+namespace fir
+{
+	struct Module;
+	struct IRBlock;
+	struct PHINode;
+	struct Function;
+	struct Instruction;
+
+	namespace passes
+	{
+		// each of these works on one function, and returns true if it changed anything.
+
+		// turns stack allocations (and lvalues) that are only ever read and written directly into ssa values,
+		// inserting phi nodes where the control flow merges.
+		bool promoteAllocations(Function* fn);
+
+		// evaluates arithmetic, comparisons, and branches whose operands are all constants.
+		bool foldConstants(Function* fn);
+
+		// removes instructions without side effects whose results are never used.
+		bool eliminateDeadCode(Function* fn);
+
+		// removes unreachable blocks, merges blocks into their only predecessor, and puts the rest in an order where
+		// every block comes after the blocks that dominate it.
+		bool simplifyControlFlow(Function* fn);
+
+		// removes refcount increments that get cancelled out by a decrement of the same value later in the block,
+		// when nothing in between could look at the refcount or free the value.
+		bool elideRefCounts(Function* fn);
+
+		// the total number of increments and decrements that elideRefCounts() has removed.
+		size_t getElidedRefCountCount();
+
+		// turns virtual calls into direct ones, when every class that could be behind the pointer has the same method
+		// in that slot, or when we can see which vtable the object was given.
+		bool devirtualiseCalls(Function* fn);
+
+		// the total number of calls that devirtualiseCalls() has made direct.
+		size_t getDevirtualisedCallCount();
+
+		// removes bounds checks on indices that can't be out of range (or that were already checked), and moves the
+		// ones on the counter of a loop over a range to before the loop.
+		bool eliminateBoundsChecks(Function* fn);
+
+		// the total number of bounds checks that eliminateBoundsChecks() has removed from where they were, and how
+		// many of those were hoisted out of a loop rather than removed outright.
+		size_t getRemovedBoundsCheckCount();
+		size_t getHoistedBoundsCheckCount();
+
+		// inlines calls to small functions that don't call anything else; functions marked always-inline are
+		// allowed to be bigger.
+		bool inlineCalls(Function* fn);
+
+
+		struct PassManager
+		{
+			using FunctionPass = bool (*)(Function*);
+
+			void addPass(const std::string& name, FunctionPass pass);
+
+			// runs the passes in order over every function in the module, over and over until none of them
+			// change anything (or we've gone around enough times). callees go before their callers.
+			void run(Module* mod);
+
+			// the passes we run by default.
+			static PassManager getDefaultPipeline();
+
+			struct {
+				size_t instructionsBefore = 0;
+				size_t instructionsAfter = 0;
+				size_t blocksBefore = 0;
+				size_t blocksAfter = 0;
+				size_t refCountsElided = 0;
+				size_t callsDevirtualised = 0;
+				size_t boundsChecksRemoved = 0;
+				size_t boundsChecksHoisted = 0;
+			} stats;
+
+			private:
+			std::vector<std::pair<std::string, FunctionPass>> passes;
+		};
+
+
+
+		// helpers shared by the passes.
+		Instruction* getTerminator(IRBlock* blk);
+		std::vector<IRBlock*> getSuccessors(IRBlock* blk);
+		std::vector<PHINode*> getPHIs(IRBlock* blk);
+		util::hash_map<IRBlock*, std::vector<IRBlock*>> getPredecessors(Function* fn);
+
+		// the blocks reachable from the entry block, in reverse post-order.
+		std::vector<IRBlock*> getReversePostOrder(Function* fn);
+
+		// the immediate dominator of every reachable block; the entry block is its own.
+		util::hash_map<IRBlock*, IRBlock*> getImmediateDominators(Function* fn);
+
+		// whether every path from the entry to b goes through a.
+		bool dominates(const util::hash_map<IRBlock*, IRBlock*>& idom, IRBlock* a, IRBlock* b);
+	}
+}
@@ -20,17 +20,20 @@ namespace fir
 
 	struct Name
 	{
-		NameKind kind;
-
-		std::string name;
-		std::vector<std::string> scope;
-		std::vector<fir::Type*> params;
-		fir::Type* retty;
+		NameKind getKind() const { return this->kind; }
+		const std::string& getName() const { return this->name; }
+		const std::vector<std::string>& getScope() const { return this->scope; }
+		const std::vector<fir::Type*>& getParams() const { return this->params; }
+		fir::Type* getReturnType() const { return this->retty; }
 
 		std::string str() const;
 		std::string mangled() const;
 		std::string mangledWithoutScope() const;
 
+		// computed once, the first time it's needed. this is why the fields are private -- if they could change,
+		// the hash (and the mangled name) could go stale.
+		size_t hash() const;
+
 		bool operator== (const Name& other) const;
 		bool operator!= (const Name& other) const;
 
@@ -50,6 +53,19 @@ namespace fir
 	private:
 		Name(NameKind kind, std::string name, std::vector<std::string> scope, std::vector<fir::Type*> params, fir::Type* retty)
 			: kind(kind), name(std::move(name)), scope(std::move(scope)), params(std::move(params)), retty(retty) { }
+
+		NameKind kind;
+
+		std::string name;
+		std::vector<std::string> scope;
+		std::vector<fir::Type*> params;
+		fir::Type* retty;
+
+		// 0 means we haven't computed it yet.
+		mutable size_t hashValue = 0;
+
+		// empty until someone asks for it.
+		mutable std::string mangledName;
 	};
 
 	std::string obfuscateName(const std::string& name);
@@ -70,16 +86,7 @@ namespace std
 	{
 		std::size_t operator()(const fir::Name& k) const
 		{
-			using std::size_t;
-			using std::hash;
-			using std::string;
-
-			// Compute individual hash values for first,
-			// second and third and combine them using XOR
-			// and bit shifting:
-
-			// return ((hash<string>()(k.name) ^ (hash<std::vector<std::string>>()(k.scope) << 1)) >> 1) ^ (hash<int>()(k.third) << 1);
-			return hash<string>()(k.str());
+			return k.hash();
 		}
 	};
 }
@@ -134,6 +141,30 @@ namespace fir
 	size_t getSizeOfType(Type* type);
 	size_t getAlignmentOfType(Type* type);
 
+	// how a type is laid out in memory; for aggregates (structs, classes, tuples, and the builtin ones like strings
+	// and slices), this includes the types and offsets of the fields. computed on first use and kept on the type.
+	struct TypeLayout
+	{
+		size_t size = 0;
+		size_t alignment = 0;
+
+		std::vector<Type*> fieldTypes;
+		std::vector<size_t> fieldOffsets;
+
+		// the same thing, but the way the c abi lays it out: every field is padded to its alignment before it
+		// is placed, and aggregates are aligned to their most-aligned field. the interpreter has its own ideas
+		// (above), but anything that makes native code has to agree with c, so it uses these.
+		size_t abiSize = 0;
+		size_t abiAlignment = 0;
+		std::vector<size_t> abiFieldOffsets;
+	};
+
+	const TypeLayout& getTypeLayout(Type* type);
+
+	// must be called when the body of a type changes, since its layout (and the layout of anything containing it)
+	// would be different.
+	void invalidateTypeLayouts();
+
 	bool areTypesCovariant(Type* base, Type* derv);
 	bool areTypesContravariant(Type* base, Type* derv, bool traitChecking);
 	bool areMethodsVirtuallyCompatible(FunctionType* base, FunctionType* fn, bool traitChecking);
@@ -348,6 +379,11 @@ namespace fir
 		// base things
 		size_t id = 0;
 
+		// see getTypeLayout().
+		TypeLayout* layout = 0;
+		size_t layoutGeneration = 0;
+		friend const TypeLayout& getTypeLayout(Type* type);
+
 		PointerType* pointerTo = 0;
 		PointerType* mutablePointerTo = 0;
 
@@ -1200,39 +1236,38 @@ namespace fir
 
 
 
-	struct HashTypeByStr
-	{
-		size_t operator() (Type* t) const
-		{
-			return std::hash<std::string>()(t->str());
-		}
-	};
-
-	struct TypesEqual
-	{
-		bool operator() (Type* a, Type* b) const
-		{
-			return a->isTypeEqual(b);
-		}
-	};
-
+	// types that are built out of other types (tuples, arrays, functions, etc.) are hash-consed here. every type
+	// that we're built out of is already unique (the named ones by name, and the rest come through here), so
+	// it's enough to hash and compare the pointers of the parts instead of the types themselves.
 	struct TypeCache
 	{
-		std::unordered_set<Type*, HashTypeByStr, TypesEqual> cache;
+		// we don't store the keys, since that would mean allocating one just to look something up. instead
+		// each bucket holds all the types that hashed the same, and the caller knows how to compare them.
+		util::hash_map<size_t, std::vector<Type*>> cache;
 
-		template <typename T>
-		T* getOrAddCachedType(T* type)
+		template <typename T, typename Eq, typename Make>
+		T* getOrAddCachedType(size_t hash, Eq&& matches, Make&& make)
 		{
-			if(auto it = cache.find(type); it != cache.end())
+			auto& bucket = this->cache[hash];
+			for(auto t : bucket)
 			{
-				delete type;
-				return dynamic_cast<T*>(*it);
-			}
-			else
-			{
-				cache.insert(type);
-				return type;
+				if(auto tt = dynamic_cast<T*>(t); tt && matches(tt))
+					return tt;
 			}
+
+			T* ret = make();
+			bucket.push_back(ret);
+
+			return ret;
+		}
+
+		static size_t hashTypeList(size_t seed, const std::vector<Type*>& types)
+		{
+			for(auto t : types)
+				_hash_combine(seed, t);
+
+			_hash_combine(seed, types.size());
+			return seed;
 		}
 
 		static TypeCache& get();
@@ -51,6 +51,7 @@ namespace fir
 		virtual Type* getType();
 		void setType(Type* t)   { this->valueType = t; }
 		void setKind(Kind k)    { this->kind = k; }
+		Kind getKind()          { return this->kind; }
 
 		bool islvalue()     { return this->kind == Kind::lvalue; }
 		bool canmove()      { return this->kind == Kind::xvalue || this->kind == Kind::prvalue; }
@@ -66,6 +67,22 @@ namespace fir
 
 		static size_t getCurrentValueId();
 
+		// instructions (and phi nodes) register themselves with the values they use, once per use, so we can find
+		// (and replace) them without going through the whole function. constants are shared all over the place, so
+		// we don't keep track of theirs.
+		const std::vector<Value*>& getUsers()   { return this->users; }
+		bool hasUsers()                         { return !this->users.empty(); }
+		void replaceAllUsesWith(Value* v);
+
+		void addUser(Value* user);
+		void removeUser(Value* user);
+
+		// for users: change every reference to 'from' into a reference to 'to'.
+		virtual void replaceUsesOf(Value* from, Value* to);
+
+		// the instruction that this is the result of, if any.
+		Instruction* getDefiningInstruction()   { return this->definingInstruction; }
+
 		// protected shit
 		size_t id;
 		protected:
@@ -79,6 +96,10 @@ namespace fir
 		Type* valueType;
 		Kind kind;
 		bool isconst = false;
+
+		bool tracksUsers = true;
+		std::vector<Value*> users;
+		Instruction* definingInstruction = 0;
 	};
 
 	struct PHINode : Value
@@ -88,6 +109,14 @@ namespace fir
 
 		std::map<IRBlock*, Value*> getValues();
 
+		// for the optimiser, when it rewrites the control flow around us.
+		void setIncoming(Value* v, IRBlock* block);
+		void removeIncoming(IRBlock* block);
+		void replaceIncomingBlock(IRBlock* from, IRBlock* to);
+
+		// replaces both incoming values and incoming blocks.
+		virtual void replaceUsesOf(Value* from, Value* to) override;
+
 		protected:
 		PHINode(Type* type);
 
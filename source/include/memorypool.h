@@ -12,11 +12,14 @@ namespace util
 	void clearAllPools();
 
 
+	// each thread gets its own pool, so the parser can allocate from several threads without locking.
+	// the pools are never freed when a thread exits (the nodes outlive it), but clearAllPools() still gets them.
 	template <typename T, typename... Args>
 	T* pool(Args&&... args)
 	{
-		static MemoryPool<T, 1 << 9> _pool;
-		addPool(&_pool);
-		return _pool.construct(std::forward<Args>(args)...);
+		thread_local MemoryPool<T, 1 << 9>* _pool = 0;
+		if(!_pool) addPool(_pool = new MemoryPool<T, 1 << 9>());
+
+		return _pool->construct(std::forward<Args>(args)...);
 	}
 }
@@ -0,0 +1,80 @@
+// parallel.h
+// Copyright (c) 2020, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include "defs.h"
+
+namespace util
+{
+	// runs fn(0) ... fn(count - 1) on a bunch of worker threads, and returns when all of them are done.
+	// there's no ordering between the calls, so fn had better not touch anything that the others do.
+	//
+	// errors don't get printed (or exit) while the threads are running: each call writes into its own buffer, and
+	// an error just ends that call. once they've all been joined, the buffers get printed in order (so the output
+	// doesn't depend on who got there first), and if there was an error we exit from here.
+	template <typename Fn>
+	void parallelFor(size_t count, Fn&& fn)
+	{
+		size_t nthreads = std::min(static_cast<size_t>(std::max(std::thread::hardware_concurrency(), 1U)), count);
+
+		// not worth spinning up threads for this.
+		if(nthreads <= 1)
+		{
+			for(size_t i = 0; i < count; i++)
+				fn(i);
+
+			return;
+		}
+
+		std::vector<std::string> outputs(count);
+		std::atomic<bool> failed = false;
+
+		// instead of chopping the range up front, each thread just takes the next index -- files
+		// vary wildly in size, so this keeps everybody busy until the end.
+		std::atomic<size_t> next = 0;
+		auto worker = [&next, &fn, &outputs, &failed, count]() {
+			for(size_t i = next++; i < count; i = next++)
+			{
+				auto old = setErrorOutputBuffer(&outputs[i]);
+
+				try
+				{
+					fn(i);
+				}
+				catch(WorkerExit&)
+				{
+					failed = true;
+				}
+
+				setErrorOutputBuffer(old);
+			}
+		};
+
+		// the calling thread also does some of the work.
+		std::vector<std::thread> threads;
+		for(size_t i = 0; i < nthreads - 1; i++)
+			threads.emplace_back(worker);
+
+		worker();
+
+		for(auto& t : threads)
+			t.join();
+
+		for(const auto& out : outputs)
+		{
+			if(!out.empty())
+				writeErrorOutput(out);
+		}
+
+		if(failed)
+			doTheExit();
+	}
+}
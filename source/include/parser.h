@@ -27,6 +27,10 @@ namespace parser
 		std::vector<std::string> modulePath;
 
 		ast::TopLevelBlock* root = 0;
+
+		// from '@platform[native_word_size]', if the file had one (0 if not). files get parsed in parallel, so
+		// the collector applies these afterwards, in order.
+		size_t nativeWordSize = 0;
 	};
 
 
@@ -40,6 +44,13 @@ namespace parser
 		Kind kind = Kind::Invalid;
 	};
 
+	struct CustomOperators
+	{
+		util::hash_map<std::string, CustomOperatorDecl> binaryOps;
+		util::hash_map<std::string, CustomOperatorDecl> prefixOps;
+		util::hash_map<std::string, CustomOperatorDecl> postfixOps;
+	};
+
 	std::tuple<util::hash_map<std::string, parser::CustomOperatorDecl>,	util::hash_map<std::string, parser::CustomOperatorDecl>,
 		util::hash_map<std::string, parser::CustomOperatorDecl>> parseOperators(const lexer::TokenList& tokens);
 
@@ -47,7 +58,7 @@ namespace parser
 	size_t parseOperatorDecl(const lexer::TokenList& tokens, size_t i, int* kind, CustomOperatorDecl* out);
 
 	std::vector<frontend::ImportThing> parseImports(const std::string& filename, const lexer::TokenList& tokens);
-	ParsedFile parseFile(const std::string& filename, const frontend::FileInnards& file, frontend::CollectorState& cs);
+	ParsedFile parseFile(const std::string& filename, const frontend::FileInnards& file, const CustomOperators& ops);
 }
 
 
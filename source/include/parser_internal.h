@@ -240,7 +240,8 @@ namespace parser
 		bool operatorsStillValid = true;
 		bool nativeWordSizeStillValid = true;
 
-		frontend::CollectorState* cState = 0;
+		// set by '@platform[native_word_size]'; this ends up in the ParsedFile.
+		size_t nativeWordSize = 0;
 
 		private:
 			// 1 = inside function
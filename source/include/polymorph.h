@@ -77,8 +77,9 @@ namespace sst
 		};
 
 
+		// if 'quiet', the error (if any) is a placeholder that just says it didn't work.
 		std::pair<Solution_t, ErrorMsg*> solveTypeList(const Location& callLoc, const std::vector<ArgType>& target,
-			const std::vector<ArgType>& given, const Solution_t& partial, bool isFnCall);
+			const std::vector<ArgType>& given, const Solution_t& partial, bool isFnCall, bool quiet = false);
 
 		TCResult fullyInstantiatePolymorph(TypecheckState* fs, ast::Parameterisable* thing, const TypeParamMap_t& mappings);
 
@@ -100,6 +101,10 @@ namespace sst
 			const TypeParamMap_t& _gmaps, fir::Type* return_infer, fir::Type* type_infer, bool isFnCall, std::vector<FnCallArgument>* args,
 			bool fillplaceholders, fir::Type* problem_infer = 0);
 
+		// how many times checkForExistingDeclaration() found something we already instantiated (hits), and how
+		// many times it didn't (misses). only counts things inside a generic context.
+		std::pair<size_t, size_t> getInstantiationCacheStats();
+
 
 		namespace internal
 		{
@@ -26,8 +26,9 @@ namespace sst
 
 	namespace resolver
 	{
+		// if 'quiet', a failure is just a distance of -1, and the error message isn't made.
 		std::pair<int, ErrorMsg*> computeNamedOverloadDistance(const Location& fnLoc, const std::vector<FnParam>& target,
-			const std::vector<FnCallArgument>& _args, bool cvararg, const Location& callLoc);
+			const std::vector<FnCallArgument>& _args, bool cvararg, const Location& callLoc, bool quiet = false);
 
 		std::pair<int, ErrorMsg*> computeOverloadDistance(const Location& fnLoc, const std::vector<fir::LocatedType>& target,
 			const std::vector<fir::LocatedType>& _args, bool cvararg, const Location& callLoc);
@@ -7,7 +7,7 @@
 #include "sst_expr.h"
 
 
-#include "mpreal/mpreal.h"
+#include "ir/constant.h"
 
 
 
@@ -483,7 +483,7 @@ namespace sst
 
 		virtual CGResult _codegen(cgn::CodegenState* cs, fir::Type* inferred = 0) override;
 
-		mpfr::mpreal num;
+		fir::NumberValue num;
 	};
 
 	struct LiteralString : Expr
@@ -88,6 +88,25 @@ namespace sst
 		// the same thing, but for reexports (ie. public imports).
 		std::map<const StateTree*, Location> reexportMetadata;
 
+		// a definition that we can see through one of our imports, or through one of their public imports (and
+		// theirs, and so on) -- 'exporter' is the tree that publicly imported 'source', or null if 'source' is
+		// the import itself.
+		struct ImportedDefn
+		{
+			Defn* defn = 0;
+			StateTree* import = 0;
+			StateTree* source = 0;
+			StateTree* exporter = 0;
+		};
+
+		// everything in 'imports' (including their re-exports), by name, so that merging another tree only needs
+		// to look up each of its names once. addDefinition() keeps it up to date, through 'importedBy'.
+		util::hash_map<std::string, std::vector<ImportedDefn>> importedDefinitions;
+
+		// the trees that can see our definitions through their 'importedDefinitions', and how they see them.
+		// (ImportedDefn::defn is unused here.)
+		std::vector<std::pair<StateTree*, ImportedDefn>> importedBy;
+
 
 		// what's there to explain? a simple map of operators to their functions. we use
 		// function overload resolution to determine which one to call, and ambiguities are
@@ -108,6 +127,7 @@ namespace sst
 		std::vector<ast::Parameterisable*> getUnresolvedGenericDefnsWithName(const std::string& name);
 
 		void addDefinition(const std::string& name, Defn* def, const TypeParamMap_t& gmaps = { });
+		void addImport(StateTree* tree, const Location& loc);
 	};
 
 	struct DefinitionTree
@@ -7,9 +7,11 @@
 #include "errors.h"
 #include "backend.h"
 #include "frontend.h"
+#include "polymorph.h"
 
 #include "ir/module.h"
 #include "ir/interp.h"
+#include "ir/passes.h"
 
 #include "memorypool.h"
 #include "allocator.h"
@@ -39,6 +41,7 @@ static void compile(std::string in, std::string out)
 	double parser_ms    = 0;
 	double typecheck_ms = 0;
 	double codegen_ms   = 0;
+	double optimise_ms  = 0;
 
 	timer total;
 
@@ -62,6 +65,13 @@ static void compile(std::string in, std::string out)
 			printStats("lex");
 		}
 
+		if(frontend::getPrintProfileStats())
+		{
+			auto [ bytes, ms ] = frontend::getLexerStats();
+			debuglogln("lexer: %.2f MB in %.1f ms (%.1f MB/s)", static_cast<double>(bytes) / 1000000.0, ms,
+				ms > 0 ? static_cast<double>(bytes) / 1000.0 / ms : 0.0);
+		}
+
 		{
 			timer t(&parser_ms);
 			frontend::parseFiles(&state);
@@ -74,6 +84,12 @@ static void compile(std::string in, std::string out)
 			printStats("typecheck");
 		}
 
+		if(frontend::getPrintProfileStats())
+		{
+			auto [ hits, misses ] = sst::poly::getInstantiationCacheStats();
+			debuglogln("generic instantiations: %d cache hits, %d misses", hits, misses);
+		}
+
 		{
 			timer t(&codegen_ms);
 			iceAssert(dtree);
@@ -82,14 +98,34 @@ static void compile(std::string in, std::string out)
 			module->finaliseGlobalConstructors();
 			printStats("codegen");
 
-			// if we requested to dump, then dump the IR here.
-			if(frontend::getPrintFIR())
-				fprintf(stderr, "%s\n", module->print().c_str());
+			cd.module = module;
+		}
 
+		if(frontend::getOptLevel() > backend::OptimisationLevel::None)
+		{
+			timer t(&optimise_ms);
 
-			cd.module = module;
+			// this runs before we pick a backend, so the interpreter gets the same (optimised) code as llvm.
+			auto pm = fir::passes::PassManager::getDefaultPipeline();
+			pm.run(cd.module);
+
+			printStats("optimise");
+
+			if(frontend::getPrintProfileStats())
+			{
+				debuglogln("fir: %d -> %d instructions, %d -> %d blocks, %d refcount ops elided, %d virtual calls devirtualised",
+					pm.stats.instructionsBefore, pm.stats.instructionsAfter, pm.stats.blocksBefore, pm.stats.blocksAfter,
+					pm.stats.refCountsElided, pm.stats.callsDevirtualised);
+
+				debuglogln("fir: %d bounds checks removed (%d hoisted out of loops)", pm.stats.boundsChecksRemoved,
+					pm.stats.boundsChecksHoisted);
+			}
 		}
 
+		// if we requested to dump, then dump the IR here.
+		if(frontend::getPrintFIR())
+			fprintf(stderr, "%s\n", cd.module->print().c_str());
+
 
 		// delete *most* of the memory we've allocated. obviously IR values need to stay alive,
 		// since we haven't run the backend yet. so this just kills the AST and SST values.
@@ -103,8 +139,8 @@ static void compile(std::string in, std::string out)
 			auto compile_ms = static_cast<double>((std::chrono::high_resolution_clock::now() - start_time).count()) / 1000.0 / 1000.0;
 
 
-			debuglogln("%-9s (%.1f ms)\t[lex: %.1f, parse: %.1f, typechk: %.1f, codegen: %.1f]", "compile",
-				compile_ms, lexer_ms, parser_ms, typecheck_ms, codegen_ms);
+			debuglogln("%-9s (%.1f ms)\t[lex: %.1f, parse: %.1f, typechk: %.1f, codegen: %.1f, opt: %.1f]", "compile",
+				compile_ms, lexer_ms, parser_ms, typecheck_ms, codegen_ms, optimise_ms);
 
 			debuglogln("processed: %d lines, %.2f loc/s, %d fir values\n", state.totalLinesOfCode,
 				static_cast<double>(state.totalLinesOfCode) / (compile_ms / 1000.0),
@@ -4,6 +4,8 @@
 
 #include <stdlib.h>
 
+#include <atomic>
+
 #include "defs.h"
 #include "allocator.h"
 
@@ -61,9 +63,10 @@ namespace mem
 
 
 
-	static size_t allocated_count = 0;
-	static size_t freed_count = 0;
-	static size_t watermark = 0;
+	// the pools (and hence we) get called from the parser threads.
+	static std::atomic<size_t> allocated_count = 0;
+	static std::atomic<size_t> freed_count = 0;
+	static std::atomic<size_t> watermark = 0;
 
 	void* allocate_memory(size_t bytes)
 	{
@@ -5,18 +5,22 @@
 #include "defs.h"
 #include "memorypool.h"
 
+#include <mutex>
 #include <unordered_set>
 
 namespace util
 {
+	static std::mutex poolLock;
 	static std::unordered_set<MemoryPool_base*> pools;
 	void addPool(MemoryPool_base* pool)
 	{
+		std::lock_guard<std::mutex> lk(poolLock);
 		pools.insert(pool);
 	}
 
 	void clearAllPools()
 	{
+		std::lock_guard<std::mutex> lk(poolLock);
 		for(auto pool : pools)
 			pool->clear();
 	}
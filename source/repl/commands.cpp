@@ -38,8 +38,10 @@ namespace repl
 		}
 		else if(s.find("clear_history") == 0)
 		{
-			// just loading an empty history will effectively clear the history.
-			consoleState->loadHistory({ });
+			// just loading an empty history will effectively clear the history. (there's no console when we're
+			// reading a script)
+			if(consoleState)
+				consoleState->loadHistory({ });
 		}
 		else
 		{
@@ -4,7 +4,12 @@
 
 #include <stdlib.h>
 
+#include <chrono>
+#include <iostream>
+
 #include "repl.h"
+#include "errors.h"
+#include "platform.h"
 #include "frontend.h"
 
 #define ZTMU_CREATE_IMPL 1
@@ -19,8 +24,68 @@ namespace repl
 	static constexpr const char* EXTRA_INDENT       = "  ";
 	static constexpr size_t EXTRA_INDENT_LEN        = std::char_traits<char>::length(EXTRA_INDENT);
 
+	// when the input isn't a terminal (eg. `flaxc -repl < session.flx`), there's no line editing or history; we just
+	// feed it the lines, joining them up when they need more like the continuation prompt would.
+	static void runScript()
+	{
+		repl::setupEnvironment();
+
+		using clock = std::chrono::steady_clock;
+		std::vector<double> times;
+
+		std::string input;
+		std::string line;
+		while(std::getline(std::cin, line))
+		{
+			input += (input.empty() ? "" : "\n") + line;
+			if(input.empty())
+				continue;
+
+			if(input[0] == ':' && input.find("::") != 0)
+			{
+				auto quit = repl::runCommand(input.substr(1), nullptr);
+				if(quit) break;
+
+				input.clear();
+				continue;
+			}
+
+			auto start = clock::now();
+			bool needmore = repl::processLine(input);
+			times.push_back(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+
+			if(!needmore)
+				input.clear();
+		}
+
+		// so we can tell whether lines get slower the longer the session goes on.
+		if(frontend::getPrintProfileStats() && !times.empty())
+		{
+			auto n = std::min(times.size(), size_t(1000));
+			auto avg = [&times](size_t begin, size_t count) -> double {
+				double total = 0;
+				for(size_t i = begin; i < begin + count; i++)
+					total += times[i];
+
+				return total / count;
+			};
+
+			debuglogln("repl: %d lines in %.1f ms; first %d: %.3f ms/line, last %d: %.3f ms/line", times.size(),
+				avg(0, times.size()) * times.size(), n, avg(0, n), n, avg(times.size() - n, n));
+		}
+	}
+
 	void start()
 	{
+	#if OS_WINDOWS
+		bool interactive = _isatty(_fileno(stdin));
+	#else
+		bool interactive = isatty(STDIN_FILENO);
+	#endif
+
+		if(!interactive)
+			return runScript();
+
 		zpr::println("flax repl -- version %s", frontend::getVersion());
 		zpr::println("type %s:?%s for help\n", COLOUR_GREEN_BOLD, COLOUR_RESET);
 
@@ -34,10 +34,7 @@ namespace repl
 			this->fs = new sst::TypecheckState(tree);
 			this->cs = new cgn::CodegenState(fir::IRBuilder(this->module));
 			this->cs->module = this->module;
-
-
-			this->interpState = new fir::interp::InterpState(this->module);
-			this->interpState->initialise(/* runGlobalInit: */ true);
+			this->cs->typeDefnMap = &this->fs->typeDefnMap;
 
 			// so we don't crash, give us a starting location.
 			this->cs->pushLoc(Location());
@@ -45,7 +42,14 @@ namespace repl
 
 		~State()
 		{
-			delete this->interpState;
+			// lines run in the same interpreter state as #run directives (see cs->interpState), which keeps the
+			// globals alive from one line to the next.
+			if(this->cs->interpState)
+			{
+				this->cs->interpState->finalise();
+				delete this->cs->interpState;
+			}
+
 			delete this->cs;
 			delete this->fs;
 			delete this->module;
@@ -54,7 +58,6 @@ namespace repl
 		fir::Module* module;
 		cgn::CodegenState* cs;
 		sst::TypecheckState* fs;
-		fir::interp::InterpState* interpState;
 
 		size_t fnCounter = 0;
 		size_t varCounter = 0;
@@ -148,11 +151,50 @@ namespace repl
 	}
 
 
+	// every line gets a tree of its own, so that it can shadow what came before. if they were nested, then looking up
+	// a name would have to go through every line so far (and the scope of everything would get longer and longer);
+	// so once a line is done, what it defined moves up into the top-level tree, and the next line starts from there.
+	static void finishLine(sst::StateTree* line)
+	{
+		auto top = line->parent;
+		state->fs->stree = top;
+
+		// shadowing replaces everything with that name, generic or not.
+		for(const auto& [ name, _ ] : line->definitions)
+			top->definitions.erase(name), top->unresolvedGenericDefs.erase(name);
+
+		for(const auto& [ name, _ ] : line->unresolvedGenericDefs)
+			top->definitions.erase(name), top->unresolvedGenericDefs.erase(name);
+
+		for(const auto& [ name, defs ] : line->definitions)
+			top->definitions[name] = defs;
+
+		for(const auto& [ name, defs ] : line->unresolvedGenericDefs)
+			top->unresolvedGenericDefs[name] = defs;
+
+		// the line's subtrees (eg. the insides of types) keep pointing at the line's tree, which still has everything
+		// that was defined on it, so lookups from in there work like they used to.
+		for(const auto& [ name, tree ] : line->subtrees)
+			top->subtrees[name] = tree;
+
+		for(const auto& [ op, fns ] : line->infixOperatorOverloads)
+			top->infixOperatorOverloads[op].insert(top->infixOperatorOverloads[op].end(), fns.begin(), fns.end());
+
+		for(const auto& [ op, fns ] : line->prefixOperatorOverloads)
+			top->prefixOperatorOverloads[op].insert(top->prefixOperatorOverloads[op].end(), fns.begin(), fns.end());
+
+		for(const auto& [ op, fns ] : line->postfixOperatorOverloads)
+			top->postfixOperatorOverloads[op].insert(top->postfixOperatorOverloads[op].end(), fns.begin(), fns.end());
+	}
+
 	bool processLine(const std::string& line)
 	{
 		// before we begin, bring us into a new namespace.
 		state->fs->pushAnonymousTree();
 
+		auto tree = state->fs->stree;
+		defer(finishLine(tree));
+
 		bool needmore = false;
 		auto stmt = repl::parseAndTypecheck(line, &needmore);
 		if(!stmt)
@@ -160,30 +202,28 @@ namespace repl
 
 
 		{
-			// copy some stuff over.
-			state->cs->typeDefnMap = state->fs->typeDefnMap;
-
 			// so the thing is, all the previous things have already been code-generated,
 			// and have had their initialisers run. so there's really no need for their
 			// init pieces to stick around. we need to remove the functions as well for this
 			// to work properly!
 			for(auto [ gv, pc ] : state->cs->globalInitPieces)
 			{
+				if(state->cs->interpState)
+					state->cs->interpState->compiledFunctions.erase(pc);
+
 				state->module->removeFunction(pc);
 				delete pc;
 			}
 
 			state->cs->globalInitPieces.clear();
+			state->cs->globalInitPiecesRun = 0;
 
-			// ok, we have a thing. try to run it. note: this will help us to run is->initialise(true),
-			// which will call the global inits. this function also calls Stmt::codegen, which will
-			// (potentially) populate the globalInitPieces, before calling cs->finishGlobalInits(). basically,
+			// ok, we have a thing. try to run it. this goes through the same interpreter state as #run, so it only
+			// sets up the globals that are new, and runs the init pieces that the line made before running the line
+			// itself (which calls Stmt::codegen, which (potentially) populates the globalInitPieces). basically,
 			// it's all handled.
 			auto value = magicallyRunExpressionAtCompileTime(state->cs, *stmt, nullptr,
-				fir::Name::obfuscate("__anon_runner_", state->fnCounter++),
-				state->interpState);
-
-			state->interpState->finalise();
+				fir::Name::obfuscate("__anon_runner_", state->fnCounter++));
 
 			if(value)
 			{
@@ -120,7 +120,7 @@ TCResult ast::ClassDefn::generateDeclaration(sst::TypecheckState* fs, fir::Type*
 	}
 	fs->teleportOut();
 
-	this->genericVersions.push_back({ defn, fs->getGenericContextStack() });
+	this->addGenericVersion(defn, fs->getGenericContextStack());
 	return TCResult(defn);
 }
 
@@ -449,13 +449,13 @@ TCResult ast::InitFunctionDefn::typecheck(sst::TypecheckState* fs, fir::Type* in
 	{
 		if(cls->getBaseClass() && !this->didCallSuper)
 		{
-			error(this, "initialiser for class '%s' must explicitly call an initialiser of the base class '%s'", cls->getTypeName().name,
-				cls->getBaseClass()->getTypeName().name);
+			error(this, "initialiser for class '%s' must explicitly call an initialiser of the base class '%s'", cls->getTypeName().getName(),
+				cls->getBaseClass()->getTypeName().getName());
 		}
 		else if(!cls->getBaseClass() && this->didCallSuper)
 		{
 			error(this, "cannot call base class initialiser for class '%s' when it does not inherit from a base class",
-				cls->getTypeName().name);
+				cls->getTypeName().getName());
 		}
 		else if(cls->getBaseClass() && this->didCallSuper)
 		{
@@ -60,7 +60,10 @@ TCResult ast::IfDirective::typecheck(sst::TypecheckState* fs, fir::Type* infer)
 	// internals ourselves, since cgn::codegen expects a fully typechecked module/dtree, which we don't have right now
 	auto mod = new fir::Module("");
 	auto cs = new cgn::CodegenState(fir::IRBuilder(mod));
-	cs->typeDefnMap = fs->typeDefnMap;
+
+	// codegen adds empty entries when it looks things up, and the module isn't done yet, so give it a copy.
+	auto typeDefns = fs->typeDefnMap;
+	cs->typeDefnMap = &typeDefns;
 	cs->module = mod;
 
 	// so we don't crash, give us a starting location.
@@ -54,7 +54,7 @@ TCResult ast::EnumDefn::generateDeclaration(sst::TypecheckState* fs, fir::Type*
 
 	defn->enclosingScope.stree->addDefinition(defnname, defn, gmaps);
 
-	this->genericVersions.push_back({ defn, fs->getGenericContextStack() });
+	this->addGenericVersion(defn, fs->getGenericContextStack());
 	return TCResult(defn);
 }
 
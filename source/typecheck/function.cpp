@@ -115,7 +115,7 @@ TCResult ast::FuncDefn::generateDeclaration(sst::TypecheckState* fs, fir::Type*
 
 
 	// add to our versions.
-	this->genericVersions.push_back({ defn, fs->getGenericContextStack() });
+	this->addGenericVersion(defn, fs->getGenericContextStack());
 	return TCResult(defn);
 }
 
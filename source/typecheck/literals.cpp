@@ -2,6 +2,8 @@
 // Copyright (c) 2014 - 2017, zhiayang
 // Licensed under the Apache License Version 2.0.
 
+#include <errno.h>
+
 #include "ast.h"
 #include "typecheck.h"
 
@@ -10,31 +12,157 @@
 
 #include "memorypool.h"
 
+// integers are read straight into 64 bits; this gives up (and leaves it to mpfr) if the number doesn't fit, or if
+// it has something in it we don't expect. 'str' is the literal without its sign or base prefix.
+static bool parseInteger(std::string_view str, int base, bool neg, fir::NumberValue* out)
+{
+	auto digit = [base](char c) -> int {
+		if(c >= '0' && c <= '9')                    return (c - '0' < base ? c - '0' : -1);
+		else if(base == 16 && isxdigit(c))          return 10 + (tolower(c) - 'a');
+		else                                        return -1;
+	};
+
+	size_t i = 0;
+	uint64_t mag = 0;
+	for(; i < str.size() && digit(str[i]) >= 0; i++)
+	{
+		auto d = static_cast<uint64_t>(digit(str[i]));
+		if(mag > (UINT64_MAX - d) / base)
+			return false;
+
+		mag = mag * base + d;
+	}
+
+	if(i == 0)
+		return false;
+
+	// the lexer allows exponents on (decimal) integers, eg. 1e5, and those are still integers.
+	if(i < str.size() && (str[i] == 'e' || str[i] == 'E'))
+	{
+		// (negative exponents make it a float, so we never see those here.)
+		if(i + 1 < str.size() && str[i + 1] == '+')
+			i++;
+
+		size_t exp = 0;
+		for(i++; i < str.size() && isdigit(str[i]); i++)
+		{
+			exp = (exp * 10) + static_cast<size_t>(str[i] - '0');
+			if(mag != 0 && exp > 19)
+				return false;
+		}
+
+		for(size_t k = 0; k < exp && mag != 0; k++)
+		{
+			if(mag > UINT64_MAX / 10)
+				return false;
+
+			mag *= 10;
+		}
+	}
+
+	if(i != str.size())
+		return false;
+
+	if(neg)
+	{
+		if(mag > static_cast<uint64_t>(INT64_MAX) + 1)
+			return false;
+
+		*out = fir::NumberValue::ofSigned(static_cast<int64_t>(0 - mag));
+	}
+	else if(mag > static_cast<uint64_t>(INT64_MAX))
+	{
+		*out = fir::NumberValue::ofUnsigned(mag);
+	}
+	else
+	{
+		*out = fir::NumberValue::ofSigned(static_cast<int64_t>(mag));
+	}
+
+	return true;
+}
+
+// floating point literals are always decimal, and strtod rounds correctly, so we get the same double that mpfr
+// would have given us (at its default precision).
+static bool parseDouble(const std::string& str, fir::NumberValue* out)
+{
+	errno = 0;
+
+	char* end = 0;
+	double d = strtod(str.c_str(), &end);
+
+	if(end != str.c_str() + str.size() || errno == ERANGE || !std::isfinite(d))
+		return false;
+
+	*out = fir::NumberValue::ofDouble(d);
+	return true;
+}
+
 TCResult ast::LitNumber::typecheck(sst::TypecheckState* fs, fir::Type* infer)
 {
 	fs->pushLoc(this);
 	defer(fs->popLoc());
 
+	auto str = std::string_view(this->num);
+
+	bool sgn = (str.find('-') == 0);
+	if(str.find('-') == 0 || str.find('+') == 0)
+		str.remove_prefix(1);
+
 	// i don't think mpfr auto-detects base, LMAO
 	int base = 10;
-	if(this->num.find("0x") == 0 || this->num.find("0X") == 0)
-		base = 16;
+	if(str.find("0x") == 0 || str.find("0X") == 0)
+		base = 16, str.remove_prefix(2);
 
-	auto number = mpfr::mpreal(this->num, mpfr_get_default_prec(), base);
-	bool sgn = mpfr::signbit(number);
-	bool flt = ((this->num.find(".") != std::string::npos) || !mpfr::isint(number));
+	else if(str.find("0b") == 0 || str.find("0B") == 0)
+		base = 2, str.remove_prefix(2);
+
+	// a negative exponent (eg. 1e-5) makes it a fraction, even without a decimal point.
+	bool flt = (str.find('.') != std::string::npos) || (str.find("e-") != std::string::npos)
+		|| (str.find("E-") != std::string::npos);
 
 	size_t bits = 0;
-	if(flt)
+	fir::NumberValue number;
+
+	// making an mpreal is slow, and we don't need one for most literals.
+	if(flt ? parseDouble(this->num, &number) : parseInteger(str, base, sgn, &number))
 	{
-		// fuck it lah.
-		bits = sizeof(double) * CHAR_BIT;
+		auto v = number.toLLong();
+		if(flt)
+		{
+			// fuck it lah.
+			bits = sizeof(double) * CHAR_BIT;
+		}
+
+		else if(!sgn && number.toULLong() > static_cast<uint64_t>(INT64_MAX))
+			bits = sizeof(uintmax_t) * CHAR_BIT;
+
+		else if(v >= SHRT_MIN && v <= SHRT_MAX)
+			bits = sizeof(short) * CHAR_BIT;
+
+		else if(v >= INT_MIN && v <= INT_MAX)
+			bits = sizeof(int) * CHAR_BIT;
+
+		else if(v >= LONG_MIN && v <= LONG_MAX)
+			bits = sizeof(long) * CHAR_BIT;
+
+		else
+			bits = sizeof(intmax_t) * CHAR_BIT;
 	}
 	else
 	{
-		auto m_ptr = number.mpfr_ptr();
+		// too big for 64 bits, so mpfr gets to deal with it.
+		auto big = mpfr::mpreal((sgn ? "-" : "") + std::string(str), mpfr_get_default_prec(), base);
+		number = fir::NumberValue::ofBig(big);
+
+		flt = flt || !mpfr::isint(big);
+
+		auto m_ptr = big.mpfr_ptr();
 		auto m_rnd = MPFR_RNDN;
-		if(mpfr_fits_sshort_p(m_ptr, m_rnd))
+		if(flt)
+			bits = sizeof(double) * CHAR_BIT;
+
+		else if(mpfr_fits_sshort_p(m_ptr, m_rnd))
 			bits = sizeof(short) * CHAR_BIT;
 
 		else if(mpfr_fits_sint_p(m_ptr, m_rnd))
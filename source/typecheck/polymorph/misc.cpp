@@ -160,6 +160,62 @@ namespace sst
 }
 
 
+static size_t instantiationCacheHits = 0;
+static size_t instantiationCacheMisses = 0;
+
+std::pair<size_t, size_t> sst::poly::getInstantiationCacheStats()
+{
+	return { instantiationCacheHits, instantiationCacheMisses };
+}
+
+static size_t hashGenericMap(const TypeParamMap_t& map)
+{
+	// hash_map doesn't iterate in any particular order, so combine the entries in a way that doesn't care.
+	// (the types are uniqued, so the pointer is good enough.)
+	size_t ret = map.size();
+	for(const auto& [ name, type ] : map)
+	{
+		size_t h = 0;
+		_hash_combine(h, name);
+		_hash_combine(h, type);
+
+		ret += h;
+	}
+
+	return ret;
+}
+
+// goes from the back, so that the hash of a suffix is one of the steps along the way to the hash of the whole stack.
+static size_t hashGenericContextStack(const std::vector<TypeParamMap_t>& gcs, std::vector<size_t>* suffixes = nullptr)
+{
+	size_t ret = 0;
+	if(suffixes) suffixes->push_back(ret);
+
+	for(auto it = gcs.rbegin(); it != gcs.rend(); ++it)
+	{
+		_hash_combine(ret, hashGenericMap(*it));
+		if(suffixes) suffixes->push_back(ret);
+	}
+
+	return ret;
+}
+
+void ast::Parameterisable::addGenericVersion(sst::Defn* defn, const std::vector<TypeParamMap_t>& gcs)
+{
+	std::vector<size_t> suffixes;
+	hashGenericContextStack(gcs, &suffixes);
+
+	auto idx = this->genericVersions.size();
+	this->genericVersions.push_back({ defn, gcs });
+
+	for(auto h : suffixes)
+	{
+		auto& list = this->genericVersionIndex[h];
+		if(list.empty() || list.back() != idx)
+			list.push_back(idx);
+	}
+}
+
 //* helper method that abstracts away the common error-checking
 std::pair<bool, sst::Defn*> ast::Parameterisable::checkForExistingDeclaration(sst::TypecheckState* fs, const TypeParamMap_t& gmaps)
 {
@@ -196,17 +252,32 @@ std::pair<bool, sst::Defn*> ast::Parameterisable::checkForExistingDeclaration(ss
 		if(!gmaps.empty())
 			currentGCS.push_back(gmaps);
 
-		for(const auto& gv : this->genericVersions)
+		//* every version is in the index under each suffix of its stack, so we only need to look at the ones that
+		//* (probably) end with our entire stack. the indices are in order, so we still find the first one.
+		if(auto it = this->genericVersionIndex.find(hashGenericContextStack(currentGCS)); it != this->genericVersionIndex.end())
 		{
-			//* note!! Defn::type can be null for enums -- we need to find a way to prevent this!!
-			// TODO: prevent this!!
-			// TODO: prevent this!!
-			// TODO: prevent this!!
-			// TODO: prevent this!!
-			if(gv.first->type && !gv.first->type->containsPlaceholders() && doRootsMatch(gv.second, currentGCS))
-				return { true, gv.first };
+			for(auto idx : it->second)
+			{
+				const auto& gv = this->genericVersions[idx];
+
+				//* note!! Defn::type can be null for enums -- we need to find a way to prevent this!!
+				// TODO: prevent this!!
+				// TODO: prevent this!!
+				// TODO: prevent this!!
+				// TODO: prevent this!!
+				if(gv.first->type && !gv.first->type->containsPlaceholders() && doRootsMatch(gv.second, currentGCS))
+				{
+					if(!currentGCS.empty())
+						instantiationCacheHits++;
+
+					return { true, gv.first };
+				}
+			}
 		}
 
+		if(!currentGCS.empty())
+			instantiationCacheMisses++;
+
 
 		if(this->generics.size() > 0 && gmaps.empty())
 		{
@@ -17,9 +17,24 @@ namespace sst
 	namespace poly
 	{
 		static ErrorMsg* solveSingleTypeList(Solution_t* soln, const Location& callLoc, const std::vector<ArgType>& target,
-			const std::vector<ArgType>& given, bool isFnCall);
+			const std::vector<ArgType>& given, bool isFnCall, bool quiet);
 
-		static ErrorMsg* solveSingleType(Solution_t* soln, const fir::LocatedType& target, const fir::LocatedType& given)
+		// when the caller only wants to know whether (and how well) it works, there's no point printing the types
+		// into a message nobody will read; every quiet failure gets this one instead, which must not be changed.
+		static ErrorMsg* getQuietFailure()
+		{
+			static ErrorMsg* ret = BareError::make("no solution");
+			return ret;
+		}
+
+		template <typename... Ts>
+		static ErrorMsg* fail(bool quiet, const Location& loc, const char* fmt, Ts&&... ts)
+		{
+			if(quiet)   return getQuietFailure();
+			else        return SimpleError::make(loc, fmt, ts...);
+		}
+
+		static ErrorMsg* solveSingleType(Solution_t* soln, const fir::LocatedType& target, const fir::LocatedType& given, bool quiet)
 		{
 			auto tgt = target.type;
 			auto gvn = given.type;
@@ -36,7 +51,7 @@ namespace sst
 				else
 				{
 					soln->distance = -1;
-					return SimpleError::make(given.loc, "no valid cast from given type '%s' to target type '%s'", gvn, tgt);
+					return fail(quiet, given.loc, "no valid cast from given type '%s' to target type '%s'", gvn, tgt);
 				}
 			}
 			else
@@ -76,7 +91,7 @@ namespace sst
 								}
 								else
 								{
-									return SimpleError::make(given.loc, "conflicting solutions for type parameter '%s': previous: '%s', current: '%s'",
+									return fail(quiet, given.loc, "conflicting solutions for type parameter '%s': previous: '%s', current: '%s'",
 										ptt->getName(), ltt->str(), gvn);
 								}
 							}
@@ -104,7 +119,7 @@ namespace sst
 				{
 					// make sure they're the same 'kind' of type first.
 					if(tt->isFunctionType() != gt->isFunctionType() || tt->isTupleType() != gt->isTupleType())
-						return SimpleError::make(given.loc, "no valid conversion from given type '%s' to target type '%s'", gt, tt);
+						return fail(quiet, given.loc, "no valid conversion from given type '%s' to target type '%s'", gt, tt);
 
 					std::vector<ArgType> problem;
 					std::vector<ArgType> input;
@@ -132,7 +147,7 @@ namespace sst
 
 					// for recursive solving, we're never a function call.
 					// related: so, firstOptionalArgument is always -1 in these cases.
-					return solveSingleTypeList(soln, given.loc, problem, input, /* isFnCall: */ false);
+					return solveSingleTypeList(soln, given.loc, problem, input, /* isFnCall: */ false, quiet);
 				}
 				else
 				{
@@ -146,7 +161,7 @@ namespace sst
 
 
 		static ErrorMsg* solveSingleTypeList(Solution_t* soln, const Location& callLoc, const std::vector<ArgType>& target,
-			const std::vector<ArgType>& given, bool isFnCall)
+			const std::vector<ArgType>& given, bool isFnCall, bool quiet)
 		{
 			bool fvararg = (isFnCall && target.size() > 0 && target.back()->isVariadicArrayType());
 
@@ -194,7 +209,7 @@ namespace sst
 					}
 					else
 					{
-						return SimpleError::make(given[i].loc, "function has no parameter named '%s'", given[i].name);
+						return fail(quiet, given[i].loc, "function has no parameter named '%s'", given[i].name);
 					}
 
 					/*
@@ -264,10 +279,13 @@ namespace sst
 				if(given[i].name.empty())
 				{
 					if(didNames)
-						return SimpleError::make(given[i].loc, "positional arguments cannot appear after named arguments");
+						return fail(quiet, given[i].loc, "positional arguments cannot appear after named arguments");
 
 					else if(targ->optional)
 					{
+						if(quiet)
+							return getQuietFailure();
+
 						std::string probablyIntendedArgumentName;
 						for(const auto& a : target)
 						{
@@ -296,7 +314,7 @@ namespace sst
 				}
 
 				iceAssert(targ);
-				auto err = solveSingleType(soln, targ->toFLT(), given[i].toFLT());
+				auto err = solveSingleType(soln, targ->toFLT(), given[i].toFLT(), quiet);
 				if(err != nullptr) return err;
 
 				// possibly increase solution completion by re-substituting with new information
@@ -305,7 +323,11 @@ namespace sst
 
 			if(unsolvedtargets.size() > 0 || (!fvararg && given.size() > target.size()))
 			{
-				if(targetnames.empty() || given.size() > target.size())
+				if(quiet)
+				{
+					return getQuietFailure();
+				}
+				else if(targetnames.empty() || given.size() > target.size())
 				{
 					return SimpleError::make(callLoc, "expected %d %s, but %d %s provided",
 						target.size(), zfu::plural("argument", target.size()), given.size(), given.size() == 1 ? "was" : "were");
@@ -333,7 +355,7 @@ namespace sst
 					auto copy = *soln;
 
 					// ok, if we fulfil all the conditions to forward, then we forward.
-					auto err = solveSingleType(&copy, target.back().toFLT(), given.back().toFLT());
+					auto err = solveSingleType(&copy, target.back().toFLT(), given.back().toFLT(), quiet);
 					if(err == nullptr)
 					{
 						iceAssert(copy.distance >= 0);
@@ -353,8 +375,9 @@ namespace sst
 
 				for(size_t i = varArgStart; i < given.size(); i++)
 				{
-					auto err = solveSingleType(soln, ltvarty, given[i].toFLT());
-					if(err) return err->append(SimpleError::make(MsgType::Note, target.back().loc, "in argument of variadic parameter"));
+					auto err = solveSingleType(soln, ltvarty, given[i].toFLT(), quiet);
+					if(err && quiet)    return err;
+					else if(err)        return err->append(SimpleError::make(MsgType::Note, target.back().loc, "in argument of variadic parameter"));
 				}
 
 				// ok, everything should be good??
@@ -372,7 +395,7 @@ namespace sst
 
 
 		std::pair<Solution_t, ErrorMsg*> solveTypeList(const Location& callLoc, const std::vector<ArgType>& target,
-			const std::vector<ArgType>& given, const Solution_t& partial, bool isFnCall)
+			const std::vector<ArgType>& given, const Solution_t& partial, bool isFnCall, bool quiet)
 		{
 			Solution_t prevSoln = partial;
 
@@ -396,7 +419,7 @@ namespace sst
 				//* if we didn't reset the distance, it would just keep increasing to infinity (and overflow)
 				auto soln = prevSoln; soln.distance = 0;
 
-				auto errs = solveSingleTypeList(&soln, callLoc, target, given, isFnCall);
+				auto errs = solveSingleTypeList(&soln, callLoc, target, given, isFnCall, quiet);
 				if(errs) return { soln, errs };
 
 				if(soln == prevSoln)            { break; }
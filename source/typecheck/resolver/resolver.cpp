@@ -2,6 +2,8 @@
 // Copyright (c) 2017, zhiayang
 // Licensed under the Apache License Version 2.0.
 
+#include <optional>
+
 #include "sst.h"
 #include "errors.h"
 #include "ir/type.h"
@@ -13,6 +15,64 @@
 namespace sst {
 namespace resolver
 {
+	// the same function usually gets called with the same kinds of arguments over and over (eg. all the calls to
+	// print), so remember the overload distance for each (non-generic) candidate and the types and names of the
+	// arguments it was given. this only depends on the types, which are uniqued, so the pointers are enough.
+	struct CallShape
+	{
+		Defn* target = 0;
+		std::vector<std::tuple<fir::Type*, std::string, bool>> args;
+
+		bool operator == (const CallShape& other) const { return this->target == other.target && this->args == other.args; }
+	};
+}
+}
+
+namespace std
+{
+	template<>
+	struct hash<sst::resolver::CallShape>
+	{
+		size_t operator () (const sst::resolver::CallShape& cs) const
+		{
+			size_t ret = 0;
+			_hash_combine(ret, cs.target);
+
+			for(const auto& [ type, name, ignore ] : cs.args)
+			{
+				_hash_combine(ret, type);
+				_hash_combine(ret, name);
+				_hash_combine(ret, ignore);
+			}
+
+			return ret;
+		}
+	};
+}
+
+namespace sst {
+namespace resolver
+{
+	static util::hash_map<CallShape, int> overloadDistanceCache;
+
+	// returns std::nullopt if we can't cache this shape (eg. one of the arguments still needs inferring).
+	static std::optional<CallShape> getCallShape(Defn* target, const std::vector<FnCallArgument>& args)
+	{
+		CallShape ret;
+		ret.target = target;
+		ret.args.reserve(args.size());
+
+		for(const auto& a : args)
+		{
+			if(!a.value->type || a.value->type->containsPlaceholders())
+				return std::nullopt;
+
+			ret.args.push_back({ a.value->type, a.name, a.ignoreName });
+		}
+
+		return ret;
+	}
+
 	std::pair<int, ErrorMsg*> computeOverloadDistance(const Location& fnLoc, const std::vector<fir::LocatedType>& _target,
 		const std::vector<fir::LocatedType>& _args, bool cvararg, const Location& callLoc)
 	{
@@ -37,7 +97,7 @@ namespace resolver
 
 
 	std::pair<int, ErrorMsg*> computeNamedOverloadDistance(const Location& fnLoc, const std::vector<FnParam>& target,
-		const std::vector<FnCallArgument>& _args, bool cvararg, const Location& callLoc)
+		const std::vector<FnCallArgument>& _args, bool cvararg, const Location& callLoc, bool quiet)
 	{
 		std::vector<FnCallArgument> input;
 		if(cvararg) input = zfu::take(_args, target.size());
@@ -53,10 +113,10 @@ namespace resolver
 
 		auto [ soln, err1 ] = poly::solveTypeList(callLoc, zfu::map(target, [](const FnParam& p) -> poly::ArgType {
 			return poly::ArgType(p.name, p.type, p.loc, p.defaultVal != 0);
-		}), arguments, poly::Solution_t(), /* isFnCall: */ true);
+		}), arguments, poly::Solution_t(), /* isFnCall: */ true, quiet);
 
 
-		if(err1 != nullptr) return { -1, err1 };
+		if(err1 != nullptr) return { -1, quiet ? nullptr : err1 };
 		else                return { soln.distance, nullptr };
 	}
 
@@ -122,6 +182,9 @@ namespace resolver
 
 			int bestDist = INT_MAX;
 			std::map<Defn*, ErrorMsg*> fails;
+
+			// candidates that we know won't work, but don't have an error message for yet.
+			std::map<FunctionDecl*, std::vector<FnCallArgument>> unexplained;
 			std::vector<std::tuple<Defn*, std::vector<FnCallArgument>, int>> finals;
 
 			auto cands = _cands;
@@ -213,7 +276,24 @@ namespace resolver
 						}
 						else
 						{
-							std::tie(dist, fails[fn]) = computeNamedOverloadDistance(fn->loc, fn->params, replacementArgs, fn->isVarArg, callLoc);
+							// the distance is all we need for now; if it didn't work, we only need to know why when
+							// none of the others work either, so don't make the message until then.
+							auto shape = getCallShape(fn, replacementArgs);
+							if(auto it = (shape ? overloadDistanceCache.find(*shape) : overloadDistanceCache.end()); it != overloadDistanceCache.end())
+							{
+								dist = it->second;
+							}
+							else
+							{
+								dist = computeNamedOverloadDistance(fn->loc, fn->params, replacementArgs, fn->isVarArg, callLoc,
+									/* quiet: */ true).first;
+
+								if(shape) overloadDistanceCache[*shape] = dist;
+							}
+
+							fails[fn] = nullptr;
+							if(dist == -1)
+								unexplained[fn] = replacementArgs;
 						}
 					}
 
@@ -301,6 +381,9 @@ namespace resolver
 
 			if(finals.empty())
 			{
+				for(const auto& [ fn, args ] : unexplained)
+					fails[fn] = computeNamedOverloadDistance(fn->loc, fn->params, args, fn->isVarArg, callLoc).second;
+
 				auto err = createErrorFromFailedCandidates(fs, callLoc, cands[0].first->id.name, cands[0].second,
 					zfu::map(zfu::pairs(fails), [](auto p) -> std::pair<Locatable*, ErrorMsg*> {
 						return std::make_pair(p.first, p.second);
@@ -75,7 +75,7 @@ TCResult ast::StructDefn::generateDeclaration(sst::TypecheckState* fs, fir::Type
 		fs->typeDefnMap[str] = defn;
 	}
 
-	this->genericVersions.push_back({ defn, fs->getGenericContextStack() });
+	this->addGenericVersion(defn, fs->getGenericContextStack());
 	return TCResult(defn);
 }
 
@@ -59,60 +59,62 @@ namespace sst
 		std::string imported;
 	};
 
-	static void checkConflictingDefinitions(Location loc, const char* kind, const sst::StateTree* base, const sst::StateTree* branch,
-		std::optional<Location> importer = { }, std::optional<ExportMetadata> exporter = { })
+	static void checkConflictingDefinitions(Location loc, const char* kind, const std::vector<sst::Defn*>& base,
+		const std::vector<sst::Defn*>& branch, std::optional<Location> importer = { }, std::optional<ExportMetadata> exporter = { })
 	{
-		for(const auto& [ name, defns ] : base->definitions)
+		for(auto d1 : base)
 		{
-			if(auto it = branch->definitions.find(name); it != branch->definitions.end())
+			for(auto d2 : branch)
 			{
-				for(auto d1 : defns)
+				if(!definitionsConflict(d1, d2))
+					continue;
+
+				auto error = SimpleError::make(MsgType::Error, loc, "'%s' here introduces duplicate definitions:", kind);
+
+				if(d1 == d2)
 				{
-					for(auto d2 : it->second)
+					if(importer && exporter)
 					{
-						if(!definitionsConflict(d1, d2))
-							continue;
+						error->append(SimpleError::make(MsgType::Note, exporter->loc,
+							"this public import (from the imported module '%s') brings '%s' into scope ...",
+							exporter->module, exporter->imported));
 
-						auto error = SimpleError::make(MsgType::Error, loc, "'%s' here introduces duplicate definitions:", kind);
-
-						if(d1 == d2)
-						{
-							if(importer && exporter)
-							{
-								error->append(SimpleError::make(MsgType::Note, exporter->loc,
-									"this public import (from the imported module '%s') brings '%s' into scope ...",
-									exporter->module, exporter->imported));
-
-								error->append(SimpleError::make(MsgType::Note, *importer,
-									"... which conflicts with this using/import statement here:"));
-							}
-							else if(importer)
-							{
-								error->append(SimpleError::make(MsgType::Note, *importer,
-									"most likely caused by this import here:"));
-							}
-							else if(exporter)
-							{
-								error->append(SimpleError::make(MsgType::Note, exporter->loc,
-									"most likely caused by this public import here, in module '%s':", exporter->module));
-							}
-
-							error->append(SimpleError::make(MsgType::Note, d1->loc, "for reference, here is the (first) "
-								"conflicting definition:"));
-						}
-						else
-						{
-							error->append(SimpleError::make(MsgType::Note, d1->loc, "first definition here:"))
-								->append(SimpleError::make(MsgType::Note, d2->loc, "second definition here:"));
-						}
-
-						error->postAndQuit();
+						error->append(SimpleError::make(MsgType::Note, *importer,
+							"... which conflicts with this using/import statement here:"));
+					}
+					else if(importer)
+					{
+						error->append(SimpleError::make(MsgType::Note, *importer,
+							"most likely caused by this import here:"));
 					}
+					else if(exporter)
+					{
+						error->append(SimpleError::make(MsgType::Note, exporter->loc,
+							"most likely caused by this public import here, in module '%s':", exporter->module));
+					}
+
+					error->append(SimpleError::make(MsgType::Note, d1->loc, "for reference, here is the (first) "
+						"conflicting definition:"));
+				}
+				else
+				{
+					error->append(SimpleError::make(MsgType::Note, d1->loc, "first definition here:"))
+						->append(SimpleError::make(MsgType::Note, d2->loc, "second definition here:"));
 				}
+
+				error->postAndQuit();
 			}
 		}
 	}
 
+	static std::optional<Location> getImportInfo(const sst::StateTree* base, const sst::StateTree* import)
+	{
+		if(auto it = base->importMetadata.find(import); it != base->importMetadata.end())
+			return it->second;
+
+		return { };
+	}
+
 	static std::optional<ExportMetadata> getExportInfo(const sst::StateTree* base, const sst::StateTree* branch)
 	{
 		if(auto it = base->reexportMetadata.find(branch); it != base->reexportMetadata.end())
@@ -126,68 +128,59 @@ namespace sst
 		return { };
 	}
 
-	static void checkExportsRecursively(const Location& loc, const char* kind, sst::StateTree* base, sst::StateTree* branch,
-		std::optional<Location> importer = { }, std::optional<ExportMetadata> exporter = { })
-	{
-		if(branch->isAnonymous || branch->isCompilerGenerated)
-			return;
-
-		checkConflictingDefinitions(loc, kind, base, branch, importer, exporter);
-
-		for(auto exp : base->reexports)
-			checkExportsRecursively(loc, kind, exp, branch, importer, getExportInfo(base, exp));
-	}
-
 	void mergeExternalTree(const Location& loc, const char* kind, sst::StateTree* base, sst::StateTree* branch)
 	{
 		if(branch->isAnonymous || branch->isCompilerGenerated)
 			return;
 
-		// first check conflicts for this level:
-		checkConflictingDefinitions(loc, kind, base, branch);
+		// we need to check the new tree, and every one of *their* public imports, against the things in our tree,
+		// the things in our imports, and (recursively) every re-export of those. the last two are already flattened
+		// into base->importedDefinitions, so we only need to look at each incoming name once.
+		std::vector<sst::StateTree*> incoming = { branch };
+		incoming.insert(incoming.end(), branch->reexports.begin(), branch->reexports.end());
 
-		// then, for every one of *our* imports:
-		for(auto import : base->imports)
+		for(auto tree : incoming)
 		{
-			std::optional<Location> importer;
-			if(auto it = base->importMetadata.find(import); it != base->importMetadata.end())
-				importer = it->second;
-
-			// check that the new tree doesn't trample over it.
-			checkConflictingDefinitions(loc, kind, import, branch, importer);
-
-			// then, recursively check every single re-export on *our* side for conflicts:
-			for(auto rexp : import->reexports)
-				checkExportsRecursively(loc, kind, rexp, branch, importer, getExportInfo(import, rexp));
-
-			// then, also check that, for every one of *their* public imports:
-			for(auto rexp : branch->reexports)
+			bool isReexport = (tree != branch);
+			for(const auto& [ name, defns ] : tree->definitions)
 			{
-				auto exportInfo = getExportInfo(import, rexp);
-
-				// it doesn't trample with anything in our tree,
-				checkConflictingDefinitions(loc, kind, base, rexp, importer, exportInfo);
-
-				// and it doesn't conflict with anything in our imports.
-				checkConflictingDefinitions(loc, kind, import, rexp, importer, exportInfo);
+				// first check conflicts for this level. (their re-exports are only checked against us if we
+				// have imports of our own; the notes come from the first one.)
+				if(auto it = base->definitions.find(name); it != base->definitions.end())
+				{
+					if(!isReexport)
+					{
+						checkConflictingDefinitions(loc, kind, it->second, defns);
+					}
+					else if(!base->imports.empty())
+					{
+						auto import = base->imports.front();
+						checkConflictingDefinitions(loc, kind, it->second, defns, getImportInfo(base, import),
+							getExportInfo(import, tree));
+					}
+				}
 
-				// finally, also check that, for every one of *our* imports' re-exports,
-				for(auto rexp2 : import->reexports)
+				// then, check that it doesn't trample over any of our imports.
+				if(auto it = base->importedDefinitions.find(name); it != base->importedDefinitions.end())
 				{
-					auto exportInfo = getExportInfo(import, rexp2);
+					for(const auto& imp : it->second)
+					{
+						// for their re-exports, we only go one level into our imports' re-exports.
+						if(isReexport && imp.exporter && imp.exporter != imp.import)
+							continue;
 
-					// check that *they* don't trample anything:
-					checkConflictingDefinitions(loc, kind, rexp2, branch, importer, exportInfo);
+						std::optional<ExportMetadata> exportInfo;
+						if(imp.exporter)        exportInfo = getExportInfo(imp.exporter, imp.source);
+						else if(isReexport)     exportInfo = getExportInfo(imp.import, tree);
 
-					// and neither does their reexport:
-					checkConflictingDefinitions(loc, kind, rexp2, rexp, importer, exportInfo);
+						checkConflictingDefinitions(loc, kind, { imp.defn }, defns, getImportInfo(base, imp.import), exportInfo);
+					}
 				}
 			}
 		}
 
 		// no problem -- attach the trees
-		base->imports.push_back(branch);
-		base->importMetadata[branch] = loc;
+		base->addImport(branch, loc);
 
 		// merge the subtrees as well.
 		for(const auto& [ name, tr ] : branch->subtrees)
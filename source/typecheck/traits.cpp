@@ -52,7 +52,7 @@ TCResult ast::TraitDefn::generateDeclaration(sst::TypecheckState* fs, fir::Type*
 		fs->typeDefnMap[str] = defn;
 	}
 
-	this->genericVersions.push_back({ defn, fs->getGenericContextStack() });
+	this->addGenericVersion(defn, fs->getGenericContextStack());
 	return TCResult(defn);
 }
 
@@ -255,6 +255,48 @@ namespace sst
 	void StateTree::addDefinition(const std::string& name, Defn* def, const TypeParamMap_t& gmaps)
 	{
 		this->definitions[name].push_back(def);
+
+		for(auto [ tree, imp ] : this->importedBy)
+		{
+			imp.defn = def;
+			tree->importedDefinitions[name].push_back(imp);
+		}
+	}
+
+	void StateTree::addImport(StateTree* tree, const Location& loc)
+	{
+		this->imports.push_back(tree);
+		this->importMetadata[tree] = loc;
+
+		// the tree itself, then everything it re-exports, all the way down. this goes breadth-first, so each tree
+		// is recorded through the shortest path to it -- mergeExternalTree() only looks one level into re-exports,
+		// so a direct re-export that we first reached through a longer path would get missed.
+		std::unordered_set<StateTree*> seen;
+		std::vector<std::pair<StateTree*, StateTree*>> worklist = { { tree, nullptr } };
+
+		for(size_t i = 0; i < worklist.size(); i++)
+		{
+			auto [ source, exporter ] = worklist[i];
+			if(!seen.insert(source).second)
+				continue;
+
+			auto imp = ImportedDefn { /* defn: */ 0, /* import: */ tree, /* source: */ source, /* exporter: */ exporter };
+			for(const auto& [ name, defns ] : source->definitions)
+			{
+				auto& list = this->importedDefinitions[name];
+				for(auto d : defns)
+				{
+					imp.defn = d;
+					list.push_back(imp);
+				}
+			}
+
+			imp.defn = 0;
+			source->importedBy.push_back({ this, imp });
+
+			for(auto rexp : source->reexports)
+				worklist.push_back({ rexp, source });
+		}
 	}
 
 
@@ -51,7 +51,7 @@ TCResult ast::UnionDefn::generateDeclaration(sst::TypecheckState* fs, fir::Type*
 
 	defn->enclosingScope.stree->addDefinition(defnname, defn, gmaps);
 
-	this->genericVersions.push_back({ defn, fs->getGenericContextStack() });
+	this->addGenericVersion(defn, fs->getGenericContextStack());
 
 	fs->typeDefnMap[defn->type] = defn;
 	return TCResult(defn);